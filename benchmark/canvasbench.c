@@ -0,0 +1,122 @@
+// Benchmark of the retained canvas (touchpad/canvas.h) against canvas size
+// and amount of ink. For every new segment it compares
+//   replay:      clear the canvas and draw every segment again (what WM_PAINT
+//                did before the backbuffer)
+//   incremental: draw the new segment into the backbuffer and copy its dirty
+//                rectangle to a second framebuffer (the blit of WM_PAINT)
+//
+//   gcc -O2 -I../touchpad -o canvasbench canvasbench.c ../touchpad/canvas.c ../touchpad/segmentgrid.c ../touchpad/stroke.c ../touchpad/point2d.c ../touchpad/threading.c ../touchpad/utils.c ../touchpad/hashindex.c ../touchpad/hiddecoder.c -lm -lpthread
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "canvas.h"
+#include "stroke.h"
+
+#define STROKE_WIDTH 20.0f
+
+// build numStrokes random walks of pointsPerStroke points inside the canvas
+static void mBuildStrokes(StrokeList* strokes, int width, int height, unsigned int numStrokes, unsigned int pointsPerStroke)
+{
+  unsigned int randomState = 7;
+#define NEXT_RANDOM() (randomState = (randomState * 1103515245u) + 12345u, (randomState >> 16) & 0x7fff)
+
+  for (unsigned int strokeIdx = 0; strokeIdx < numStrokes; strokeIdx++)
+  {
+    Point2D point = (Point2D){.X = NEXT_RANDOM() % width, .Y = NEXT_RANDOM() % height};
+    mCreateNewStroke(point, strokes);
+
+    for (unsigned int pointIdx = 1; pointIdx < pointsPerStroke; pointIdx++)
+    {
+      long x = (long)point.X + (long)(NEXT_RANDOM() % 13) - 6;
+      long y = (long)point.Y + (long)(NEXT_RANDOM() % 13) - 6;
+
+      point.X = (ULONG)((x < 0) ? 0 : ((x >= width) ? (width - 1) : x));
+      point.Y = (ULONG)((y < 0) ? 0 : ((y >= height) ? (height - 1) : y));
+      mAppendPoint2DToLastStroke(point, strokes);
+    }
+  }
+#undef NEXT_RANDOM
+}
+
+static void mBlitDirtyRect(const CANVAS* canvas, unsigned int* window, const RECT* dirtyRect)
+{
+  size_t cbRow = sizeof(unsigned int) * (size_t)(dirtyRect->right - dirtyRect->left);
+
+  for (int y = dirtyRect->top; y < dirtyRect->bottom; y++)
+  {
+    size_t offset = ((size_t)y * canvas->Stride) + dirtyRect->left;
+    memcpy(window + offset, canvas->Pixels + offset, cbRow);
+  }
+}
+
+int main()
+{
+  const int sizes[3][2]              = {{720, 480}, {1920, 1080}, {3840, 2160}};
+  const unsigned int strokeCounts[3] = {10, 100, 1000};
+  const unsigned int pointsPerStroke = 50;
+  const unsigned int numNewSegments  = 200;
+
+  printf("%-11s %8s %18s %18s %8s\n", "canvas", "strokes", "replay us/seg", "incremental us/seg", "speedup");
+
+  for (unsigned int sizeIdx = 0; sizeIdx < 3; sizeIdx++)
+  {
+    int width  = sizes[sizeIdx][0];
+    int height = sizes[sizeIdx][1];
+
+    unsigned int* pixels = (unsigned int*)mMalloc(sizeof(unsigned int) * width * height, __FILE__, __LINE__);
+    unsigned int* window = (unsigned int*)mMalloc(sizeof(unsigned int) * width * height, __FILE__, __LINE__);
+
+    for (unsigned int countIdx = 0; countIdx < 3; countIdx++)
+    {
+      StrokeList strokes;
+      memset(&strokes, 0, sizeof(StrokeList));
+      mBuildStrokes(&strokes, width, height, strokeCounts[countIdx], pointsPerStroke);
+
+      CANVAS canvas;
+      mInitializeCanvas(&canvas, pixels, width, height, width);
+
+      // replay everything for each new segment, fewer iterations because it is slow
+      unsigned int numReplays = (strokeCounts[countIdx] >= 1000) ? 5 : 20;
+      unsigned long long time = mGetTimestamp();
+      for (unsigned int replayIdx = 0; replayIdx < numReplays; replayIdx++)
+      {
+        RECT dirtyRect;
+        mFillCanvas(&canvas, CANVAS_COLOR(0, 0, 0));
+        mDrawCanvasStrokes(&canvas, &strokes, STROKE_WIDTH, CANVAS_COLOR(255, 255, 255));
+        mTakeCanvasDirtyRect(&canvas, &dirtyRect);
+        mBlitDirtyRect(&canvas, window, &dirtyRect);
+      }
+      double replayMicroseconds = (double)(mGetTimestamp() - time) * 1e6 / (double)mGetTimestampFrequency() / numReplays;
+
+      // draw only the new segments of the last stroke
+      StrokeIndexEntry lastStroke = strokes.Entries[strokes.Size - 1];
+      Point2D* lastStrokePoints   = mGetStrokePoints(&strokes, strokes.Size - 1);
+
+      time = mGetTimestamp();
+      for (unsigned int segmentIdx = 0; segmentIdx < numNewSegments; segmentIdx++)
+      {
+        unsigned int pointIdx = 1 + (segmentIdx % (lastStroke.Size - 1));
+        RECT dirtyRect;
+        mDrawCanvasSegment(&canvas, lastStrokePoints[pointIdx - 1], lastStrokePoints[pointIdx], STROKE_WIDTH, CANVAS_COLOR(255, 255, 255));
+        mTakeCanvasDirtyRect(&canvas, &dirtyRect);
+        mBlitDirtyRect(&canvas, window, &dirtyRect);
+      }
+      double incrementalMicroseconds = (double)(mGetTimestamp() - time) * 1e6 / (double)mGetTimestampFrequency() / numNewSegments;
+
+      printf("%4dx%-6d %8u %18.1f %18.2f %7.0fx\n", width, height, strokeCounts[countIdx], replayMicroseconds, incrementalMicroseconds, replayMicroseconds / incrementalMicroseconds);
+
+      mFreeStrokeList(&strokes);
+    }
+
+    free(pixels);
+    free(window);
+  }
+
+  return 0;
+}
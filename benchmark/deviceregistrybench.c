@@ -0,0 +1,405 @@
+// Test and benchmark of the device registry (touchpad/deviceregistry.h) and
+// the hash index under it (touchpad/hashindex.h) with synthetic device
+// handles. Every operation is mirrored in a plain array that is searched
+// linearly, and the registry must return the same device index or the same
+// miss:
+//   churn      random adds, overwrites, removals and lookups (including
+//              handles that were removed, like Windows reusing a handle)
+//              while the index grows from empty
+//   collisions handles whose hashes share their low bits, so they have the
+//              same home slot at every capacity up to 1024, with their probe
+//              sequences wrapping around the end of the slots, removed in
+//              random order (backward shift deletion) with every remaining
+//              handle looked up after each removal
+// Then the lookup that WM_INPUT does per message is timed against a linear
+// scan for a few registry sizes. It exits with -1 on the first difference.
+//
+//   gcc -O2 -I../touchpad -o deviceregistrybench deviceregistrybench.c ../touchpad/deviceregistry.c ../touchpad/hashindex.c ../touchpad/hiddecoder.c ../touchpad/threading.c ../touchpad/utils.c -lpthread
+//
+// Usage: deviceregistrybench [--operations <count>]
+//   --operations random operations of the churn test (default 1000000)
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "hashindex.h"
+#include "deviceregistry.h"
+
+// synthetic handles are aligned like the pointers that Windows hands out
+#define HANDLE_BASE      0x10000
+#define HANDLE_ALIGNMENT 8
+// the churn test draws its handles from this many so that they are reused
+#define NUM_CHURN_HANDLES 1024
+// the whole registry is compared with the reference this often
+#define CHURN_CHECK_INTERVAL 1000
+
+#define NUM_COLLIDING_HANDLES 64
+#define COLLIDING_HASH_BITS   10
+#define NUM_LOOKUPS           4000000
+
+// the array that the registry replaces
+struct REFERENCE_REGISTRY
+{
+  void** Handles;
+  unsigned int* DeviceIndices;
+  unsigned int Size;
+};
+
+typedef struct REFERENCE_REGISTRY REFERENCE_REGISTRY;
+
+static unsigned int s_randomState = 12345;
+
+static unsigned int mNextRandom()
+{
+  s_randomState = (s_randomState * 1103515245u) + 12345u;
+  return (s_randomState >> 8) & 0xffffff;
+}
+
+static void* mGetSyntheticHandle(unsigned int handleIdx)
+{
+  return (void*)(size_t)(HANDLE_BASE + ((size_t)handleIdx * HANDLE_ALIGNMENT));
+}
+
+// a copy of the key mix of hashindex.c to pick handles with the same home slot
+static unsigned long long mMixHandle(void* handle)
+{
+  unsigned long long key = (unsigned long long)(size_t)handle;
+  key ^= key >> 30;
+  key *= 0xBF58476D1CE4E5B9ULL;
+  key ^= key >> 27;
+  key *= 0x94D049BB133111EBULL;
+  key ^= key >> 31;
+  return key;
+}
+
+static void mInitializeReferenceRegistry(unsigned int capacity, REFERENCE_REGISTRY* reference)
+{
+  reference->Handles       = (void**)mMalloc(sizeof(void*) * capacity, __FILE__, __LINE__);
+  reference->DeviceIndices = (unsigned int*)mMalloc(sizeof(unsigned int) * capacity, __FILE__, __LINE__);
+  reference->Size          = 0;
+}
+
+static void mFreeReferenceRegistry(REFERENCE_REGISTRY* reference)
+{
+  free(reference->Handles);
+  free(reference->DeviceIndices);
+  memset(reference, 0, sizeof(REFERENCE_REGISTRY));
+}
+
+static int mFindInReference(const REFERENCE_REGISTRY* reference, void* handle, unsigned int* deviceIdx)
+{
+  for (unsigned int entryIdx = 0; entryIdx < reference->Size; entryIdx++)
+  {
+    if (reference->Handles[entryIdx] == handle)
+    {
+      (*deviceIdx) = reference->DeviceIndices[entryIdx];
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+static void mAddToReference(REFERENCE_REGISTRY* reference, void* handle, unsigned int deviceIdx)
+{
+  for (unsigned int entryIdx = 0; entryIdx < reference->Size; entryIdx++)
+  {
+    if (reference->Handles[entryIdx] == handle)
+    {
+      reference->DeviceIndices[entryIdx] = deviceIdx;
+      return;
+    }
+  }
+
+  reference->Handles[reference->Size]       = handle;
+  reference->DeviceIndices[reference->Size] = deviceIdx;
+  reference->Size++;
+}
+
+static int mRemoveFromReference(REFERENCE_REGISTRY* reference, void* handle)
+{
+  for (unsigned int entryIdx = 0; entryIdx < reference->Size; entryIdx++)
+  {
+    if (reference->Handles[entryIdx] == handle)
+    {
+      reference->Size--;
+      reference->Handles[entryIdx]       = reference->Handles[reference->Size];
+      reference->DeviceIndices[entryIdx] = reference->DeviceIndices[reference->Size];
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+// the registry must give the same answer as the reference for the handle
+static int mCheckHandle(DEVICE_REGISTRY* registry, const REFERENCE_REGISTRY* reference, void* handle)
+{
+  unsigned int deviceIdx          = (unsigned int)-2;
+  unsigned int referenceDeviceIdx = (unsigned int)-2;
+  int retval                      = mFindDeviceInRegistry(registry, handle, &deviceIdx);
+  int referenceRetval             = mFindInReference(reference, handle, &referenceDeviceIdx);
+
+  if ((retval != referenceRetval) || ((retval == 0) && (deviceIdx != referenceDeviceIdx)))
+  {
+    printf(FG_RED);
+    printf("Handle %p: the registry returned %d (device %u) instead of %d (device %u)\n", handle, retval, deviceIdx, referenceRetval, referenceDeviceIdx);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  return 0;
+}
+
+static int mCheckRegistry(DEVICE_REGISTRY* registry, const REFERENCE_REGISTRY* reference)
+{
+  if (registry->HandleIndex.Size != reference->Size)
+  {
+    printf(FG_RED);
+    printf("The registry holds %u handles instead of %u\n", registry->HandleIndex.Size, reference->Size);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  for (unsigned int entryIdx = 0; entryIdx < reference->Size; entryIdx++)
+  {
+    if (mCheckHandle(registry, reference, reference->Handles[entryIdx]) != 0)
+    {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static int mRunChurnTest(unsigned int numOperations)
+{
+  DEVICE_REGISTRY registry;
+  memset(&registry, 0, sizeof(DEVICE_REGISTRY));
+
+  REFERENCE_REGISTRY reference;
+  mInitializeReferenceRegistry(NUM_CHURN_HANDLES, &reference);
+
+  unsigned int maxSize = 0;
+  int retval           = 0;
+
+  for (unsigned int operationIdx = 0; (retval == 0) && (operationIdx < numOperations); operationIdx++)
+  {
+    // the set of live handles slowly moves through the handle range so that
+    // the registry grows, shrinks and sees removed handles again
+    unsigned int window    = 64 + ((operationIdx / 1024) % (NUM_CHURN_HANDLES - 64));
+    void* handle           = mGetSyntheticHandle(mNextRandom() % window);
+    unsigned int operation = mNextRandom() % 8;
+
+    if (operation < 3)
+    {
+      unsigned int deviceIdx = mNextRandom() % 16;
+      mAddDeviceToRegistry(&registry, handle, deviceIdx);
+      mAddToReference(&reference, handle, deviceIdx);
+    }
+    else if (operation < 5)
+    {
+      mRemoveDeviceFromRegistry(&registry, handle);
+      mRemoveFromReference(&reference, handle);
+    }
+
+    retval = mCheckHandle(&registry, &reference, handle);
+
+    if ((retval == 0) && ((operationIdx % CHURN_CHECK_INTERVAL) == 0))
+    {
+      retval = mCheckRegistry(&registry, &reference);
+    }
+
+    maxSize = (reference.Size > maxSize) ? reference.Size : maxSize;
+  }
+
+  if (retval == 0)
+  {
+    retval = mCheckRegistry(&registry, &reference);
+  }
+
+  if (retval == 0)
+  {
+    printf("churn: %u operations, up to %u handles, %u slots\n", numOperations, maxSize, registry.HandleIndex.Capacity);
+  }
+
+  mFreeDeviceRegistry(&registry);
+  mFreeReferenceRegistry(&reference);
+
+  return retval;
+}
+
+static int mRunCollisionTest()
+{
+  // handles whose home slot is one of the last 4 slots at every capacity up to 2^COLLIDING_HASH_BITS
+  void* handles[NUM_COLLIDING_HANDLES];
+  unsigned int numHandles = 0;
+  unsigned long long mask = (1ULL << COLLIDING_HASH_BITS) - 1;
+
+  for (unsigned int handleIdx = 0; numHandles < NUM_COLLIDING_HANDLES; handleIdx++)
+  {
+    void* handle = mGetSyntheticHandle(handleIdx);
+    if ((mMixHandle(handle) & mask) >= (mask - 3))
+    {
+      handles[numHandles++] = handle;
+    }
+  }
+
+  DEVICE_REGISTRY registry;
+  memset(&registry, 0, sizeof(DEVICE_REGISTRY));
+
+  REFERENCE_REGISTRY reference;
+  mInitializeReferenceRegistry(NUM_COLLIDING_HANDLES, &reference);
+
+  int retval = 0;
+
+  for (unsigned int roundIdx = 0; (retval == 0) && (roundIdx < 100); roundIdx++)
+  {
+    // insert the handles in random order, growing from the minimum capacity in the first round
+    for (unsigned int handleIdx = 0; handleIdx < NUM_COLLIDING_HANDLES; handleIdx++)
+    {
+      unsigned int swapIdx = handleIdx + (mNextRandom() % (NUM_COLLIDING_HANDLES - handleIdx));
+      void* handle         = handles[swapIdx];
+      handles[swapIdx]     = handles[handleIdx];
+      handles[handleIdx]   = handle;
+    }
+
+    for (unsigned int handleIdx = 0; (retval == 0) && (handleIdx < NUM_COLLIDING_HANDLES); handleIdx++)
+    {
+      mAddDeviceToRegistry(&registry, handles[handleIdx], handleIdx + roundIdx);
+      mAddToReference(&reference, handles[handleIdx], handleIdx + roundIdx);
+      retval = mCheckRegistry(&registry, &reference);
+    }
+
+    // remove them in another order and look up all the others after every removal
+    for (unsigned int handleIdx = 0; (retval == 0) && (handleIdx < NUM_COLLIDING_HANDLES); handleIdx++)
+    {
+      unsigned int removeIdx = (handleIdx * 37) % NUM_COLLIDING_HANDLES;
+
+      if (mRemoveFromHashIndex(&registry.HandleIndex, (unsigned long long)(size_t)handles[removeIdx]) != 0)
+      {
+        printf(FG_RED);
+        printf("Handle %p was not found for the removal\n", handles[removeIdx]);
+        printf(RESET_COLOR);
+        retval = -1;
+        break;
+      }
+
+      mRemoveFromReference(&reference, handles[removeIdx]);
+
+      // a second removal must miss
+      if (mRemoveFromHashIndex(&registry.HandleIndex, (unsigned long long)(size_t)handles[removeIdx]) != -1)
+      {
+        printf(FG_RED);
+        printf("Handle %p was removed twice\n", handles[removeIdx]);
+        printf(RESET_COLOR);
+        retval = -1;
+        break;
+      }
+
+      retval = mCheckRegistry(&registry, &reference);
+      for (unsigned int checkIdx = 0; (retval == 0) && (checkIdx < NUM_COLLIDING_HANDLES); checkIdx++)
+      {
+        retval = mCheckHandle(&registry, &reference, handles[checkIdx]);
+      }
+    }
+  }
+
+  if (retval == 0)
+  {
+    printf("collisions: %u handles with the same home slot, %u slots\n", NUM_COLLIDING_HANDLES, registry.HandleIndex.Capacity);
+  }
+
+  mFreeDeviceRegistry(&registry);
+  mFreeReferenceRegistry(&reference);
+
+  return retval;
+}
+
+static void mMeasureLookups(unsigned int numDevices)
+{
+  DEVICE_REGISTRY registry;
+  memset(&registry, 0, sizeof(DEVICE_REGISTRY));
+
+  REFERENCE_REGISTRY reference;
+  mInitializeReferenceRegistry(numDevices, &reference);
+
+  for (unsigned int deviceIdx = 0; deviceIdx < numDevices; deviceIdx++)
+  {
+    mAddDeviceToRegistry(&registry, mGetSyntheticHandle(deviceIdx * 13), deviceIdx);
+    mAddToReference(&reference, mGetSyntheticHandle(deviceIdx * 13), deviceIdx);
+  }
+
+  // the messages come from a random device
+  unsigned int checksum        = 0;
+  unsigned long long startTime = mGetTimestamp();
+
+  for (unsigned int lookupIdx = 0; lookupIdx < NUM_LOOKUPS; lookupIdx++)
+  {
+    unsigned int deviceIdx = 0;
+    mFindDeviceInRegistry(&registry, mGetSyntheticHandle((lookupIdx % numDevices) * 13), &deviceIdx);
+    checksum += deviceIdx;
+  }
+
+  double registrySeconds = (double)(mGetTimestamp() - startTime) / (double)mGetTimestampFrequency();
+  startTime              = mGetTimestamp();
+
+  for (unsigned int lookupIdx = 0; lookupIdx < NUM_LOOKUPS; lookupIdx++)
+  {
+    unsigned int deviceIdx = 0;
+    mFindInReference(&reference, mGetSyntheticHandle((lookupIdx % numDevices) * 13), &deviceIdx);
+    checksum -= deviceIdx;
+  }
+
+  double referenceSeconds = (double)(mGetTimestamp() - startTime) / (double)mGetTimestampFrequency();
+
+  printf("%7u %12.1f %12.1f%s\n", numDevices, registrySeconds * 1e9 / NUM_LOOKUPS, referenceSeconds * 1e9 / NUM_LOOKUPS, (checksum == 0) ? "" : " (different devices)");
+
+  mFreeDeviceRegistry(&registry);
+  mFreeReferenceRegistry(&reference);
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned int numOperations = 1000000;
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--operations") == 0) && ((argIdx + 1) < argc))
+    {
+      numOperations = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else
+    {
+      numOperations = 0;
+      break;
+    }
+  }
+
+  if (numOperations == 0)
+  {
+    printf("Usage: %s [--operations <count>]\n", argv[0]);
+    return -1;
+  }
+
+  if ((mRunChurnTest(numOperations) != 0) || (mRunCollisionTest() != 0))
+  {
+    return -1;
+  }
+
+  printf("%7s %12s %12s\n", "devices", "registry ns", "linear ns");
+  mMeasureLookups(4);
+  mMeasureLookups(16);
+  mMeasureLookups(256);
+
+  printf(FG_GREEN);
+  printf("The registry matches the linear scan: OK\n");
+  printf(RESET_COLOR);
+
+  return 0;
+}
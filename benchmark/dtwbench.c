@@ -0,0 +1,295 @@
+// Equivalence check and throughput of the banded DTW kernel (touchpad/dtw.h).
+//
+// The anti-diagonal kernel is compared with the row by row reference on random
+// sequences of every length up to DTW_MAX_POINTS, with windows from 0 to wider
+// than the sequence and 1 to DTW_MAX_CHANNELS channels. It also checks that
+// LB_Keogh is never above the distance and that an abandoned distance is never
+// below the bound.
+//
+// Then random strokes (x, y and the direction, like the features of the
+// recognizer) are searched for the nearest of NUM_REFERENCES references with
+// the reference implementation, with the kernel, with the kernel abandoning at
+// the nearest distance so far and with LB_Keogh in front of it. The nearest
+// reference must be the same for all of them.
+//
+//   gcc -O2 -I../touchpad -o dtwbench dtwbench.c ../touchpad/dtw.c ../touchpad/threading.c ../touchpad/utils.c ../touchpad/hashindex.c ../touchpad/hiddecoder.c -lm -lpthread
+//   (add -mavx2 for the AVX2 kernel or -DDTW_DISABLE_SIMD for the scalar one)
+//
+// Usage: dtwbench [--queries <count>]
+#include "platform.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "dtw.h"
+
+#define NUM_EQUIVALENCE_TRIALS 20000
+#define NUM_REFERENCES 2000
+#define NUM_STROKE_CHANNELS 4
+// the relative difference allowed between the kernel and the reference (the sums are not added in the same order)
+#define MAX_RELATIVE_ERROR 1e-4f
+
+static unsigned int g_random_state = 2136;
+
+static float mRandomFloat()
+{
+  g_random_state = (g_random_state * 1103515245u) + 12345u;
+  return (float)((g_random_state >> 8) & 0xffff) / 65535.0f;
+}
+
+// the values after the sequence are NaN so that reading them spoils the distance
+static void mBuildRandomSequence(const DTW_PARAMETERS* parameters, float* sequence)
+{
+  for (unsigned int valueIdx = 0; valueIdx < (DTW_MAX_POINTS * DTW_MAX_CHANNELS); valueIdx++)
+  {
+    sequence[valueIdx] = (valueIdx < (parameters->NumPoints * parameters->NumChannels)) ? (mRandomFloat() - 0.5f) : NAN;
+  }
+}
+
+// a smooth random stroke in the unit square, planar x, y, direction x and direction y
+static void mBuildRandomStroke(const DTW_PARAMETERS* parameters, float* stroke)
+{
+  unsigned int numPoints = parameters->NumPoints;
+  float x                = mRandomFloat();
+  float y                = mRandomFloat();
+  float angle            = 6.2831853f * mRandomFloat();
+  float turn             = 0.2f * (mRandomFloat() - 0.5f);
+  float step             = (0.3f + (0.7f * mRandomFloat())) / (float)numPoints;
+
+  for (unsigned int pointIdx = 0; pointIdx < numPoints; pointIdx++)
+  {
+    stroke[pointIdx]                   = x;
+    stroke[numPoints + pointIdx]       = y;
+    stroke[(2 * numPoints) + pointIdx] = cosf(angle);
+    stroke[(3 * numPoints) + pointIdx] = sinf(angle);
+
+    x += step * cosf(angle);
+    y += step * sinf(angle);
+    angle += turn;
+    turn += 0.05f * (mRandomFloat() - 0.5f);
+  }
+}
+
+// the reference stroke written again: shifted, with noise and a different speed along the stroke
+static void mBuildQueryStroke(const DTW_PARAMETERS* parameters, const float* reference, float* query)
+{
+  unsigned int numPoints = parameters->NumPoints;
+  float shiftX           = 0.05f * (mRandomFloat() - 0.5f);
+  float shiftY           = 0.05f * (mRandomFloat() - 0.5f);
+  float warp             = 0.6f * (mRandomFloat() - 0.5f);
+
+  for (unsigned int pointIdx = 0; pointIdx < numPoints; pointIdx++)
+  {
+    float t          = (float)pointIdx / (float)(numPoints - 1);
+    float warped     = t + (warp * t * (1.0f - t));
+    unsigned int idx = (unsigned int)((warped * (float)(numPoints - 1)) + 0.5f);
+    idx              = (idx > (numPoints - 1)) ? (numPoints - 1) : idx;
+
+    for (unsigned int channelIdx = 0; channelIdx < NUM_STROKE_CHANNELS; channelIdx++)
+    {
+      float noise                                = 0.01f * (mRandomFloat() - 0.5f);
+      query[(channelIdx * numPoints) + pointIdx] = reference[(channelIdx * numPoints) + idx] + noise;
+    }
+
+    query[pointIdx] += shiftX;
+    query[numPoints + pointIdx] += shiftY;
+  }
+}
+
+static int mIsSameDistance(float distance, float referenceDistance)
+{
+  return fabsf(distance - referenceDistance) <= (MAX_RELATIVE_ERROR * (1.0f + referenceDistance));
+}
+
+// returns the number of failed trials
+static unsigned int mCheckEquivalence()
+{
+  unsigned int numFailures = 0;
+  float query[DTW_MAX_POINTS * DTW_MAX_CHANNELS];
+  float reversedQuery[DTW_MAX_POINTS * DTW_MAX_CHANNELS];
+  float reference[DTW_MAX_POINTS * DTW_MAX_CHANNELS];
+  float lower[DTW_MAX_POINTS * DTW_MAX_CHANNELS];
+  float upper[DTW_MAX_POINTS * DTW_MAX_CHANNELS];
+
+  for (unsigned int trialIdx = 0; trialIdx < NUM_EQUIVALENCE_TRIALS; trialIdx++)
+  {
+    DTW_PARAMETERS parameters;
+    parameters.NumPoints   = 1 + (unsigned int)(mRandomFloat() * (DTW_MAX_POINTS - 0.01f));
+    parameters.NumChannels = 1 + (unsigned int)(mRandomFloat() * (DTW_MAX_CHANNELS - 0.01f));
+    parameters.Window      = (unsigned int)(mRandomFloat() * (float)(parameters.NumPoints + 2));
+
+    for (unsigned int channelIdx = 0; channelIdx < DTW_MAX_CHANNELS; channelIdx++)
+    {
+      parameters.Weights[channelIdx] = (mRandomFloat() < 0.1f) ? 0.0f : (0.05f + mRandomFloat());
+    }
+
+    mBuildRandomSequence(&parameters, query);
+    mBuildRandomSequence(&parameters, reference);
+    memcpy(reversedQuery, query, sizeof(reversedQuery));
+    mReverseDtwSequence(&parameters, query, reversedQuery);
+    mGetDtwEnvelope(&parameters, reference, lower, upper);
+
+    float referenceDistance = mGetReferenceDtwDistance(&parameters, query, reference);
+    float distance          = mGetDtwDistance(&parameters, reversedQuery, reference, FLT_MAX);
+    float lowerBound        = mGetLbKeoghDistance(&parameters, lower, upper, query, FLT_MAX);
+    float bound             = referenceDistance * 2.0f * mRandomFloat();
+    float abandoned         = mGetDtwDistance(&parameters, reversedQuery, reference, bound);
+
+    int isEquivalent = mIsSameDistance(distance, referenceDistance);
+    int isLowerBound = (lowerBound <= (referenceDistance * (1.0f + MAX_RELATIVE_ERROR)));
+    // below the bound the distance must be exact, at or above it any value >= bound will do
+    int isAbandonedCorrectly = (referenceDistance < bound) ? mIsSameDistance(abandoned, referenceDistance) : (abandoned >= (bound * (1.0f - MAX_RELATIVE_ERROR)));
+
+    if (!isEquivalent || !isLowerBound || !isAbandonedCorrectly)
+    {
+      if (numFailures < 10)
+      {
+        printf("points %u channels %u window %u: reference %f kernel %f LB_Keogh %f bound %f abandoned %f\n", parameters.NumPoints, parameters.NumChannels, parameters.Window, referenceDistance, distance, lowerBound, bound, abandoned);
+      }
+
+      numFailures++;
+    }
+  }
+
+  return numFailures;
+}
+
+// the nearest reference of every query, returns the seconds
+static double mSearchReferences(const DTW_PARAMETERS* parameters, const float* queries, unsigned int numQueries, const float* references, const float* lowers, const float* uppers, int method, unsigned int* nearest, unsigned int* numDtwRuns)
+{
+  unsigned int sequenceSize = parameters->NumPoints * parameters->NumChannels;
+  unsigned long long time   = mGetTimestamp();
+  (*numDtwRuns)             = 0;
+  float reversedQuery[DTW_MAX_POINTS * DTW_MAX_CHANNELS];
+
+  for (unsigned int queryIdx = 0; queryIdx < numQueries; queryIdx++)
+  {
+    const float* query = queries + (queryIdx * sequenceSize);
+    float bestDistance = FLT_MAX;
+    mReverseDtwSequence(parameters, query, reversedQuery);
+
+    for (unsigned int referenceIdx = 0; referenceIdx < NUM_REFERENCES; referenceIdx++)
+    {
+      const float* reference = references + (referenceIdx * sequenceSize);
+      float distance;
+
+      if (method == 0)
+      {
+        distance = mGetReferenceDtwDistance(parameters, query, reference);
+      }
+      else if (method == 1)
+      {
+        distance = mGetDtwDistance(parameters, reversedQuery, reference, FLT_MAX);
+      }
+      else if ((method == 3) && (mGetLbKeoghDistance(parameters, lowers + (referenceIdx * sequenceSize), uppers + (referenceIdx * sequenceSize), query, bestDistance) >= bestDistance))
+      {
+        continue;
+      }
+      else
+      {
+        distance = mGetDtwDistance(parameters, reversedQuery, reference, bestDistance);
+      }
+
+      (*numDtwRuns)++;
+      if (distance < bestDistance)
+      {
+        bestDistance      = distance;
+        nearest[queryIdx] = referenceIdx;
+      }
+    }
+  }
+
+  return (double)(mGetTimestamp() - time) / (double)mGetTimestampFrequency();
+}
+
+int main(int argc, char* argv[])
+{
+  const unsigned int lengths[3] = {16, 32, 64};
+  const unsigned int windows[4] = {3, 4, 8, 64};
+  const char* methodNames[4]    = {"reference", "kernel", "kernel+abandon", "LB_Keogh+kernel"};
+  unsigned int numQueries       = 200;
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--queries") == 0) && ((argIdx + 1) < argc))
+    {
+      numQueries = (unsigned int)atoi(argv[++argIdx]);
+    }
+  }
+
+  printf("Kernel: %s\n", mGetDtwKernelName());
+
+  unsigned int numFailures = mCheckEquivalence();
+  if (numFailures != 0)
+  {
+    printf(FG_RED);
+    printf("%u of %u random trials differ from the reference\n", numFailures, NUM_EQUIVALENCE_TRIALS);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  printf("%u random trials match the reference\n\n", NUM_EQUIVALENCE_TRIALS);
+
+  float* references     = (float*)mMalloc(sizeof(float) * NUM_REFERENCES * DTW_MAX_POINTS * NUM_STROKE_CHANNELS, __FILE__, __LINE__);
+  float* lowers         = (float*)mMalloc(sizeof(float) * NUM_REFERENCES * DTW_MAX_POINTS * NUM_STROKE_CHANNELS, __FILE__, __LINE__);
+  float* uppers         = (float*)mMalloc(sizeof(float) * NUM_REFERENCES * DTW_MAX_POINTS * NUM_STROKE_CHANNELS, __FILE__, __LINE__);
+  float* queries        = (float*)mMalloc(sizeof(float) * numQueries * DTW_MAX_POINTS * NUM_STROKE_CHANNELS, __FILE__, __LINE__);
+  unsigned int* nearest = (unsigned int*)mMalloc(sizeof(unsigned int) * numQueries * 4, __FILE__, __LINE__);
+
+  printf("%6s %6s %16s %16s %14s %10s\n", "points", "window", "method", "comparisons/s", "DTW runs", "identical");
+
+  for (unsigned int lengthIdx = 0; lengthIdx < 3; lengthIdx++)
+  {
+    for (unsigned int windowIdx = 0; windowIdx < 4; windowIdx++)
+    {
+      DTW_PARAMETERS parameters;
+      memset(&parameters, 0, sizeof(DTW_PARAMETERS));
+      parameters.NumPoints   = lengths[lengthIdx];
+      parameters.NumChannels = NUM_STROKE_CHANNELS;
+      parameters.Window      = (windows[windowIdx] < lengths[lengthIdx]) ? windows[windowIdx] : lengths[lengthIdx];
+      parameters.Weights[0]  = 1.0f;
+      parameters.Weights[1]  = 1.0f;
+      parameters.Weights[2]  = 0.05f;
+      parameters.Weights[3]  = 0.05f;
+
+      unsigned int sequenceSize = parameters.NumPoints * parameters.NumChannels;
+      g_random_state            = 0x5eed;
+
+      for (unsigned int referenceIdx = 0; referenceIdx < NUM_REFERENCES; referenceIdx++)
+      {
+        mBuildRandomStroke(&parameters, references + (referenceIdx * sequenceSize));
+        mGetDtwEnvelope(&parameters, references + (referenceIdx * sequenceSize), lowers + (referenceIdx * sequenceSize), uppers + (referenceIdx * sequenceSize));
+      }
+
+      for (unsigned int queryIdx = 0; queryIdx < numQueries; queryIdx++)
+      {
+        unsigned int referenceIdx = (unsigned int)(mRandomFloat() * (NUM_REFERENCES - 1));
+        mBuildQueryStroke(&parameters, references + (referenceIdx * sequenceSize), queries + (queryIdx * sequenceSize));
+      }
+
+      for (int method = 0; method < 4; method++)
+      {
+        unsigned int numDtwRuns = 0;
+        double seconds          = mSearchReferences(&parameters, queries, numQueries, references, lowers, uppers, method, nearest + (method * numQueries), &numDtwRuns);
+        double numComparisons   = (double)numQueries * NUM_REFERENCES;
+        int isIdentical         = (memcmp(nearest, nearest + (method * numQueries), sizeof(unsigned int) * numQueries) == 0);
+
+        printf("%6u %6u %16s %16.0f %13.1f%% %10s\n", parameters.NumPoints, parameters.Window, methodNames[method], numComparisons / seconds, 100.0 * (double)numDtwRuns / numComparisons, isIdentical ? "yes" : "NO");
+      }
+    }
+  }
+
+  free(references);
+  free(lowers);
+  free(uppers);
+  free(queries);
+  free(nearest);
+
+  return 0;
+}
@@ -0,0 +1,374 @@
+// Benchmark of undo and redo with the stroke edit log (touchpad/editlog.h)
+// over a long writing session on a 1920x1080 canvas. Every operation is one
+// of: write a new stroke (a random walk), undo, redo or clear, and the canvas
+// is kept up to date like the application does:
+//   new stroke: its segments are drawn into the canvas while it is written
+//   clear:      the canvas is filled with the background
+//   undo, redo: mRedrawCanvasRect of the strokes that appeared or disappeared
+// An undo or a redo is compared with repainting the whole canvas from the
+// visible strokes (mFillCanvas and mDrawCanvasStrokes), which is also the
+// reference: both canvases must be identical pixel for pixel. The live strokes
+// are drawn from their simplified view as the application does, a segment once
+// its end point can no longer move (mGetFinalSimplifiedSize).
+//
+// The visible strokes are also checked after every operation against a plain
+// model that copies the whole list of visible strokes for every edit. The log
+// is compacted every --max-edits edits, so the session also reports the size
+// of the point pool next to the number of points that were written.
+//
+//   gcc -O2 -I../touchpad -o editlogbench editlogbench.c ../touchpad/editlog.c ../touchpad/canvas.c ../touchpad/segmentgrid.c ../touchpad/stroke.c ../touchpad/point2d.c ../touchpad/threading.c ../touchpad/utils.c ../touchpad/hashindex.c ../touchpad/hiddecoder.c -lm -lpthread
+//
+// Usage: editlogbench [--ops <count>] [--max-edits <count>]
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "canvas.h"
+#include "stroke.h"
+#include "editlog.h"
+
+#define CANVAS_WIDTH     1920
+#define CANVAS_HEIGHT    1080
+#define STROKE_WIDTH     20.0f
+#define STROKE_COLOR     CANVAS_COLOR(255, 255, 255)
+#define BACKGROUND_COLOR CANVAS_COLOR(0, 0, 0)
+
+// the visible strokes of the model after an edit, strokes are numbered in the order they were written
+struct MODEL_STATE
+{
+  unsigned int* StrokeIds;
+  unsigned int NumStrokes;
+};
+
+typedef struct MODEL_STATE MODEL_STATE;
+
+struct MODEL
+{
+  // States[0] is empty, States[1..NumStates) follow the edits, States[Cursor] is the current one
+  MODEL_STATE* States;
+  unsigned int NumStates;
+  unsigned int Capacity;
+  unsigned int Cursor;
+};
+
+typedef struct MODEL MODEL;
+
+static unsigned int g_random_state = 7;
+
+static unsigned int mNextRandom()
+{
+  g_random_state = (g_random_state * 1103515245u) + 12345u;
+  return (g_random_state >> 16) & 0x7fff;
+}
+
+static double mGetMicroseconds(unsigned long long start, unsigned long long end)
+{
+  return (double)(end - start) * 1e6 / (double)mGetTimestampFrequency();
+}
+
+// a new state after the current one, the states that could be redone are dropped
+static MODEL_STATE* mPushModelState(MODEL* model, unsigned int numStrokes)
+{
+  for (unsigned int stateIdx = model->Cursor + 1; stateIdx < model->NumStates; stateIdx++)
+  {
+    free(model->States[stateIdx].StrokeIds);
+  }
+  model->NumStates = model->Cursor + 1;
+
+  if (model->NumStates == model->Capacity)
+  {
+    model->Capacity = model->Capacity * 2;
+    model->States   = (MODEL_STATE*)mRealloc(model->States, sizeof(MODEL_STATE) * model->Capacity, __FILE__, __LINE__);
+  }
+
+  MODEL_STATE* state = &model->States[model->NumStates];
+  state->StrokeIds   = (unsigned int*)mMalloc(sizeof(unsigned int) * (numStrokes + 1), __FILE__, __LINE__);
+  state->NumStrokes  = numStrokes;
+
+  model->NumStates++;
+  model->Cursor++;
+
+  return state;
+}
+
+static void mFreeModel(MODEL* model)
+{
+  for (unsigned int stateIdx = 0; stateIdx < model->NumStates; stateIdx++)
+  {
+    free(model->States[stateIdx].StrokeIds);
+  }
+  free(model->States);
+}
+
+// draw the segments of the last stroke up to its endPointIdx-th simplified point
+static void mDrawLastStrokeSegments(StrokeList* strokes, CANVAS* canvas, unsigned int endPointIdx, unsigned int* numDrawnPoints)
+{
+  Point2D* strokePoints = mGetSimplifiedStrokePoints(strokes, strokes->Size - 1);
+
+  for (; (*numDrawnPoints) < endPointIdx; (*numDrawnPoints)++)
+  {
+    if ((*numDrawnPoints) != 0)
+    {
+      mDrawCanvasSegment(canvas, strokePoints[(*numDrawnPoints) - 1], strokePoints[*numDrawnPoints], STROKE_WIDTH, STROKE_COLOR);
+    }
+  }
+}
+
+// write a random walk like a finger would, the timestamp of the stroke is its id + 1
+static void mWriteStroke(StrokeList* strokes, STROKE_EDIT_LOG* log, CANVAS* canvas, unsigned int strokeId, unsigned long long* numWrittenPoints)
+{
+  unsigned int numPoints = 10 + (mNextRandom() % 60);
+  Point2D point          = (Point2D){.X = 50 + (mNextRandom() % (CANVAS_WIDTH - 100)), .Y = 50 + (mNextRandom() % (CANVAS_HEIGHT - 100))};
+
+  mCreateNewStroke(point, strokes);
+  mSetLastStrokeTimestamp(strokes, (unsigned long long)strokeId + 1);
+  mRecordNewStroke(log, strokes);
+
+  unsigned int numDrawnPoints = 0;
+  for (unsigned int pointIdx = 1; pointIdx < numPoints; pointIdx++)
+  {
+    long x = (long)point.X + (long)(mNextRandom() % 21) - 10;
+    long y = (long)point.Y + (long)(mNextRandom() % 21) - 10;
+
+    point.X = (ULONG)((x < 0) ? 0 : ((x >= CANVAS_WIDTH) ? (CANVAS_WIDTH - 1) : x));
+    point.Y = (ULONG)((y < 0) ? 0 : ((y >= CANVAS_HEIGHT) ? (CANVAS_HEIGHT - 1) : y));
+    mAppendPoint2DToLastStroke(point, strokes);
+
+    // like the application, only the final segments are drawn while the stroke grows
+    mDrawLastStrokeSegments(strokes, canvas, mGetFinalSimplifiedSize(strokes), &numDrawnPoints);
+  }
+
+  mDrawLastStrokeSegments(strokes, canvas, strokes->Entries[strokes->Size - 1].SimplifiedSize, &numDrawnPoints);
+
+  (*numWrittenPoints) += numPoints;
+}
+
+static int mCheckVisibleStrokes(const STROKE_EDIT_LOG* log, const StrokeList* strokes, const MODEL* model, unsigned int opIdx)
+{
+  const MODEL_STATE* state = &model->States[model->Cursor];
+
+  StrokeList view;
+  mGetVisibleStrokes(log, strokes, &view);
+
+  if (view.Size != state->NumStrokes)
+  {
+    printf(FG_RED);
+    printf("Operation %u: %u visible stroke(s) instead of %u at %s:%d\n", opIdx, view.Size, state->NumStrokes, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  for (unsigned int strokeIdx = 0; strokeIdx < view.Size; strokeIdx++)
+  {
+    if (view.Entries[strokeIdx].StartTimestamp != ((unsigned long long)state->StrokeIds[strokeIdx] + 1))
+    {
+      printf(FG_RED);
+      printf("Operation %u: visible stroke %u is stroke %llu instead of %u at %s:%d\n", opIdx, strokeIdx, view.Entries[strokeIdx].StartTimestamp - 1, state->StrokeIds[strokeIdx], __FILE__, __LINE__);
+      printf(RESET_COLOR);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned int numOps   = 10000;
+  unsigned int maxEdits = STROKE_EDIT_LOG_DEFAULT_MAX_EDITS;
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--ops") == 0) && ((argIdx + 1) < argc))
+    {
+      numOps = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--max-edits") == 0) && ((argIdx + 1) < argc))
+    {
+      maxEdits = (unsigned int)atoi(argv[++argIdx]);
+    }
+  }
+
+  unsigned int* pixels    = (unsigned int*)mMalloc(sizeof(unsigned int) * CANVAS_WIDTH * CANVAS_HEIGHT, __FILE__, __LINE__);
+  unsigned int* reference = (unsigned int*)mMalloc(sizeof(unsigned int) * CANVAS_WIDTH * CANVAS_HEIGHT, __FILE__, __LINE__);
+
+  CANVAS canvas;
+  CANVAS referenceCanvas;
+  mInitializeCanvas(&canvas, pixels, CANVAS_WIDTH, CANVAS_HEIGHT, CANVAS_WIDTH);
+  mInitializeCanvas(&referenceCanvas, reference, CANVAS_WIDTH, CANVAS_HEIGHT, CANVAS_WIDTH);
+  mFillCanvas(&canvas, BACKGROUND_COLOR);
+
+  StrokeList strokes;
+  memset(&strokes, 0, sizeof(StrokeList));
+  strokes.SimplifyTolerance = 2.0f;
+
+  STROKE_EDIT_LOG log;
+  mInitializeStrokeEditLog(&log, maxEdits);
+
+  // the empty state before the first edit
+  MODEL model;
+  memset(&model, 0, sizeof(MODEL));
+  model.Capacity             = 256;
+  model.States               = (MODEL_STATE*)mMalloc(sizeof(MODEL_STATE) * model.Capacity, __FILE__, __LINE__);
+  model.States[0].StrokeIds  = (unsigned int*)mMalloc(sizeof(unsigned int), __FILE__, __LINE__);
+  model.States[0].NumStrokes = 0;
+  model.NumStates            = 1;
+
+  unsigned int numStrokesWritten      = 0;
+  unsigned long long numPointsWritten = 0;
+  unsigned int maxPoolPoints          = 0;
+  unsigned int numUndoRedo            = 0;
+  unsigned int numClears              = 0;
+  double editMicroseconds             = 0.0;
+  double regionMicroseconds           = 0.0;
+  double repaintMicroseconds          = 0.0;
+  double maxRegionMicroseconds        = 0.0;
+  double maxRepaintMicroseconds       = 0.0;
+  double recordMicroseconds           = 0.0;
+  int isValid                         = 1;
+
+  // undo and redo come in bursts like a learner taking back a few strokes
+  unsigned int burstType   = 0;
+  unsigned int burstLength = 0;
+
+  for (unsigned int opIdx = 0; (opIdx < numOps) && isValid; opIdx++)
+  {
+    if (burstLength == 0)
+    {
+      unsigned int r = mNextRandom() % 100;
+      burstType      = (r < 80) ? 0 : ((r < 90) ? 1 : ((r < 97) ? 2 : 3));
+      burstLength    = ((burstType == 1) || (burstType == 2)) ? (1 + (mNextRandom() % 6)) : 1;
+    }
+    burstLength--;
+
+    if (burstType == 0)
+    {
+      const MODEL_STATE* current = &model.States[model.Cursor];
+      unsigned int numVisible    = current->NumStrokes;
+
+      unsigned long long startTime = mGetTimestamp();
+      mWriteStroke(&strokes, &log, &canvas, numStrokesWritten, &numPointsWritten);
+      recordMicroseconds += mGetMicroseconds(startTime, mGetTimestamp());
+
+      MODEL_STATE* state = mPushModelState(&model, numVisible + 1);
+      current            = &model.States[model.Cursor - 1];
+      memcpy(state->StrokeIds, current->StrokeIds, sizeof(unsigned int) * numVisible);
+      state->StrokeIds[numVisible] = numStrokesWritten;
+      numStrokesWritten++;
+    }
+    else if (burstType == 3)
+    {
+      int isRecorded = (mRecordClear(&log, &strokes) == 0);
+      mFillCanvas(&canvas, BACKGROUND_COLOR);
+
+      if (isRecorded != (model.States[model.Cursor].NumStrokes != 0))
+      {
+        printf(FG_RED);
+        printf("Operation %u: mRecordClear returned %d with %u visible stroke(s) at %s:%d\n", opIdx, isRecorded, model.States[model.Cursor].NumStrokes, __FILE__, __LINE__);
+        printf(RESET_COLOR);
+        isValid = 0;
+      }
+
+      if (isRecorded)
+      {
+        mPushModelState(&model, 0);
+        numClears++;
+      }
+    }
+    else
+    {
+      int isRedo = (burstType == 2);
+      RECT changedBounds;
+
+      unsigned long long startTime = mGetTimestamp();
+      int retval                   = isRedo ? mRedoStrokeEdit(&log, &strokes, &changedBounds) : mUndoStrokeEdit(&log, &strokes, &changedBounds);
+      unsigned long long editTime  = mGetTimestamp();
+
+      // the model keeps every edit, the log cannot undo the ones that a compaction folded
+      int isModelDone = isRedo ? ((model.Cursor + 1) < model.NumStates) : (model.Cursor > 0);
+      int isFolded    = !isRedo && (retval != 0) && (log.NumApplied == 0) && (log.NumCompactions != 0);
+      if (((retval == 0) != isModelDone) && !isFolded)
+      {
+        printf(FG_RED);
+        printf("Operation %u: %s returned %d at %s:%d\n", opIdx, isRedo ? "redo" : "undo", retval, __FILE__, __LINE__);
+        printf(RESET_COLOR);
+        isValid = 0;
+        break;
+      }
+
+      if (retval != 0)
+      {
+        continue;
+      }
+
+      model.Cursor = isRedo ? (model.Cursor + 1) : (model.Cursor - 1);
+
+      StrokeList view;
+      mGetVisibleStrokes(&log, &strokes, &view);
+
+      mRedrawCanvasRect(&canvas, &changedBounds, &view, STROKE_WIDTH, STROKE_COLOR, BACKGROUND_COLOR);
+      unsigned long long regionTime = mGetTimestamp();
+
+      mFillCanvas(&referenceCanvas, BACKGROUND_COLOR);
+      mDrawCanvasStrokes(&referenceCanvas, &view, STROKE_WIDTH, STROKE_COLOR);
+      unsigned long long repaintTime = mGetTimestamp();
+
+      double region  = mGetMicroseconds(editTime, regionTime);
+      double repaint = mGetMicroseconds(regionTime, repaintTime);
+
+      editMicroseconds += mGetMicroseconds(startTime, editTime);
+      regionMicroseconds += region;
+      repaintMicroseconds += repaint;
+      maxRegionMicroseconds  = (region > maxRegionMicroseconds) ? region : maxRegionMicroseconds;
+      maxRepaintMicroseconds = (repaint > maxRepaintMicroseconds) ? repaint : maxRepaintMicroseconds;
+      numUndoRedo++;
+
+      if (memcmp(pixels, reference, sizeof(unsigned int) * CANVAS_WIDTH * CANVAS_HEIGHT) != 0)
+      {
+        printf(FG_RED);
+        printf("Operation %u: the canvas differs from a full repaint after %s at %s:%d\n", opIdx, isRedo ? "redo" : "undo", __FILE__, __LINE__);
+        printf(RESET_COLOR);
+        isValid = 0;
+      }
+    }
+
+    if (mCheckVisibleStrokes(&log, &strokes, &model, opIdx) != 0)
+    {
+      isValid = 0;
+    }
+
+    maxPoolPoints = (strokes.Points.Size > maxPoolPoints) ? strokes.Points.Size : maxPoolPoints;
+  }
+
+  unsigned int numUndoRedoDiv = (numUndoRedo == 0) ? 1 : numUndoRedo;
+  unsigned int numStrokesDiv  = (numStrokesWritten == 0) ? 1 : numStrokesWritten;
+
+  printf("%u operations: %u stroke(s) written (%llu points), %u undo/redo, %u clear(s)\n", numOps, numStrokesWritten, numPointsWritten, numUndoRedo, numClears);
+  printf("  new stroke (write, record):     %8.2f us\n", recordMicroseconds / numStrokesDiv);
+  printf("  undo/redo edit:                 %8.3f us\n", editMicroseconds / numUndoRedoDiv);
+  printf("  undo/redo region redraw:        %8.2f us (max %.2f us)\n", regionMicroseconds / numUndoRedoDiv, maxRegionMicroseconds);
+  printf("  undo/redo full repaint:         %8.2f us (max %.2f us)\n", repaintMicroseconds / numUndoRedoDiv, maxRepaintMicroseconds);
+  printf("  speedup:                        %8.1fx\n", (regionMicroseconds > 0.0) ? (repaintMicroseconds / regionMicroseconds) : 0.0);
+  printf("  compactions:                    %8u (at most %u edits)\n", log.NumCompactions, log.MaxEdits);
+  printf("  point pool:                     %8u points now, %u at most\n", strokes.Points.Size, maxPoolPoints);
+
+  if (isValid)
+  {
+    printf(FG_GREEN);
+    printf("Every canvas matched a full repaint and every visible stroke matched the model\n");
+    printf(RESET_COLOR);
+  }
+
+  mFreeModel(&model);
+  mFreeStrokeEditLog(&log);
+  mFreeStrokeList(&strokes);
+  free(pixels);
+  free(reference);
+
+  return isValid ? 0 : -1;
+}
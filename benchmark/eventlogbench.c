@@ -0,0 +1,280 @@
+// Stress test and cost of the binary event log (touchpad/eventlog.h) that
+// replaced the printf calls of the input thread. Every writer thread logs
+// --events records in bursts of --burst records (a WM_INPUT message logs a
+// few) with a pause of 1 ms between the bursts, and the time spent in
+// mLogEvent is measured. The file is then read back: the records of every
+// writer must be in order, and the records plus the drops that the drain
+// thread reported must add up to what was logged. It exits with -1 on the
+// first lost, duplicated or reordered record.
+//
+// For comparison the same contact line that the application used to print is
+// formatted with fprintf into the null device, which is still much cheaper
+// than the Windows console.
+//
+//   gcc -O2 -I../touchpad -o eventlogbench eventlogbench.c ../touchpad/eventlog.c ../touchpad/spscring.c ../touchpad/threading.c ../touchpad/utils.c ../touchpad/hashindex.c ../touchpad/hiddecoder.c -lpthread
+//
+// Usage: eventlogbench [--events <count>] [--threads <count>] [--burst <count>] [--capacity <count>] [--file <path>]
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "eventlog.h"
+
+#ifdef _WIN32
+#define NULL_DEVICE_PATH "NUL"
+#else
+#define NULL_DEVICE_PATH "/dev/null"
+#endif
+
+struct EVENT_LOG_BENCH_WRITER
+{
+  EVENT_LOG_WRITER* Writer;
+  unsigned int NumEvents;
+  unsigned int BurstSize;
+  // ticks spent in mLogEvent
+  unsigned long long LogTicks;
+};
+
+typedef struct EVENT_LOG_BENCH_WRITER EVENT_LOG_BENCH_WRITER;
+
+static void mWriterThread(void* arg)
+{
+  EVENT_LOG_BENCH_WRITER* benchWriter = (EVENT_LOG_BENCH_WRITER*)arg;
+  unsigned int eventIdx               = 0;
+
+  while (eventIdx < benchWriter->NumEvents)
+  {
+    unsigned int burstEnd = eventIdx + benchWriter->BurstSize;
+    burstEnd              = (burstEnd > benchWriter->NumEvents) ? benchWriter->NumEvents : burstEnd;
+
+    unsigned long long startTime = mGetTimestamp();
+
+    for (; eventIdx < burstEnd; eventIdx++)
+    {
+      mLogEvent(benchWriter->Writer, EVENT_LOG_TOUCH_CONTACT, eventIdx, benchWriter->Writer->WriterIdx, eventIdx * 3, eventIdx * 7, 1);
+    }
+
+    benchWriter->LogTicks += mGetTimestamp() - startTime;
+
+    mSleepMilliseconds(1);
+  }
+}
+
+// Read the log back and check every record, returns -1 on the first error.
+static int mVerifyEventLog(const char* filePath, EVENT_LOG_BENCH_WRITER* benchWriters, unsigned int numWriters, unsigned long long* numRecords, unsigned long long* numDropped)
+{
+  FILE* file = fopen(filePath, "rb");
+  if (file == NULL)
+  {
+    printf(FG_RED);
+    printf("Failed to open %s at %s:%d\n", filePath, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  EVENT_LOG_FILE_HEADER fileHeader;
+  if ((fread(&fileHeader, 1, sizeof(EVENT_LOG_FILE_HEADER), file) != sizeof(EVENT_LOG_FILE_HEADER)) || (fileHeader.Magic != EVENT_LOG_MAGIC) || (fileHeader.cbRecord != sizeof(EVENT_LOG_RECORD)))
+  {
+    printf(FG_RED);
+    printf("Invalid file header at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    fclose(file);
+    return -1;
+  }
+
+  unsigned int nextEventIdx[EVENT_LOG_MAX_WRITERS];
+  unsigned int numWriterRecords[EVENT_LOG_MAX_WRITERS];
+  unsigned int numWriterDrops[EVENT_LOG_MAX_WRITERS];
+  memset(nextEventIdx, 0, sizeof(nextEventIdx));
+  memset(numWriterRecords, 0, sizeof(numWriterRecords));
+  memset(numWriterDrops, 0, sizeof(numWriterDrops));
+
+  EVENT_LOG_RECORD record;
+  int retval = 0;
+
+  while ((retval == 0) && (fread(&record, 1, sizeof(EVENT_LOG_RECORD), file) == sizeof(EVENT_LOG_RECORD)))
+  {
+    unsigned int writerIdx = record.WriterIdx;
+    if (writerIdx >= numWriters)
+    {
+      retval = -1;
+    }
+    else if (record.EventId == EVENT_LOG_RECORDS_DROPPED)
+    {
+      numWriterDrops[writerIdx] += record.Args[1];
+      retval = ((record.Args[0] == writerIdx) && (numWriterDrops[writerIdx] == record.Args[2])) ? 0 : -1;
+    }
+    else
+    {
+      // dropped records leave a gap, but the sequence never goes back
+      unsigned int eventIdx = record.Args[0];
+      int isValid           = (record.EventId == EVENT_LOG_TOUCH_CONTACT) && (eventIdx >= nextEventIdx[writerIdx]) && (record.Args[1] == writerIdx) && (record.Args[2] == eventIdx * 3) && (record.Args[3] == eventIdx * 7) && (record.Args[4] == 1);
+      if (!isValid)
+      {
+        printf(FG_RED);
+        printf("Record #%u of writer #%u is lost or corrupted (received #%u)\n", nextEventIdx[writerIdx], writerIdx, eventIdx);
+        printf(RESET_COLOR);
+        retval = -1;
+      }
+
+      nextEventIdx[writerIdx] = eventIdx + 1;
+      numWriterRecords[writerIdx]++;
+    }
+  }
+
+  fclose(file);
+
+  (*numRecords) = 0;
+  (*numDropped) = 0;
+
+  for (unsigned int writerIdx = 0; (retval == 0) && (writerIdx < numWriters); writerIdx++)
+  {
+    if ((numWriterRecords[writerIdx] + numWriterDrops[writerIdx]) != benchWriters[writerIdx].NumEvents)
+    {
+      printf(FG_RED);
+      printf("Writer #%u: %u record(s) and %u drop(s) for %u event(s)\n", writerIdx, numWriterRecords[writerIdx], numWriterDrops[writerIdx], benchWriters[writerIdx].NumEvents);
+      printf(RESET_COLOR);
+      retval = -1;
+    }
+
+    (*numRecords) += numWriterRecords[writerIdx];
+    (*numDropped) += numWriterDrops[writerIdx];
+  }
+
+  return retval;
+}
+
+// ns per line of the printf that the input thread used to do for every contact
+static double mMeasurePrintf(unsigned int numEvents)
+{
+  FILE* nullFile = fopen(NULL_DEVICE_PATH, "w");
+  if (nullFile == NULL)
+  {
+    return 0.0;
+  }
+
+  unsigned long long startTime = mGetTimestamp();
+
+  for (unsigned int eventIdx = 0; eventIdx < numEvents; eventIdx++)
+  {
+    fprintf(nullFile, "%s", FG_GREEN);
+    fprintf(nullFile, "report: %d, touchID: %d, tipSwitch: %d, position: (%d, %d), eventType: %s\n", eventIdx, eventIdx & 0xf, 1, eventIdx * 3, eventIdx * 7, "touch move");
+    fprintf(nullFile, "%s", RESET_COLOR);
+  }
+
+  double seconds = (double)(mGetTimestamp() - startTime) / (double)mGetTimestampFrequency();
+  fclose(nullFile);
+
+  return seconds * 1e9 / numEvents;
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned int numEvents  = 200000;
+  unsigned int numWriters = 2;
+  unsigned int burstSize  = 64;
+  unsigned int capacity   = 0;
+  const char* filePath    = "eventlogbench.evlg";
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--events") == 0) && ((argIdx + 1) < argc))
+    {
+      numEvents = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--threads") == 0) && ((argIdx + 1) < argc))
+    {
+      numWriters = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--burst") == 0) && ((argIdx + 1) < argc))
+    {
+      burstSize = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--capacity") == 0) && ((argIdx + 1) < argc))
+    {
+      capacity = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--file") == 0) && ((argIdx + 1) < argc))
+    {
+      filePath = argv[++argIdx];
+    }
+    else
+    {
+      numWriters = 0;
+      break;
+    }
+  }
+
+  if ((numWriters == 0) || (numWriters > EVENT_LOG_MAX_WRITERS) || (burstSize == 0) || (numEvents == 0))
+  {
+    printf("Usage: %s [--events <count>] [--threads <count>] [--burst <count>] [--capacity <count>] [--file <path>]\n", argv[0]);
+    return -1;
+  }
+
+  EVENT_LOG* log = (EVENT_LOG*)mMalloc(sizeof(EVENT_LOG), __FILE__, __LINE__);
+  if (mOpenEventLog(filePath, numWriters, capacity, log) != 0)
+  {
+    return -1;
+  }
+
+  unsigned int ringCapacity = log->Writers[0].Ring.Capacity;
+
+  EVENT_LOG_BENCH_WRITER benchWriters[EVENT_LOG_MAX_WRITERS];
+  THREAD_HANDLE threads[EVENT_LOG_MAX_WRITERS];
+  memset(benchWriters, 0, sizeof(benchWriters));
+
+  unsigned long long startTime = mGetTimestamp();
+
+  for (unsigned int writerIdx = 0; writerIdx < numWriters; writerIdx++)
+  {
+    benchWriters[writerIdx].Writer    = &log->Writers[writerIdx];
+    benchWriters[writerIdx].NumEvents = numEvents;
+    benchWriters[writerIdx].BurstSize = burstSize;
+
+    if (mCreateThread(&threads[writerIdx], mWriterThread, &benchWriters[writerIdx]) != 0)
+    {
+      return -1;
+    }
+  }
+
+  unsigned long long logTicks = 0;
+  for (unsigned int writerIdx = 0; writerIdx < numWriters; writerIdx++)
+  {
+    mJoinThread(&threads[writerIdx]);
+    logTicks += benchWriters[writerIdx].LogTicks;
+  }
+
+  mCloseEventLog(log);
+  free(log);
+
+  double seconds = (double)(mGetTimestamp() - startTime) / (double)mGetTimestampFrequency();
+
+  unsigned long long numRecords;
+  unsigned long long numDropped;
+  if (mVerifyEventLog(filePath, benchWriters, numWriters, &numRecords, &numDropped) != 0)
+  {
+    printf(FG_RED);
+    printf("The event log is not what was logged\n");
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  unsigned long long numLogged = (unsigned long long)numEvents * numWriters;
+  double logNanoseconds        = (double)logTicks * 1e9 / (double)mGetTimestampFrequency() / (double)numLogged;
+
+  printf(FG_GREEN);
+  printf("%llu records (%u bytes each) from %u thread(s) through rings of %u records: OK\n", numLogged, (unsigned int)sizeof(EVENT_LOG_RECORD), numWriters, ringCapacity);
+  printf(RESET_COLOR);
+  printf("%llu written, %llu dropped, %.2f s\n", numRecords, numDropped, seconds);
+  printf("mLogEvent:          %8.1f ns/event\n", logNanoseconds);
+  printf("fprintf(" NULL_DEVICE_PATH "): %8.1f ns/event\n", mMeasurePrintf(numEvents));
+
+  remove(filePath);
+
+  return 0;
+}
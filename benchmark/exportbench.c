@@ -0,0 +1,282 @@
+// Benchmark of the stroke export format (touchpad/strokeexport.h). A session
+// of handwriting is synthesized like a touchpad reports it (a report every
+// ~8 ms and a few device units, with jitter), exported to a file, read back
+// and decoded. It reports the size of the file next to a naive dump of the
+// StrokeList (the StrokeIndexEntry and Point2D arrays), the encode and decode
+// throughput next to a memcpy of the naive dump, and checks that every point
+// and every timestamp survives the round trip. Every truncation of a small
+// export must be rejected by the reader instead of being read past its end.
+//
+//   gcc -O2 -I../touchpad -o exportbench exportbench.c ../touchpad/strokeexport.c ../touchpad/stroke.c ../touchpad/point2d.c ../touchpad/threading.c ../touchpad/utils.c ../touchpad/hashindex.c ../touchpad/hiddecoder.c -lm -lpthread
+//
+// Usage: exportbench [--strokes <count>] [--repeat <count>] [--file <path>]
+#include "platform.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "stroke.h"
+#include "strokeexport.h"
+
+// a report every 8 ms like most Precision Touchpads
+#define REPORT_INTERVAL_US 8000
+// the pen is lifted for this long between two strokes
+#define STROKE_PAUSE_US    150000
+#define TRUNCATION_STROKES 20
+
+static unsigned int g_random_state = 2136;
+
+static float mRandomFloat()
+{
+  g_random_state = (g_random_state * 1103515245u) + 12345u;
+  return (float)((g_random_state >> 8) & 0xffff) / 65535.0f;
+}
+
+static double mGetMilliseconds(unsigned long long start, unsigned long long end)
+{
+  return (double)(end - start) * 1e3 / (double)mGetTimestampFrequency();
+}
+
+// strokes of 10 to 100 reports on a touchpad of 0..4000 x 0..3000 device units
+static void mBuildSession(StrokeList* strokes, unsigned int numStrokes)
+{
+  unsigned long long frequency = mGetTimestampFrequency();
+  unsigned long long time      = frequency;
+
+  for (unsigned int strokeIdx = 0; strokeIdx < numStrokes; strokeIdx++)
+  {
+    float x                = 500.0f + (3000.0f * mRandomFloat());
+    float y                = 500.0f + (2000.0f * mRandomFloat());
+    float angle            = 6.2832f * mRandomFloat();
+    float turn             = 0.1f * (mRandomFloat() - 0.5f);
+    float speed            = 1.0f + (6.0f * mRandomFloat());
+    unsigned int numPoints = 10 + (unsigned int)(90.0f * mRandomFloat());
+
+    for (unsigned int pointIdx = 0; pointIdx < numPoints; pointIdx++)
+    {
+      Point2D point = (Point2D){.X = (ULONG)(x + (2.0f * mRandomFloat())), .Y = (ULONG)(y + (2.0f * mRandomFloat()))};
+      if (pointIdx == 0)
+      {
+        mCreateNewStroke(point, strokes);
+      }
+      else
+      {
+        mAppendPoint2DToLastStroke(point, strokes);
+      }
+
+      mSetLastStrokeTimestamp(strokes, time);
+      time += (frequency * REPORT_INTERVAL_US) / 1000000;
+
+      angle += turn;
+      x += speed * cosf(angle);
+      y += speed * sinf(angle);
+      x = (x < 0.0f) ? 0.0f : x;
+      y = (y < 0.0f) ? 0.0f : y;
+    }
+
+    time += (frequency * STROKE_PAUSE_US) / 1000000;
+  }
+}
+
+// Decode every stroke and compare it with the list (when strokes is not
+// NULL). Returns the number of points or -1 if the export does not match.
+static long long mDecodeExport(const BYTE* data, size_t cbData, StrokeList* strokes, Point2D* points)
+{
+  STROKE_EXPORT_READER reader;
+  if (mOpenStrokeExportReader(data, cbData, &reader) != 0)
+  {
+    return -1;
+  }
+
+  long long numPoints          = 0;
+  unsigned long long frequency = mGetTimestampFrequency();
+  EXPORTED_STROKE stroke;
+
+  while (mReadExportedStroke(&reader, &stroke, points) == 0)
+  {
+    numPoints += stroke.NumPoints;
+
+    if (strokes != NULL)
+    {
+      StrokeIndexEntry entry  = strokes->Entries[reader.NumStrokesRead - 1];
+      double expectedStart    = (double)(entry.StartTimestamp - strokes->Entries[0].StartTimestamp) * 1e6 / (double)frequency;
+      double expectedDuration = (double)(entry.EndTimestamp - entry.StartTimestamp) * 1e6 / (double)frequency;
+      int areTimestampsEqual  = (fabs((double)stroke.StartMicroseconds - expectedStart) < 1.0) && (fabs((double)stroke.DurationMicroseconds - expectedDuration) < 1.0);
+
+      if ((stroke.NumPoints != entry.Size) || !areTimestampsEqual || (memcmp(points, mGetStrokePoints(strokes, reader.NumStrokesRead - 1), sizeof(Point2D) * entry.Size) != 0))
+      {
+        return -1;
+      }
+    }
+  }
+
+  if (reader.NumStrokesRead != reader.FileHeader->NumStrokes)
+  {
+    return -1;
+  }
+
+  return numPoints;
+}
+
+// every prefix of a small export must be rejected
+static int mCheckTruncations()
+{
+  StrokeList strokes;
+  STROKE_EXPORT_BUFFER buffer;
+  memset(&strokes, 0, sizeof(StrokeList));
+  memset(&buffer, 0, sizeof(STROKE_EXPORT_BUFFER));
+
+  mBuildSession(&strokes, TRUNCATION_STROKES);
+  mEncodeStrokeExport(strokes.Entries, strokes.Size, strokes.Points.Entries, NULL, &buffer);
+
+  int retval      = 0;
+  Point2D* points = (Point2D*)mMalloc(sizeof(Point2D) * strokes.Points.Size, __FILE__, __LINE__);
+
+  for (size_t cbData = 0; cbData < buffer.cbData; cbData++)
+  {
+    // a copy of exactly cbData bytes so that reading past it is caught by a sanitizer
+    BYTE* data = (BYTE*)mMalloc(cbData + 1, __FILE__, __LINE__);
+    memcpy(data, buffer.Data, cbData);
+
+    if (mDecodeExport(data, cbData, NULL, points) >= 0)
+    {
+      retval = -1;
+    }
+
+    free(data);
+  }
+
+  free(points);
+  mFreeStrokeExportBuffer(&buffer);
+  mFreeStrokeList(&strokes);
+
+  return retval;
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned int numStrokes = 100000;
+  unsigned int numRepeats = 10;
+  const char* filePath    = NULL;
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--strokes") == 0) && ((argIdx + 1) < argc))
+    {
+      numStrokes = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--repeat") == 0) && ((argIdx + 1) < argc))
+    {
+      numRepeats = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--file") == 0) && ((argIdx + 1) < argc))
+    {
+      filePath = argv[++argIdx];
+    }
+    else
+    {
+      printf("Usage: %s [--strokes <count>] [--repeat <count>] [--file <path>]\n", argv[0]);
+      return -1;
+    }
+  }
+
+  numRepeats = (numRepeats == 0) ? 1 : numRepeats;
+
+  StrokeList strokes;
+  memset(&strokes, 0, sizeof(StrokeList));
+  mBuildSession(&strokes, numStrokes);
+
+  RECT physicalRect      = {.left = 0, .top = 0, .right = 4000, .bottom = 3000};
+  size_t cbNaive         = (sizeof(StrokeIndexEntry) * strokes.Size) + (sizeof(Point2D) * strokes.Points.Size);
+  unsigned int numPoints = strokes.Points.Size;
+  // the file is kept when it is given with --file
+  const char* exportPath = (filePath != NULL) ? filePath : "exportbench.strk";
+
+  // the export of the application, once
+  unsigned long long time = mGetTimestamp();
+  if (mWriteStrokeExport(exportPath, &strokes, &physicalRect) != 0)
+  {
+    return -1;
+  }
+  double writeMilliseconds = mGetMilliseconds(time, mGetTimestamp());
+
+  FILE* file = fopen(exportPath, "rb");
+  if (file == NULL)
+  {
+    printf(FG_RED);
+    printf("Failed to open %s\n", exportPath);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  fseek(file, 0, SEEK_END);
+  size_t cbFile = (size_t)ftell(file);
+  fseek(file, 0, SEEK_SET);
+  BYTE* fileData = (BYTE*)mMalloc(cbFile, __FILE__, __LINE__);
+  size_t cbRead  = fread(fileData, 1, cbFile, file);
+  fclose(file);
+
+  Point2D* points = (Point2D*)mMalloc(sizeof(Point2D) * strokes.Points.Size, __FILE__, __LINE__);
+  int isIdentical = (cbRead == cbFile) && (mDecodeExport(fileData, cbFile, &strokes, points) == (long long)strokes.Points.Size);
+
+  printf("%u strokes, %u points\n", strokes.Size, strokes.Points.Size);
+  printf("naive dump: %10.2f MB (%.2f bytes/point)\n", cbNaive / 1e6, (double)cbNaive / strokes.Points.Size);
+  printf("export:     %10.2f MB (%.2f bytes/point, %.1f%% of the naive dump), written in %.2f ms\n", cbFile / 1e6, (double)cbFile / strokes.Points.Size, 100.0 * cbFile / cbNaive, writeMilliseconds);
+
+  // encode into a reused buffer
+  STROKE_EXPORT_BUFFER buffer;
+  memset(&buffer, 0, sizeof(STROKE_EXPORT_BUFFER));
+  mEncodeStrokeExport(strokes.Entries, strokes.Size, strokes.Points.Entries, &physicalRect, &buffer);
+
+  time = mGetTimestamp();
+  for (unsigned int repeatIdx = 0; repeatIdx < numRepeats; repeatIdx++)
+  {
+    mEncodeStrokeExport(strokes.Entries, strokes.Size, strokes.Points.Entries, &physicalRect, &buffer);
+  }
+  double encodeSeconds = mGetMilliseconds(time, mGetTimestamp()) / 1e3 / numRepeats;
+
+  long long numDecoded = 0;
+  time                 = mGetTimestamp();
+  for (unsigned int repeatIdx = 0; repeatIdx < numRepeats; repeatIdx++)
+  {
+    numDecoded += mDecodeExport(fileData, cbFile, NULL, points);
+  }
+  double decodeSeconds = mGetMilliseconds(time, mGetTimestamp()) / 1e3 / numRepeats;
+
+  // the bandwidth that a naive dump would be read at
+  BYTE* naiveCopy = (BYTE*)mMalloc(cbNaive, __FILE__, __LINE__);
+  memcpy(naiveCopy, strokes.Points.Entries, sizeof(Point2D) * strokes.Points.Size);
+  time = mGetTimestamp();
+  for (unsigned int repeatIdx = 0; repeatIdx < numRepeats; repeatIdx++)
+  {
+    memcpy(points, naiveCopy, sizeof(Point2D) * strokes.Points.Size);
+    memcpy(naiveCopy, points, sizeof(Point2D) * strokes.Points.Size);
+  }
+  double copySeconds = mGetMilliseconds(time, mGetTimestamp()) / 1e3 / numRepeats / 2.0;
+
+  printf("%10s %14s %14s %14s\n", "", "M points/s", "naive MB/s", "export MB/s");
+  printf("%10s %14.1f %14.1f %14.1f\n", "encode", strokes.Points.Size / encodeSeconds / 1e6, cbNaive / encodeSeconds / 1e6, cbFile / encodeSeconds / 1e6);
+  printf("%10s %14.1f %14.1f %14.1f\n", "decode", strokes.Points.Size / decodeSeconds / 1e6, cbNaive / decodeSeconds / 1e6, cbFile / decodeSeconds / 1e6);
+  printf("%10s %14.1f %14.1f %14s\n", "memcpy", strokes.Points.Size / copySeconds / 1e6, (sizeof(Point2D) * strokes.Points.Size) / copySeconds / 1e6, "-");
+
+  int isTruncationRejected = (mCheckTruncations() == 0);
+  printf("round trip: %s, truncated exports rejected: %s\n", isIdentical ? "identical" : "DIFFERENT", isTruncationRejected ? "yes" : "NO");
+
+  free(naiveCopy);
+  free(points);
+  free(fileData);
+  mFreeStrokeExportBuffer(&buffer);
+  mFreeStrokeList(&strokes);
+
+  if (filePath == NULL)
+  {
+    remove(exportPath);
+  }
+
+  return (isIdentical && isTruncationRejected && (numDecoded == ((long long)numPoints * numRepeats))) ? 0 : -1;
+}
@@ -0,0 +1,462 @@
+// Benchmark of the background export writer (touchpad/exportwriter.h). This
+// thread plays the message loop: it appends points to a StrokeList and every
+// --save-every points asks the STROKE_EXPORT_WRITER to save them, while the
+// writer thread encodes and writes the previous snapshot. The canvas is
+// cleared every --clear-every points so that the snapshots also see a new
+// generation of strokes.
+//
+// The points are a function of their generation and of their index in it, so
+// every file that was written is read back and checked against the list as it
+// was when the save was requested: the same strokes, the last one cut where
+// it was still growing, and every point. A coalesced save must not leave a
+// file behind. It reports how long mRequestStrokeExport blocks the caller next
+// to a synchronous mWriteStrokeExport of the final list (what a save cost the
+// message loop before), the time until a save is written and the number of
+// saves that coalesced. Build it with -fsanitize=thread to check the hand-off.
+// A snapshot of the visible strokes of an edit log is checked first: it must
+// hold the points of those strokes only.
+//
+//   gcc -O2 -I../touchpad -o exportwriterbench exportwriterbench.c ../touchpad/exportwriter.c ../touchpad/strokeexport.c ../touchpad/stroke.c ../touchpad/point2d.c ../touchpad/threading.c ../touchpad/utils.c ../touchpad/hashindex.c ../touchpad/hiddecoder.c -lm -lpthread
+//
+// Usage: exportwriterbench [--points <count>] [--save-every <points>] [--clear-every <points>] [--interval <ms>] [--dir <path>]
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "stroke.h"
+#include "strokeexport.h"
+#include "exportwriter.h"
+
+struct SAVE_RECORD
+{
+  unsigned int Generation;
+  unsigned int NumStrokes;
+  unsigned int NumPoints;
+  // STROKE_EXPORT_STATUS_* once the completion was taken, -1 before
+  int Status;
+  double LatencyMs;
+};
+
+typedef struct SAVE_RECORD SAVE_RECORD;
+
+static double mGetMilliseconds(unsigned long long start, unsigned long long end)
+{
+  return (double)(end - start) * 1e3 / (double)mGetTimestampFrequency();
+}
+
+static unsigned int mGetStrokeSize(unsigned int generation, unsigned int strokeIdx)
+{
+  return 10 + (((strokeIdx * 37) + (generation * 11)) % 90);
+}
+
+static Point2D mGetPoint(unsigned int generation, unsigned int pointIdx)
+{
+  return (Point2D){.X = ((pointIdx * 7) + (generation * 131)) % 4000, .Y = ((pointIdx * 13) + (generation * 17)) % 3000};
+}
+
+// arg is the notification counter of main
+static void mNotify(void* arg)
+{
+  mAtomicAdd((volatile unsigned int*)arg, 1);
+}
+
+static void mGetFilePath(char* filePath, size_t cbFilePath, const char* directory, unsigned int requestIdx)
+{
+  snprintf(filePath, cbFilePath, "%s/exportwriterbench-%u.strk", directory, requestIdx);
+}
+
+// what the message loop does on the notification, returns the number of completions taken
+static unsigned int mTakeCompletions(STROKE_EXPORT_WRITER* writer, SAVE_RECORD* records)
+{
+  unsigned int numCompletions = 0;
+  STROKE_EXPORT_COMPLETION completion;
+
+  while (mTakeStrokeExportCompletion(writer, &completion) == 0)
+  {
+    SAVE_RECORD* record = &records[completion.RequestIdx];
+    record->Status      = completion.Status;
+    record->LatencyMs   = mGetMilliseconds(completion.SubmitTimestamp, completion.FinishTimestamp);
+
+    // the writer reports what it took from the snapshot
+    if ((completion.NumStrokes != record->NumStrokes) || (completion.NumPoints != record->NumPoints))
+    {
+      record->Status = STROKE_EXPORT_STATUS_FAILED;
+    }
+
+    numCompletions++;
+  }
+
+  return numCompletions;
+}
+
+// Returns -1 if the snapshot is not a copy of the strokes [firstStroke, endStroke) of generation 0.
+static int mCheckSnapshotPoints(const STROKE_SNAPSHOT* snapshot, unsigned int firstStroke, unsigned int endStroke)
+{
+  unsigned int pointIdx = 0;
+  for (unsigned int strokeIdx = 0; strokeIdx < firstStroke; strokeIdx++)
+  {
+    pointIdx += mGetStrokeSize(0, strokeIdx);
+  }
+
+  if (snapshot->NumStrokes != (endStroke - firstStroke))
+  {
+    return -1;
+  }
+
+  unsigned int numPoints = 0;
+  for (unsigned int strokeIdx = 0; strokeIdx < snapshot->NumStrokes; strokeIdx++)
+  {
+    StrokeIndexEntry stroke = snapshot->Entries[strokeIdx];
+    if ((stroke.Offset != numPoints) || (stroke.Size != mGetStrokeSize(0, firstStroke + strokeIdx)))
+    {
+      return -1;
+    }
+
+    for (unsigned int strokePointIdx = 0; strokePointIdx < stroke.Size; strokePointIdx++)
+    {
+      Point2D expected = mGetPoint(0, pointIdx);
+      Point2D point    = snapshot->Points[stroke.Offset + strokePointIdx];
+      if ((point.X != expected.X) || (point.Y != expected.Y))
+      {
+        return -1;
+      }
+      pointIdx++;
+    }
+
+    numPoints += stroke.Size;
+  }
+
+  return (snapshot->NumPoints == numPoints) ? 0 : -1;
+}
+
+// Snapshot the visible strokes of an edit log (a view that shares the point
+// pool with the hidden strokes around it, see mGetVisibleStrokes): only their
+// points must be copied. Returns -1 on the first difference.
+static int mCheckVisibleStrokesSnapshot()
+{
+  StrokeList strokes = (StrokeList){.Entries = NULL, .Size = 0, .Capacity = 0};
+  unsigned int pointIdx = 0;
+
+  for (unsigned int strokeIdx = 0; strokeIdx < 6; strokeIdx++)
+  {
+    mCreateNewStroke(mGetPoint(0, pointIdx++), &strokes);
+    for (unsigned int strokePointIdx = 1; strokePointIdx < mGetStrokeSize(0, strokeIdx); strokePointIdx++)
+    {
+      mAppendPoint2DToLastStroke(mGetPoint(0, pointIdx++), &strokes);
+    }
+  }
+
+  STROKE_SNAPSHOT snapshot;
+  mInitializeStrokeSnapshot(&snapshot);
+
+  // strokes 0 and 5 are hidden, then stroke 1 is hidden too (a new generation
+  // of the view), then stroke 5 is shown again like a new stroke of the same
+  // generation that only the last part of the snapshot is updated for
+  unsigned int viewStrokes[3][2] = {{1, 5}, {2, 5}, {2, 6}};
+  int retval                     = 0;
+
+  for (unsigned int viewIdx = 0; (viewIdx < 3) && (retval == 0); viewIdx++)
+  {
+    StrokeList view = strokes;
+    view.Entries    = strokes.Entries + viewStrokes[viewIdx][0];
+    view.Size       = viewStrokes[viewIdx][1] - viewStrokes[viewIdx][0];
+    view.Generation = strokes.Generation + ((viewIdx == 0) ? 0 : 1);
+
+    mUpdateStrokeSnapshot(&snapshot, &view);
+    retval = mCheckSnapshotPoints(&snapshot, viewStrokes[viewIdx][0], viewStrokes[viewIdx][1]);
+  }
+
+  if (retval != 0)
+  {
+    printf(FG_RED);
+    printf("The snapshot of the visible strokes has %u strokes and %u points\n", snapshot.NumStrokes, snapshot.NumPoints);
+    printf(RESET_COLOR);
+  }
+
+  mFreeStrokeSnapshot(&snapshot);
+  mFreeStrokeList(&strokes);
+
+  return retval;
+}
+
+// Returns -1 if the file does not hold the strokes of the record.
+static int mCheckExportFile(const char* filePath, const SAVE_RECORD* record)
+{
+  FILE* file = fopen(filePath, "rb");
+  if (file == NULL)
+  {
+    return -1;
+  }
+
+  fseek(file, 0, SEEK_END);
+  long cbFile = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  BYTE* data      = (BYTE*)mMalloc((size_t)cbFile + 1, __FILE__, __LINE__);
+  int isRead      = (fread(data, 1, (size_t)cbFile, file) == (size_t)cbFile);
+  Point2D* points = NULL;
+  int retval      = -1;
+  fclose(file);
+
+  STROKE_EXPORT_READER reader;
+  if (isRead && (mOpenStrokeExportReader(data, (size_t)cbFile, &reader) == 0) && (reader.FileHeader->NumStrokes == record->NumStrokes) && (reader.FileHeader->NumPoints == record->NumPoints))
+  {
+    points = (Point2D*)mMalloc(((size_t)reader.FileHeader->MaxStrokePoints + 1) * sizeof(Point2D), __FILE__, __LINE__);
+    retval = 0;
+
+    unsigned int pointIdx = 0;
+    EXPORTED_STROKE stroke;
+    for (unsigned int strokeIdx = 0; (strokeIdx < record->NumStrokes) && (retval == 0); strokeIdx++)
+    {
+      if (mReadExportedStroke(&reader, &stroke, points) != 0)
+      {
+        retval = -1;
+        break;
+      }
+
+      // only the last stroke can be cut short
+      unsigned int expectedSize = mGetStrokeSize(record->Generation, strokeIdx);
+      int isSizeValid           = (strokeIdx == (record->NumStrokes - 1)) ? ((stroke.NumPoints != 0) && (stroke.NumPoints <= expectedSize)) : (stroke.NumPoints == expectedSize);
+      retval                    = isSizeValid ? 0 : -1;
+
+      for (unsigned int strokePointIdx = 0; (strokePointIdx < stroke.NumPoints) && (retval == 0); strokePointIdx++)
+      {
+        Point2D expected = mGetPoint(record->Generation, pointIdx);
+        retval           = ((points[strokePointIdx].X == expected.X) && (points[strokePointIdx].Y == expected.Y)) ? 0 : -1;
+        pointIdx++;
+      }
+    }
+
+    retval = (pointIdx == record->NumPoints) ? retval : -1;
+  }
+
+  free(points);
+  free(data);
+
+  return retval;
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned int numPoints  = 2000000;
+  unsigned int saveEvery  = 20000;
+  unsigned int clearEvery = 700000;
+  unsigned int intervalMs = 0;
+  const char* directory   = ".";
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--points") == 0) && ((argIdx + 1) < argc))
+    {
+      numPoints = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--save-every") == 0) && ((argIdx + 1) < argc))
+    {
+      saveEvery = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--clear-every") == 0) && ((argIdx + 1) < argc))
+    {
+      clearEvery = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--interval") == 0) && ((argIdx + 1) < argc))
+    {
+      intervalMs = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--dir") == 0) && ((argIdx + 1) < argc))
+    {
+      directory = argv[++argIdx];
+    }
+    else
+    {
+      printf("Usage: %s [--points <count>] [--save-every <points>] [--clear-every <points>] [--interval <ms>] [--dir <path>]\n", argv[0]);
+      return -1;
+    }
+  }
+
+  if (mCheckVisibleStrokesSnapshot() != 0)
+  {
+    return -1;
+  }
+
+  saveEvery  = (saveEvery == 0) ? 1 : saveEvery;
+  clearEvery = (clearEvery == 0) ? numPoints + 1 : clearEvery;
+
+  unsigned int maxSaves = (numPoints / saveEvery) + 1;
+  SAVE_RECORD* records  = (SAVE_RECORD*)mMalloc(((size_t)maxSaves + 1) * sizeof(SAVE_RECORD), __FILE__, __LINE__);
+  memset(records, 0, ((size_t)maxSaves + 1) * sizeof(SAVE_RECORD));
+
+  StrokeList strokes = (StrokeList){.Entries = NULL, .Size = 0, .Capacity = 0};
+
+  volatile unsigned int numNotifications = 0;
+  STROKE_EXPORT_WRITER writer;
+  if (mStartStrokeExportWriter(&writer, mNotify, (void*)&numNotifications) != 0)
+  {
+    return -1;
+  }
+
+  char filePath[STROKE_EXPORT_WRITER_MAX_PATH];
+  unsigned int numSaves                = 0;
+  unsigned int numCompleted            = 0;
+  unsigned int pointIdx                = 0;
+  unsigned int strokeIdx               = 0;
+  unsigned int strokePointIdx          = 0;
+  unsigned long long totalRequestTicks = 0;
+  unsigned long long maxRequestTicks   = 0;
+  unsigned long long startTime         = mGetTimestamp();
+
+  for (unsigned int globalIdx = 0; globalIdx < numPoints; globalIdx++)
+  {
+    if ((globalIdx != 0) && ((globalIdx % clearEvery) == 0))
+    {
+      mClearStrokeList(&strokes);
+      pointIdx       = 0;
+      strokeIdx      = 0;
+      strokePointIdx = 0;
+    }
+
+    Point2D point = mGetPoint(strokes.Generation, pointIdx);
+    if (strokePointIdx == 0)
+    {
+      mCreateNewStroke(point, &strokes);
+    }
+    else
+    {
+      mAppendPoint2DToLastStroke(point, &strokes);
+    }
+
+    mSetLastStrokeTimestamp(&strokes, startTime + globalIdx);
+    pointIdx++;
+    strokePointIdx++;
+
+    if (strokePointIdx == mGetStrokeSize(strokes.Generation, strokeIdx))
+    {
+      strokeIdx++;
+      strokePointIdx = 0;
+    }
+
+    if (((globalIdx + 1) % saveEvery) == 0)
+    {
+      mGetFilePath(filePath, sizeof(filePath), directory, numSaves + 1);
+
+      unsigned long long requestStart = mGetTimestamp();
+      unsigned int requestIdx         = mRequestStrokeExport(&writer, &strokes, filePath, NULL);
+      unsigned long long requestTicks = mGetTimestamp() - requestStart;
+
+      totalRequestTicks += requestTicks;
+      maxRequestTicks = (requestTicks > maxRequestTicks) ? requestTicks : maxRequestTicks;
+      numSaves++;
+
+      if (requestIdx != numSaves)
+      {
+        printf(FG_RED);
+        printf("Request %u returned index %u\n", numSaves, requestIdx);
+        printf(RESET_COLOR);
+        return -1;
+      }
+
+      records[requestIdx] = (SAVE_RECORD){.Generation = strokes.Generation, .NumStrokes = strokes.Size, .NumPoints = strokes.Points.Size, .Status = -1};
+      numCompleted += mTakeCompletions(&writer, records);
+
+      if (intervalMs != 0)
+      {
+        mSleepMilliseconds(intervalMs);
+      }
+    }
+  }
+
+  double appendMilliseconds = mGetMilliseconds(startTime, mGetTimestamp());
+
+  // the last save may still be waiting
+  while (numCompleted < numSaves)
+  {
+    numCompleted += mTakeCompletions(&writer, records);
+    mSleepMilliseconds(1);
+  }
+
+  unsigned int numDroppedCompletions = writer.NumDroppedCompletions;
+  mStopStrokeExportWriter(&writer);
+
+  // what a save cost the message loop when the file was written on it
+  mGetFilePath(filePath, sizeof(filePath), directory, 0);
+  unsigned long long syncStart = mGetTimestamp();
+  mWriteStrokeExport(filePath, &strokes, NULL);
+  double syncMilliseconds = mGetMilliseconds(syncStart, mGetTimestamp());
+  remove(filePath);
+
+  unsigned int numWritten   = 0;
+  unsigned int numCoalesced = 0;
+  unsigned int numInvalid   = 0;
+  double totalLatencyMs     = 0.0;
+  double maxLatencyMs       = 0.0;
+
+  for (unsigned int requestIdx = 1; requestIdx <= numSaves; requestIdx++)
+  {
+    SAVE_RECORD* record = &records[requestIdx];
+    mGetFilePath(filePath, sizeof(filePath), directory, requestIdx);
+
+    if (record->Status == STROKE_EXPORT_STATUS_WRITTEN)
+    {
+      numWritten++;
+      totalLatencyMs += record->LatencyMs;
+      maxLatencyMs = (record->LatencyMs > maxLatencyMs) ? record->LatencyMs : maxLatencyMs;
+
+      if (mCheckExportFile(filePath, record) != 0)
+      {
+        numInvalid++;
+        printf(FG_RED);
+        printf("Save %u does not match the strokes (%u strokes, %u points of generation %u)\n", requestIdx, record->NumStrokes, record->NumPoints, record->Generation);
+        printf(RESET_COLOR);
+      }
+    }
+    else if (record->Status == STROKE_EXPORT_STATUS_COALESCED)
+    {
+      numCoalesced++;
+
+      FILE* file = fopen(filePath, "rb");
+      if (file != NULL)
+      {
+        fclose(file);
+        numInvalid++;
+        printf(FG_RED);
+        printf("Save %u was coalesced but its file exists\n", requestIdx);
+        printf(RESET_COLOR);
+      }
+    }
+    else
+    {
+      numInvalid++;
+      printf(FG_RED);
+      printf("Save %u failed\n", requestIdx);
+      printf(RESET_COLOR);
+    }
+
+    remove(filePath);
+  }
+
+  printf("%u points, %u saves (%u written, %u coalesced) in %.2f ms, %u notifications\n", numPoints, numSaves, numWritten, numCoalesced, appendMilliseconds, numNotifications);
+  printf("mRequestStrokeExport: mean %.3f ms, max %.3f ms\n", (numSaves != 0) ? (mGetMilliseconds(0, totalRequestTicks) / numSaves) : 0.0, mGetMilliseconds(0, maxRequestTicks));
+  printf("mWriteStrokeExport of the last %u points on the caller: %.3f ms\n", strokes.Points.Size, syncMilliseconds);
+  printf("request to written: mean %.2f ms, max %.2f ms\n", (numWritten != 0) ? (totalLatencyMs / numWritten) : 0.0, maxLatencyMs);
+
+  if ((numInvalid != 0) || (numDroppedCompletions != 0))
+  {
+    printf(FG_RED);
+    printf("FAILED: %u invalid saves, %u dropped completions\n", numInvalid, numDroppedCompletions);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  printf(FG_GREEN);
+  printf("every written save matches the strokes at its request\n");
+  printf(RESET_COLOR);
+
+  mFreeStrokeList(&strokes);
+  free(records);
+
+  return 0;
+}
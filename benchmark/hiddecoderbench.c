@@ -0,0 +1,466 @@
+// Microbenchmark of the touch report decoder (touchpad/hiddecoder.h) against
+// the per-contact lookups that mHandleInputMessage did before the decode plan:
+// HidP_GetUsageValue for the contact count and for X, Y and the contact ID of
+// every contact, plus HidP_MaxUsageListLength, a malloc and HidP_GetUsages
+// for its tip switch. HidP does not exist outside Windows, so the baseline
+// emulates those calls the way the preparsed data is organized: every lookup
+// scans a list of value or button caps for the usage page, usage and link
+// collection, then extracts the bits. It is a model of the old code path, not
+// the Windows implementation, and the real HidP calls cost more.
+//
+// Reports of a 5-contact Precision Touchpad (parallel reporting mode) and of a
+// 2-contact one in hybrid reporting mode (a frame of up to 5 fingers is split
+// over 3 reports, the follow-up reports carry contact count 0) are generated
+// with their expected contacts. Both decoders must produce exactly those
+// contacts; it exits with -1 on the first difference.
+//
+//   gcc -O2 -I../touchpad -o hiddecoderbench hiddecoderbench.c ../touchpad/hiddecoder.c ../touchpad/threading.c ../touchpad/utils.c ../touchpad/hashindex.c -lpthread
+//
+// Usage: hiddecoderbench [--frames <count>]
+//   --frames touch frames generated per reporting mode (default 1000000)
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "hiddecoder.h"
+
+// report ID, per contact a byte with tip switch, confidence and a 6 bit
+// contact ID followed by 16 bit X and Y, then 16 bit scan time, 8 bit
+// contact count and a byte with the button
+#define BENCH_REPORT_ID        4
+#define BENCH_CB_CONTACT       5
+#define BENCH_MAX_FINGERS      5
+#define BENCH_MAX_CAPS         64
+
+#define USAGE_PAGE_GENERIC   0x01
+#define USAGE_PAGE_DIGITIZER 0x0D
+#define USAGE_PAGE_BUTTON    0x09
+#define USAGE_GENERIC_X      0x30
+#define USAGE_GENERIC_Y      0x31
+#define USAGE_TIP_SWITCH     0x42
+#define USAGE_CONFIDENCE     0x47
+#define USAGE_CONTACT_ID     0x51
+#define USAGE_CONTACT_COUNT  0x54
+#define USAGE_SCAN_TIME      0x56
+
+// a value or button cap of the preparsed data, one usage each
+struct EMULATED_HIDP_CAP
+{
+  USHORT UsagePage;
+  USHORT Usage;
+  USHORT LinkCollection;
+  BYTE ReportID;
+  int IsButton;
+  HID_REPORT_FIELD Field;
+};
+
+typedef struct EMULATED_HIDP_CAP EMULATED_HIDP_CAP;
+
+struct EMULATED_HIDP_DATA
+{
+  EMULATED_HIDP_CAP ValueCaps[BENCH_MAX_CAPS];
+  unsigned int NumValueCaps;
+  EMULATED_HIDP_CAP ButtonCaps[BENCH_MAX_CAPS];
+  unsigned int NumButtonCaps;
+  USHORT ContactCountLinkCollection;
+  unsigned int NumContactLinkCollections;
+};
+
+typedef struct EMULATED_HIDP_DATA EMULATED_HIDP_DATA;
+
+struct BENCH_DEVICE
+{
+  unsigned int NumSlots;
+  unsigned int cbReport;
+  HID_TOUCH_DECODE_PLAN Plan;
+  EMULATED_HIDP_DATA HidP;
+};
+
+typedef struct BENCH_DEVICE BENCH_DEVICE;
+
+struct BENCH_REPORTS
+{
+  BYTE* Reports;
+  unsigned int NumReports;
+  TOUCH_DATA* Contacts;
+  unsigned int NumContacts;
+};
+
+typedef struct BENCH_REPORTS BENCH_REPORTS;
+
+static HID_REPORT_FIELD mMakeField(unsigned int bitOffset, unsigned int bitSize, LONG logicalMax)
+{
+  return (HID_REPORT_FIELD){.BitOffset = bitOffset, .BitSize = bitSize, .LogicalMin = 0, .LogicalMax = logicalMax};
+}
+
+static void mAddCap(EMULATED_HIDP_DATA* hidp, int isButton, USHORT usagePage, USHORT usage, USHORT linkCollection, HID_REPORT_FIELD field)
+{
+  EMULATED_HIDP_CAP cap = {.UsagePage = usagePage, .Usage = usage, .LinkCollection = linkCollection, .ReportID = BENCH_REPORT_ID, .IsButton = isButton, .Field = field};
+
+  if (isButton)
+  {
+    hidp->ButtonCaps[hidp->NumButtonCaps++] = cap;
+  }
+  else
+  {
+    hidp->ValueCaps[hidp->NumValueCaps++] = cap;
+  }
+}
+
+static void mInitializeBenchDevice(unsigned int numSlots, BENCH_DEVICE* device)
+{
+  memset(device, 0, sizeof(BENCH_DEVICE));
+  device->NumSlots = numSlots;
+
+  unsigned int scanTimeBitOffset     = (1 + (numSlots * BENCH_CB_CONTACT)) * 8;
+  unsigned int contactCountBitOffset = scanTimeBitOffset + 16;
+  unsigned int buttonBitOffset       = contactCountBitOffset + 8;
+  device->cbReport                   = (buttonBitOffset / 8) + 1;
+
+  HID_TOUCH_DECODE_PLAN* plan = &device->Plan;
+  EMULATED_HIDP_DATA* hidp    = &device->HidP;
+  mInitializeTouchDecodePlan(plan);
+  plan->ReportID     = BENCH_REPORT_ID;
+  plan->NumContacts  = numSlots;
+  plan->ContactCount = mMakeField(contactCountBitOffset, 8, BENCH_MAX_FINGERS);
+
+  // link collection 0 is the top-level collection, the fingers are 1..numSlots
+  for (unsigned int slotIdx = 0; slotIdx < numSlots; slotIdx++)
+  {
+    unsigned int contactBitOffset     = (1 + (slotIdx * BENCH_CB_CONTACT)) * 8;
+    USHORT linkColID                  = (USHORT)(slotIdx + 1);
+    HID_TOUCH_CONTACT_LAYOUT* contact = &plan->Contacts[slotIdx];
+
+    contact->LinkColID = linkColID;
+    contact->TipSwitch = mMakeField(contactBitOffset, 1, 1);
+    contact->ContactID = mMakeField(contactBitOffset + 2, 6, 63);
+    contact->X         = mMakeField(contactBitOffset + 8, 16, 4095);
+    contact->Y         = mMakeField(contactBitOffset + 24, 16, 4095);
+
+    mAddCap(hidp, 1, USAGE_PAGE_DIGITIZER, USAGE_TIP_SWITCH, linkColID, contact->TipSwitch);
+    mAddCap(hidp, 1, USAGE_PAGE_DIGITIZER, USAGE_CONFIDENCE, linkColID, mMakeField(contactBitOffset + 1, 1, 1));
+    mAddCap(hidp, 0, USAGE_PAGE_DIGITIZER, USAGE_CONTACT_ID, linkColID, contact->ContactID);
+    mAddCap(hidp, 0, USAGE_PAGE_GENERIC, USAGE_GENERIC_X, linkColID, contact->X);
+    mAddCap(hidp, 0, USAGE_PAGE_GENERIC, USAGE_GENERIC_Y, linkColID, contact->Y);
+  }
+
+  mAddCap(hidp, 0, USAGE_PAGE_DIGITIZER, USAGE_SCAN_TIME, 0, mMakeField(scanTimeBitOffset, 16, 65535));
+  mAddCap(hidp, 0, USAGE_PAGE_DIGITIZER, USAGE_CONTACT_COUNT, 0, plan->ContactCount);
+  mAddCap(hidp, 1, USAGE_PAGE_BUTTON, 1, 0, mMakeField(buttonBitOffset, 1, 1));
+
+  hidp->ContactCountLinkCollection = 0;
+  hidp->NumContactLinkCollections  = numSlots;
+
+  mFinalizeTouchDecodePlan(plan);
+}
+
+// HidP_GetUsageValue: find the value cap, check the report ID, extract the bits
+static int mGetUsageValueByScanning(const EMULATED_HIDP_DATA* hidp, USHORT usagePage, USHORT linkCollection, USHORT usage, ULONG* value, const BYTE* report)
+{
+  for (unsigned int capIdx = 0; capIdx < hidp->NumValueCaps; capIdx++)
+  {
+    const EMULATED_HIDP_CAP* cap = &hidp->ValueCaps[capIdx];
+    if ((cap->UsagePage == usagePage) && (cap->Usage == usage) && (cap->LinkCollection == linkCollection))
+    {
+      if (report[0] != cap->ReportID)
+      {
+        return -1;
+      }
+
+      (*value) = mReadHidReportField(report, &cap->Field);
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+// HidP_MaxUsageListLength
+static ULONG mGetMaxUsageListLengthByScanning(const EMULATED_HIDP_DATA* hidp, USHORT usagePage)
+{
+  ULONG maxLength = 0;
+  for (unsigned int capIdx = 0; capIdx < hidp->NumButtonCaps; capIdx++)
+  {
+    maxLength += (hidp->ButtonCaps[capIdx].UsagePage == usagePage);
+  }
+
+  return maxLength;
+}
+
+// HidP_GetUsages: the usages of the buttons of the page and link collection that are on
+static int mGetUsagesByScanning(const EMULATED_HIDP_DATA* hidp, USHORT usagePage, USHORT linkCollection, USHORT* usages, ULONG* numUsages, const BYTE* report)
+{
+  ULONG maxUsages = (*numUsages);
+  (*numUsages)    = 0;
+
+  for (unsigned int capIdx = 0; capIdx < hidp->NumButtonCaps; capIdx++)
+  {
+    const EMULATED_HIDP_CAP* cap = &hidp->ButtonCaps[capIdx];
+    if ((cap->UsagePage != usagePage) || (cap->LinkCollection != linkCollection) || (report[0] != cap->ReportID))
+    {
+      continue;
+    }
+
+    if (mReadHidReportField(report, &cap->Field) != 0)
+    {
+      if ((*numUsages) == maxUsages)
+      {
+        return -1;
+      }
+
+      usages[(*numUsages)++] = cap->Usage;
+    }
+  }
+
+  return 0;
+}
+
+// The decoding of the old mHandleInputMessage, with the contact count of
+// hybrid reporting mode carried over like mDecodeTouchReport does.
+static int mDecodeReportByScanning(const EMULATED_HIDP_DATA* hidp, unsigned int* numPendingContacts, const BYTE* report, TOUCH_DATA* touches, unsigned int* numTouches)
+{
+  (*numTouches) = 0;
+
+  ULONG contactCount;
+  if (mGetUsageValueByScanning(hidp, USAGE_PAGE_DIGITIZER, hidp->ContactCountLinkCollection, USAGE_CONTACT_COUNT, &contactCount, report) != 0)
+  {
+    return -1;
+  }
+
+  if (contactCount != 0)
+  {
+    (*numPendingContacts) = contactCount;
+  }
+
+  unsigned int numContacts = ((*numPendingContacts) < hidp->NumContactLinkCollections) ? (*numPendingContacts) : hidp->NumContactLinkCollections;
+  (*numPendingContacts) -= numContacts;
+
+  for (unsigned int contactIdx = 0; contactIdx < numContacts; contactIdx++)
+  {
+    USHORT linkColID = (USHORT)(contactIdx + 1);
+    ULONG x;
+    ULONG y;
+    ULONG touchID;
+
+    if ((mGetUsageValueByScanning(hidp, USAGE_PAGE_GENERIC, linkColID, USAGE_GENERIC_X, &x, report) != 0) || (mGetUsageValueByScanning(hidp, USAGE_PAGE_GENERIC, linkColID, USAGE_GENERIC_Y, &y, report) != 0) || (mGetUsageValueByScanning(hidp, USAGE_PAGE_DIGITIZER, linkColID, USAGE_CONTACT_ID, &touchID, report) != 0))
+    {
+      return -1;
+    }
+
+    ULONG maxNumButtons = mGetMaxUsageListLengthByScanning(hidp, USAGE_PAGE_DIGITIZER);
+    ULONG numButtons    = maxNumButtons;
+    USHORT* usages      = (USHORT*)mMalloc(sizeof(USHORT) * maxNumButtons, __FILE__, __LINE__);
+
+    if (mGetUsagesByScanning(hidp, USAGE_PAGE_DIGITIZER, linkColID, usages, &numButtons, report) != 0)
+    {
+      free(usages);
+      return -1;
+    }
+
+    int isContactOnSurface = 0;
+    for (ULONG usageIdx = 0; usageIdx < numButtons; usageIdx++)
+    {
+      if (usages[usageIdx] == USAGE_TIP_SWITCH)
+      {
+        isContactOnSurface = 1;
+        break;
+      }
+    }
+
+    free(usages);
+
+    touches[contactIdx].TouchID        = touchID;
+    touches[contactIdx].X              = x;
+    touches[contactIdx].Y              = y;
+    touches[contactIdx].OnSurface      = isContactOnSurface;
+    touches[contactIdx].SequenceNumber = 0;
+  }
+
+  (*numTouches) = numContacts;
+
+  return 0;
+}
+
+// Frames of 1 to 5 fingers, each frame is split over as many reports as the device needs.
+static void mGenerateReports(const BENCH_DEVICE* device, unsigned int numFrames, BENCH_REPORTS* reports)
+{
+  unsigned int reportsPerFrame = (BENCH_MAX_FINGERS + device->NumSlots - 1) / device->NumSlots;
+
+  reports->Reports     = (BYTE*)mMalloc((size_t)numFrames * reportsPerFrame * device->cbReport, __FILE__, __LINE__);
+  reports->Contacts    = (TOUCH_DATA*)mMalloc(sizeof(TOUCH_DATA) * numFrames * BENCH_MAX_FINGERS, __FILE__, __LINE__);
+  reports->NumReports  = 0;
+  reports->NumContacts = 0;
+
+  unsigned int randomState = 12345;
+#define NEXT_RANDOM() (randomState = (randomState * 1103515245u) + 12345u, (randomState >> 16) & 0x7fff)
+
+  for (unsigned int frameIdx = 0; frameIdx < numFrames; frameIdx++)
+  {
+    unsigned int numFingers = 1 + (NEXT_RANDOM() % BENCH_MAX_FINGERS);
+
+    for (unsigned int fingerIdx = 0; fingerIdx < numFingers; fingerIdx++)
+    {
+      unsigned int slotIdx = fingerIdx % device->NumSlots;
+      if (slotIdx == 0)
+      {
+        BYTE* newReport = reports->Reports + ((size_t)reports->NumReports * device->cbReport);
+        memset(newReport, 0, device->cbReport);
+        newReport[0] = BENCH_REPORT_ID;
+        // the first report of the frame carries the contact count of the whole frame
+        newReport[device->Plan.ContactCount.BitOffset / 8] = (BYTE)((fingerIdx == 0) ? numFingers : 0);
+        newReport[device->cbReport - 4]                   = (BYTE)(frameIdx & 0xff);
+        reports->NumReports++;
+      }
+
+      TOUCH_DATA* touch = &reports->Contacts[reports->NumContacts++];
+      touch->TouchID    = fingerIdx;
+      touch->X          = NEXT_RANDOM() & 0xfff;
+      touch->Y          = NEXT_RANDOM() & 0xfff;
+      touch->OnSurface  = ((NEXT_RANDOM() % 16) != 0);
+
+      BYTE* contact = reports->Reports + ((size_t)(reports->NumReports - 1) * device->cbReport) + 1 + (slotIdx * BENCH_CB_CONTACT);
+      contact[0]    = (BYTE)((touch->OnSurface ? 0x01 : 0x00) | 0x02 | ((touch->TouchID & 0x3f) << 2));
+      contact[1]    = (BYTE)(touch->X & 0xff);
+      contact[2]    = (BYTE)((touch->X >> 8) & 0xff);
+      contact[3]    = (BYTE)(touch->Y & 0xff);
+      contact[4]    = (BYTE)((touch->Y >> 8) & 0xff);
+    }
+  }
+#undef NEXT_RANDOM
+}
+
+static int mCheckContacts(const char* name, const BENCH_REPORTS* reports, const TOUCH_DATA* decoded, unsigned int numDecoded)
+{
+  if (numDecoded != reports->NumContacts)
+  {
+    printf(FG_RED);
+    printf("%s decoded %u contacts instead of %u at %s:%d\n", name, numDecoded, reports->NumContacts, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  for (unsigned int contactIdx = 0; contactIdx < numDecoded; contactIdx++)
+  {
+    const TOUCH_DATA* expected = &reports->Contacts[contactIdx];
+    const TOUCH_DATA* actual   = &decoded[contactIdx];
+
+    if ((actual->TouchID != expected->TouchID) || (actual->X != expected->X) || (actual->Y != expected->Y) || (actual->OnSurface != expected->OnSurface))
+    {
+      printf(FG_RED);
+      printf("%s decoded contact #%u as (%u, %u, %u, %d) instead of (%u, %u, %u, %d) at %s:%d\n", name, contactIdx, actual->TouchID, actual->X, actual->Y, actual->OnSurface, expected->TouchID, expected->X, expected->Y, expected->OnSurface, __FILE__, __LINE__);
+      printf(RESET_COLOR);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static double mGetSeconds(unsigned long long start, unsigned long long end)
+{
+  return (double)(end - start) / (double)mGetTimestampFrequency();
+}
+
+// returns -1 if a decoder does not produce the generated contacts
+static int mRunBench(const char* modeName, unsigned int numSlots, unsigned int numFrames)
+{
+  BENCH_DEVICE device;
+  mInitializeBenchDevice(numSlots, &device);
+
+  BENCH_REPORTS reports;
+  mGenerateReports(&device, numFrames, &reports);
+
+  TOUCH_DATA* decoded = (TOUCH_DATA*)mMalloc(sizeof(TOUCH_DATA) * (reports.NumContacts + HID_TOUCH_DECODE_PLAN_MAX_CONTACTS), __FILE__, __LINE__);
+  int retval          = 0;
+
+  // before: a lookup in the caps for every value of every contact
+  unsigned int numPendingContacts = 0;
+  unsigned int numDecoded         = 0;
+  unsigned long long startTime    = mGetTimestamp();
+
+  for (unsigned int reportIdx = 0; reportIdx < reports.NumReports; reportIdx++)
+  {
+    unsigned int numTouches;
+    if (mDecodeReportByScanning(&device.HidP, &numPendingContacts, reports.Reports + ((size_t)reportIdx * device.cbReport), &decoded[numDecoded], &numTouches) == 0)
+    {
+      numDecoded += numTouches;
+    }
+  }
+
+  double scanningSeconds = mGetSeconds(startTime, mGetTimestamp());
+  retval                 = mCheckContacts("The caps lookups", &reports, decoded, numDecoded);
+
+  // after: the decode plan
+  HID_TOUCH_DECODE_STATE state;
+  mResetTouchDecodeState(&state);
+  numDecoded = 0;
+  startTime  = mGetTimestamp();
+
+  for (unsigned int reportIdx = 0; reportIdx < reports.NumReports; reportIdx++)
+  {
+    unsigned int numTouches;
+    if (mDecodeTouchReport(&device.Plan, &state, reports.Reports + ((size_t)reportIdx * device.cbReport), device.cbReport, &decoded[numDecoded], &numTouches) == 0)
+    {
+      numDecoded += numTouches;
+    }
+  }
+
+  double planSeconds = mGetSeconds(startTime, mGetTimestamp());
+  if (retval == 0)
+  {
+    retval = mCheckContacts("mDecodeTouchReport", &reports, decoded, numDecoded);
+  }
+
+  if (retval == 0)
+  {
+    printf("%-9s %5u  %9u  %9.2e/s  %9.2e/s  %6.1fx\n", modeName, numSlots, reports.NumReports, reports.NumContacts / scanningSeconds, reports.NumContacts / planSeconds, scanningSeconds / planSeconds);
+  }
+
+  free(decoded);
+  free(reports.Reports);
+  free(reports.Contacts);
+
+  return retval;
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned int numFrames = 1000000;
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--frames") == 0) && ((argIdx + 1) < argc))
+    {
+      numFrames = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else
+    {
+      numFrames = 0;
+      break;
+    }
+  }
+
+  if (numFrames == 0)
+  {
+    printf("Usage: %s [--frames <count>]\n", argv[0]);
+    return -1;
+  }
+
+  printf("%-9s %5s  %9s  %11s  %11s  %7s\n", "mode", "slots", "reports", "caps lookup", "decode plan", "speedup");
+
+  if ((mRunBench("parallel", BENCH_MAX_FINGERS, numFrames) != 0) || (mRunBench("hybrid", 2, numFrames) != 0))
+  {
+    return -1;
+  }
+
+  printf(FG_GREEN);
+  printf("Both decoders produce the generated contacts: OK\n");
+  printf(RESET_COLOR);
+
+  return 0;
+}
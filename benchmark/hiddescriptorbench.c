@@ -0,0 +1,804 @@
+// Test and benchmark of the HID report descriptor parser
+// (touchpad/hiddescriptor.h) on hand-written Precision Touchpad descriptors.
+// None of them was captured from a device and no HidP caps were recorded:
+// the expected HID_DEVICE_INFO (link collections, Has* flags, PhysicalRect,
+// ContactCountLinkCollection) and decode plan are what
+// mParseConnectedInputDevices and mCompileTouchDecodePlan should build from
+// the HidP_* caps of each descriptor, written out below by hand following the
+// HID 1.11 item rules and HidP's numbering of link collections. A report is
+// then built from the expected layout and decoded with the parsed plan.
+// Descriptors and caps captured from real touchpads still have to be added.
+//
+// Descriptors:
+//   ms_sample  the sample descriptor of the Windows Precision Touchpad
+//              documentation (touchpad, configuration and mouse collections,
+//              5 contacts per report), report IDs chosen here
+//   hybrid2    2 contacts per report for hybrid reporting mode with 12 bit
+//              coordinates, Push/Pop and 32 bit (page:usage) usages
+//   combo      a keyboard collection before the touchpad, the contacts nested
+//              in a logical collection and one collection that cannot be
+//              decoded (no contact ID or Y)
+//   noid       a single finger without Report ID items, the fields still
+//              start after the report ID byte, which is 0
+// plus malformed descriptors that must be rejected (e.g. a Report Count of
+// 2^32 - 1), and each descriptor is parsed repeatedly to measure the parser.
+// It exits with -1 on the first difference.
+//
+//   gcc -O2 -I../touchpad -o hiddescriptorbench hiddescriptorbench.c ../touchpad/hiddescriptor.c ../touchpad/hiddecoder.c ../touchpad/threading.c ../touchpad/utils.c ../touchpad/hashindex.c -lpthread
+//
+// Usage: hiddescriptorbench [--iterations <count>]
+//   --iterations parses of every descriptor for the measurement (default 100000)
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "hiddecoder.h"
+#include "hiddescriptor.h"
+
+#define FIELD(bitOffset, bitSize, logicalMin, logicalMax) {.BitOffset = (bitOffset), .BitSize = (bitSize), .LogicalMin = (logicalMin), .LogicalMax = (logicalMax)}
+
+// report IDs of the sample descriptor
+#define MS_SAMPLE_REPORTID_TOUCHPAD        0x01
+#define MS_SAMPLE_REPORTID_MOUSE           0x02
+#define MS_SAMPLE_REPORTID_FEATURE         0x03
+#define MS_SAMPLE_REPORTID_FUNCTION_SWITCH 0x04
+#define MS_SAMPLE_REPORTID_MAX_COUNT       0x05
+#define MS_SAMPLE_REPORTID_PTPHQA          0x06
+
+#define MS_SAMPLE_FINGER                                                          \
+  0x05, 0x0d,       /*   USAGE_PAGE (Digitizers)                       */         \
+  0x09, 0x22,       /*   USAGE (Finger)                                */         \
+  0xa1, 0x02,       /*   COLLECTION (Logical)                          */         \
+  0x15, 0x00,       /*     LOGICAL_MINIMUM (0)                         */         \
+  0x25, 0x01,       /*     LOGICAL_MAXIMUM (1)                         */         \
+  0x09, 0x47,       /*     USAGE (Confidence)                          */         \
+  0x09, 0x42,       /*     USAGE (Tip switch)                          */         \
+  0x95, 0x02,       /*     REPORT_COUNT (2)                            */         \
+  0x75, 0x01,       /*     REPORT_SIZE (1)                             */         \
+  0x81, 0x02,       /*     INPUT (Data,Var,Abs)                        */         \
+  0x95, 0x01,       /*     REPORT_COUNT (1)                            */         \
+  0x75, 0x02,       /*     REPORT_SIZE (2)                             */         \
+  0x25, 0x02,       /*     LOGICAL_MAXIMUM (2)                         */         \
+  0x09, 0x51,       /*     USAGE (Contact Identifier)                  */         \
+  0x81, 0x02,       /*     INPUT (Data,Var,Abs)                        */         \
+  0x75, 0x01,       /*     REPORT_SIZE (1)                             */         \
+  0x95, 0x04,       /*     REPORT_COUNT (4)                            */         \
+  0x81, 0x03,       /*     INPUT (Cnst,Var,Abs)                        */         \
+  0x05, 0x01,       /*     USAGE_PAGE (Generic Desktop)                */         \
+  0x15, 0x00,       /*     LOGICAL_MINIMUM (0)                         */         \
+  0x26, 0xff, 0x0f, /*     LOGICAL_MAXIMUM (4095)                      */         \
+  0x75, 0x10,       /*     REPORT_SIZE (16)                            */         \
+  0x55, 0x0e,       /*     UNIT_EXPONENT (-2)                          */         \
+  0x65, 0x13,       /*     UNIT (Inch,EngLinear)                       */         \
+  0x09, 0x30,       /*     USAGE (X)                                   */         \
+  0x35, 0x00,       /*     PHYSICAL_MINIMUM (0)                        */         \
+  0x46, 0x90, 0x01, /*     PHYSICAL_MAXIMUM (400)                      */         \
+  0x95, 0x01,       /*     REPORT_COUNT (1)                            */         \
+  0x81, 0x02,       /*     INPUT (Data,Var,Abs)                        */         \
+  0x46, 0x13, 0x01, /*     PHYSICAL_MAXIMUM (275)                      */         \
+  0x09, 0x31,       /*     USAGE (Y)                                   */         \
+  0x81, 0x02,       /*     INPUT (Data,Var,Abs)                        */         \
+  0xc0              /*   END_COLLECTION                                */
+
+static const BYTE s_msSampleDescriptor[] = {
+  0x05, 0x0d,                         // USAGE_PAGE (Digitizers)
+  0x09, 0x05,                         // USAGE (Touch Pad)
+  0xa1, 0x01,                         // COLLECTION (Application)
+  0x85, MS_SAMPLE_REPORTID_TOUCHPAD,  //   REPORT_ID (Touch pad)
+  MS_SAMPLE_FINGER,
+  MS_SAMPLE_FINGER,
+  MS_SAMPLE_FINGER,
+  MS_SAMPLE_FINGER,
+  MS_SAMPLE_FINGER,
+  0x55, 0x0c,                         //   UNIT_EXPONENT (-4)
+  0x66, 0x01, 0x10,                   //   UNIT (Seconds)
+  0x47, 0xff, 0xff, 0x00, 0x00,       //   PHYSICAL_MAXIMUM (65535)
+  0x27, 0xff, 0xff, 0x00, 0x00,       //   LOGICAL_MAXIMUM (65535)
+  0x75, 0x10,                         //   REPORT_SIZE (16)
+  0x95, 0x01,                         //   REPORT_COUNT (1)
+  0x05, 0x0d,                         //   USAGE_PAGE (Digitizers)
+  0x09, 0x56,                         //   USAGE (Scan Time)
+  0x81, 0x02,                         //   INPUT (Data,Var,Abs)
+  0x09, 0x54,                         //   USAGE (Contact count)
+  0x25, 0x7f,                         //   LOGICAL_MAXIMUM (127)
+  0x95, 0x01,                         //   REPORT_COUNT (1)
+  0x75, 0x08,                         //   REPORT_SIZE (8)
+  0x81, 0x02,                         //   INPUT (Data,Var,Abs)
+  0x05, 0x09,                         //   USAGE_PAGE (Button)
+  0x09, 0x01,                         //   USAGE (Button 1)
+  0x25, 0x01,                         //   LOGICAL_MAXIMUM (1)
+  0x75, 0x01,                         //   REPORT_SIZE (1)
+  0x95, 0x01,                         //   REPORT_COUNT (1)
+  0x81, 0x02,                         //   INPUT (Data,Var,Abs)
+  0x95, 0x07,                         //   REPORT_COUNT (7)
+  0x81, 0x03,                         //   INPUT (Cnst,Var,Abs)
+  0x05, 0x0d,                         //   USAGE_PAGE (Digitizers)
+  0x85, MS_SAMPLE_REPORTID_MAX_COUNT, //   REPORT_ID (Feature)
+  0x09, 0x55,                         //   USAGE (Contact Count Maximum)
+  0x09, 0x59,                         //   USAGE (Pad Type)
+  0x75, 0x04,                         //   REPORT_SIZE (4)
+  0x95, 0x02,                         //   REPORT_COUNT (2)
+  0x25, 0x0f,                         //   LOGICAL_MAXIMUM (15)
+  0xb1, 0x02,                         //   FEATURE (Data,Var,Abs)
+  0x06, 0x00, 0xff,                   //   USAGE_PAGE (Vendor Defined)
+  0x85, MS_SAMPLE_REPORTID_PTPHQA,    //   REPORT_ID (PTPHQA)
+  0x09, 0xc5,                         //   USAGE (Vendor Usage 0xC5)
+  0x15, 0x00,                         //   LOGICAL_MINIMUM (0)
+  0x26, 0xff, 0x00,                   //   LOGICAL_MAXIMUM (0xff)
+  0x75, 0x08,                         //   REPORT_SIZE (8)
+  0x96, 0x00, 0x01,                   //   REPORT_COUNT (0x100 (256))
+  0xb1, 0x02,                         //   FEATURE (Data,Var,Abs)
+  0xc0,                               // END_COLLECTION
+
+  0x05, 0x0d,                              // USAGE_PAGE (Digitizer)
+  0x09, 0x0e,                              // USAGE (Configuration)
+  0xa1, 0x01,                              // COLLECTION (Application)
+  0x85, MS_SAMPLE_REPORTID_FEATURE,        //   REPORT_ID (Feature)
+  0x09, 0x22,                              //   USAGE (Finger)
+  0xa1, 0x02,                              //   COLLECTION (logical)
+  0x09, 0x52,                              //     USAGE (Input Mode)
+  0x15, 0x00,                              //     LOGICAL_MINIMUM (0)
+  0x25, 0x0a,                              //     LOGICAL_MAXIMUM (10)
+  0x75, 0x08,                              //     REPORT_SIZE (8)
+  0x95, 0x01,                              //     REPORT_COUNT (1)
+  0xb1, 0x02,                              //     FEATURE (Data,Var,Abs)
+  0xc0,                                    //   END_COLLECTION
+  0x09, 0x22,                              //   USAGE (Finger)
+  0xa1, 0x00,                              //   COLLECTION (physical)
+  0x85, MS_SAMPLE_REPORTID_FUNCTION_SWITCH, //     REPORT_ID (Feature)
+  0x09, 0x57,                              //     USAGE (Surface switch)
+  0x09, 0x58,                              //     USAGE (Button switch)
+  0x75, 0x01,                              //     REPORT_SIZE (1)
+  0x95, 0x02,                              //     REPORT_COUNT (2)
+  0x25, 0x01,                              //     LOGICAL_MAXIMUM (1)
+  0xb1, 0x02,                              //     FEATURE (Data,Var,Abs)
+  0x95, 0x06,                              //     REPORT_COUNT (6)
+  0xb1, 0x03,                              //     FEATURE (Cnst,Var,Abs)
+  0xc0,                                    //   END_COLLECTION
+  0xc0,                                    // END_COLLECTION
+
+  0x05, 0x01,                      // USAGE_PAGE (Generic Desktop)
+  0x09, 0x02,                      // USAGE (Mouse)
+  0xa1, 0x01,                      // COLLECTION (Application)
+  0x85, MS_SAMPLE_REPORTID_MOUSE,  //   REPORT_ID (Mouse)
+  0x09, 0x01,                      //   USAGE (Pointer)
+  0xa1, 0x00,                      //   COLLECTION (Physical)
+  0x05, 0x09,                      //     USAGE_PAGE (Button)
+  0x19, 0x01,                      //     USAGE_MINIMUM (Button 1)
+  0x29, 0x02,                      //     USAGE_MAXIMUM (Button 2)
+  0x25, 0x01,                      //     LOGICAL_MAXIMUM (1)
+  0x75, 0x01,                      //     REPORT_SIZE (1)
+  0x95, 0x02,                      //     REPORT_COUNT (2)
+  0x81, 0x02,                      //     INPUT (Data,Var,Abs)
+  0x95, 0x06,                      //     REPORT_COUNT (6)
+  0x81, 0x03,                      //     INPUT (Cnst,Var,Abs)
+  0x05, 0x01,                      //     USAGE_PAGE (Generic Desktop)
+  0x09, 0x30,                      //     USAGE (X)
+  0x09, 0x31,                      //     USAGE (Y)
+  0x75, 0x10,                      //     REPORT_SIZE (16)
+  0x95, 0x02,                      //     REPORT_COUNT (2)
+  0x25, 0x0a,                      //     LOGICAL_MAXIMUM (10)
+  0x81, 0x06,                      //     INPUT (Data,Var,Rel)
+  0xc0,                            //   END_COLLECTION
+  0xc0,                            // END_COLLECTION
+};
+
+#define HYBRID2_FINGER                                                              \
+  0x05, 0x0d,                   /*   USAGE_PAGE (Digitizers)                 */     \
+  0x09, 0x22,                   /*   USAGE (Finger)                          */     \
+  0xa1, 0x02,                   /*   COLLECTION (Logical)                    */     \
+  0x15, 0x00,                   /*     LOGICAL_MINIMUM (0)                   */     \
+  0x25, 0x0f,                   /*     LOGICAL_MAXIMUM (15)                  */     \
+  0x75, 0x08,                   /*     REPORT_SIZE (8)                       */     \
+  0x95, 0x01,                   /*     REPORT_COUNT (1)                      */     \
+  0x09, 0x51,                   /*     USAGE (Contact Identifier)            */     \
+  0x81, 0x02,                   /*     INPUT (Data,Var,Abs)                  */     \
+  0x25, 0x01,                   /*     LOGICAL_MAXIMUM (1)                   */     \
+  0x75, 0x01,                   /*     REPORT_SIZE (1)                       */     \
+  0x95, 0x02,                   /*     REPORT_COUNT (2)                      */     \
+  0x09, 0x42,                   /*     USAGE (Tip switch)                    */     \
+  0x09, 0x47,                   /*     USAGE (Confidence)                    */     \
+  0x81, 0x02,                   /*     INPUT (Data,Var,Abs)                  */     \
+  0x95, 0x06,                   /*     REPORT_COUNT (6)                      */     \
+  0x81, 0x03,                   /*     INPUT (Cnst,Var,Abs)                  */     \
+  0xa4,                         /*     PUSH                                  */     \
+  0x26, 0xff, 0x0f,             /*     LOGICAL_MAXIMUM (4095)                */     \
+  0x75, 0x0c,                   /*     REPORT_SIZE (12)                      */     \
+  0x95, 0x01,                   /*     REPORT_COUNT (1)                      */     \
+  0x35, 0x00,                   /*     PHYSICAL_MINIMUM (0)                  */     \
+  0x46, 0xb0, 0x04,             /*     PHYSICAL_MAXIMUM (1200)               */     \
+  0x0b, 0x30, 0x00, 0x01, 0x00, /*     USAGE (Generic Desktop:X)             */     \
+  0x81, 0x02,                   /*     INPUT (Data,Var,Abs)                  */     \
+  0x46, 0x20, 0x03,             /*     PHYSICAL_MAXIMUM (800)                */     \
+  0x0b, 0x31, 0x00, 0x01, 0x00, /*     USAGE (Generic Desktop:Y)             */     \
+  0x81, 0x02,                   /*     INPUT (Data,Var,Abs)                  */     \
+  0xb4,                         /*     POP                                   */     \
+  0x25, 0x3f,                   /*     LOGICAL_MAXIMUM (63)                  */     \
+  0x75, 0x08,                   /*     REPORT_SIZE (8)                       */     \
+  0x95, 0x01,                   /*     REPORT_COUNT (1)                      */     \
+  0x09, 0x48,                   /*     USAGE (Width)                         */     \
+  0x81, 0x02,                   /*     INPUT (Data,Var,Abs)                  */     \
+  0x09, 0x49,                   /*     USAGE (Height)                        */     \
+  0x81, 0x02,                   /*     INPUT (Data,Var,Abs)                  */     \
+  0xc0                          /*   END_COLLECTION                          */
+
+static const BYTE s_hybrid2Descriptor[] = {
+  0x05, 0x0d,                   // USAGE_PAGE (Digitizers)
+  0x09, 0x05,                   // USAGE (Touch Pad)
+  0xa1, 0x01,                   // COLLECTION (Application)
+  0x85, 0x03,                   //   REPORT_ID (3)
+  HYBRID2_FINGER,
+  HYBRID2_FINGER,
+  0x05, 0x0d,                   //   USAGE_PAGE (Digitizers)
+  0x09, 0x54,                   //   USAGE (Contact count)
+  0x25, 0x05,                   //   LOGICAL_MAXIMUM (5)
+  0x75, 0x08,                   //   REPORT_SIZE (8)
+  0x95, 0x01,                   //   REPORT_COUNT (1)
+  0x81, 0x02,                   //   INPUT (Data,Var,Abs)
+  0x09, 0x56,                   //   USAGE (Scan Time)
+  0x27, 0xff, 0xff, 0x00, 0x00, //   LOGICAL_MAXIMUM (65535)
+  0x75, 0x10,                   //   REPORT_SIZE (16)
+  0x81, 0x02,                   //   INPUT (Data,Var,Abs)
+  0xc0,                         // END_COLLECTION
+};
+
+#define COMBO_FINGER                                                          \
+  0x09, 0x22,       /*     USAGE (Finger)                          */         \
+  0xa1, 0x00,       /*     COLLECTION (Physical)                   */         \
+  0x15, 0x00,       /*       LOGICAL_MINIMUM (0)                   */         \
+  0x25, 0x01,       /*       LOGICAL_MAXIMUM (1)                   */         \
+  0x75, 0x01,       /*       REPORT_SIZE (1)                       */         \
+  0x95, 0x01,       /*       REPORT_COUNT (1)                      */         \
+  0x09, 0x42,       /*       USAGE (Tip switch)                    */         \
+  0x81, 0x02,       /*       INPUT (Data,Var,Abs)                  */         \
+  0x95, 0x07,       /*       REPORT_COUNT (7)                      */         \
+  0x81, 0x03,       /*       INPUT (Cnst,Var,Abs)                  */         \
+  0x26, 0xff, 0x00, /*       LOGICAL_MAXIMUM (255)                 */         \
+  0x75, 0x08,       /*       REPORT_SIZE (8)                       */         \
+  0x95, 0x01,       /*       REPORT_COUNT (1)                      */         \
+  0x09, 0x51,       /*       USAGE (Contact Identifier)            */         \
+  0x81, 0x02,       /*       INPUT (Data,Var,Abs)                  */         \
+  0x05, 0x01,       /*       USAGE_PAGE (Generic Desktop)          */         \
+  0x75, 0x10,       /*       REPORT_SIZE (16)                      */         \
+  0x26, 0xb8, 0x0b, /*       LOGICAL_MAXIMUM (3000)                */         \
+  0x35, 0x00,       /*       PHYSICAL_MINIMUM (0)                  */         \
+  0x46, 0xe8, 0x03, /*       PHYSICAL_MAXIMUM (1000)               */         \
+  0x09, 0x30,       /*       USAGE (X)                             */         \
+  0x81, 0x02,       /*       INPUT (Data,Var,Abs)                  */         \
+  0x26, 0xd0, 0x07, /*       LOGICAL_MAXIMUM (2000)                */         \
+  0x46, 0x9a, 0x02, /*       PHYSICAL_MAXIMUM (666)                */         \
+  0x09, 0x31,       /*       USAGE (Y)                             */         \
+  0x81, 0x02,       /*       INPUT (Data,Var,Abs)                  */         \
+  0x05, 0x0d,       /*       USAGE_PAGE (Digitizers)               */         \
+  0xc0              /*     END_COLLECTION                          */
+
+// the keyboard collection at the start of s_comboDescriptor
+#define COMBO_CB_KEYBOARD 45
+
+static const BYTE s_comboDescriptor[] = {
+  0x05, 0x01,       // USAGE_PAGE (Generic Desktop)
+  0x09, 0x06,       // USAGE (Keyboard)
+  0xa1, 0x01,       // COLLECTION (Application)
+  0x85, 0x01,       //   REPORT_ID (1)
+  0x05, 0x07,       //   USAGE_PAGE (Keyboard)
+  0x19, 0xe0,       //   USAGE_MINIMUM (Keyboard LeftControl)
+  0x29, 0xe7,       //   USAGE_MAXIMUM (Keyboard Right GUI)
+  0x15, 0x00,       //   LOGICAL_MINIMUM (0)
+  0x25, 0x01,       //   LOGICAL_MAXIMUM (1)
+  0x75, 0x01,       //   REPORT_SIZE (1)
+  0x95, 0x08,       //   REPORT_COUNT (8)
+  0x81, 0x02,       //   INPUT (Data,Var,Abs)
+  0x95, 0x01,       //   REPORT_COUNT (1)
+  0x75, 0x08,       //   REPORT_SIZE (8)
+  0x81, 0x03,       //   INPUT (Cnst,Var,Abs)
+  0x95, 0x06,       //   REPORT_COUNT (6)
+  0x75, 0x08,       //   REPORT_SIZE (8)
+  0x26, 0xff, 0x00, //   LOGICAL_MAXIMUM (255)
+  0x19, 0x00,       //   USAGE_MINIMUM (Reserved (no event indicated))
+  0x2a, 0xff, 0x00, //   USAGE_MAXIMUM (255)
+  0x81, 0x00,       //   INPUT (Data,Ary,Abs)
+  0xc0,             // END_COLLECTION
+
+  0x06, 0x0d, 0x00, // USAGE_PAGE (Digitizers)
+  0x09, 0x05,       // USAGE (Touch Pad)
+  0xa1, 0x01,       // COLLECTION (Application)
+  0x85, 0x02,       //   REPORT_ID (2)
+  0xa1, 0x02,       //   COLLECTION (Logical)
+  COMBO_FINGER,
+  COMBO_FINGER,
+  COMBO_FINGER,
+  0x09, 0x22,       //     USAGE (Finger)
+  0xa1, 0x00,       //     COLLECTION (Physical)
+  0x25, 0x01,       //       LOGICAL_MAXIMUM (1)
+  0x75, 0x01,       //       REPORT_SIZE (1)
+  0x95, 0x01,       //       REPORT_COUNT (1)
+  0x09, 0x42,       //       USAGE (Tip switch)
+  0x81, 0x02,       //       INPUT (Data,Var,Abs)
+  0x95, 0x07,       //       REPORT_COUNT (7)
+  0x81, 0x03,       //       INPUT (Cnst,Var,Abs)
+  0x05, 0x01,       //       USAGE_PAGE (Generic Desktop)
+  0x75, 0x10,       //       REPORT_SIZE (16)
+  0x95, 0x01,       //       REPORT_COUNT (1)
+  0x26, 0xb8, 0x0b, //       LOGICAL_MAXIMUM (3000)
+  0x46, 0xe8, 0x03, //       PHYSICAL_MAXIMUM (1000)
+  0x09, 0x30,       //       USAGE (X)
+  0x81, 0x02,       //       INPUT (Data,Var,Abs)
+  0x05, 0x0d,       //       USAGE_PAGE (Digitizers)
+  0xc0,             //     END_COLLECTION
+  0xc0,             //   END_COLLECTION
+  0x25, 0x04,       //   LOGICAL_MAXIMUM (4)
+  0x75, 0x08,       //   REPORT_SIZE (8)
+  0x95, 0x01,       //   REPORT_COUNT (1)
+  0x09, 0x54,       //   USAGE (Contact count)
+  0x81, 0x02,       //   INPUT (Data,Var,Abs)
+  0xc0,             // END_COLLECTION
+};
+
+// a single finger without Report ID items, the reports still start with a 0 ID byte
+static const BYTE s_noReportIDDescriptor[] = {
+  0x05, 0x0d,       // USAGE_PAGE (Digitizers)
+  0x09, 0x05,       // USAGE (Touch Pad)
+  0xa1, 0x01,       // COLLECTION (Application)
+  0x09, 0x22,       //   USAGE (Finger)
+  0xa1, 0x02,       //   COLLECTION (Logical)
+  0x15, 0x00,       //     LOGICAL_MINIMUM (0)
+  0x25, 0x01,       //     LOGICAL_MAXIMUM (1)
+  0x75, 0x01,       //     REPORT_SIZE (1)
+  0x95, 0x01,       //     REPORT_COUNT (1)
+  0x09, 0x42,       //     USAGE (Tip switch)
+  0x81, 0x02,       //     INPUT (Data,Var,Abs)
+  0x95, 0x07,       //     REPORT_COUNT (7)
+  0x81, 0x03,       //     INPUT (Cnst,Var,Abs)
+  0x25, 0x0f,       //     LOGICAL_MAXIMUM (15)
+  0x75, 0x08,       //     REPORT_SIZE (8)
+  0x95, 0x01,       //     REPORT_COUNT (1)
+  0x09, 0x51,       //     USAGE (Contact Identifier)
+  0x81, 0x02,       //     INPUT (Data,Var,Abs)
+  0x05, 0x01,       //     USAGE_PAGE (Generic Desktop)
+  0x26, 0xa0, 0x0f, //     LOGICAL_MAXIMUM (4000)
+  0x75, 0x10,       //     REPORT_SIZE (16)
+  0x35, 0x00,       //     PHYSICAL_MINIMUM (0)
+  0x46, 0xe8, 0x03, //     PHYSICAL_MAXIMUM (1000)
+  0x09, 0x30,       //     USAGE (X)
+  0x81, 0x02,       //     INPUT (Data,Var,Abs)
+  0x26, 0x60, 0x09, //     LOGICAL_MAXIMUM (2400)
+  0x46, 0x58, 0x02, //     PHYSICAL_MAXIMUM (600)
+  0x09, 0x31,       //     USAGE (Y)
+  0x81, 0x02,       //     INPUT (Data,Var,Abs)
+  0x05, 0x0d,       //     USAGE_PAGE (Digitizers)
+  0xc0,             //   END_COLLECTION
+  0x25, 0x01,       //   LOGICAL_MAXIMUM (1)
+  0x75, 0x08,       //   REPORT_SIZE (8)
+  0x09, 0x54,       //   USAGE (Contact count)
+  0x81, 0x02,       //   INPUT (Data,Var,Abs)
+  0xc0,             // END_COLLECTION
+};
+
+// the contact of link collection linkColID, the fingers start after the report ID byte
+#define MS_SAMPLE_CONTACT(linkColID)                                                         \
+  {.LinkColID = (linkColID),                                                                 \
+   .X         = FIELD(8 + (40 * ((linkColID) - 1)) + 8, 16, 0, 4095),                        \
+   .Y         = FIELD(8 + (40 * ((linkColID) - 1)) + 24, 16, 0, 4095),                       \
+   .ContactID = FIELD(8 + (40 * ((linkColID) - 1)) + 2, 2, 0, 2),                            \
+   .TipSwitch = FIELD(8 + (40 * ((linkColID) - 1)) + 1, 1, 0, 1)}
+
+#define HYBRID2_CONTACT(linkColID)                                                           \
+  {.LinkColID = (linkColID),                                                                 \
+   .X         = FIELD(8 + (56 * ((linkColID) - 1)) + 16, 12, 0, 4095),                       \
+   .Y         = FIELD(8 + (56 * ((linkColID) - 1)) + 28, 12, 0, 4095),                       \
+   .ContactID = FIELD(8 + (56 * ((linkColID) - 1)), 8, 0, 15),                               \
+   .TipSwitch = FIELD(8 + (56 * ((linkColID) - 1)) + 8, 1, 0, 1)}
+
+// the fingers are link collections 2 to 4 inside the logical collection 1
+#define COMBO_CONTACT(linkColID)                                                             \
+  {.LinkColID = (linkColID),                                                                 \
+   .X         = FIELD(8 + (48 * ((linkColID) - 2)) + 16, 16, 0, 3000),                       \
+   .Y         = FIELD(8 + (48 * ((linkColID) - 2)) + 32, 16, 0, 2000),                       \
+   .ContactID = FIELD(8 + (48 * ((linkColID) - 2)) + 8, 8, 0, 255),                          \
+   .TipSwitch = FIELD(8 + (48 * ((linkColID) - 2)), 1, 0, 1)}
+
+#define LINK_COLLECTION(linkColID, rectLeft, rectTop, rectRight, rectBottom, hasX, hasY, hasContactID, hasTipSwitch, hasConfidence, hasWidth, hasHeight) \
+  {.LinkColID = (linkColID), .PhysicalRect = {.left = (rectLeft), .top = (rectTop), .right = (rectRight), .bottom = (rectBottom)}, .HasX = (hasX), .HasY = (hasY), .HasContactID = (hasContactID), .HasTipSwitch = (hasTipSwitch), .HasConfidence = (hasConfidence), .HasWidth = (hasWidth), .HasHeight = (hasHeight), .HasPressure = 0}
+
+static const HID_TOUCH_LINK_COL_INFO s_msSampleLinkCollections[] = {
+  LINK_COLLECTION(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0),
+  LINK_COLLECTION(1, 0, 0, 400, 275, 1, 1, 1, 1, 1, 0, 0),
+  LINK_COLLECTION(2, 0, 0, 400, 275, 1, 1, 1, 1, 1, 0, 0),
+  LINK_COLLECTION(3, 0, 0, 400, 275, 1, 1, 1, 1, 1, 0, 0),
+  LINK_COLLECTION(4, 0, 0, 400, 275, 1, 1, 1, 1, 1, 0, 0),
+  LINK_COLLECTION(5, 0, 0, 400, 275, 1, 1, 1, 1, 1, 0, 0),
+};
+
+static const HID_TOUCH_LINK_COL_INFO s_hybrid2LinkCollections[] = {
+  LINK_COLLECTION(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0),
+  LINK_COLLECTION(1, 0, 0, 1200, 800, 1, 1, 1, 1, 1, 1, 1),
+  LINK_COLLECTION(2, 0, 0, 1200, 800, 1, 1, 1, 1, 1, 1, 1),
+};
+
+// the logical collection 1 has no fields
+static const HID_TOUCH_LINK_COL_INFO s_comboLinkCollections[] = {
+  LINK_COLLECTION(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0),
+  LINK_COLLECTION(2, 0, 0, 1000, 666, 1, 1, 1, 1, 0, 0, 0),
+  LINK_COLLECTION(3, 0, 0, 1000, 666, 1, 1, 1, 1, 0, 0, 0),
+  LINK_COLLECTION(4, 0, 0, 1000, 666, 1, 1, 1, 1, 0, 0, 0),
+  LINK_COLLECTION(5, 0, 0, 1000, 0, 1, 0, 0, 1, 0, 0, 0),
+};
+
+static const HID_TOUCH_LINK_COL_INFO s_noReportIDLinkCollections[] = {
+  LINK_COLLECTION(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0),
+  LINK_COLLECTION(1, 0, 0, 1000, 600, 1, 1, 1, 1, 0, 0, 0),
+};
+
+struct DESCRIPTOR_CASE
+{
+  const char* Name;
+  const BYTE* Descriptor;
+  unsigned int cbDescriptor;
+  const HID_TOUCH_LINK_COL_INFO* LinkCollections;
+  unsigned int NumLinkCollections;
+  USHORT ContactCountLinkCollection;
+  HID_TOUCH_DECODE_PLAN Plan;
+};
+
+typedef struct DESCRIPTOR_CASE DESCRIPTOR_CASE;
+
+static const DESCRIPTOR_CASE s_descriptorCases[] = {
+  {
+    .Name                       = "ms_sample",
+    .Descriptor                 = s_msSampleDescriptor,
+    .cbDescriptor               = sizeof(s_msSampleDescriptor),
+    .LinkCollections            = s_msSampleLinkCollections,
+    .NumLinkCollections         = sizeof(s_msSampleLinkCollections) / sizeof(s_msSampleLinkCollections[0]),
+    .ContactCountLinkCollection = 0,
+    // 5 contacts of 5 bytes, scan time, contact count, button
+    .Plan = {.IsValid = 1, .ReportID = MS_SAMPLE_REPORTID_TOUCHPAD, .cbMinReport = 29, .ContactCount = FIELD(224, 8, 0, 127), .Contacts = {MS_SAMPLE_CONTACT(1), MS_SAMPLE_CONTACT(2), MS_SAMPLE_CONTACT(3), MS_SAMPLE_CONTACT(4), MS_SAMPLE_CONTACT(5)}, .NumContacts = 5},
+  },
+  {
+    .Name                       = "hybrid2",
+    .Descriptor                 = s_hybrid2Descriptor,
+    .cbDescriptor               = sizeof(s_hybrid2Descriptor),
+    .LinkCollections            = s_hybrid2LinkCollections,
+    .NumLinkCollections         = sizeof(s_hybrid2LinkCollections) / sizeof(s_hybrid2LinkCollections[0]),
+    .ContactCountLinkCollection = 0,
+    // 2 contacts of 7 bytes, contact count, scan time
+    .Plan = {.IsValid = 1, .ReportID = 3, .cbMinReport = 16, .ContactCount = FIELD(120, 8, 0, 5), .Contacts = {HYBRID2_CONTACT(1), HYBRID2_CONTACT(2)}, .NumContacts = 2},
+  },
+  {
+    .Name                       = "combo",
+    .Descriptor                 = s_comboDescriptor,
+    .cbDescriptor               = sizeof(s_comboDescriptor),
+    .LinkCollections            = s_comboLinkCollections,
+    .NumLinkCollections         = sizeof(s_comboLinkCollections) / sizeof(s_comboLinkCollections[0]),
+    .ContactCountLinkCollection = 0,
+    // 3 contacts of 6 bytes, the collection without contact ID (3 bytes), contact count
+    .Plan = {.IsValid = 1, .ReportID = 2, .cbMinReport = 23, .ContactCount = FIELD(176, 8, 0, 4), .Contacts = {COMBO_CONTACT(2), COMBO_CONTACT(3), COMBO_CONTACT(4)}, .NumContacts = 3},
+  },
+  {
+    .Name                       = "noid",
+    .Descriptor                 = s_noReportIDDescriptor,
+    .cbDescriptor               = sizeof(s_noReportIDDescriptor),
+    .LinkCollections            = s_noReportIDLinkCollections,
+    .NumLinkCollections         = sizeof(s_noReportIDLinkCollections) / sizeof(s_noReportIDLinkCollections[0]),
+    .ContactCountLinkCollection = 0,
+    // the 0 ID byte, 1 contact of 6 bytes, contact count
+    .Plan = {.IsValid = 1, .ReportID = 0, .cbMinReport = 8, .ContactCount = FIELD(56, 8, 0, 1), .Contacts = {{.LinkColID = 1, .X = FIELD(24, 16, 0, 4000), .Y = FIELD(40, 16, 0, 2400), .ContactID = FIELD(16, 8, 0, 15), .TipSwitch = FIELD(8, 1, 0, 1)}}, .NumContacts = 1},
+  },
+};
+
+static const BYTE s_hugeReportCountDescriptor[] = {0x05, 0x0d, 0x09, 0x05, 0xa1, 0x01, 0x85, 0x01, 0x09, 0x22, 0xa1, 0x02, 0x75, 0x01, 0x97, 0xff, 0xff, 0xff, 0xff, 0x09, 0x42, 0x81, 0x02, 0xc0, 0xc0};
+static const BYTE s_hugeReportSizeDescriptor[]  = {0x05, 0x0d, 0x09, 0x05, 0xa1, 0x01, 0x85, 0x01, 0x09, 0x22, 0xa1, 0x02, 0x77, 0xff, 0xff, 0xff, 0xff, 0x95, 0x02, 0x09, 0x42, 0x81, 0x02, 0xc0, 0xc0};
+static const BYTE s_truncatedDescriptor[]       = {0x05, 0x0d, 0x09, 0x05, 0xa1, 0x01, 0x85};
+static const BYTE s_unbalancedDescriptor[]      = {0x05, 0x0d, 0x09, 0x05, 0xa1, 0x01, 0xc0, 0xc0};
+static const BYTE s_inputOutsideDescriptor[]    = {0x75, 0x08, 0x95, 0x01, 0x81, 0x02};
+static const BYTE s_reportIdZeroDescriptor[]    = {0x05, 0x0d, 0x09, 0x05, 0xa1, 0x01, 0x85, 0x00, 0xc0};
+static const BYTE s_popDescriptor[]             = {0x05, 0x0d, 0x09, 0x05, 0xa1, 0x01, 0xb4, 0xc0};
+static const BYTE s_pushDescriptor[]            = {0x05, 0x0d, 0x09, 0x05, 0xa1, 0x01, 0xa4, 0xa4, 0xa4, 0xa4, 0xa4, 0xa4, 0xa4, 0xa4, 0xa4, 0xc0};
+static const BYTE s_deepDescriptor[]            = {0x05, 0x0d, 0x09, 0x05, 0xa1, 0x01, 0xa1, 0x02, 0xa1, 0x02, 0xa1, 0x02, 0xa1, 0x02, 0xa1, 0x02, 0xa1, 0x02, 0xa1, 0x02, 0xa1, 0x02, 0xa1, 0x02, 0xa1, 0x02, 0xa1, 0x02, 0xa1, 0x02, 0xa1, 0x02, 0xa1, 0x02, 0xa1, 0x02, 0xa1, 0x02};
+
+struct MALFORMED_CASE
+{
+  const char* Name;
+  const BYTE* Descriptor;
+  unsigned int cbDescriptor;
+};
+
+typedef struct MALFORMED_CASE MALFORMED_CASE;
+
+static const MALFORMED_CASE s_malformedCases[] = {
+  {"Report Count 2^32 - 1", s_hugeReportCountDescriptor, sizeof(s_hugeReportCountDescriptor)},
+  {"Report Size 2^32 - 1", s_hugeReportSizeDescriptor, sizeof(s_hugeReportSizeDescriptor)},
+  {"truncated item", s_truncatedDescriptor, sizeof(s_truncatedDescriptor)},
+  {"unbalanced End Collection", s_unbalancedDescriptor, sizeof(s_unbalancedDescriptor)},
+  {"Input outside of a collection", s_inputOutsideDescriptor, sizeof(s_inputOutsideDescriptor)},
+  {"Report ID 0", s_reportIdZeroDescriptor, sizeof(s_reportIdZeroDescriptor)},
+  {"Pop without Push", s_popDescriptor, sizeof(s_popDescriptor)},
+  {"9 Push items", s_pushDescriptor, sizeof(s_pushDescriptor)},
+  {"17 nested collections", s_deepDescriptor, sizeof(s_deepDescriptor)},
+  {"no touchpad collection", s_comboDescriptor, COMBO_CB_KEYBOARD},
+};
+
+// the list is reused between the parses like the device list reuses its entries
+static void mResetDeviceInfo(HID_DEVICE_INFO* deviceInfo)
+{
+  deviceInfo->LinkColInfoList.Size = 0;
+  mClearHashIndex(&deviceInfo->LinkColInfoList.LinkColIndex);
+}
+
+static void mFreeDeviceInfo(HID_DEVICE_INFO* deviceInfo)
+{
+  free(deviceInfo->LinkColInfoList.Entries);
+  mFreeHashIndex(&deviceInfo->LinkColInfoList.LinkColIndex);
+  memset(deviceInfo, 0, sizeof(HID_DEVICE_INFO));
+}
+
+static int mIsSameField(const HID_REPORT_FIELD* left, const HID_REPORT_FIELD* right)
+{
+  return (left->BitOffset == right->BitOffset) && (left->BitSize == right->BitSize) && (left->LogicalMin == right->LogicalMin) && (left->LogicalMax == right->LogicalMax);
+}
+
+static void mWriteHidReportField(BYTE* report, const HID_REPORT_FIELD* field, ULONG value)
+{
+  for (unsigned int bitIdx = 0; bitIdx < field->BitSize; bitIdx++)
+  {
+    unsigned int bitOffset = field->BitOffset + bitIdx;
+    BYTE mask              = (BYTE)(1 << (bitOffset & 7));
+
+    if ((value >> bitIdx) & 1)
+    {
+      report[bitOffset >> 3] |= mask;
+    }
+    else
+    {
+      report[bitOffset >> 3] &= (BYTE)~mask;
+    }
+  }
+}
+
+static int mFailCase(const char* caseName, const char* message, unsigned int value, unsigned int expectedValue)
+{
+  printf(FG_RED);
+  printf("%s: %s is %u instead of %u\n", caseName, message, value, expectedValue);
+  printf(RESET_COLOR);
+  return -1;
+}
+
+static int mCheckLinkCollections(const DESCRIPTOR_CASE* descriptorCase, HID_DEVICE_INFO* deviceInfo)
+{
+  HID_LINK_COL_INFO_LIST* linkColInfoList = &deviceInfo->LinkColInfoList;
+
+  if (linkColInfoList->Size != descriptorCase->NumLinkCollections)
+  {
+    return mFailCase(descriptorCase->Name, "the number of link collections", linkColInfoList->Size, descriptorCase->NumLinkCollections);
+  }
+
+  for (unsigned int linkColIdx = 0; linkColIdx < descriptorCase->NumLinkCollections; linkColIdx++)
+  {
+    const HID_TOUCH_LINK_COL_INFO* expected = &descriptorCase->LinkCollections[linkColIdx];
+
+    unsigned int foundLinkColIdx;
+    if (mFindInHashIndex(&linkColInfoList->LinkColIndex, expected->LinkColID, &foundLinkColIdx) != 0)
+    {
+      return mFailCase(descriptorCase->Name, "a missing link collection", expected->LinkColID, expected->LinkColID);
+    }
+
+    const HID_TOUCH_LINK_COL_INFO* actual = &linkColInfoList->Entries[foundLinkColIdx];
+
+    int isSame = (actual->LinkColID == expected->LinkColID) && (actual->HasX == expected->HasX) && (actual->HasY == expected->HasY) && (actual->HasContactID == expected->HasContactID) && (actual->HasTipSwitch == expected->HasTipSwitch) && (actual->HasConfidence == expected->HasConfidence) && (actual->HasWidth == expected->HasWidth) && (actual->HasHeight == expected->HasHeight) && (actual->HasPressure == expected->HasPressure);
+    isSame     = isSame && (actual->PhysicalRect.left == expected->PhysicalRect.left) && (actual->PhysicalRect.top == expected->PhysicalRect.top) && (actual->PhysicalRect.right == expected->PhysicalRect.right) && (actual->PhysicalRect.bottom == expected->PhysicalRect.bottom);
+
+    if (!isSame)
+    {
+      printf(FG_RED);
+      printf("%s: link collection %u has X %d, Y %d, contact ID %d, tip switch %d, confidence %d, width %d, height %d, pressure %d and physical rect (%d, %d, %d, %d)\n", descriptorCase->Name, expected->LinkColID, actual->HasX, actual->HasY, actual->HasContactID, actual->HasTipSwitch, actual->HasConfidence, actual->HasWidth, actual->HasHeight, actual->HasPressure, actual->PhysicalRect.left, actual->PhysicalRect.top, actual->PhysicalRect.right, actual->PhysicalRect.bottom);
+      printf(RESET_COLOR);
+      return -1;
+    }
+  }
+
+  if (deviceInfo->ContactCountLinkCollection != descriptorCase->ContactCountLinkCollection)
+  {
+    return mFailCase(descriptorCase->Name, "the contact count link collection", deviceInfo->ContactCountLinkCollection, descriptorCase->ContactCountLinkCollection);
+  }
+
+  return 0;
+}
+
+static int mCheckDecodePlan(const DESCRIPTOR_CASE* descriptorCase, const HID_TOUCH_DECODE_PLAN* plan)
+{
+  const HID_TOUCH_DECODE_PLAN* expected = &descriptorCase->Plan;
+
+  if (plan->IsValid != expected->IsValid)
+  {
+    return mFailCase(descriptorCase->Name, "IsValid", plan->IsValid, expected->IsValid);
+  }
+
+  if (plan->ReportID != expected->ReportID)
+  {
+    return mFailCase(descriptorCase->Name, "the report ID", plan->ReportID, expected->ReportID);
+  }
+
+  if (plan->cbMinReport != expected->cbMinReport)
+  {
+    return mFailCase(descriptorCase->Name, "cbMinReport", plan->cbMinReport, expected->cbMinReport);
+  }
+
+  if (plan->NumContacts != expected->NumContacts)
+  {
+    return mFailCase(descriptorCase->Name, "the number of contacts", plan->NumContacts, expected->NumContacts);
+  }
+
+  if (!mIsSameField(&plan->ContactCount, &expected->ContactCount))
+  {
+    return mFailCase(descriptorCase->Name, "the bit offset of the contact count", plan->ContactCount.BitOffset, expected->ContactCount.BitOffset);
+  }
+
+  for (unsigned int contactIdx = 0; contactIdx < expected->NumContacts; contactIdx++)
+  {
+    const HID_TOUCH_CONTACT_LAYOUT* actualContact   = &plan->Contacts[contactIdx];
+    const HID_TOUCH_CONTACT_LAYOUT* expectedContact = &expected->Contacts[contactIdx];
+
+    if ((actualContact->LinkColID != expectedContact->LinkColID) || !mIsSameField(&actualContact->X, &expectedContact->X) || !mIsSameField(&actualContact->Y, &expectedContact->Y) || !mIsSameField(&actualContact->ContactID, &expectedContact->ContactID) || !mIsSameField(&actualContact->TipSwitch, &expectedContact->TipSwitch))
+    {
+      printf(FG_RED);
+      printf("%s: the layout of contact #%u (link collection %u) differs\n", descriptorCase->Name, contactIdx, actualContact->LinkColID);
+      printf(RESET_COLOR);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+// a report with every contact on the surface, written with the expected layout and decoded with the parsed plan
+static int mCheckDecodedReport(const DESCRIPTOR_CASE* descriptorCase, const HID_TOUCH_DECODE_PLAN* plan)
+{
+  const HID_TOUCH_DECODE_PLAN* expected = &descriptorCase->Plan;
+
+  BYTE report[64];
+  memset(report, 0xA5, sizeof(report));
+  report[0] = expected->ReportID;
+  mWriteHidReportField(report, &expected->ContactCount, expected->NumContacts);
+
+  for (unsigned int contactIdx = 0; contactIdx < expected->NumContacts; contactIdx++)
+  {
+    const HID_TOUCH_CONTACT_LAYOUT* layout = &expected->Contacts[contactIdx];
+    mWriteHidReportField(report, &layout->ContactID, (contactIdx + 1) % (layout->ContactID.LogicalMax + 1));
+    mWriteHidReportField(report, &layout->X, (ULONG)layout->X.LogicalMax - (contactIdx * 101));
+    mWriteHidReportField(report, &layout->Y, 17 + (contactIdx * 31));
+    mWriteHidReportField(report, &layout->TipSwitch, 1);
+  }
+
+  HID_TOUCH_DECODE_STATE state;
+  mResetTouchDecodeState(&state);
+
+  TOUCH_DATA touches[HID_TOUCH_DECODE_PLAN_MAX_CONTACTS];
+  unsigned int numTouches;
+
+  if (mDecodeTouchReport(plan, &state, report, expected->cbMinReport, touches, &numTouches) != 0)
+  {
+    printf(FG_RED);
+    printf("%s: a report of %u bytes was not decoded\n", descriptorCase->Name, expected->cbMinReport);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  if (numTouches != expected->NumContacts)
+  {
+    return mFailCase(descriptorCase->Name, "the number of decoded contacts", numTouches, expected->NumContacts);
+  }
+
+  for (unsigned int contactIdx = 0; contactIdx < numTouches; contactIdx++)
+  {
+    const HID_TOUCH_CONTACT_LAYOUT* layout = &expected->Contacts[contactIdx];
+
+    if (touches[contactIdx].TouchID != ((contactIdx + 1) % (layout->ContactID.LogicalMax + 1)) || (touches[contactIdx].X != ((ULONG)layout->X.LogicalMax - (contactIdx * 101))) || (touches[contactIdx].Y != (17 + (contactIdx * 31))) || !touches[contactIdx].OnSurface)
+    {
+      printf(FG_RED);
+      printf("%s: decoded contact #%u is (%u, %u, %u, %d)\n", descriptorCase->Name, contactIdx, touches[contactIdx].TouchID, touches[contactIdx].X, touches[contactIdx].Y, touches[contactIdx].OnSurface);
+      printf(RESET_COLOR);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static double mGetSeconds(unsigned long long start, unsigned long long end)
+{
+  return (double)(end - start) / (double)mGetTimestampFrequency();
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned int numIterations = 100000;
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--iterations") == 0) && ((argIdx + 1) < argc))
+    {
+      numIterations = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else
+    {
+      numIterations = 0;
+      break;
+    }
+  }
+
+  if (numIterations == 0)
+  {
+    printf("Usage: %s [--iterations <count>]\n", argv[0]);
+    return -1;
+  }
+
+  HID_DEVICE_INFO deviceInfo;
+  memset(&deviceInfo, 0, sizeof(HID_DEVICE_INFO));
+
+  printf("descriptor  bytes  contacts  link collections  parse\n");
+
+  for (unsigned int caseIdx = 0; caseIdx < (sizeof(s_descriptorCases) / sizeof(s_descriptorCases[0])); caseIdx++)
+  {
+    const DESCRIPTOR_CASE* descriptorCase = &s_descriptorCases[caseIdx];
+
+    mResetDeviceInfo(&deviceInfo);
+    if (mParseHidReportDescriptor(descriptorCase->Descriptor, descriptorCase->cbDescriptor, HID_USAGE_PAGE_DIGITIZER, HID_USAGE_DIGITIZER_TOUCH_PAD, &deviceInfo) != 0)
+    {
+      printf(FG_RED);
+      printf("%s: the descriptor was rejected\n", descriptorCase->Name);
+      printf(RESET_COLOR);
+      return -1;
+    }
+
+    if ((mCheckLinkCollections(descriptorCase, &deviceInfo) != 0) || (mCheckDecodePlan(descriptorCase, &deviceInfo.DecodePlan) != 0) || (mCheckDecodedReport(descriptorCase, &deviceInfo.DecodePlan) != 0))
+    {
+      return -1;
+    }
+
+    unsigned long long startTime = mGetTimestamp();
+
+    for (unsigned int iterationIdx = 0; iterationIdx < numIterations; iterationIdx++)
+    {
+      mResetDeviceInfo(&deviceInfo);
+      mParseHidReportDescriptor(descriptorCase->Descriptor, descriptorCase->cbDescriptor, HID_USAGE_PAGE_DIGITIZER, HID_USAGE_DIGITIZER_TOUCH_PAD, &deviceInfo);
+    }
+
+    double seconds = mGetSeconds(startTime, mGetTimestamp());
+
+    printf("%-10s  %5u  %8u  %16u  %8.2f us\n", descriptorCase->Name, descriptorCase->cbDescriptor, deviceInfo.DecodePlan.NumContacts, deviceInfo.LinkColInfoList.Size, seconds * 1e6 / numIterations);
+  }
+
+  printf("malformed descriptors:\n");
+
+  for (unsigned int caseIdx = 0; caseIdx < (sizeof(s_malformedCases) / sizeof(s_malformedCases[0])); caseIdx++)
+  {
+    const MALFORMED_CASE* malformedCase = &s_malformedCases[caseIdx];
+
+    mResetDeviceInfo(&deviceInfo);
+    unsigned long long startTime = mGetTimestamp();
+    int retval                   = mParseHidReportDescriptor(malformedCase->Descriptor, malformedCase->cbDescriptor, HID_USAGE_PAGE_DIGITIZER, HID_USAGE_DIGITIZER_TOUCH_PAD, &deviceInfo);
+    double seconds               = mGetSeconds(startTime, mGetTimestamp());
+
+    if ((retval == 0) || deviceInfo.DecodePlan.IsValid)
+    {
+      printf(FG_RED);
+      printf("%s: the descriptor was accepted\n", malformedCase->Name);
+      printf(RESET_COLOR);
+      return -1;
+    }
+
+    printf("  %-30s rejected in %.2f us\n", malformedCase->Name, seconds * 1e6);
+  }
+
+  mFreeDeviceInfo(&deviceInfo);
+
+  printf(FG_GREEN);
+  printf("The parsed descriptors match the expected caps: OK\n");
+  printf(RESET_COLOR);
+
+  return 0;
+}
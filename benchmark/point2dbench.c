@@ -0,0 +1,161 @@
+// Microbenchmark of appending points to a Point2DList (touchpad/point2d.h)
+// one at a time like mHandleTouchEventsMessage does during a stroke. The
+// append that the list used before it tracked a capacity (allocate Size + 1
+// points, copy the whole stroke and free the old array on every point) is
+// kept here as the reference. Both build the same strokes and the points are
+// checked against each other; it exits with -1 on the first difference.
+//
+//   gcc -O2 -DCOUNT_MEMORY_ALLOCATIONS -I../touchpad -o point2dbench point2dbench.c ../touchpad/point2d.c ../touchpad/threading.c ../touchpad/utils.c ../touchpad/hashindex.c ../touchpad/hiddecoder.c -lpthread
+//
+// Usage: point2dbench [--points <count>]
+//   --points points appended per measurement and per stroke length (default 2000000)
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "point2d.h"
+
+// the reference is quadratic, it appends at most this many points per stroke length
+#define MAX_COPYING_POINTS 200000
+
+static const unsigned int s_strokeLengths[] = {16, 256, 4096};
+
+struct COPYING_POINT_LIST
+{
+  Point2D* Entries;
+  unsigned int Size;
+};
+
+typedef struct COPYING_POINT_LIST COPYING_POINT_LIST;
+
+// mAppendPoint2DToList before the list had a capacity
+static void mAppendPointByCopying(Point2D point, COPYING_POINT_LIST* list)
+{
+  unsigned int newArraySize = list->Size + 1;
+  Point2D* newArray         = (Point2D*)mMalloc(sizeof(Point2D) * newArraySize, __FILE__, __LINE__);
+
+  for (unsigned int pIdx = 0; pIdx < list->Size; pIdx++)
+  {
+    newArray[pIdx].X = list->Entries[pIdx].X;
+    newArray[pIdx].Y = list->Entries[pIdx].Y;
+  }
+
+  newArray[list->Size].X = point.X;
+  newArray[list->Size].Y = point.Y;
+
+  free(list->Entries);
+
+  list->Entries = newArray;
+  list->Size    = newArraySize;
+}
+
+static Point2D mGetStrokePoint(unsigned int pointIdx)
+{
+  Point2D point;
+  point.X = 1000 + ((pointIdx * 7) & 1023);
+  point.Y = 1000 + ((pointIdx * 13) & 1023);
+  return point;
+}
+
+static double mGetSeconds(unsigned long long start, unsigned long long end)
+{
+  return (double)(end - start) / (double)mGetTimestampFrequency();
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned int numPoints = 2000000;
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--points") == 0) && ((argIdx + 1) < argc))
+    {
+      numPoints = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else
+    {
+      numPoints = 0;
+      break;
+    }
+  }
+
+  if (numPoints == 0)
+  {
+    printf("Usage: %s [--points <count>]\n", argv[0]);
+    return -1;
+  }
+
+  printf("points/stroke        before                        after\n");
+
+  for (unsigned int lengthIdx = 0; lengthIdx < (sizeof(s_strokeLengths) / sizeof(s_strokeLengths[0])); lengthIdx++)
+  {
+    unsigned int strokeLength = s_strokeLengths[lengthIdx];
+
+    unsigned int numCopyingPoints  = (numPoints < MAX_COPYING_POINTS) ? numPoints : MAX_COPYING_POINTS;
+    unsigned int numCopyingStrokes = (numCopyingPoints + strokeLength - 1) / strokeLength;
+    unsigned int numStrokes        = (numPoints + strokeLength - 1) / strokeLength;
+
+    // before: a new array for every point
+    unsigned long long startAllocations = mGetNumMemoryAllocations();
+    unsigned long long startTime        = mGetTimestamp();
+    COPYING_POINT_LIST copyingList      = {.Entries = NULL, .Size = 0};
+
+    for (unsigned int strokeIdx = 0; strokeIdx < numCopyingStrokes; strokeIdx++)
+    {
+      free(copyingList.Entries);
+      copyingList.Entries = NULL;
+      copyingList.Size    = 0;
+
+      for (unsigned int pointIdx = 0; pointIdx < strokeLength; pointIdx++)
+      {
+        mAppendPointByCopying(mGetStrokePoint(pointIdx), &copyingList);
+      }
+    }
+
+    double copyingSeconds                 = mGetSeconds(startTime, mGetTimestamp());
+    unsigned long long copyingAllocations = mGetNumMemoryAllocations() - startAllocations;
+
+    // after: a fresh list for every stroke, as mCreateNewStroke starts one
+    startAllocations = mGetNumMemoryAllocations();
+    startTime        = mGetTimestamp();
+    Point2DList list;
+    memset(&list, 0, sizeof(Point2DList));
+
+    for (unsigned int strokeIdx = 0; strokeIdx < numStrokes; strokeIdx++)
+    {
+      mFreePoint2DList(&list);
+
+      for (unsigned int pointIdx = 0; pointIdx < strokeLength; pointIdx++)
+      {
+        mAppendPoint2DToList(mGetStrokePoint(pointIdx), &list);
+      }
+    }
+
+    double seconds                 = mGetSeconds(startTime, mGetTimestamp());
+    unsigned long long allocations = mGetNumMemoryAllocations() - startAllocations;
+
+    if ((list.Size != strokeLength) || (copyingList.Size != strokeLength) || (memcmp(list.Entries, copyingList.Entries, sizeof(Point2D) * strokeLength) != 0))
+    {
+      printf(FG_RED);
+      printf("The points of a stroke of %u points differ at %s:%d\n", strokeLength, __FILE__, __LINE__);
+      printf(RESET_COLOR);
+      return -1;
+    }
+
+    printf("%-13u %9.2e/s, %5.1f allocs/stroke  %9.2e/s, %5.1f allocs/stroke\n", strokeLength, (double)numCopyingStrokes * strokeLength / copyingSeconds, (double)copyingAllocations / numCopyingStrokes, (double)numStrokes * strokeLength / seconds, (double)allocations / numStrokes);
+
+    free(copyingList.Entries);
+    mFreePoint2DList(&list);
+  }
+
+  printf(FG_GREEN);
+  printf("The points are the same: OK\n");
+  printf(RESET_COLOR);
+
+  return 0;
+}
@@ -0,0 +1,106 @@
+// Throughput of the anti-aliased capsule rasterizer of the canvas
+// (touchpad/canvas.h) at several stroke widths. Random short segments (like
+// the moves of a finger between two reports) are blended into a 1920x1080
+// canvas. The covered pixels are the area of the capsules. The checksum of the
+// canvas is the same for every kernel, so builds with different kernels can be
+// compared:
+//
+//   gcc -O2 -I../touchpad -o rasterbench rasterbench.c ../touchpad/canvas.c ../touchpad/segmentgrid.c ../touchpad/stroke.c ../touchpad/point2d.c ../touchpad/threading.c ../touchpad/utils.c ../touchpad/hashindex.c ../touchpad/hiddecoder.c -lm -lpthread
+//   (add -mavx2 for the AVX2 kernel or -DCANVAS_DISABLE_SIMD for the scalar one)
+//
+// Usage: rasterbench [--segments <count>]
+#include "platform.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+#include "threading.h"
+#include "canvas.h"
+
+#define CANVAS_WIDTH 1920
+#define CANVAS_HEIGHT 1080
+#define MAX_SEGMENT_LENGTH 32
+
+int main(int argc, char* argv[])
+{
+  const float widths[5]    = {2.0f, 8.0f, 20.0f, 40.0f, 80.0f};
+  unsigned int numSegments = 200000;
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--segments") == 0) && ((argIdx + 1) < argc))
+    {
+      numSegments = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else
+    {
+      printf("Usage: %s [--segments <count>]\n", argv[0]);
+      return -1;
+    }
+  }
+
+  unsigned int* pixels = (unsigned int*)mMalloc(sizeof(unsigned int) * CANVAS_WIDTH * CANVAS_HEIGHT, __FILE__, __LINE__);
+  Point2D* points      = (Point2D*)mMalloc(sizeof(Point2D) * (numSegments + 1), __FILE__, __LINE__);
+  unsigned int* colors = (unsigned int*)mMalloc(sizeof(unsigned int) * numSegments, __FILE__, __LINE__);
+
+  // a random walk with steps of up to MAX_SEGMENT_LENGTH pixels and a random color per segment
+  unsigned int randomState = 11;
+#define NEXT_RANDOM() (randomState = (randomState * 1103515245u) + 12345u, (randomState >> 16) & 0x7fff)
+  points[0] = (Point2D){.X = CANVAS_WIDTH / 2, .Y = CANVAS_HEIGHT / 2};
+  for (unsigned int segmentIdx = 0; segmentIdx < numSegments; segmentIdx++)
+  {
+    long x = (long)points[segmentIdx].X + (long)(NEXT_RANDOM() % (MAX_SEGMENT_LENGTH + 1)) - (MAX_SEGMENT_LENGTH / 2);
+    long y = (long)points[segmentIdx].Y + (long)(NEXT_RANDOM() % (MAX_SEGMENT_LENGTH + 1)) - (MAX_SEGMENT_LENGTH / 2);
+
+    points[segmentIdx + 1].X = (ULONG)((x < 0) ? 0 : ((x >= CANVAS_WIDTH) ? (CANVAS_WIDTH - 1) : x));
+    points[segmentIdx + 1].Y = (ULONG)((y < 0) ? 0 : ((y >= CANVAS_HEIGHT) ? (CANVAS_HEIGHT - 1) : y));
+    colors[segmentIdx]       = CANVAS_COLOR(NEXT_RANDOM() & 0xff, NEXT_RANDOM() & 0xff, NEXT_RANDOM() & 0xff);
+  }
+#undef NEXT_RANDOM
+
+  printf("kernel: %s, %u segments of up to %d pixels on %dx%d\n", mGetCanvasKernelName(), numSegments, MAX_SEGMENT_LENGTH, CANVAS_WIDTH, CANVAS_HEIGHT);
+  printf("%6s %14s %16s %12s\n", "width", "M segments/s", "M pixels/s", "checksum");
+
+  for (unsigned int widthIdx = 0; widthIdx < 5; widthIdx++)
+  {
+    float width = widths[widthIdx];
+
+    CANVAS canvas;
+    mInitializeCanvas(&canvas, pixels, CANVAS_WIDTH, CANVAS_HEIGHT, CANVAS_WIDTH);
+    mFillCanvas(&canvas, CANVAS_COLOR(32, 32, 32));
+
+    // covered pixels, a rectangle of the length of the segment and a disk
+    double area = 0.0;
+    for (unsigned int segmentIdx = 0; segmentIdx < numSegments; segmentIdx++)
+    {
+      double dx = (double)points[segmentIdx + 1].X - (double)points[segmentIdx].X;
+      double dy = (double)points[segmentIdx + 1].Y - (double)points[segmentIdx].Y;
+      area += (width * sqrt((dx * dx) + (dy * dy))) + (3.14159265358979 * width * width * 0.25);
+    }
+
+    unsigned long long time = mGetTimestamp();
+    for (unsigned int segmentIdx = 0; segmentIdx < numSegments; segmentIdx++)
+    {
+      mDrawCanvasSegment(&canvas, points[segmentIdx], points[segmentIdx + 1], width, colors[segmentIdx]);
+    }
+    double seconds = (double)(mGetTimestamp() - time) / (double)mGetTimestampFrequency();
+
+    // FNV-1a of the pixels
+    unsigned int checksum = 2166136261u;
+    for (unsigned int pixelIdx = 0; pixelIdx < (CANVAS_WIDTH * CANVAS_HEIGHT); pixelIdx++)
+    {
+      checksum = (checksum ^ pixels[pixelIdx]) * 16777619u;
+    }
+
+    printf("%6.0f %14.2f %16.1f %12.8x\n", width, numSegments / seconds / 1e6, area / seconds / 1e6, checksum);
+  }
+
+  free(colors);
+  free(points);
+  free(pixels);
+
+  return 0;
+}
@@ -0,0 +1,436 @@
+// Headless benchmark of the background recognition worker
+// (touchpad/recognitionworker.h) with a database of the size of the jōyō set.
+// The characters are the synthetic ones of syntheticcharacters.h, written one
+// stroke at a time: every stroke is appended to a StrokeList, resampled and
+// submitted like the application does when a stroke ends.
+//
+// The serial pass scores every stroke on this thread, once from scratch with
+// mRecognizeStrokes and once with a RECOGNIZER_SESSION
+// (mRecognizeStrokesIncremental) that resumes the templates from the strokes
+// it already compared, and checks that both rank the same best candidate. It
+// also counts, after the first stroke of a character, the strokes that kept
+// its bounding box and the strokes where the session resumed from every
+// earlier stroke (the shapes do not depend on the bounding box).
+//
+// The worker passes submit the strokes to a RECOGNITION_WORKER, once back to
+// back (most requests are replaced or cancelled) and once with --interval ms
+// between two strokes, and report the time from the end of a stroke until its
+// result is taken, how long mSubmitRecognitionRequest blocks the caller and
+// whether the result of the last stroke has the best candidate of the serial
+// pass. --shortlist 0 compares every template, which is slow enough for the
+// requests to be cancelled while they are scored.
+//
+//   gcc -O2 -I../touchpad -o recognitionworkerbench recognitionworkerbench.c syntheticcharacters.c ../touchpad/recognitionworker.c ../touchpad/recognizer.c ../touchpad/dtw.c ../touchpad/resampler.c ../touchpad/stroke.c ../touchpad/point2d.c ../touchpad/hiddecoder.c ../touchpad/touchevents.c ../touchpad/workpool.c ../touchpad/threading.c ../touchpad/hashindex.c ../touchpad/utils.c -lm -lpthread
+//
+// Usage: recognitionworkerbench [--queries <count>] [--interval <ms>] [--threads <count>] [--shortlist <size>]
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "stroke.h"
+#include "resampler.h"
+#include "workpool.h"
+#include "recognizer.h"
+#include "syntheticcharacters.h"
+#include "recognitionworker.h"
+
+#define NUM_CANDIDATES    10
+// the same spacing as the application
+#define RESAMPLE_SPACING  8.0f
+// wait this long for the result of the last stroke before giving up
+#define RESULT_TIMEOUT_MS 10000
+
+// the same shortlist size as the application
+#define APPLICATION_SHORTLIST_SIZE 200
+
+// the times of a pass, in milliseconds
+struct TIME_SAMPLES
+{
+  double* Values;
+  unsigned int Size;
+  unsigned int Capacity;
+};
+
+typedef struct TIME_SAMPLES TIME_SAMPLES;
+
+// signaled by the worker thread when a result can be taken
+struct RESULT_SIGNAL
+{
+  THREAD_MUTEX Mutex;
+  THREAD_CONDITION Condition;
+  int IsResultReady;
+};
+
+typedef struct RESULT_SIGNAL RESULT_SIGNAL;
+
+static void mAddTimeSample(TIME_SAMPLES* samples, double milliseconds)
+{
+  if (samples->Size == samples->Capacity)
+  {
+    samples->Capacity = (samples->Capacity == 0) ? 1024 : (samples->Capacity * 2);
+    samples->Values   = (double*)mRealloc(samples->Values, sizeof(double) * samples->Capacity, __FILE__, __LINE__);
+  }
+
+  samples->Values[samples->Size] = milliseconds;
+  samples->Size++;
+}
+
+static int mCompareTimeSamples(const void* a, const void* b)
+{
+  double valueA = *((const double*)a);
+  double valueB = *((const double*)b);
+  return (valueA > valueB) - (valueA < valueB);
+}
+
+// mean, p50, p99 and max without the line break
+static void mPrintTimeSamples(const char* label, TIME_SAMPLES* samples)
+{
+  if (samples->Size == 0)
+  {
+    printf("%16s %10s %10s %10s %10s", label, "-", "-", "-", "-");
+    return;
+  }
+
+  double total = 0.0;
+  for (unsigned int sampleIdx = 0; sampleIdx < samples->Size; sampleIdx++)
+  {
+    total += samples->Values[sampleIdx];
+  }
+
+  qsort(samples->Values, samples->Size, sizeof(double), mCompareTimeSamples);
+  printf("%16s %10.3f %10.3f %10.3f %10.3f", label, total / samples->Size, samples->Values[samples->Size / 2], samples->Values[(unsigned int)(0.99 * (samples->Size - 1))], samples->Values[samples->Size - 1]);
+}
+
+static double mGetMilliseconds(unsigned long long start, unsigned long long end)
+{
+  return (double)(end - start) * 1e3 / (double)mGetTimestampFrequency();
+}
+
+// append stroke strokeIdx of the written character like the touch events would
+static void mCopyWrittenStroke(StrokeList* written, unsigned int strokeIdx, StrokeList* strokes)
+{
+  Point2D* points        = mGetStrokePoints(written, strokeIdx);
+  unsigned int numPoints = written->Entries[strokeIdx].Size;
+
+  mCreateNewStroke(points[0], strokes);
+  for (unsigned int pointIdx = 1; pointIdx < numPoints; pointIdx++)
+  {
+    mAppendPoint2DToLastStroke(points[pointIdx], strokes);
+  }
+}
+
+// the best candidate of every written character
+static void mRunSerialPass(const SYNTHETIC_CHARACTER* characters, unsigned int numQueries, const RECOGNIZER_DATABASE* database, unsigned int* bestCodePoints)
+{
+  StrokeList written;
+  StrokeList strokes;
+  STROKE_RESAMPLER resampler;
+  RECOGNIZER_SESSION session;
+  TIME_SAMPLES scratchTimes;
+  TIME_SAMPLES incrementalTimes;
+  memset(&written, 0, sizeof(StrokeList));
+  memset(&strokes, 0, sizeof(StrokeList));
+  memset(&scratchTimes, 0, sizeof(TIME_SAMPLES));
+  memset(&incrementalTimes, 0, sizeof(TIME_SAMPLES));
+  mInitializeStrokeResampler(&resampler, 65536, RECOGNIZER_MAX_STROKES, RESAMPLE_SPACING);
+  mInitializeRecognizerSession(&session, database);
+
+  volatile unsigned int cancel = 0;
+  unsigned int numStrokes      = 0;
+  unsigned int numSameBox      = 0;
+  unsigned int numResumed      = 0;
+  unsigned int numSameTop1     = 0;
+  unsigned int numTop1         = 0;
+  mSeedSyntheticRandom(SYNTHETIC_QUERY_RANDOM_SEED);
+
+  for (unsigned int queryIdx = 0; queryIdx < numQueries; queryIdx++)
+  {
+    unsigned int characterIdx = (unsigned int)(mRandomSyntheticFloat() * (NUM_SYNTHETIC_TEMPLATES - 1));
+    mClearStrokeList(&written);
+    mWriteSyntheticCharacter(&characters[characterIdx], &written);
+
+    mClearStrokeList(&strokes);
+    mClearStrokeResampler(&resampler);
+    mResetRecognizerSession(&session);
+    bestCodePoints[queryIdx] = (unsigned int)-1;
+
+    for (unsigned int strokeIdx = 0; strokeIdx < written.Size; strokeIdx++)
+    {
+      float previousScale, previousOffsetX, previousOffsetY;
+      mGetStrokeResamplerNormalization(&resampler, &previousScale, &previousOffsetX, &previousOffsetY);
+
+      mCopyWrittenStroke(&written, strokeIdx, &strokes);
+      mUpdateStrokeResampler(&resampler, &strokes);
+      mFinishResampledStroke(&resampler);
+
+      float scale, offsetX, offsetY;
+      mGetStrokeResamplerNormalization(&resampler, &scale, &offsetX, &offsetY);
+      numSameBox += (strokeIdx != 0) && (scale == previousScale) && (offsetX == previousOffsetX) && (offsetY == previousOffsetY);
+
+      RECOGNIZER_CANDIDATE scratchCandidates[NUM_CANDIDATES];
+      RECOGNIZER_CANDIDATE incrementalCandidates[NUM_CANDIDATES];
+      unsigned int numScratchCandidates;
+      unsigned int numIncrementalCandidates;
+
+      unsigned long long time = mGetTimestamp();
+      mRecognizeStrokes(database, &resampler, scratchCandidates, NUM_CANDIDATES, &numScratchCandidates);
+      mAddTimeSample(&scratchTimes, mGetMilliseconds(time, mGetTimestamp()));
+
+      time = mGetTimestamp();
+      mRecognizeStrokesIncremental(database, &session, &resampler, NULL, &cancel, incrementalCandidates, NUM_CANDIDATES, &numIncrementalCandidates);
+      mAddTimeSample(&incrementalTimes, mGetMilliseconds(time, mGetTimestamp()));
+
+      numResumed += (strokeIdx != 0) && (session.NumResumedStrokes == strokeIdx);
+
+      unsigned int scratchBest     = (numScratchCandidates != 0) ? scratchCandidates[0].CodePoint : (unsigned int)-1;
+      unsigned int incrementalBest = (numIncrementalCandidates != 0) ? incrementalCandidates[0].CodePoint : (unsigned int)-1;
+      numSameTop1 += (scratchBest == incrementalBest);
+      numStrokes++;
+
+      bestCodePoints[queryIdx] = incrementalBest;
+    }
+
+    numTop1 += (bestCodePoints[queryIdx] == (SYNTHETIC_FIRST_CODE_POINT + characterIdx));
+  }
+
+  unsigned int numLaterStrokes = numStrokes - numQueries;
+  printf("serial: %u strokes of %u characters, top-1 of the last stroke %.1f%%\n", numStrokes, numQueries, 100.0 * numTop1 / numQueries);
+  printf("after the first stroke: %.1f%% kept the bounding box, %.1f%% resumed the session\n", 100.0 * numSameBox / numLaterStrokes, 100.0 * numResumed / numLaterStrokes);
+  printf("%16s %10s %10s %10s %10s %12s\n", "per stroke", "mean ms", "p50 ms", "p99 ms", "max ms", "same top-1");
+  mPrintTimeSamples("scratch", &scratchTimes);
+  printf("\n");
+  mPrintTimeSamples("incremental", &incrementalTimes);
+  printf(" %11.1f%%\n", 100.0 * numSameTop1 / numStrokes);
+
+  free(scratchTimes.Values);
+  free(incrementalTimes.Values);
+  mFreeRecognizerSession(&session);
+  mFreeStrokeResampler(&resampler);
+  mFreeStrokeList(&strokes);
+  mFreeStrokeList(&written);
+}
+
+static void mSignalRecognitionResult(void* arg)
+{
+  RESULT_SIGNAL* signal = (RESULT_SIGNAL*)arg;
+
+  mLockThreadMutex(&signal->Mutex);
+  signal->IsResultReady = 1;
+  mSignalThreadCondition(&signal->Condition);
+  mUnlockThreadMutex(&signal->Mutex);
+}
+
+// take the results that came in, returns -1 if requestIdx has no result yet
+static int mTakeWorkerResults(RECOGNITION_WORKER* worker, RESULT_SIGNAL* signal, unsigned int requestIdx, TIME_SAMPLES* latencies, RECOGNITION_RESULT* lastResult)
+{
+  int retval = -1;
+
+  mLockThreadMutex(&signal->Mutex);
+  signal->IsResultReady = 0;
+  mUnlockThreadMutex(&signal->Mutex);
+
+  RECOGNITION_RESULT result;
+  if (mTakeRecognitionResult(worker, &result) == 0)
+  {
+    mAddTimeSample(latencies, mGetMilliseconds(result.SubmitTimestamp, mGetTimestamp()));
+    if (result.RequestIdx == requestIdx)
+    {
+      (*lastResult) = result;
+      retval        = 0;
+    }
+  }
+
+  return retval;
+}
+
+// Take the results as they come in for timeout ms, or until requestIdx has one
+// if isWaitingForRequest. Returns -1 if requestIdx has no result.
+static int mWaitForWorkerResults(RECOGNITION_WORKER* worker, RESULT_SIGNAL* signal, unsigned int requestIdx, int isWaitingForRequest, unsigned int timeout, TIME_SAMPLES* latencies, RECOGNITION_RESULT* lastResult)
+{
+  unsigned long long start = mGetTimestamp();
+  int retval               = mTakeWorkerResults(worker, signal, requestIdx, latencies, lastResult);
+
+  while (!isWaitingForRequest || (retval != 0))
+  {
+    double remaining = (double)timeout - mGetMilliseconds(start, mGetTimestamp());
+    if (remaining <= 0.0)
+    {
+      break;
+    }
+
+    mLockThreadMutex(&signal->Mutex);
+    if (!signal->IsResultReady)
+    {
+      mWaitThreadCondition(&signal->Condition, &signal->Mutex, 1 + (unsigned int)remaining);
+    }
+    mUnlockThreadMutex(&signal->Mutex);
+
+    if (mTakeWorkerResults(worker, signal, requestIdx, latencies, lastResult) == 0)
+    {
+      retval = 0;
+    }
+  }
+
+  return retval;
+}
+
+static void mRunWorkerPass(const SYNTHETIC_CHARACTER* characters, unsigned int numQueries, const RECOGNIZER_DATABASE* database, unsigned int numThreads, unsigned int interval, const unsigned int* bestCodePoints)
+{
+  StrokeList written;
+  StrokeList strokes;
+  STROKE_RESAMPLER resampler;
+  RESULT_SIGNAL signal;
+  RECOGNITION_WORKER worker;
+  TIME_SAMPLES submitTimes;
+  TIME_SAMPLES latencies;
+  TIME_SAMPLES lastLatencies;
+  memset(&written, 0, sizeof(StrokeList));
+  memset(&strokes, 0, sizeof(StrokeList));
+  memset(&signal, 0, sizeof(RESULT_SIGNAL));
+  memset(&submitTimes, 0, sizeof(TIME_SAMPLES));
+  memset(&latencies, 0, sizeof(TIME_SAMPLES));
+  memset(&lastLatencies, 0, sizeof(TIME_SAMPLES));
+  mInitializeStrokeResampler(&resampler, 65536, RECOGNIZER_MAX_STROKES, RESAMPLE_SPACING);
+  mInitializeThreadMutex(&signal.Mutex);
+  mInitializeThreadCondition(&signal.Condition);
+
+  if (mStartRecognitionWorker(&worker, database, NUM_CANDIDATES, numThreads, mSignalRecognitionResult, &signal) != 0)
+  {
+    exit(-1);
+  }
+
+  unsigned int numStrokes  = 0;
+  unsigned int numSameTop1 = 0;
+  unsigned int numTimeouts = 0;
+  mSeedSyntheticRandom(SYNTHETIC_QUERY_RANDOM_SEED);
+
+  for (unsigned int queryIdx = 0; queryIdx < numQueries; queryIdx++)
+  {
+    unsigned int characterIdx = (unsigned int)(mRandomSyntheticFloat() * (NUM_SYNTHETIC_TEMPLATES - 1));
+    mClearStrokeList(&written);
+    mWriteSyntheticCharacter(&characters[characterIdx], &written);
+
+    mClearStrokeList(&strokes);
+    mClearStrokeResampler(&resampler);
+    mResetRecognitionWorker(&worker);
+
+    RECOGNITION_RESULT lastResult;
+    unsigned int requestIdx = 0;
+
+    for (unsigned int strokeIdx = 0; strokeIdx < written.Size; strokeIdx++)
+    {
+      mCopyWrittenStroke(&written, strokeIdx, &strokes);
+      mUpdateStrokeResampler(&resampler, &strokes);
+      mFinishResampledStroke(&resampler);
+
+      unsigned long long time = mGetTimestamp();
+      requestIdx              = mSubmitRecognitionRequest(&worker, &resampler);
+      mAddTimeSample(&submitTimes, mGetMilliseconds(time, mGetTimestamp()));
+      numStrokes++;
+
+      // the next stroke is being written
+      if ((strokeIdx + 1) < written.Size)
+      {
+        mWaitForWorkerResults(&worker, &signal, requestIdx, 0, interval, &latencies, &lastResult);
+      }
+    }
+
+    if (mWaitForWorkerResults(&worker, &signal, requestIdx, 1, RESULT_TIMEOUT_MS, &latencies, &lastResult) != 0)
+    {
+      numTimeouts++;
+      continue;
+    }
+
+    mAddTimeSample(&lastLatencies, latencies.Values[latencies.Size - 1]);
+    unsigned int best = (lastResult.NumCandidates != 0) ? lastResult.Candidates[0].CodePoint : (unsigned int)-1;
+    numSameTop1 += (best == bestCodePoints[queryIdx]);
+  }
+
+  unsigned int numCancelled = worker.NumCancelledRequests;
+  unsigned int numReplaced  = worker.NumReplacedRequests;
+  unsigned int numCompleted = worker.NumCompletedRequests;
+  mStopRecognitionWorker(&worker);
+
+  printf("\n%u ms between strokes: %u requests, %u completed, %u cancelled while scored, %u replaced before, %u timeouts\n", interval, numStrokes, numCompleted, numCancelled, numReplaced, numTimeouts);
+  printf("%16s %10s %10s %10s %10s %12s\n", "", "mean ms", "p50 ms", "p99 ms", "max ms", "same top-1");
+  mPrintTimeSamples("submit", &submitTimes);
+  printf("\n");
+  mPrintTimeSamples("any result", &latencies);
+  printf("\n");
+  mPrintTimeSamples("last stroke", &lastLatencies);
+  printf(" %11.1f%%\n", 100.0 * numSameTop1 / numQueries);
+
+  free(submitTimes.Values);
+  free(latencies.Values);
+  free(lastLatencies.Values);
+  mDestroyThreadCondition(&signal.Condition);
+  mDestroyThreadMutex(&signal.Mutex);
+  mFreeStrokeResampler(&resampler);
+  mFreeStrokeList(&strokes);
+  mFreeStrokeList(&written);
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned int numQueries = 100;
+  unsigned int interval   = 30;
+  unsigned int numThreads = 0;
+  unsigned int shortlist  = APPLICATION_SHORTLIST_SIZE;
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--queries") == 0) && ((argIdx + 1) < argc))
+    {
+      numQueries = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--interval") == 0) && ((argIdx + 1) < argc))
+    {
+      interval = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--threads") == 0) && ((argIdx + 1) < argc))
+    {
+      numThreads = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--shortlist") == 0) && ((argIdx + 1) < argc))
+    {
+      shortlist = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else
+    {
+      printf("Usage: %s [--queries <count>] [--interval <ms>] [--threads <count>] [--shortlist <size>]\n", argv[0]);
+      return -1;
+    }
+  }
+
+  if (numQueries == 0)
+  {
+    return 0;
+  }
+
+  RECOGNIZER_DATABASE database;
+  mInitializeRecognizerDatabase(&database);
+
+  SYNTHETIC_CHARACTER* characters = mBuildSyntheticCharacters(&database);
+  database.ShortlistSize          = shortlist;
+
+  printf("templates: %u, shortlist of %u, scoring threads: %u\n", database.NumTemplates, database.ShortlistSize, (numThreads != 0) ? numThreads : mGetNumProcessors());
+
+  unsigned int* bestCodePoints = (unsigned int*)mMalloc(sizeof(unsigned int) * numQueries, __FILE__, __LINE__);
+  mRunSerialPass(characters, numQueries, &database, bestCodePoints);
+  mRunWorkerPass(characters, numQueries, &database, numThreads, 0, bestCodePoints);
+  if (interval != 0)
+  {
+    mRunWorkerPass(characters, numQueries, &database, numThreads, interval, bestCodePoints);
+  }
+
+  free(bestCodePoints);
+  free(characters);
+  mFreeRecognizerDatabase(&database);
+
+  return 0;
+}
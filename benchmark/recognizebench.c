@@ -0,0 +1,482 @@
+// Benchmark of the kanji recognizer (touchpad/recognizer.h) with a database
+// of the size of the jōyō set (2136 characters).
+//
+// Without --trace the templates are the random kanji-like characters of
+// syntheticcharacters.h. Every query is one of them written again: scaled to
+// device units, slightly slanted, with jitter and sampled like a touchpad. The
+// queries go through the same StrokeList -> STROKE_RESAMPLER ->
+// mRecognizeStrokes path as in the application and the top-1 / top-10
+// accuracy is reported with the time per query.
+//
+// With --trace the queries are the strokes of a recorded session (see
+// touchpad/touchtrace.h), a pause of CHARACTER_PAUSE_MS between two strokes
+// starts a new character. Only the time per query is reported because the
+// characters are not labeled. --templates replaces the random templates with a
+// template file.
+//
+// Every query set is run once for each shortlist size in SHORTLIST_SIZES (0
+// compares every template with a similar stroke count) to show how much of the
+// exhaustive top-1 the coarse index keeps and what it saves. --index writes the
+// templates as an index file and the queries use the memory mapped copy.
+//
+// Then the queries are scored by mRecognizeStrokesParallel with a work pool of
+// 1 to --threads threads (one per processor by default), once comparing every
+// template and once with the shortlist size of the application.
+//
+//   gcc -O2 -I../touchpad -o recognizebench recognizebench.c syntheticcharacters.c ../touchpad/recognizer.c ../touchpad/dtw.c ../touchpad/resampler.c ../touchpad/stroke.c ../touchpad/point2d.c ../touchpad/hiddecoder.c ../touchpad/touchevents.c ../touchpad/touchtrace.c ../touchpad/workpool.c ../touchpad/threading.c ../touchpad/hashindex.c ../touchpad/utils.c -lm -lpthread
+//
+// Usage: recognizebench [--queries <count>] [--trace <file>] [--templates <file>] [--index <file>] [--threads <count>]
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "hiddecoder.h"
+#include "touchevents.h"
+#include "touchtrace.h"
+#include "stroke.h"
+#include "resampler.h"
+#include "workpool.h"
+#include "recognizer.h"
+#include "syntheticcharacters.h"
+
+#define NUM_CANDIDATES      10
+// the same spacing as the application
+#define RESAMPLE_SPACING    8.0f
+#define CHARACTER_PAUSE_MS  1000
+#define NUM_SHORTLIST_SIZES 7
+
+// the same shortlist size as the application
+#define APPLICATION_SHORTLIST_SIZE 200
+
+static const unsigned int SHORTLIST_SIZES[NUM_SHORTLIST_SIZES] = {0, 800, 400, 200, 100, 50, 25};
+
+// the time and the best candidate of every query of a run
+struct QUERY_RESULTS
+{
+  double* Times;
+  unsigned int* BestCodePoints;
+  unsigned int Size;
+  unsigned int Capacity;
+};
+
+typedef struct QUERY_RESULTS QUERY_RESULTS;
+
+// the written characters or the characters of a recording
+struct QUERY_SET
+{
+  const SYNTHETIC_CHARACTER* Characters;
+  unsigned int NumQueries;
+  const char* TracePath;
+};
+
+typedef struct QUERY_SET QUERY_SET;
+
+// the queries are scored in parallel when it is set
+static WORK_POOL* g_scoring_pool = NULL;
+
+static void mAddQueryResult(QUERY_RESULTS* results, double milliseconds, unsigned int bestCodePoint)
+{
+  if (results->Size == results->Capacity)
+  {
+    results->Capacity       = (results->Capacity == 0) ? 1024 : (results->Capacity * 2);
+    results->Times          = (double*)mRealloc(results->Times, sizeof(double) * results->Capacity, __FILE__, __LINE__);
+    results->BestCodePoints = (unsigned int*)mRealloc(results->BestCodePoints, sizeof(unsigned int) * results->Capacity, __FILE__, __LINE__);
+  }
+
+  results->Times[results->Size]          = milliseconds;
+  results->BestCodePoints[results->Size] = bestCodePoint;
+  results->Size++;
+}
+
+static int mCompareQueryTimes(const void* a, const void* b)
+{
+  double valueA = *((const double*)a);
+  double valueB = *((const double*)b);
+  return (valueA > valueB) - (valueA < valueB);
+}
+
+// resample the strokes like the application and time the recognition
+static void mRunQuery(const RECOGNIZER_DATABASE* database, StrokeList* strokes, STROKE_RESAMPLER* resampler, QUERY_RESULTS* results, RECOGNIZER_CANDIDATE* candidates, unsigned int* numCandidates)
+{
+  mClearStrokeResampler(resampler);
+  mUpdateStrokeResampler(resampler, strokes);
+  mFinishResampledStroke(resampler);
+
+  unsigned long long time = mGetTimestamp();
+  if (g_scoring_pool != NULL)
+  {
+    mRecognizeStrokesParallel(database, resampler, g_scoring_pool, candidates, NUM_CANDIDATES, numCandidates);
+  }
+  else
+  {
+    mRecognizeStrokes(database, resampler, candidates, NUM_CANDIDATES, numCandidates);
+  }
+  double milliseconds = (double)(mGetTimestamp() - time) * 1e3 / (double)mGetTimestampFrequency();
+
+  mAddQueryResult(results, milliseconds, ((*numCandidates) != 0) ? candidates[0].CodePoint : (unsigned int)-1);
+}
+
+// the strokes of a recorded session, see replaybench.c for the decoding
+static void mRunTraceQueries(const char* tracePath, const RECOGNIZER_DATABASE* database, STROKE_RESAMPLER* resampler, QUERY_RESULTS* results)
+{
+  TOUCH_TRACE_MAPPING mapping;
+  if (mMapTouchTrace(tracePath, &mapping) != 0)
+  {
+    exit(-1);
+  }
+
+  const TOUCH_TRACE_FILE_HEADER* fileHeader = mGetTouchTraceFileHeader(mapping.Data, mapping.cbData);
+  if (fileHeader == NULL)
+  {
+    printf(FG_RED);
+    printf("%s is not a supported touch trace\n", tracePath);
+    printf(RESET_COLOR);
+    exit(-1);
+  }
+
+  HID_TOUCH_DECODE_PLAN* decodePlans   = NULL;
+  HID_TOUCH_DECODE_STATE* decodeStates = NULL;
+  unsigned int numDecodePlans          = 0;
+  ULONG reportSequenceNumber           = 0;
+  ULONG trackingTouchID                = (ULONG)-1;
+  unsigned long long pauseTicks        = (unsigned long long)fileHeader->TimestampFrequency * CHARACTER_PAUSE_MS / 1000;
+  unsigned long long lastTouchUp       = 0;
+  TOUCH_CONTACT_TABLE previousTouches;
+  TOUCH_DATA_BATCH touchBatch;
+  StrokeList strokes;
+
+  mResetTouchContactTable(&previousTouches);
+  memset(&touchBatch, 0, sizeof(TOUCH_DATA_BATCH));
+  memset(&strokes, 0, sizeof(StrokeList));
+
+  size_t offset = fileHeader->cbFileHeader;
+  const TOUCH_TRACE_RECORD_HEADER* record;
+
+  while ((record = mGetNextTouchTraceRecord(mapping.Data, mapping.cbData, &offset)) != NULL)
+  {
+    if ((record->Type == TOUCH_TRACE_RECORD_DECODE_PLAN) && (record->cbPayload == sizeof(HID_TOUCH_DECODE_PLAN)))
+    {
+      if (record->DeviceIdx >= numDecodePlans)
+      {
+        decodePlans  = (HID_TOUCH_DECODE_PLAN*)mRealloc(decodePlans, sizeof(HID_TOUCH_DECODE_PLAN) * (record->DeviceIdx + 1), __FILE__, __LINE__);
+        decodeStates = (HID_TOUCH_DECODE_STATE*)mRealloc(decodeStates, sizeof(HID_TOUCH_DECODE_STATE) * (record->DeviceIdx + 1), __FILE__, __LINE__);
+        memset(&decodePlans[numDecodePlans], 0, sizeof(HID_TOUCH_DECODE_PLAN) * (record->DeviceIdx + 1 - numDecodePlans));
+        numDecodePlans = record->DeviceIdx + 1;
+      }
+
+      memcpy(&decodePlans[record->DeviceIdx], mGetTouchTraceRecordPayload(record), sizeof(HID_TOUCH_DECODE_PLAN));
+      mResetTouchDecodeState(&decodeStates[record->DeviceIdx]);
+    }
+    else if ((record->Type == TOUCH_TRACE_RECORD_REPORTS) && (record->DeviceIdx < numDecodePlans) && decodePlans[record->DeviceIdx].IsValid && (record->Count != 0))
+    {
+      mDecodeTouchReportBatch(&decodePlans[record->DeviceIdx], &decodeStates[record->DeviceIdx], mGetTouchTraceRecordPayload(record), record->cbPayload / record->Count, record->Count, &reportSequenceNumber, &touchBatch);
+      mInterpretRawTouchInputBatch(&previousTouches, touchBatch.Entries, touchBatch.Size, touchBatch.EventTypes);
+
+      for (unsigned int contactIdx = 0; contactIdx < touchBatch.Size; contactIdx++)
+      {
+        unsigned int eventType = touchBatch.EventTypes[contactIdx];
+
+        // a new character after a pause
+        if ((eventType == EVENT_TYPE_TOUCH_DOWN) && (trackingTouchID == (ULONG)-1) && (strokes.Size != 0) && ((record->Timestamp - lastTouchUp) > pauseTicks))
+        {
+          RECOGNIZER_CANDIDATE candidates[NUM_CANDIDATES];
+          unsigned int numCandidates;
+          mRunQuery(database, &strokes, resampler, results, candidates, &numCandidates);
+          mClearStrokeList(&strokes);
+        }
+
+        unsigned int strokeEvent;
+        if (mAddTouchEventToStrokes(touchBatch.Entries[contactIdx], eventType, &trackingTouchID, &strokes, &strokeEvent) != 0)
+        {
+          printf(FG_RED);
+          printf("The application state is broken!\n");
+          printf(RESET_COLOR);
+          exit(-1);
+        }
+
+        if (strokeEvent == STROKE_EVENT_END_STROKE)
+        {
+          lastTouchUp = record->Timestamp;
+        }
+      }
+    }
+  }
+
+  if (strokes.Size != 0)
+  {
+    RECOGNIZER_CANDIDATE candidates[NUM_CANDIDATES];
+    unsigned int numCandidates;
+    mRunQuery(database, &strokes, resampler, results, candidates, &numCandidates);
+  }
+
+  mFreeStrokeList(&strokes);
+  mFreeTouchDataBatch(&touchBatch);
+  free(decodePlans);
+  free(decodeStates);
+  mUnmapTouchTrace(&mapping);
+}
+
+// the written characters, the same ones for every shortlist size
+static void mRunSyntheticQueries(const SYNTHETIC_CHARACTER* characters, unsigned int numQueries, const RECOGNIZER_DATABASE* database, STROKE_RESAMPLER* resampler, QUERY_RESULTS* results, unsigned int* numTop1, unsigned int* numTop10)
+{
+  StrokeList strokes;
+  memset(&strokes, 0, sizeof(StrokeList));
+
+  (*numTop1)  = 0;
+  (*numTop10) = 0;
+  mSeedSyntheticRandom(SYNTHETIC_QUERY_RANDOM_SEED);
+
+  for (unsigned int queryIdx = 0; queryIdx < numQueries; queryIdx++)
+  {
+    unsigned int characterIdx = (unsigned int)(mRandomSyntheticFloat() * (NUM_SYNTHETIC_TEMPLATES - 1));
+    mClearStrokeList(&strokes);
+    mWriteSyntheticCharacter(&characters[characterIdx], &strokes);
+
+    RECOGNIZER_CANDIDATE candidates[NUM_CANDIDATES];
+    unsigned int numCandidates;
+    mRunQuery(database, &strokes, resampler, results, candidates, &numCandidates);
+
+    for (unsigned int candidateIdx = 0; candidateIdx < numCandidates; candidateIdx++)
+    {
+      if (candidates[candidateIdx].CodePoint == (SYNTHETIC_FIRST_CODE_POINT + characterIdx))
+      {
+        (*numTop1) += (candidateIdx == 0);
+        (*numTop10)++;
+        break;
+      }
+    }
+  }
+
+  mFreeStrokeList(&strokes);
+}
+
+// Run the query set once and print a row of the table without the line break.
+// The best candidates are compared to the reference results (the first run if
+// reference->Size is 0). Returns the mean time per query or -1 without queries.
+static double mMeasureQueries(const char* label, const QUERY_SET* querySet, const RECOGNIZER_DATABASE* database, STROKE_RESAMPLER* resampler, QUERY_RESULTS* reference)
+{
+  QUERY_RESULTS results;
+  memset(&results, 0, sizeof(QUERY_RESULTS));
+
+  unsigned int numTop1  = 0;
+  unsigned int numTop10 = 0;
+  if (querySet->TracePath != NULL)
+  {
+    mRunTraceQueries(querySet->TracePath, database, resampler, &results);
+  }
+  else
+  {
+    mRunSyntheticQueries(querySet->Characters, querySet->NumQueries, database, resampler, &results, &numTop1, &numTop10);
+  }
+
+  if (results.Size == 0)
+  {
+    printf("%10s no queries", label);
+    return -1.0;
+  }
+
+  if (reference->Size == 0)
+  {
+    reference->Size           = results.Size;
+    reference->BestCodePoints = (unsigned int*)mMalloc(sizeof(unsigned int) * results.Size, __FILE__, __LINE__);
+    memcpy(reference->BestCodePoints, results.BestCodePoints, sizeof(unsigned int) * results.Size);
+  }
+
+  unsigned int numSameTop1 = 0;
+  double total             = 0.0;
+  for (unsigned int queryIdx = 0; queryIdx < results.Size; queryIdx++)
+  {
+    numSameTop1 += (queryIdx < reference->Size) && (results.BestCodePoints[queryIdx] == reference->BestCodePoints[queryIdx]);
+    total += results.Times[queryIdx];
+  }
+
+  qsort(results.Times, results.Size, sizeof(double), mCompareQueryTimes);
+
+  printf("%10s ", label);
+  if (querySet->TracePath != NULL)
+  {
+    printf("%8s %8s ", "-", "-");
+  }
+  else
+  {
+    printf("%7.1f%% %7.1f%% ", 100.0 * numTop1 / results.Size, 100.0 * numTop10 / results.Size);
+  }
+
+  printf("%11.1f%% %10.3f %10.3f %10.3f %10.3f", 100.0 * numSameTop1 / results.Size, total / results.Size, results.Times[results.Size / 2], results.Times[(unsigned int)(0.99 * (results.Size - 1))], results.Times[results.Size - 1]);
+
+  double meanMilliseconds = total / results.Size;
+  free(results.Times);
+  free(results.BestCodePoints);
+
+  return meanMilliseconds;
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned int numQueries   = 1000;
+  const char* tracePath     = NULL;
+  const char* templatesPath = NULL;
+  const char* indexPath     = NULL;
+  unsigned int maxThreads   = mGetNumProcessors();
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--queries") == 0) && ((argIdx + 1) < argc))
+    {
+      numQueries = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--trace") == 0) && ((argIdx + 1) < argc))
+    {
+      tracePath = argv[++argIdx];
+    }
+    else if ((strcmp(argv[argIdx], "--templates") == 0) && ((argIdx + 1) < argc))
+    {
+      templatesPath = argv[++argIdx];
+    }
+    else if ((strcmp(argv[argIdx], "--index") == 0) && ((argIdx + 1) < argc))
+    {
+      indexPath = argv[++argIdx];
+    }
+    else if ((strcmp(argv[argIdx], "--threads") == 0) && ((argIdx + 1) < argc))
+    {
+      maxThreads = (unsigned int)atoi(argv[++argIdx]);
+      maxThreads = (maxThreads < 1) ? 1 : ((maxThreads > WORK_POOL_MAX_THREADS) ? WORK_POOL_MAX_THREADS : maxThreads);
+    }
+    else
+    {
+      printf("Usage: %s [--queries <count>] [--trace <file>] [--templates <file>] [--index <file>] [--threads <count>]\n", argv[0]);
+      return -1;
+    }
+  }
+
+  if ((templatesPath != NULL) && (tracePath == NULL))
+  {
+    printf(FG_RED);
+    printf("--templates needs --trace for the queries\n");
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  SYNTHETIC_CHARACTER* characters = NULL;
+  RECOGNIZER_DATABASE database;
+  mInitializeRecognizerDatabase(&database);
+
+  unsigned long long time = mGetTimestamp();
+  if (templatesPath != NULL)
+  {
+    if (mLoadRecognizerDatabase(templatesPath, &database) != 0)
+    {
+      return -1;
+    }
+  }
+  else
+  {
+    characters = mBuildSyntheticCharacters(&database);
+  }
+  double loadMilliseconds = (double)(mGetTimestamp() - time) * 1e3 / (double)mGetTimestampFrequency();
+
+  printf("templates: %u (%s, %.1f ms), %u strokes (%.1f MB)\n", database.NumTemplates, (templatesPath != NULL) ? templatesPath : "synthetic", loadMilliseconds, database.NumFeatures, (double)database.NumFeatures * sizeof(RECOGNIZER_STROKE_FEATURES) / 1e6);
+
+  if (indexPath != NULL)
+  {
+    if (mWriteRecognizerIndex(indexPath, &database) != 0)
+    {
+      return -1;
+    }
+
+    mFreeRecognizerDatabase(&database);
+
+    time = mGetTimestamp();
+    if (mMapRecognizerIndex(indexPath, &database) != 0)
+    {
+      return -1;
+    }
+    double mapMilliseconds = (double)(mGetTimestamp() - time) * 1e3 / (double)mGetTimestampFrequency();
+
+    printf("index: %s (%.1f MB) mapped in %.3f ms\n", indexPath, (double)database.Mapping.cbData / 1e6, mapMilliseconds);
+  }
+
+  STROKE_RESAMPLER resampler;
+  mInitializeStrokeResampler(&resampler, 65536, RECOGNIZER_MAX_STROKES, RESAMPLE_SPACING);
+
+  QUERY_SET querySet = {.Characters = characters, .NumQueries = numQueries, .TracePath = tracePath};
+  QUERY_RESULTS exhaustiveResults;
+  memset(&exhaustiveResults, 0, sizeof(QUERY_RESULTS));
+
+  printf("%10s %8s %8s %12s %10s %10s %10s %10s\n", "shortlist", "top-1", "top-10", "same top-1", "mean ms", "p50 ms", "p99 ms", "max ms");
+
+  // the first run compares everything and is the reference of the others
+  for (unsigned int sizeIdx = 0; sizeIdx < NUM_SHORTLIST_SIZES; sizeIdx++)
+  {
+    char label[16];
+    snprintf(label, sizeof(label), (SHORTLIST_SIZES[sizeIdx] == 0) ? "all" : "%u", SHORTLIST_SIZES[sizeIdx]);
+
+    database.ShortlistSize = SHORTLIST_SIZES[sizeIdx];
+    double meanMilliseconds = mMeasureQueries(label, &querySet, &database, &resampler, &exhaustiveResults);
+    printf("\n");
+
+    if (meanMilliseconds < 0.0)
+    {
+      break;
+    }
+  }
+
+  const unsigned int threadShortlistSizes[2] = {0, APPLICATION_SHORTLIST_SIZE};
+  for (unsigned int sizeIdx = 0; (sizeIdx < 2) && (exhaustiveResults.Size != 0); sizeIdx++)
+  {
+    database.ShortlistSize = threadShortlistSizes[sizeIdx];
+    if (threadShortlistSizes[sizeIdx] == 0)
+    {
+      printf("\nparallel, every template\n");
+    }
+    else
+    {
+      printf("\nparallel, shortlist of %u\n", threadShortlistSizes[sizeIdx]);
+    }
+    printf("%10s %8s %8s %12s %10s %10s %10s %10s %8s\n", "threads", "top-1", "top-10", "same top-1", "mean ms", "p50 ms", "p99 ms", "max ms", "speedup");
+
+    // the same top-1 is checked against the serial run with the same shortlist
+    QUERY_RESULTS serialResults;
+    memset(&serialResults, 0, sizeof(QUERY_RESULTS));
+    double serialMilliseconds = mMeasureQueries("serial", &querySet, &database, &resampler, &serialResults);
+    printf(" %7.2fx\n", 1.0);
+
+    for (unsigned int numThreads = 1; numThreads <= maxThreads; numThreads++)
+    {
+      WORK_POOL pool;
+      mInitializeWorkPool(&pool, numThreads);
+      g_scoring_pool = &pool;
+
+      char label[16];
+      snprintf(label, sizeof(label), "%u", numThreads);
+      double meanMilliseconds = mMeasureQueries(label, &querySet, &database, &resampler, &serialResults);
+      printf(" %7.2fx\n", serialMilliseconds / meanMilliseconds);
+
+      g_scoring_pool = NULL;
+      mFreeWorkPool(&pool);
+    }
+
+    free(serialResults.BestCodePoints);
+  }
+
+  if (tracePath != NULL)
+  {
+    printf("queries: %u characters of %s\n", exhaustiveResults.Size, tracePath);
+  }
+  else
+  {
+    printf("queries: %u written characters\n", numQueries);
+  }
+
+  free(exhaustiveResults.BestCodePoints);
+  free(characters);
+  mFreeStrokeResampler(&resampler);
+  mFreeRecognizerDatabase(&database);
+
+  return 0;
+}
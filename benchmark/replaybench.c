@@ -0,0 +1,679 @@
+// Headless benchmark of the input pipeline of the touchpad application. It
+// replays a touch trace (see touchpad/touchtrace.h, recorded with
+// `touchpad --record <file>`) or a synthetic trace through the same stages that
+// mHandleInputMessage runs for every WM_INPUT message:
+// report decode -> touch events -> strokes.
+// It then reports how many points the stroke simplification dropped
+// (--tolerance) and how long repainting every stroke takes with the raw and
+// with the simplified points. With the synthetic trace it exits with -1 if
+// not every contact of the reports reached the interpreter.
+//
+// It does not depend on the Windows API. On Linux:
+//
+//   gcc -O2 -DCOUNT_MEMORY_ALLOCATIONS -I../touchpad -o replaybench replaybench.c ../touchpad/hiddecoder.c ../touchpad/touchevents.c ../touchpad/point2d.c ../touchpad/stroke.c ../touchpad/canvas.c ../touchpad/segmentgrid.c ../touchpad/touchtrace.c ../touchpad/threading.c ../touchpad/hashindex.c ../touchpad/utils.c -lm -lpthread
+//
+// Usage: replaybench [--trace <file> | --messages <count> [--hybrid]] [--paced] [--repeat <count>] [--tolerance <units>]
+//   --trace     replay a recorded trace instead of the synthetic one
+//   --messages  number of WM_INPUT messages of the synthetic trace
+//   --hybrid    the synthetic touchpad reports in hybrid mode, its frames are
+//               split over several reports and messages
+//   --paced     deliver the messages at their recorded times (latency) instead
+//               of as fast as possible (throughput)
+//   --repeat    replay the trace this many times (the strokes are cleared in between)
+//   --tolerance simplification tolerance of the strokes in device units (default 2)
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "hiddecoder.h"
+#include "touchevents.h"
+#include "touchtrace.h"
+#include "stroke.h"
+#include "canvas.h"
+
+#define STAGE_DECODE    0
+#define STAGE_INTERPRET 1
+#define STAGE_STROKE    2
+#define STAGE_TOTAL     3
+#define NUM_STAGES      4
+
+static const char* STAGE_NAMES[NUM_STAGES] = {"decode", "interpret", "stroke", "total"};
+
+// synthetic Windows Precision Touchpad, in parallel reporting mode with a
+// contact collection per finger or in hybrid reporting mode (--hybrid) with
+// fewer contact collections than fingers
+#define SYNTHETIC_REPORT_ID                  1
+#define SYNTHETIC_MAX_FRAME_CONTACTS         5
+#define SYNTHETIC_HYBRID_CONTACTS_PER_REPORT 2
+#define SYNTHETIC_CB_CONTACT                 5
+#define SYNTHETIC_MAX_CB_REPORT              (1 + (SYNTHETIC_MAX_FRAME_CONTACTS * SYNTHETIC_CB_CONTACT) + 2 + 1)
+#define SYNTHETIC_NUM_MESSAGES               200000
+// a fast touchpad (500 Hz), Precision Touchpads report at 125 Hz or more
+#define SYNTHETIC_MESSAGE_INTERVAL_US 2000
+
+// the strokes are repainted into a canvas that covers the logical range of most touchpads
+#define PAINT_CANVAS_SIZE 4096
+#define PAINT_STROKE_WIDTH 20.0f
+
+struct LATENCY_SAMPLES
+{
+  unsigned long long* Entries;
+  unsigned int Size;
+  unsigned int Capacity;
+};
+
+typedef struct LATENCY_SAMPLES LATENCY_SAMPLES;
+
+struct REPLAY_STATE
+{
+  HID_TOUCH_DECODE_PLAN* DecodePlans;
+  // the decode state of each device, a frame may continue in the next message
+  HID_TOUCH_DECODE_STATE* DecodeStates;
+  unsigned int NumDecodePlans;
+  TOUCH_CONTACT_TABLE PreviousTouches;
+  TOUCH_DATA_BATCH TouchBatch;
+  ULONG ReportSequenceNumber;
+  StrokeList Strokes;
+  ULONG TrackingTouchID;
+
+  unsigned long long NumMessages;
+  unsigned long long NumReports;
+  unsigned long long NumContacts;
+  unsigned long long NumStrokes;
+  unsigned long long NumSkippedMessages;
+  // stale contacts that the contact table evicted
+  unsigned long long NumEvictedContacts;
+  LATENCY_SAMPLES StageLatencies[NUM_STAGES];
+  // time between the scheduled arrival of a message and the end of its processing (--paced)
+  LATENCY_SAMPLES ArrivalLatencies;
+};
+
+typedef struct REPLAY_STATE REPLAY_STATE;
+
+static void mAddLatencySample(LATENCY_SAMPLES* samples, unsigned long long value)
+{
+  if (samples->Size == samples->Capacity)
+  {
+    samples->Capacity = (samples->Capacity == 0) ? 4096 : (samples->Capacity * 2);
+    samples->Entries  = (unsigned long long*)realloc(samples->Entries, sizeof(unsigned long long) * samples->Capacity);
+    if (samples->Entries == NULL)
+    {
+      printf(FG_RED);
+      printf("realloc failed at %s:%d\n", __FILE__, __LINE__);
+      printf(RESET_COLOR);
+      exit(-1);
+    }
+  }
+
+  samples->Entries[samples->Size] = value;
+  samples->Size++;
+}
+
+static int mCompareLatencySamples(const void* a, const void* b)
+{
+  unsigned long long valueA = *((const unsigned long long*)a);
+  unsigned long long valueB = *((const unsigned long long*)b);
+  return (valueA > valueB) - (valueA < valueB);
+}
+
+static double mGetLatencyPercentile(const LATENCY_SAMPLES* samples, double percentile, double nanosecondsPerTick)
+{
+  if (samples->Size == 0)
+  {
+    return 0.0;
+  }
+
+  unsigned int sampleIdx = (unsigned int)(percentile * (samples->Size - 1));
+  return samples->Entries[sampleIdx] * nanosecondsPerTick;
+}
+
+static void mPrintLatencies(const char* name, LATENCY_SAMPLES* samples, double nanosecondsPerTick)
+{
+  qsort(samples->Entries, samples->Size, sizeof(unsigned long long), mCompareLatencySamples);
+  printf("%-10s p50 %10.0f ns  p99 %10.0f ns  p99.9 %10.0f ns  max %10.0f ns\n", name, mGetLatencyPercentile(samples, 0.5, nanosecondsPerTick), mGetLatencyPercentile(samples, 0.99, nanosecondsPerTick), mGetLatencyPercentile(samples, 0.999, nanosecondsPerTick), mGetLatencyPercentile(samples, 1.0, nanosecondsPerTick));
+}
+
+static void mAppendToBuffer(BYTE** buffer, size_t* cbBuffer, size_t* capacity, const void* data, size_t cbData)
+{
+  if (((*cbBuffer) + cbData) > (*capacity))
+  {
+    while (((*cbBuffer) + cbData) > (*capacity))
+    {
+      (*capacity) = ((*capacity) == 0) ? (1 << 20) : ((*capacity) * 2);
+    }
+
+    (*buffer) = (BYTE*)realloc((*buffer), (*capacity));
+    if ((*buffer) == NULL)
+    {
+      printf(FG_RED);
+      printf("realloc failed at %s:%d\n", __FILE__, __LINE__);
+      printf(RESET_COLOR);
+      exit(-1);
+    }
+  }
+
+  memcpy((*buffer) + (*cbBuffer), data, cbData);
+  (*cbBuffer) += cbData;
+}
+
+static void mAppendTraceRecord(BYTE** buffer, size_t* cbBuffer, size_t* capacity, unsigned int recordType, unsigned int count, unsigned long long timestamp, const void* payload, unsigned int cbPayload)
+{
+  TOUCH_TRACE_RECORD_HEADER recordHeader;
+  recordHeader.Type      = recordType;
+  recordHeader.DeviceIdx = 0;
+  recordHeader.Timestamp = timestamp;
+  recordHeader.cbPayload = cbPayload;
+  recordHeader.Count     = count;
+
+  static const BYTE padding[TOUCH_TRACE_ALIGNMENT] = {0};
+
+  mAppendToBuffer(buffer, cbBuffer, capacity, &recordHeader, sizeof(TOUCH_TRACE_RECORD_HEADER));
+  mAppendToBuffer(buffer, cbBuffer, capacity, payload, cbPayload);
+  mAppendToBuffer(buffer, cbBuffer, capacity, padding, mGetTouchTraceRecordSize(cbPayload) - sizeof(TOUCH_TRACE_RECORD_HEADER) - cbPayload);
+}
+
+static HID_REPORT_FIELD mMakeField(unsigned int bitOffset, unsigned int bitSize, LONG logicalMax)
+{
+  return (HID_REPORT_FIELD){.BitOffset = bitOffset, .BitSize = bitSize, .LogicalMin = 0, .LogicalMax = logicalMax};
+}
+
+static void mWriteSyntheticContact(BYTE* report, unsigned int slotIdx, ULONG contactID, int onSurface, ULONG x, ULONG y)
+{
+  BYTE* contact = report + 1 + (slotIdx * SYNTHETIC_CB_CONTACT);
+  // tip switch, confidence, 6 bit contact ID, 16 bit X, 16 bit Y
+  contact[0] = (BYTE)((onSurface ? 0x01 : 0x00) | 0x02 | ((contactID & 0x3f) << 2));
+  contact[1] = (BYTE)(x & 0xff);
+  contact[2] = (BYTE)((x >> 8) & 0xff);
+  contact[3] = (BYTE)(y & 0xff);
+  contact[4] = (BYTE)((y >> 8) & 0xff);
+}
+
+// Handwriting-like input: strokes of 20 to 200 frames with up to 4 more
+// fingers resting on the surface from time to time (the lift report of the
+// resting fingers is missing in every 8th stroke) and every few messages
+// carrying more than one report (RAWHID.dwCount > 1). A frame that does not
+// fit into the contactsPerReport contact collections continues in the next
+// reports with a contact count of 0, which may be in the next message.
+// (*numContacts) is the number of contacts written into the reports.
+static BYTE* mBuildSyntheticTrace(unsigned int numMessages, unsigned int contactsPerReport, size_t* cbTrace, unsigned long long* numContacts)
+{
+  BYTE* trace     = NULL;
+  size_t capacity = 0;
+  (*cbTrace)      = 0;
+
+  TOUCH_TRACE_FILE_HEADER fileHeader;
+  memset(&fileHeader, 0, sizeof(TOUCH_TRACE_FILE_HEADER));
+  fileHeader.Magic              = TOUCH_TRACE_MAGIC;
+  fileHeader.Version            = TOUCH_TRACE_VERSION;
+  fileHeader.cbFileHeader       = sizeof(TOUCH_TRACE_FILE_HEADER);
+  fileHeader.cbRecordHeader     = sizeof(TOUCH_TRACE_RECORD_HEADER);
+  fileHeader.TimestampFrequency = 1000000;
+  fileHeader.StartTimestamp     = 0;
+
+  mAppendToBuffer(&trace, cbTrace, &capacity, &fileHeader, sizeof(TOUCH_TRACE_FILE_HEADER));
+
+  // the contacts, 2 bytes of scan time and the contact count
+  unsigned int cbReport = 1 + (contactsPerReport * SYNTHETIC_CB_CONTACT) + 2 + 1;
+
+  HID_TOUCH_DECODE_PLAN plan;
+  mInitializeTouchDecodePlan(&plan);
+  plan.ReportID     = SYNTHETIC_REPORT_ID;
+  plan.NumContacts  = contactsPerReport;
+  plan.ContactCount = mMakeField((cbReport - 1) * 8, 8, SYNTHETIC_MAX_FRAME_CONTACTS);
+
+  for (unsigned int slotIdx = 0; slotIdx < contactsPerReport; slotIdx++)
+  {
+    unsigned int contactBitOffset = (1 + (slotIdx * SYNTHETIC_CB_CONTACT)) * 8;
+
+    plan.Contacts[slotIdx].LinkColID = (USHORT)(slotIdx + 1);
+    plan.Contacts[slotIdx].TipSwitch = mMakeField(contactBitOffset, 1, 1);
+    plan.Contacts[slotIdx].ContactID = mMakeField(contactBitOffset + 2, 6, 63);
+    plan.Contacts[slotIdx].X         = mMakeField(contactBitOffset + 8, 16, 4095);
+    plan.Contacts[slotIdx].Y         = mMakeField(contactBitOffset + 24, 16, 4095);
+  }
+
+  mFinalizeTouchDecodePlan(&plan);
+  mAppendTraceRecord(&trace, cbTrace, &capacity, TOUCH_TRACE_RECORD_DECODE_PLAN, 0, 0, &plan, sizeof(HID_TOUCH_DECODE_PLAN));
+
+  unsigned int randomState = 12345;
+#define NEXT_RANDOM() (randomState = (randomState * 1103515245u) + 12345u, (randomState >> 16) & 0x7fff)
+
+  // the writing finger uses the contact IDs 0 to 31, the resting fingers 32 to 63
+  ULONG writingContactID         = 0;
+  ULONG firstRestingContactID    = 0;
+  unsigned int strokeLeft        = 0;
+  ULONG x                        = 0;
+  ULONG y                        = 0;
+  int velocityX                  = 0;
+  int velocityY                  = 0;
+  unsigned int numRestingFingers = 0;
+  int isRestingLiftDropped       = 0;
+  unsigned long long time        = 0;
+  BYTE reports[2 * SYNTHETIC_MAX_CB_REPORT];
+
+  // the frame that is being written into the reports
+  ULONG frameContactIDs[SYNTHETIC_MAX_FRAME_CONTACTS];
+  ULONG frameX[SYNTHETIC_MAX_FRAME_CONTACTS];
+  ULONG frameY[SYNTHETIC_MAX_FRAME_CONTACTS];
+  int isFrameOnSurface            = 0;
+  unsigned int frameSize          = 0;
+  unsigned int numWrittenContacts = 0;
+
+  (*numContacts) = 0;
+
+  for (unsigned int messageIdx = 0; messageIdx < numMessages; messageIdx++)
+  {
+    unsigned int numReports = ((NEXT_RANDOM() % 8) == 0) ? 2 : 1;
+
+    for (unsigned int reportIdx = 0; reportIdx < numReports; reportIdx++)
+    {
+      BYTE* report = reports + (reportIdx * cbReport);
+      memset(report, 0, cbReport);
+      report[0] = SYNTHETIC_REPORT_ID;
+
+      if (numWrittenContacts == frameSize)
+      {
+        if (strokeLeft == 0)
+        {
+          // a new stroke with new contact IDs like a real device
+          writingContactID      = (writingContactID + 1) & 0x1f;
+          firstRestingContactID = (firstRestingContactID + numRestingFingers) & 0x1f;
+          strokeLeft            = 20 + (NEXT_RANDOM() % 180);
+          x                     = 500 + (NEXT_RANDOM() % 3000);
+          y                     = 500 + (NEXT_RANDOM() % 3000);
+          velocityX             = 0;
+          velocityY             = 0;
+          numRestingFingers     = ((NEXT_RANDOM() % 4) == 0) ? (1 + (NEXT_RANDOM() % (SYNTHETIC_MAX_FRAME_CONTACTS - 1))) : 0;
+          // a flaky device that never reports the lift of the resting fingers,
+          // they stay in the contact table until they are evicted
+          isRestingLiftDropped = ((NEXT_RANDOM() % 8) == 0);
+        }
+        else
+        {
+          // the pen keeps its direction for a while like in handwriting, with some sensor noise
+          velocityX += (int)(NEXT_RANDOM() % 3) - 1;
+          velocityY += (int)(NEXT_RANDOM() % 3) - 1;
+          velocityX = (velocityX < -8) ? -8 : ((velocityX > 8) ? 8 : velocityX);
+          velocityY = (velocityY < -8) ? -8 : ((velocityY > 8) ? 8 : velocityY);
+
+          x = (x + velocityX + (int)(NEXT_RANDOM() % 3) - 1) & 0xfff;
+          y = (y + velocityY + (int)(NEXT_RANDOM() % 3) - 1) & 0xfff;
+        }
+
+        strokeLeft--;
+        isFrameOnSurface = (strokeLeft != 0);
+
+        frameContactIDs[0] = writingContactID;
+        frameX[0]          = x;
+        frameY[0]          = y;
+
+        for (unsigned int fingerIdx = 0; fingerIdx < numRestingFingers; fingerIdx++)
+        {
+          frameContactIDs[1 + fingerIdx] = 0x20 | ((firstRestingContactID + fingerIdx) & 0x1f);
+          frameX[1 + fingerIdx]          = 3800 - (fingerIdx * 200);
+          frameY[1 + fingerIdx]          = 3800;
+        }
+
+        frameSize          = (!isFrameOnSurface && isRestingLiftDropped) ? 1 : (1 + numRestingFingers);
+        numWrittenContacts = 0;
+
+        // only the first report of a frame carries its contact count
+        report[cbReport - 1] = (BYTE)frameSize;
+      }
+
+      for (unsigned int slotIdx = 0; (slotIdx < contactsPerReport) && (numWrittenContacts < frameSize); slotIdx++)
+      {
+        mWriteSyntheticContact(report, slotIdx, frameContactIDs[numWrittenContacts], isFrameOnSurface, frameX[numWrittenContacts], frameY[numWrittenContacts]);
+        numWrittenContacts++;
+        (*numContacts)++;
+      }
+    }
+
+    mAppendTraceRecord(&trace, cbTrace, &capacity, TOUCH_TRACE_RECORD_REPORTS, numReports, time, reports, numReports * cbReport);
+    time += SYNTHETIC_MESSAGE_INTERVAL_US;
+  }
+#undef NEXT_RANDOM
+
+  return trace;
+}
+
+static void mReplayDecodePlanRecord(REPLAY_STATE* state, const TOUCH_TRACE_RECORD_HEADER* record)
+{
+  if (record->cbPayload != sizeof(HID_TOUCH_DECODE_PLAN))
+  {
+    printf(FG_YELLOW);
+    printf("Skipping the decode plan of device #%d (recorded by an incompatible build)\n", record->DeviceIdx);
+    printf(RESET_COLOR);
+    return;
+  }
+
+  if (record->DeviceIdx >= state->NumDecodePlans)
+  {
+    unsigned int numDecodePlans = record->DeviceIdx + 1;
+    state->DecodePlans          = (HID_TOUCH_DECODE_PLAN*)mRealloc(state->DecodePlans, sizeof(HID_TOUCH_DECODE_PLAN) * numDecodePlans, __FILE__, __LINE__);
+    state->DecodeStates         = (HID_TOUCH_DECODE_STATE*)mRealloc(state->DecodeStates, sizeof(HID_TOUCH_DECODE_STATE) * numDecodePlans, __FILE__, __LINE__);
+    memset(&state->DecodePlans[state->NumDecodePlans], 0, sizeof(HID_TOUCH_DECODE_PLAN) * (numDecodePlans - state->NumDecodePlans));
+    state->NumDecodePlans = numDecodePlans;
+  }
+
+  memcpy(&state->DecodePlans[record->DeviceIdx], mGetTouchTraceRecordPayload(record), sizeof(HID_TOUCH_DECODE_PLAN));
+  mResetTouchDecodeState(&state->DecodeStates[record->DeviceIdx]);
+}
+
+// the same steps as mHandleInputMessage without the drawing
+static void mReplayReportsRecord(REPLAY_STATE* state, const TOUCH_TRACE_RECORD_HEADER* record)
+{
+  if ((record->DeviceIdx >= state->NumDecodePlans) || !state->DecodePlans[record->DeviceIdx].IsValid || (record->Count == 0))
+  {
+    state->NumSkippedMessages++;
+    return;
+  }
+
+  unsigned long long stageTimestamps[NUM_STAGES];
+
+  stageTimestamps[0] = mGetTimestamp();
+
+  mDecodeTouchReportBatch(&state->DecodePlans[record->DeviceIdx], &state->DecodeStates[record->DeviceIdx], mGetTouchTraceRecordPayload(record), record->cbPayload / record->Count, record->Count, &state->ReportSequenceNumber, &state->TouchBatch);
+
+  stageTimestamps[1] = mGetTimestamp();
+
+  unsigned int numEvictedContacts = state->PreviousTouches.NumEvictedContacts;
+
+  if (mInterpretRawTouchInputBatch(&state->PreviousTouches, state->TouchBatch.Entries, state->TouchBatch.Size, state->TouchBatch.EventTypes) != 0)
+  {
+    printf(FG_RED);
+    printf("mInterpretRawTouchInputBatch failed at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    exit(-1);
+  }
+
+  stageTimestamps[2] = mGetTimestamp();
+  state->NumEvictedContacts += state->PreviousTouches.NumEvictedContacts - numEvictedContacts;
+
+  for (unsigned int contactIdx = 0; contactIdx < state->TouchBatch.Size; contactIdx++)
+  {
+    unsigned int strokeEvent;
+    if (mAddTouchEventToStrokes(state->TouchBatch.Entries[contactIdx], state->TouchBatch.EventTypes[contactIdx], &state->TrackingTouchID, &state->Strokes, &strokeEvent) != 0)
+    {
+      printf(FG_RED);
+      printf("The application state is broken!\n");
+      printf(RESET_COLOR);
+      exit(-1);
+    }
+
+    if (strokeEvent == STROKE_EVENT_NEW_STROKE)
+    {
+      state->NumStrokes++;
+    }
+  }
+
+  stageTimestamps[3] = mGetTimestamp();
+
+  mAddLatencySample(&state->StageLatencies[STAGE_DECODE], stageTimestamps[1] - stageTimestamps[0]);
+  mAddLatencySample(&state->StageLatencies[STAGE_INTERPRET], stageTimestamps[2] - stageTimestamps[1]);
+  mAddLatencySample(&state->StageLatencies[STAGE_STROKE], stageTimestamps[3] - stageTimestamps[2]);
+  mAddLatencySample(&state->StageLatencies[STAGE_TOTAL], stageTimestamps[3] - stageTimestamps[0]);
+
+  state->NumMessages++;
+  state->NumReports += record->Count;
+  state->NumContacts += state->TouchBatch.Size;
+}
+
+// repaint every stroke like after a resize, with the raw or with the simplified points
+static double mMeasurePaintMicroseconds(StrokeList* strokes, CANVAS* canvas, int isSimplified)
+{
+  unsigned long long time = mGetTimestamp();
+
+  mFillCanvas(canvas, CANVAS_COLOR(0, 0, 0));
+  if (isSimplified)
+  {
+    mDrawCanvasStrokes(canvas, strokes, PAINT_STROKE_WIDTH, CANVAS_COLOR(255, 255, 255));
+  }
+  else
+  {
+    for (unsigned int strokeIdx = 0; strokeIdx < strokes->Size; strokeIdx++)
+    {
+      StrokeIndexEntry stroke = strokes->Entries[strokeIdx];
+      Point2D* strokePoints   = mGetStrokePoints(strokes, strokeIdx);
+
+      for (unsigned int pointIdx = 1; pointIdx < stroke.Size; pointIdx++)
+      {
+        mDrawCanvasSegment(canvas, strokePoints[pointIdx - 1], strokePoints[pointIdx], PAINT_STROKE_WIDTH, CANVAS_COLOR(255, 255, 255));
+      }
+    }
+  }
+
+  return (double)(mGetTimestamp() - time) * 1e6 / (double)mGetTimestampFrequency();
+}
+
+static void mPrintSimplification(StrokeList* strokes)
+{
+  unsigned int* pixels = (unsigned int*)mMalloc(sizeof(unsigned int) * PAINT_CANVAS_SIZE * PAINT_CANVAS_SIZE, __FILE__, __LINE__);
+  CANVAS canvas;
+  mInitializeCanvas(&canvas, pixels, PAINT_CANVAS_SIZE, PAINT_CANVAS_SIZE, PAINT_CANVAS_SIZE);
+  // touch the pages before measuring
+  mFillCanvas(&canvas, CANVAS_COLOR(0, 0, 0));
+
+  double rawMicroseconds        = mMeasurePaintMicroseconds(strokes, &canvas, 0);
+  double simplifiedMicroseconds = mMeasurePaintMicroseconds(strokes, &canvas, 1);
+
+  printf("simplification (tolerance %.1f): %u -> %u points (%.1f%% dropped)\n", strokes->SimplifyTolerance, strokes->Points.Size, strokes->SimplifiedPoints.Size, (strokes->Points.Size != 0) ? (100.0 * (strokes->Points.Size - strokes->SimplifiedPoints.Size) / strokes->Points.Size) : 0.0);
+  printf("repaint of all strokes: raw %.0f us, simplified %.0f us\n", rawMicroseconds, simplifiedMicroseconds);
+
+  free(pixels);
+}
+
+static void mReplayTrace(REPLAY_STATE* state, const BYTE* trace, size_t cbTrace, int isPaced)
+{
+  const TOUCH_TRACE_FILE_HEADER* fileHeader = mGetTouchTraceFileHeader(trace, cbTrace);
+  if (fileHeader == NULL)
+  {
+    printf(FG_RED);
+    printf("The trace is not a supported touch trace at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    exit(-1);
+  }
+
+  double clockTicksPerTraceTick          = (double)mGetTimestampFrequency() / (double)fileHeader->TimestampFrequency;
+  unsigned long long replayStart          = mGetTimestamp();
+  int hasFirstReport                      = 0;
+  unsigned long long firstReportTimestamp = 0;
+
+  size_t offset = fileHeader->cbFileHeader;
+  const TOUCH_TRACE_RECORD_HEADER* record;
+
+  while ((record = mGetNextTouchTraceRecord(trace, cbTrace, &offset)) != NULL)
+  {
+    if (record->Type == TOUCH_TRACE_RECORD_DECODE_PLAN)
+    {
+      mReplayDecodePlanRecord(state, record);
+    }
+    else if (record->Type == TOUCH_TRACE_RECORD_REPORTS)
+    {
+      unsigned long long scheduledArrival = 0;
+
+      if (isPaced)
+      {
+        if (!hasFirstReport)
+        {
+          hasFirstReport       = 1;
+          firstReportTimestamp = record->Timestamp;
+          replayStart          = mGetTimestamp();
+        }
+
+        scheduledArrival = replayStart + (unsigned long long)((record->Timestamp - firstReportTimestamp) * clockTicksPerTraceTick);
+
+        // sleep most of the way and spin for the rest to hit the arrival time
+        unsigned long long now = mGetTimestamp();
+        while (now < scheduledArrival)
+        {
+          double millisecondsLeft = (double)(scheduledArrival - now) * 1000.0 / (double)mGetTimestampFrequency();
+          if (millisecondsLeft > 2.0)
+          {
+            mSleepMilliseconds((unsigned int)(millisecondsLeft - 1.0));
+          }
+
+          now = mGetTimestamp();
+        }
+      }
+
+      mReplayReportsRecord(state, record);
+
+      if (isPaced)
+      {
+        mAddLatencySample(&state->ArrivalLatencies, mGetTimestamp() - scheduledArrival);
+      }
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  const char* tracePath             = NULL;
+  int isPaced                       = 0;
+  unsigned int repeat               = 1;
+  unsigned int numSyntheticMessages = SYNTHETIC_NUM_MESSAGES;
+  float tolerance                   = 2.0f;
+  int isHybrid                      = 0;
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--trace") == 0) && ((argIdx + 1) < argc))
+    {
+      tracePath = argv[++argIdx];
+    }
+    else if ((strcmp(argv[argIdx], "--messages") == 0) && ((argIdx + 1) < argc))
+    {
+      numSyntheticMessages = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if (strcmp(argv[argIdx], "--hybrid") == 0)
+    {
+      isHybrid = 1;
+    }
+    else if (strcmp(argv[argIdx], "--paced") == 0)
+    {
+      isPaced = 1;
+    }
+    else if ((strcmp(argv[argIdx], "--repeat") == 0) && ((argIdx + 1) < argc))
+    {
+      repeat = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--tolerance") == 0) && ((argIdx + 1) < argc))
+    {
+      tolerance = (float)atof(argv[++argIdx]);
+    }
+    else
+    {
+      printf("Usage: %s [--trace <file> | --messages <count> [--hybrid]] [--paced] [--repeat <count>] [--tolerance <units>]\n", argv[0]);
+      return -1;
+    }
+  }
+
+  TOUCH_TRACE_MAPPING mapping;
+  const BYTE* trace    = NULL;
+  size_t cbTrace       = 0;
+  BYTE* syntheticTrace = NULL;
+  // contacts of one replay of the synthetic trace
+  unsigned long long numSyntheticContacts = 0;
+
+  if (tracePath != NULL)
+  {
+    if (mMapTouchTrace(tracePath, &mapping) != 0)
+    {
+      return -1;
+    }
+
+    trace   = mapping.Data;
+    cbTrace = mapping.cbData;
+  }
+  else
+  {
+    unsigned int contactsPerReport = isHybrid ? SYNTHETIC_HYBRID_CONTACTS_PER_REPORT : SYNTHETIC_MAX_FRAME_CONTACTS;
+    syntheticTrace                 = mBuildSyntheticTrace(numSyntheticMessages, contactsPerReport, &cbTrace, &numSyntheticContacts);
+    trace          = syntheticTrace;
+  }
+
+  REPLAY_STATE* state = (REPLAY_STATE*)calloc(1, sizeof(REPLAY_STATE));
+  if (state == NULL)
+  {
+    return -1;
+  }
+
+  mResetTouchContactTable(&state->PreviousTouches);
+  state->TrackingTouchID          = (ULONG)-1;
+  state->Strokes.SimplifyTolerance = tolerance;
+
+  unsigned long long allocationsBefore = mGetNumMemoryAllocations();
+  unsigned long long replayStart       = mGetTimestamp();
+
+  for (unsigned int repeatIdx = 0; repeatIdx < repeat; repeatIdx++)
+  {
+    // keep the strokes of the last replay for the simplification report
+    if (repeatIdx != 0)
+    {
+      // like pressing C in the application
+      mResetTouchContactTable(&state->PreviousTouches);
+      mClearStrokeList(&state->Strokes);
+      state->TrackingTouchID = (ULONG)-1;
+    }
+
+    mReplayTrace(state, trace, cbTrace, isPaced);
+  }
+
+  unsigned long long replayEnd      = mGetTimestamp();
+  unsigned long long numAllocations = mGetNumMemoryAllocations() - allocationsBefore;
+  double seconds                    = (double)(replayEnd - replayStart) / (double)mGetTimestampFrequency();
+  double nanosecondsPerTick         = 1e9 / (double)mGetTimestampFrequency();
+
+  printf("trace: %s (%zu bytes), mode: %s, repeat: %u\n", (tracePath != NULL) ? tracePath : (isHybrid ? "synthetic hybrid" : "synthetic"), cbTrace, isPaced ? "paced" : "as fast as possible", repeat);
+  printf("messages: %llu (skipped %llu), reports: %llu, contacts: %llu (stale evicted %llu), strokes: %llu\n", state->NumMessages, state->NumSkippedMessages, state->NumReports, state->NumContacts, state->NumEvictedContacts, state->NumStrokes);
+  printf("reports/s: %.0f, contacts/s: %.0f\n", state->NumReports / seconds, state->NumContacts / seconds);
+#ifdef COUNT_MEMORY_ALLOCATIONS
+  printf("allocations: %llu, allocations/report: %.6f\n", numAllocations, (state->NumReports != 0) ? ((double)numAllocations / (double)state->NumReports) : 0.0);
+#else
+  printf("allocations: not counted (build with -DCOUNT_MEMORY_ALLOCATIONS)\n");
+  (void)numAllocations;
+#endif
+
+  printf("per message latency:\n");
+  for (unsigned int stageIdx = 0; stageIdx < NUM_STAGES; stageIdx++)
+  {
+    mPrintLatencies(STAGE_NAMES[stageIdx], &state->StageLatencies[stageIdx], nanosecondsPerTick);
+  }
+
+  if (isPaced)
+  {
+    mPrintLatencies("arrival", &state->ArrivalLatencies, nanosecondsPerTick);
+  }
+
+  mPrintSimplification(&state->Strokes);
+
+  if (tracePath != NULL)
+  {
+    mUnmapTouchTrace(&mapping);
+  }
+
+  free(syntheticTrace);
+
+  if (tracePath == NULL)
+  {
+    if (state->NumContacts != (numSyntheticContacts * repeat))
+    {
+      printf(FG_RED);
+      printf("%llu of the %llu contacts of the synthetic trace reached the interpreter at %s:%d\n", state->NumContacts, numSyntheticContacts * repeat, __FILE__, __LINE__);
+      printf(RESET_COLOR);
+      return -1;
+    }
+
+    printf(FG_GREEN);
+    printf("Every contact of the synthetic trace reached the interpreter: OK\n");
+    printf(RESET_COLOR);
+  }
+
+  return 0;
+}
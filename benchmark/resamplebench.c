@@ -0,0 +1,141 @@
+// Microbenchmark of the stroke resampler (touchpad/resampler.h) on long
+// strokes. A spiral is revealed to the resampler one raw point at a time like
+// during writing, and the cost per raw point is compared with resampling the
+// whole stroke again after every point. It checks that the incremental result
+// is the same as resampling the finished stroke in one go.
+//
+//   gcc -O2 -DCOUNT_MEMORY_ALLOCATIONS -I../touchpad -o resamplebench resamplebench.c ../touchpad/resampler.c ../touchpad/stroke.c ../touchpad/point2d.c ../touchpad/threading.c ../touchpad/utils.c ../touchpad/hashindex.c ../touchpad/hiddecoder.c -lm -lpthread
+#include "platform.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "stroke.h"
+#include "resampler.h"
+
+#define RESAMPLE_SPACING 8.0f
+// the full resampling is quadratic, stop measuring it above this length
+#define MAX_FULL_RESAMPLE_POINTS 20000
+
+// a spiral around the center of a 4096x4096 touchpad with about 2 device units between two reports
+static void mBuildSpiralStroke(StrokeList* strokes, unsigned int numPoints)
+{
+  float angle = 0.0f;
+
+  for (unsigned int pointIdx = 0; pointIdx < numPoints; pointIdx++)
+  {
+    float radius = 100.0f + (1800.0f * (float)pointIdx / (float)numPoints);
+    angle += 2.0f / radius;
+
+    Point2D point;
+    point.X = (ULONG)(2048.0f + (radius * cosf(angle)));
+    point.Y = (ULONG)(2048.0f + (radius * sinf(angle)));
+
+    if (pointIdx == 0)
+    {
+      mCreateNewStroke(point, strokes);
+    }
+    else
+    {
+      mAppendPoint2DToLastStroke(point, strokes);
+    }
+  }
+}
+
+int main()
+{
+  const unsigned int lengths[4] = {1000, 10000, 100000, 1000000};
+
+  printf("%10s %12s %18s %18s %12s %10s\n", "raw points", "resampled", "incremental ns/pt", "full ns/pt", "allocations", "identical");
+
+  for (unsigned int lengthIdx = 0; lengthIdx < 4; lengthIdx++)
+  {
+    unsigned int numPoints = lengths[lengthIdx];
+
+    StrokeList strokes;
+    memset(&strokes, 0, sizeof(StrokeList));
+    mBuildSpiralStroke(&strokes, numPoints);
+
+    // resample the finished stroke in one go as the reference
+    STROKE_RESAMPLER reference;
+    mInitializeStrokeResampler(&reference, numPoints + 1, 1, RESAMPLE_SPACING);
+    mUpdateStrokeResampler(&reference, &strokes);
+    mFinishResampledStroke(&reference);
+
+    // reveal the raw points one at a time
+    STROKE_RESAMPLER resampler;
+    mInitializeStrokeResampler(&resampler, numPoints + 1, 1, RESAMPLE_SPACING);
+
+    unsigned long long allocationsBefore = mGetNumMemoryAllocations();
+    unsigned long long time              = mGetTimestamp();
+    for (unsigned int pointIdx = 1; pointIdx <= numPoints; pointIdx++)
+    {
+      strokes.Entries[0].Size = pointIdx;
+      mUpdateStrokeResampler(&resampler, &strokes);
+    }
+    mFinishResampledStroke(&resampler);
+    double incrementalNanoseconds     = (double)(mGetTimestamp() - time) * 1e9 / (double)mGetTimestampFrequency() / numPoints;
+    unsigned long long numAllocations = mGetNumMemoryAllocations() - allocationsBefore;
+
+    int isIdentical = (resampler.NumPoints == reference.NumPoints) && (memcmp(resampler.Points, reference.Points, sizeof(RESAMPLED_POINT) * reference.NumPoints) == 0);
+
+    // resample everything again after every point
+    double fullNanoseconds = 0.0;
+    if (numPoints <= MAX_FULL_RESAMPLE_POINTS)
+    {
+      time = mGetTimestamp();
+      for (unsigned int pointIdx = 1; pointIdx <= numPoints; pointIdx++)
+      {
+        strokes.Entries[0].Size = pointIdx;
+        mClearStrokeResampler(&resampler);
+        mUpdateStrokeResampler(&resampler, &strokes);
+      }
+      fullNanoseconds = (double)(mGetTimestamp() - time) * 1e9 / (double)mGetTimestampFrequency() / numPoints;
+    }
+
+    printf("%10u %12u %18.1f ", numPoints, reference.NumPoints, incrementalNanoseconds);
+    if (numPoints <= MAX_FULL_RESAMPLE_POINTS)
+    {
+      printf("%18.1f ", fullNanoseconds);
+    }
+    else
+    {
+      printf("%18s ", "-");
+    }
+#ifdef COUNT_MEMORY_ALLOCATIONS
+    printf("%12llu ", numAllocations);
+#else
+    printf("%12s ", "not counted");
+    (void)numAllocations;
+#endif
+
+    if (isIdentical)
+    {
+      printf(FG_GREEN);
+      printf("%10s", "yes");
+    }
+    else
+    {
+      printf(FG_RED);
+      printf("%10s", "NO");
+    }
+    printf(RESET_COLOR);
+    printf("\n");
+
+    mFreeStrokeResampler(&resampler);
+    mFreeStrokeResampler(&reference);
+    mFreeStrokeList(&strokes);
+
+    if (!isIdentical)
+    {
+      return -1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,158 @@
+// Stress test and throughput benchmark of the SPSC ring (touchpad/spscring.h)
+// that carries the touch events from the input thread to the UI thread. The
+// producer pushes TOUCH_EVENTs with increasing sequence numbers in random
+// batch sizes and the consumer checks that it receives every event exactly
+// once and in order. It exits with -1 on the first lost or reordered event.
+//
+//   gcc -O2 -I../touchpad -o ringbench ringbench.c ../touchpad/spscring.c ../touchpad/threading.c ../touchpad/utils.c ../touchpad/hashindex.c ../touchpad/hiddecoder.c -lpthread
+//
+// Usage: ringbench [--events <count>] [--capacity <count>]
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "spscring.h"
+#include "touchevents.h"
+
+#define MAX_BATCH_SIZE 64
+
+struct RING_BENCH_STATE
+{
+  SPSC_RING Ring;
+  unsigned long long NumEvents;
+  // number of times that the producer found the ring full
+  unsigned long long NumFullRetries;
+};
+
+typedef struct RING_BENCH_STATE RING_BENCH_STATE;
+
+static void mProducerThread(void* arg)
+{
+  RING_BENCH_STATE* state  = (RING_BENCH_STATE*)arg;
+  unsigned int randomState = 1;
+  TOUCH_EVENT batch[MAX_BATCH_SIZE];
+
+  unsigned long long sequenceNumber = 0;
+  while (sequenceNumber < state->NumEvents)
+  {
+    randomState            = (randomState * 1103515245u) + 12345u;
+    unsigned int batchSize = 1 + ((randomState >> 16) % MAX_BATCH_SIZE);
+    if (batchSize > (state->NumEvents - sequenceNumber))
+    {
+      batchSize = (unsigned int)(state->NumEvents - sequenceNumber);
+    }
+
+    for (unsigned int eventIdx = 0; eventIdx < batchSize; eventIdx++)
+    {
+      unsigned long long eventNumber = sequenceNumber + eventIdx;
+
+      batch[eventIdx].Touch.TouchID        = (ULONG)(eventNumber & 0xf);
+      batch[eventIdx].Touch.X              = (ULONG)eventNumber;
+      batch[eventIdx].Touch.Y              = (ULONG)(eventNumber >> 32);
+      batch[eventIdx].Touch.OnSurface      = 1;
+      batch[eventIdx].Touch.SequenceNumber = (ULONG)(eventNumber * 7);
+      batch[eventIdx].EventType            = EVENT_TYPE_TOUCH_MOVE;
+    }
+
+    unsigned int numPushed = 0;
+    while (numPushed < batchSize)
+    {
+      unsigned int count = mPushToSpscRing(&state->Ring, &batch[numPushed], batchSize - numPushed);
+      if (count == 0)
+      {
+        state->NumFullRetries++;
+        mYieldThread();
+      }
+
+      numPushed += count;
+    }
+
+    sequenceNumber += batchSize;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned long long numEvents = 100000000ULL;
+  unsigned int capacity        = 4096;
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--events") == 0) && ((argIdx + 1) < argc))
+    {
+      numEvents = strtoull(argv[++argIdx], NULL, 10);
+    }
+    else if ((strcmp(argv[argIdx], "--capacity") == 0) && ((argIdx + 1) < argc))
+    {
+      capacity = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else
+    {
+      printf("Usage: %s [--events <count>] [--capacity <count>]\n", argv[0]);
+      return -1;
+    }
+  }
+
+  RING_BENCH_STATE* state = (RING_BENCH_STATE*)mMalloc(sizeof(RING_BENCH_STATE), __FILE__, __LINE__);
+  memset(state, 0, sizeof(RING_BENCH_STATE));
+  state->NumEvents = numEvents;
+  mInitializeSpscRing(&state->Ring, sizeof(TOUCH_EVENT), capacity);
+
+  unsigned long long startTime = mGetTimestamp();
+
+  THREAD_HANDLE producerThread;
+  if (mCreateThread(&producerThread, mProducerThread, state) != 0)
+  {
+    return -1;
+  }
+
+  TOUCH_EVENT batch[MAX_BATCH_SIZE * 4];
+  unsigned long long expectedNumber = 0;
+  unsigned long long numEmptyPolls  = 0;
+
+  while (expectedNumber < numEvents)
+  {
+    unsigned int count = mPopFromSpscRing(&state->Ring, batch, MAX_BATCH_SIZE * 4);
+    if (count == 0)
+    {
+      numEmptyPolls++;
+      mYieldThread();
+      continue;
+    }
+
+    for (unsigned int eventIdx = 0; eventIdx < count; eventIdx++)
+    {
+      TOUCH_EVENT* touchEvent = &batch[eventIdx];
+
+      int isValid = (touchEvent->Touch.X == (ULONG)expectedNumber) && (touchEvent->Touch.Y == (ULONG)(expectedNumber >> 32)) && (touchEvent->Touch.TouchID == (ULONG)(expectedNumber & 0xf)) && (touchEvent->Touch.SequenceNumber == (ULONG)(expectedNumber * 7)) && (touchEvent->EventType == EVENT_TYPE_TOUCH_MOVE);
+      if (!isValid)
+      {
+        printf(FG_RED);
+        printf("Event #%llu is lost or corrupted (received X = %u)\n", expectedNumber, touchEvent->Touch.X);
+        printf(RESET_COLOR);
+        return -1;
+      }
+
+      expectedNumber++;
+    }
+  }
+
+  mJoinThread(&producerThread);
+
+  double seconds = (double)(mGetTimestamp() - startTime) / (double)mGetTimestampFrequency();
+
+  printf(FG_GREEN);
+  printf("%llu events (%u bytes each) through a ring of %u entries: OK\n", numEvents, (unsigned int)sizeof(TOUCH_EVENT), state->Ring.Capacity);
+  printf(RESET_COLOR);
+  printf("%.1f M events/s, %.1f MB/s, producer full retries: %llu, consumer empty polls: %llu\n", numEvents / seconds / 1e6, numEvents * sizeof(TOUCH_EVENT) / seconds / 1e6, state->NumFullRetries, numEmptyPolls);
+
+  mFreeSpscRing(&state->Ring);
+  free(state);
+
+  return 0;
+}
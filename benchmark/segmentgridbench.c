@@ -0,0 +1,425 @@
+// Benchmark of the segment grid (touchpad/segmentgrid.h) on canvases of 10k
+// and 100k segments of random walks over a 1920x1080 area (the coordinates
+// of the touchpad are the pixels of the canvas like in the application). It
+// compares with scanning every segment of the list:
+//   update:  mUpdateSegmentGrid after every appended point (the append path)
+//   rect:    the segments that intersect a 64x64 rect (a hit test or an erase)
+//   nearest: the stroke closest to a point
+//   redraw:  mRedrawCanvasRectIndexed against mRedrawCanvasRect and a full
+//            repaint after hiding a stroke
+// The queries only look at the second half of the strokes (like the visible
+// strokes after a clear). Every answer of the grid is checked against the
+// scan, including the queries that are made while a stroke is still growing,
+// and the indexed redraw must produce the same pixels as the others.
+//
+//   gcc -O2 -I../touchpad -o segmentgridbench segmentgridbench.c ../touchpad/segmentgrid.c ../touchpad/canvas.c ../touchpad/stroke.c ../touchpad/point2d.c ../touchpad/threading.c ../touchpad/utils.c ../touchpad/hashindex.c ../touchpad/hiddecoder.c -lm -lpthread
+//
+// Usage: segmentgridbench [--cell-size <device units>]
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "canvas.h"
+#include "stroke.h"
+#include "segmentgrid.h"
+
+#define AREA_WIDTH       1920
+#define AREA_HEIGHT      1080
+#define STROKE_WIDTH     20.0f
+#define STROKE_COLOR     CANVAS_COLOR(255, 255, 255)
+#define BACKGROUND_COLOR CANVAS_COLOR(0, 0, 0)
+#define NUM_QUERIES      2000
+#define QUERY_RECT_SIZE  64
+
+static unsigned int g_random_state = 7;
+
+static unsigned int mNextRandom()
+{
+  g_random_state = (g_random_state * 1103515245u) + 12345u;
+  return (g_random_state >> 16) & 0x7fff;
+}
+
+static double mGetMicroseconds(unsigned long long start, unsigned long long end)
+{
+  return (double)(end - start) * 1e6 / (double)mGetTimestampFrequency();
+}
+
+static unsigned int mCountSegments(const StrokeList* strokes)
+{
+  unsigned int numSegments = 0;
+  for (unsigned int strokeIdx = 0; strokeIdx < strokes->Size; strokeIdx++)
+  {
+    numSegments += (strokes->Entries[strokeIdx].SimplifiedSize > 1) ? (strokes->Entries[strokeIdx].SimplifiedSize - 1) : 0;
+  }
+  return numSegments;
+}
+
+// Liang-Barsky: clip the segment to the rect, it intersects if something is left
+static int mIsSegmentInRectScan(Point2D from, Point2D to, const RECT* rect)
+{
+  double x0     = (double)from.X;
+  double y0     = (double)from.Y;
+  double dx     = (double)to.X - x0;
+  double dy     = (double)to.Y - y0;
+  double p[4]   = {-dx, dx, -dy, dy};
+  double q[4]   = {x0 - (double)rect->left, (double)rect->right - x0, y0 - (double)rect->top, (double)rect->bottom - y0};
+  double tEnter = 0.0;
+  double tLeave = 1.0;
+
+  for (int edgeIdx = 0; edgeIdx < 4; edgeIdx++)
+  {
+    if (p[edgeIdx] == 0.0)
+    {
+      if (q[edgeIdx] < 0.0)
+      {
+        return 0;
+      }
+      continue;
+    }
+
+    double t = q[edgeIdx] / p[edgeIdx];
+    if (p[edgeIdx] < 0.0)
+    {
+      tEnter = (t > tEnter) ? t : tEnter;
+    }
+    else
+    {
+      tLeave = (t < tLeave) ? t : tLeave;
+    }
+  }
+
+  return tEnter <= tLeave;
+}
+
+static void mQuerySegmentsScan(StrokeList* strokes, unsigned int firstStroke, unsigned int endStroke, const RECT* rect, STROKE_SEGMENT_LIST* result)
+{
+  result->Size = 0;
+
+  for (unsigned int strokeIdx = firstStroke; (strokeIdx < endStroke) && (strokeIdx < strokes->Size); strokeIdx++)
+  {
+    Point2D* strokePoints = mGetSimplifiedStrokePoints(strokes, strokeIdx);
+    for (unsigned int pointIdx = 1; pointIdx < strokes->Entries[strokeIdx].SimplifiedSize; pointIdx++)
+    {
+      if (mIsSegmentInRectScan(strokePoints[pointIdx - 1], strokePoints[pointIdx], rect))
+      {
+        if (result->Size == result->Capacity)
+        {
+          result->Capacity = (result->Capacity == 0) ? 64 : (result->Capacity * 2);
+          result->Entries  = (STROKE_SEGMENT*)mRealloc(result->Entries, sizeof(STROKE_SEGMENT) * result->Capacity, __FILE__, __LINE__);
+        }
+
+        result->Entries[result->Size] = (STROKE_SEGMENT){.StrokeIdx = strokeIdx, .PointIdx = pointIdx, .From = strokePoints[pointIdx - 1], .To = strokePoints[pointIdx]};
+        result->Size++;
+      }
+    }
+  }
+}
+
+static float mFindNearestStrokeScan(StrokeList* strokes, unsigned int firstStroke, unsigned int endStroke, Point2D point)
+{
+  double best = DBL_MAX;
+
+  for (unsigned int strokeIdx = firstStroke; (strokeIdx < endStroke) && (strokeIdx < strokes->Size); strokeIdx++)
+  {
+    Point2D* strokePoints = mGetSimplifiedStrokePoints(strokes, strokeIdx);
+    for (unsigned int pointIdx = 1; pointIdx < strokes->Entries[strokeIdx].SimplifiedSize; pointIdx++)
+    {
+      double fromX   = (double)strokePoints[pointIdx - 1].X;
+      double fromY   = (double)strokePoints[pointIdx - 1].Y;
+      double dx      = (double)strokePoints[pointIdx].X - fromX;
+      double dy      = (double)strokePoints[pointIdx].Y - fromY;
+      double px      = (double)point.X - fromX;
+      double py      = (double)point.Y - fromY;
+      double length  = (dx * dx) + (dy * dy);
+      double t       = (length > 0.0) ? (((px * dx) + (py * dy)) / length) : 0.0;
+      t              = (t < 0.0) ? 0.0 : ((t > 1.0) ? 1.0 : t);
+      double squared = ((px - (t * dx)) * (px - (t * dx))) + ((py - (t * dy)) * (py - (t * dy)));
+      best           = (squared < best) ? squared : best;
+    }
+  }
+
+  return (best == DBL_MAX) ? -1.0f : (float)sqrt(best);
+}
+
+static int mIsSameSegmentList(const STROKE_SEGMENT_LIST* first, const STROKE_SEGMENT_LIST* second)
+{
+  if (first->Size != second->Size)
+  {
+    return 0;
+  }
+
+  for (unsigned int segmentIdx = 0; segmentIdx < first->Size; segmentIdx++)
+  {
+    if ((first->Entries[segmentIdx].StrokeIdx != second->Entries[segmentIdx].StrokeIdx) || (first->Entries[segmentIdx].PointIdx != second->Entries[segmentIdx].PointIdx))
+    {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+static RECT mGetRandomQueryRect()
+{
+  RECT rect;
+  rect.left   = (LONG)(mNextRandom() % (AREA_WIDTH - QUERY_RECT_SIZE));
+  rect.top    = (LONG)(mNextRandom() % (AREA_HEIGHT - QUERY_RECT_SIZE));
+  rect.right  = rect.left + QUERY_RECT_SIZE - 1;
+  rect.bottom = rect.top + QUERY_RECT_SIZE - 1;
+  return rect;
+}
+
+// Write random walks until there are numSegments simplified segments, the grid
+// is updated after every point and checked against the scan while the strokes grow.
+static int mBuildStrokes(StrokeList* strokes, SEGMENT_GRID* grid, unsigned int numSegments, double* updateMicroseconds, unsigned int* numPoints)
+{
+  STROKE_SEGMENT_LIST gridResult;
+  STROKE_SEGMENT_LIST scanResult;
+  memset(&gridResult, 0, sizeof(STROKE_SEGMENT_LIST));
+  memset(&scanResult, 0, sizeof(STROKE_SEGMENT_LIST));
+
+  unsigned long long updateTime = 0;
+  int isValid                   = 1;
+  (*numPoints)                  = 0;
+
+  while ((mCountSegments(strokes) < numSegments) && isValid)
+  {
+    unsigned int strokeSize = 20 + (mNextRandom() % 80);
+    Point2D point           = (Point2D){.X = mNextRandom() % AREA_WIDTH, .Y = mNextRandom() % AREA_HEIGHT};
+    mCreateNewStroke(point, strokes);
+
+    for (unsigned int pointIdx = 1; pointIdx < strokeSize; pointIdx++)
+    {
+      long x = (long)point.X + (long)(mNextRandom() % 25) - 12;
+      long y = (long)point.Y + (long)(mNextRandom() % 25) - 12;
+
+      point.X = (ULONG)((x < 0) ? 0 : ((x >= AREA_WIDTH) ? (AREA_WIDTH - 1) : x));
+      point.Y = (ULONG)((y < 0) ? 0 : ((y >= AREA_HEIGHT) ? (AREA_HEIGHT - 1) : y));
+      mAppendPoint2DToLastStroke(point, strokes);
+
+      unsigned long long startTime = mGetTimestamp();
+      mUpdateSegmentGrid(grid, strokes);
+      updateTime += mGetTimestamp() - startTime;
+      (*numPoints)++;
+
+      // the last segment of the growing stroke is not in the grid yet
+      if ((mNextRandom() % 256) == 0)
+      {
+        RECT rect = (RECT){.left = (LONG)point.X - 8, .top = (LONG)point.Y - 8, .right = (LONG)point.X + 8, .bottom = (LONG)point.Y + 8};
+        mQuerySegmentGrid(grid, strokes, 0, strokes->Size, &rect, &gridResult);
+        mQuerySegmentsScan(strokes, 0, strokes->Size, &rect, &scanResult);
+
+        if (!mIsSameSegmentList(&gridResult, &scanResult))
+        {
+          printf(FG_RED);
+          printf("The grid found %u segment(s) around a growing stroke instead of %u at %s:%d\n", gridResult.Size, scanResult.Size, __FILE__, __LINE__);
+          printf(RESET_COLOR);
+          isValid = 0;
+          break;
+        }
+      }
+    }
+  }
+
+  (*updateMicroseconds) = mGetMicroseconds(0, updateTime) / (double)(*numPoints);
+
+  mFreeStrokeSegmentList(&gridResult);
+  mFreeStrokeSegmentList(&scanResult);
+
+  return isValid ? 0 : -1;
+}
+
+static int mRunBenchmark(unsigned int numSegments, int cellSize, unsigned int* pixels, unsigned int* reference)
+{
+  RECT bounds = (RECT){.left = 0, .top = 0, .right = AREA_WIDTH, .bottom = AREA_HEIGHT};
+
+  StrokeList strokes;
+  memset(&strokes, 0, sizeof(StrokeList));
+  strokes.SimplifyTolerance = 2.0f;
+
+  SEGMENT_GRID grid;
+  if (mInitializeSegmentGrid(&grid, &bounds, cellSize) != 0)
+  {
+    return -1;
+  }
+
+  double updateMicroseconds;
+  unsigned int numPoints;
+  if (mBuildStrokes(&strokes, &grid, numSegments, &updateMicroseconds, &numPoints) != 0)
+  {
+    mFreeSegmentGrid(&grid);
+    mFreeStrokeList(&strokes);
+    return -1;
+  }
+
+  // the queries see the second half of the strokes
+  unsigned int firstStroke = strokes.Size / 2;
+  unsigned int endStroke   = strokes.Size;
+
+  STROKE_SEGMENT_LIST gridResult;
+  STROKE_SEGMENT_LIST scanResult;
+  memset(&gridResult, 0, sizeof(STROKE_SEGMENT_LIST));
+  memset(&scanResult, 0, sizeof(STROKE_SEGMENT_LIST));
+
+  int isValid                    = 1;
+  unsigned long long numFound    = 0;
+  unsigned long long gridTime    = 0;
+  unsigned long long scanTime    = 0;
+  unsigned long long nearestGrid = 0;
+  unsigned long long nearestScan = 0;
+
+  for (unsigned int queryIdx = 0; (queryIdx < NUM_QUERIES) && isValid; queryIdx++)
+  {
+    RECT rect = mGetRandomQueryRect();
+
+    unsigned long long startTime = mGetTimestamp();
+    mQuerySegmentGrid(&grid, &strokes, firstStroke, endStroke, &rect, &gridResult);
+    unsigned long long gridEnd = mGetTimestamp();
+    mQuerySegmentsScan(&strokes, firstStroke, endStroke, &rect, &scanResult);
+    unsigned long long scanEnd = mGetTimestamp();
+
+    gridTime += gridEnd - startTime;
+    scanTime += scanEnd - gridEnd;
+    numFound += gridResult.Size;
+
+    if (!mIsSameSegmentList(&gridResult, &scanResult))
+    {
+      printf(FG_RED);
+      printf("Rect query %u: the grid found %u segment(s) instead of %u at %s:%d\n", queryIdx, gridResult.Size, scanResult.Size, __FILE__, __LINE__);
+      printf(RESET_COLOR);
+      isValid = 0;
+    }
+
+    Point2D point = (Point2D){.X = mNextRandom() % AREA_WIDTH, .Y = mNextRandom() % AREA_HEIGHT};
+    unsigned int nearestStroke;
+    float nearestDistance = -1.0f;
+
+    startTime = mGetTimestamp();
+    mFindNearestStroke(&grid, &strokes, firstStroke, endStroke, point, FLT_MAX, &nearestStroke, &nearestDistance);
+    gridEnd = mGetTimestamp();
+    float scanDistance = mFindNearestStrokeScan(&strokes, firstStroke, endStroke, point);
+    scanEnd = mGetTimestamp();
+
+    nearestGrid += gridEnd - startTime;
+    nearestScan += scanEnd - gridEnd;
+
+    if (fabsf(nearestDistance - scanDistance) > (1e-3f * (1.0f + scanDistance)))
+    {
+      printf(FG_RED);
+      printf("Nearest query %u: the grid found a stroke at %.3f instead of %.3f at %s:%d\n", queryIdx, nearestDistance, scanDistance, __FILE__, __LINE__);
+      printf(RESET_COLOR);
+      isValid = 0;
+    }
+  }
+
+  // hide strokes one after another (like undo) and redraw their area three ways
+  CANVAS canvas;
+  CANVAS referenceCanvas;
+  mInitializeCanvas(&canvas, pixels, AREA_WIDTH, AREA_HEIGHT, AREA_WIDTH);
+  mInitializeCanvas(&referenceCanvas, reference, AREA_WIDTH, AREA_HEIGHT, AREA_WIDTH);
+
+  StrokeList view = strokes;
+  view.Entries    = strokes.Entries + firstStroke;
+  view.Size       = endStroke - firstStroke;
+
+  mFillCanvas(&canvas, BACKGROUND_COLOR);
+  mDrawCanvasStrokes(&canvas, &view, STROKE_WIDTH, STROKE_COLOR);
+  mFillCanvas(&referenceCanvas, BACKGROUND_COLOR);
+  mDrawCanvasStrokes(&referenceCanvas, &view, STROKE_WIDTH, STROKE_COLOR);
+
+  unsigned long long indexedTime = 0;
+  unsigned long long scanRedraw  = 0;
+  unsigned int numRedraws        = 0;
+
+  for (; (numRedraws < 20) && isValid && (view.Size > 1); numRedraws++)
+  {
+    view.Size--;
+    endStroke--;
+
+    StrokeIndexEntry hidden = strokes.Entries[endStroke];
+    RECT changedBounds      = (RECT){.left = (LONG)hidden.MinX, .top = (LONG)hidden.MinY, .right = (LONG)hidden.MaxX, .bottom = (LONG)hidden.MaxY};
+
+    unsigned long long startTime = mGetTimestamp();
+    mRedrawCanvasRectIndexed(&canvas, &changedBounds, &grid, &strokes, firstStroke, endStroke, &gridResult, STROKE_WIDTH, STROKE_COLOR, BACKGROUND_COLOR);
+    unsigned long long indexedEnd = mGetTimestamp();
+    mRedrawCanvasRect(&referenceCanvas, &changedBounds, &view, STROKE_WIDTH, STROKE_COLOR, BACKGROUND_COLOR);
+    unsigned long long scanEnd = mGetTimestamp();
+
+    indexedTime += indexedEnd - startTime;
+    scanRedraw += scanEnd - indexedEnd;
+  }
+
+  // the partial redraws must add up to a full repaint
+  unsigned long long repaintStart = mGetTimestamp();
+  mFillCanvas(&referenceCanvas, BACKGROUND_COLOR);
+  mDrawCanvasStrokes(&referenceCanvas, &view, STROKE_WIDTH, STROKE_COLOR);
+  unsigned long long repaintTime = mGetTimestamp() - repaintStart;
+
+  if (memcmp(pixels, reference, sizeof(unsigned int) * AREA_WIDTH * AREA_HEIGHT) != 0)
+  {
+    printf(FG_RED);
+    printf("The indexed redraws differ from a full repaint at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    isValid = 0;
+  }
+
+  numRedraws = (numRedraws == 0) ? 1 : numRedraws;
+
+  printf("%7u segments (%u strokes), cells of %d: %u cell entries, update %.3f us/point\n", grid.NumSegments, strokes.Size, cellSize, grid.NumCellEntries, updateMicroseconds);
+  printf("  rect %dx%d (%.1f segments): grid %8.2f us, scan %9.2f us\n", QUERY_RECT_SIZE, QUERY_RECT_SIZE, (double)numFound / NUM_QUERIES, mGetMicroseconds(0, gridTime) / NUM_QUERIES, mGetMicroseconds(0, scanTime) / NUM_QUERIES);
+  printf("  nearest stroke:           grid %8.2f us, scan %9.2f us\n", mGetMicroseconds(0, nearestGrid) / NUM_QUERIES, mGetMicroseconds(0, nearestScan) / NUM_QUERIES);
+  printf("  redraw after an undo:     grid %8.2f us, scan %9.2f us, full repaint %.2f us\n", mGetMicroseconds(0, indexedTime) / numRedraws, mGetMicroseconds(0, scanRedraw) / numRedraws, mGetMicroseconds(0, repaintTime));
+
+  mFreeStrokeSegmentList(&gridResult);
+  mFreeStrokeSegmentList(&scanResult);
+  mFreeSegmentGrid(&grid);
+  mFreeStrokeList(&strokes);
+
+  return isValid ? 0 : -1;
+}
+
+int main(int argc, char* argv[])
+{
+  int cellSize = 64;
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--cell-size") == 0) && ((argIdx + 1) < argc))
+    {
+      cellSize = atoi(argv[++argIdx]);
+    }
+  }
+
+  unsigned int* pixels    = (unsigned int*)mMalloc(sizeof(unsigned int) * AREA_WIDTH * AREA_HEIGHT, __FILE__, __LINE__);
+  unsigned int* reference = (unsigned int*)mMalloc(sizeof(unsigned int) * AREA_WIDTH * AREA_HEIGHT, __FILE__, __LINE__);
+
+  const unsigned int segmentCounts[2] = {10000, 100000};
+  int isValid                         = 1;
+
+  for (unsigned int countIdx = 0; countIdx < 2; countIdx++)
+  {
+    if (mRunBenchmark(segmentCounts[countIdx], cellSize, pixels, reference) != 0)
+    {
+      isValid = 0;
+    }
+  }
+
+  if (isValid)
+  {
+    printf(FG_GREEN);
+    printf("Every query matched the scan and every redraw matched the reference\n");
+    printf(RESET_COLOR);
+  }
+
+  free(pixels);
+  free(reference);
+
+  return isValid ? 0 : -1;
+}
@@ -0,0 +1,200 @@
+#include "platform.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "utils.h"
+#include "syntheticcharacters.h"
+
+static unsigned int g_random_state = SYNTHETIC_TEMPLATE_RANDOM_SEED;
+
+void mSeedSyntheticRandom(unsigned int seed)
+{
+  g_random_state = seed;
+}
+
+float mRandomSyntheticFloat()
+{
+  g_random_state = (g_random_state * 1103515245u) + 12345u;
+  return (float)((g_random_state >> 8) & 0xffff) / 65535.0f;
+}
+
+static void mAddSyntheticPoint(SYNTHETIC_CHARACTER* character, float x, float y)
+{
+  character->Points[character->NumPoints] = (RESAMPLED_POINT){.X = x, .Y = y};
+  character->NumPoints++;
+  character->Strokes[character->NumStrokes - 1].Size++;
+}
+
+// a component of 1 to 8 strokes in the unit square
+static void mBuildSyntheticComponent(SYNTHETIC_CHARACTER* character)
+{
+  unsigned int numStrokes = 1 + (unsigned int)(mRandomSyntheticFloat() * 3.99f) + (unsigned int)(mRandomSyntheticFloat() * 4.99f) * (mRandomSyntheticFloat() < 0.5f);
+  character->NumPoints    = 0;
+  character->NumStrokes   = 0;
+
+  for (unsigned int strokeIdx = 0; strokeIdx < numStrokes; strokeIdx++)
+  {
+    character->Strokes[strokeIdx] = (RESAMPLED_STROKE){.Offset = character->NumPoints, .Size = 0};
+    character->NumStrokes++;
+
+    float x0     = 0.1f + (0.6f * mRandomSyntheticFloat());
+    float y0     = 0.1f + (0.6f * mRandomSyntheticFloat());
+    float length = 0.2f + (0.6f * mRandomSyntheticFloat());
+    float x1     = x0;
+    float y1     = y0;
+    float bendX  = 0.0f;
+    float bendY  = 0.0f;
+    int hasHook  = 0;
+
+    switch ((int)(mRandomSyntheticFloat() * 4.99f))
+    {
+    case 0:  // horizontal
+      x1 = x0 + length;
+      y1 = y0 + (0.05f * (mRandomSyntheticFloat() - 0.5f));
+      break;
+    case 1:  // vertical, sometimes with a hook
+      x1      = x0 + (0.05f * (mRandomSyntheticFloat() - 0.5f));
+      y1      = y0 + length;
+      hasHook = (mRandomSyntheticFloat() < 0.3f);
+      break;
+    case 2:  // falling to the left
+      x1    = x0 - (0.5f * length);
+      y1    = y0 + length;
+      bendX = 0.1f;
+      break;
+    case 3:  // falling to the right
+      x1 = x0 + (0.6f * length);
+      y1 = y0 + (0.7f * length);
+      break;
+    default:  // a turn like the right side of 口
+      x1    = x0 + (0.7f * length);
+      y1    = y0 + length;
+      bendX = 0.35f * length;
+      bendY = -0.35f * length;
+      break;
+    }
+
+    // a quadratic curve through the bend
+    unsigned int numPoints = 8 + (unsigned int)(mRandomSyntheticFloat() * 12.0f);
+    for (unsigned int pointIdx = 0; pointIdx < numPoints; pointIdx++)
+    {
+      float t    = (float)pointIdx / (float)(numPoints - 1);
+      float bend = 4.0f * t * (1.0f - t);
+      mAddSyntheticPoint(character, x0 + ((x1 - x0) * t) + (bendX * bend), y0 + ((y1 - y0) * t) + (bendY * bend));
+    }
+
+    if (hasHook)
+    {
+      mAddSyntheticPoint(character, x1 - 0.05f, y1 - 0.04f);
+      mAddSyntheticPoint(character, x1 - 0.1f, y1 - 0.08f);
+    }
+  }
+}
+
+// put two components next to each other (or one above the other) in the unit square
+static void mComposeSyntheticCharacter(const SYNTHETIC_CHARACTER* components, SYNTHETIC_CHARACTER* character)
+{
+  const SYNTHETIC_CHARACTER* parts[2];
+  parts[0] = &components[(unsigned int)(mRandomSyntheticFloat() * (NUM_SYNTHETIC_COMPONENTS - 1))];
+  parts[1] = &components[(unsigned int)(mRandomSyntheticFloat() * (NUM_SYNTHETIC_COMPONENTS - 1))];
+
+  int isSideBySide = (mRandomSyntheticFloat() < 0.6f);
+  float split      = 0.35f + (0.25f * mRandomSyntheticFloat());
+
+  character->NumPoints  = 0;
+  character->NumStrokes = 0;
+
+  for (unsigned int partIdx = 0; partIdx < 2; partIdx++)
+  {
+    float start = (partIdx == 0) ? 0.0f : split;
+    float size  = (partIdx == 0) ? split : (1.0f - split);
+
+    for (unsigned int strokeIdx = 0; strokeIdx < parts[partIdx]->NumStrokes; strokeIdx++)
+    {
+      const RESAMPLED_STROKE stroke = parts[partIdx]->Strokes[strokeIdx];
+      const RESAMPLED_POINT* points = parts[partIdx]->Points + stroke.Offset;
+
+      character->Strokes[character->NumStrokes] = (RESAMPLED_STROKE){.Offset = character->NumPoints, .Size = 0};
+      character->NumStrokes++;
+
+      for (unsigned int pointIdx = 0; pointIdx < stroke.Size; pointIdx++)
+      {
+        if (isSideBySide)
+        {
+          mAddSyntheticPoint(character, start + (size * points[pointIdx].X), points[pointIdx].Y);
+        }
+        else
+        {
+          mAddSyntheticPoint(character, points[pointIdx].X, start + (size * points[pointIdx].Y));
+        }
+      }
+    }
+  }
+}
+
+SYNTHETIC_CHARACTER* mBuildSyntheticCharacters(RECOGNIZER_DATABASE* database)
+{
+  mSeedSyntheticRandom(SYNTHETIC_TEMPLATE_RANDOM_SEED);
+
+  SYNTHETIC_CHARACTER* components = (SYNTHETIC_CHARACTER*)mMalloc(sizeof(SYNTHETIC_CHARACTER) * NUM_SYNTHETIC_COMPONENTS, __FILE__, __LINE__);
+  for (unsigned int componentIdx = 0; componentIdx < NUM_SYNTHETIC_COMPONENTS; componentIdx++)
+  {
+    mBuildSyntheticComponent(&components[componentIdx]);
+  }
+
+  SYNTHETIC_CHARACTER* characters = (SYNTHETIC_CHARACTER*)mMalloc(sizeof(SYNTHETIC_CHARACTER) * NUM_SYNTHETIC_TEMPLATES, __FILE__, __LINE__);
+  for (unsigned int characterIdx = 0; characterIdx < NUM_SYNTHETIC_TEMPLATES; characterIdx++)
+  {
+    mComposeSyntheticCharacter(components, &characters[characterIdx]);
+    mAddRecognizerTemplate(database, SYNTHETIC_FIRST_CODE_POINT + characterIdx, characters[characterIdx].Points, characters[characterIdx].Strokes, characters[characterIdx].NumStrokes);
+  }
+
+  free(components);
+
+  return characters;
+}
+
+void mWriteSyntheticCharacter(const SYNTHETIC_CHARACTER* character, StrokeList* strokes)
+{
+  float size    = 600.0f + (400.0f * mRandomSyntheticFloat());
+  float slant   = 0.2f * (mRandomSyntheticFloat() - 0.5f);
+  float offsetX = 500.0f + (1000.0f * mRandomSyntheticFloat());
+  float offsetY = 500.0f + (1000.0f * mRandomSyntheticFloat());
+  float jitter  = 0.02f * size;
+
+  for (unsigned int strokeIdx = 0; strokeIdx < character->NumStrokes; strokeIdx++)
+  {
+    const RESAMPLED_STROKE stroke = character->Strokes[strokeIdx];
+    const RESAMPLED_POINT* points = character->Points + stroke.Offset;
+    float strokeOffsetX           = 0.06f * size * (mRandomSyntheticFloat() - 0.5f);
+    float strokeOffsetY           = 0.06f * size * (mRandomSyntheticFloat() - 0.5f);
+
+    for (unsigned int pointIdx = 0; pointIdx < stroke.Size; pointIdx++)
+    {
+      float x = offsetX + strokeOffsetX + (size * (points[pointIdx].X + (slant * points[pointIdx].Y)));
+      float y = offsetY + strokeOffsetY + (size * points[pointIdx].Y);
+
+      if (pointIdx == 0)
+      {
+        mCreateNewStroke((Point2D){.X = (ULONG)x, .Y = (ULONG)y}, strokes);
+        continue;
+      }
+
+      float previousX         = offsetX + strokeOffsetX + (size * (points[pointIdx - 1].X + (slant * points[pointIdx - 1].Y)));
+      float previousY         = offsetY + strokeOffsetY + (size * points[pointIdx - 1].Y);
+      float dx                = x - previousX;
+      float dy                = y - previousY;
+      unsigned int numReports = 1 + (unsigned int)(sqrtf((dx * dx) + (dy * dy)) / 3.0f);
+
+      for (unsigned int reportIdx = 1; reportIdx <= numReports; reportIdx++)
+      {
+        float t       = (float)reportIdx / (float)numReports;
+        float reportX = previousX + (dx * t) + (jitter * (mRandomSyntheticFloat() - 0.5f));
+        float reportY = previousY + (dy * t) + (jitter * (mRandomSyntheticFloat() - 0.5f));
+
+        mAppendPoint2DToLastStroke((Point2D){.X = (ULONG)reportX, .Y = (ULONG)reportY}, strokes);
+      }
+    }
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef __SYNTHETICCHARACTERS_H__
+#define __SYNTHETICCHARACTERS_H__
+#include "platform.h"
+
+#include "stroke.h"
+#include "resampler.h"
+#include "recognizer.h"
+
+// Random kanji-like characters for the recognizer benchmarks: two of
+// NUM_SYNTHETIC_COMPONENTS random components (horizontal, vertical and slanted
+// strokes, hooks and curves) side by side or on top of each other, so that
+// like real kanji many characters share a part. The points are in the unit
+// square.
+#define NUM_SYNTHETIC_TEMPLATES        2136
+#define NUM_SYNTHETIC_COMPONENTS       214
+#define SYNTHETIC_FIRST_CODE_POINT     0x4e00
+#define SYNTHETIC_MAX_POINTS           1024
+#define SYNTHETIC_TEMPLATE_RANDOM_SEED 2136
+// seed the random numbers with this before the queries so that every run writes the same characters
+#define SYNTHETIC_QUERY_RANDOM_SEED    0x5eed
+
+struct SYNTHETIC_CHARACTER
+{
+  RESAMPLED_POINT Points[SYNTHETIC_MAX_POINTS];
+  RESAMPLED_STROKE Strokes[RECOGNIZER_MAX_STROKES];
+  unsigned int NumPoints;
+  unsigned int NumStrokes;
+};
+
+typedef struct SYNTHETIC_CHARACTER SYNTHETIC_CHARACTER;
+
+void mSeedSyntheticRandom(unsigned int seed);
+// uniform in [0, 1]
+float mRandomSyntheticFloat();
+// Build the NUM_SYNTHETIC_TEMPLATES characters and add them to the database
+// with the code points SYNTHETIC_FIRST_CODE_POINT + characterIdx. They are the
+// same in every run. The caller frees the returned characters.
+SYNTHETIC_CHARACTER* mBuildSyntheticCharacters(RECOGNIZER_DATABASE* database);
+// write the character again like a touchpad would report it: a different size
+// and slant, misplaced strokes, some jitter and a report every ~3 device units
+void mWriteSyntheticCharacter(const SYNTHETIC_CHARACTER* character, StrokeList* strokes);
+#endif  // __SYNTHETICCHARACTERS_H__
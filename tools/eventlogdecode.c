@@ -0,0 +1,297 @@
+// Prints the binary event log of `touchpad --log <file>` (see
+// touchpad/eventlog.h) in the colors that the application used to print the
+// same events with before they were moved off the console. The records of the
+// writers are merged in timestamp order, the time is in milliseconds since the
+// log was opened.
+//
+//   gcc -O2 -I../touchpad -o eventlogdecode eventlogdecode.c ../touchpad/hashindex.c ../touchpad/hiddecoder.c ../touchpad/utils.c
+//
+// Usage: eventlogdecode <file> [--no-color] [--summary]
+//   --no-color print without the terminal escape codes (e.g. into a file)
+//   --summary  only print the number of records of each event
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "termcolor.h"
+#include "utils.h"
+#include "touchevents.h"
+#include "stroke.h"
+#include "eventlog.h"
+
+// the event ids of eventlog.h are small, unknown ones are counted in the last slot
+#define MAX_EVENT_ID 32
+
+// the index in the file breaks the ties of the sort so that the records of a writer stay in order
+struct SORTED_RECORD
+{
+  EVENT_LOG_RECORD Record;
+  unsigned long long FileIdx;
+};
+
+typedef struct SORTED_RECORD SORTED_RECORD;
+
+static const char* s_writerNames[] = {"input", "ui"};
+static int s_isColored             = 1;
+
+static int mCompareSortedRecords(const void* left, const void* right)
+{
+  const SORTED_RECORD* leftRecord  = (const SORTED_RECORD*)left;
+  const SORTED_RECORD* rightRecord = (const SORTED_RECORD*)right;
+
+  if (leftRecord->Record.Timestamp != rightRecord->Record.Timestamp)
+  {
+    return (leftRecord->Record.Timestamp < rightRecord->Record.Timestamp) ? -1 : 1;
+  }
+
+  return (leftRecord->FileIdx < rightRecord->FileIdx) ? -1 : ((leftRecord->FileIdx > rightRecord->FileIdx) ? 1 : 0);
+}
+
+static void mSetColor(const char* color)
+{
+  if (s_isColored)
+  {
+    printf("%s", color);
+  }
+}
+
+static const char* mGetTouchEventTypeName(unsigned int touchType)
+{
+  if (touchType == EVENT_TYPE_TOUCH_UP)
+  {
+    return "touch up";
+  }
+  else if (touchType == EVENT_TYPE_TOUCH_MOVE)
+  {
+    return "touch move";
+  }
+  else if (touchType == EVENT_TYPE_TOUCH_DOWN)
+  {
+    return "touch down";
+  }
+  else if (touchType == EVENT_TYPE_TOUCH_MOVE_UNCHANGED)
+  {
+    return "touch move unchanged";
+  }
+
+  return "unknown";
+}
+
+static const char* mGetStrokeEventName(unsigned int strokeEvent)
+{
+  if (strokeEvent == STROKE_EVENT_NEW_STROKE)
+  {
+    return "new stroke";
+  }
+  else if (strokeEvent == STROKE_EVENT_NEW_SEGMENT)
+  {
+    return "new segment";
+  }
+  else if (strokeEvent == STROKE_EVENT_END_STROKE)
+  {
+    return "end stroke";
+  }
+
+  return "unknown";
+}
+
+static const char* mGetEventName(unsigned int eventId)
+{
+  switch (eventId)
+  {
+    case EVENT_LOG_RECORDS_DROPPED:
+      return "records dropped";
+    case EVENT_LOG_INPUT_MESSAGE:
+      return "input message";
+    case EVENT_LOG_TOUCH_CONTACT:
+      return "touch contact";
+    case EVENT_LOG_TOUCH_EVENTS_DROPPED:
+      return "touch events dropped";
+    case EVENT_LOG_TOUCH_EVENTS_DRAINED:
+      return "touch events drained";
+    case EVENT_LOG_STROKE_EVENT:
+      return "stroke event";
+    case EVENT_LOG_RECOGNITION_RESULT:
+      return "recognition result";
+    case EVENT_LOG_KEY_UP:
+      return "key up";
+    case EVENT_LOG_INVALID_DECODE_PLAN:
+      return "invalid decode plan";
+    case EVENT_LOG_STALE_CONTACTS_EVICTED:
+      return "stale contacts evicted";
+    default:
+      return "unknown";
+  }
+}
+
+static void mPrintEventLogRecord(const EVENT_LOG_RECORD* record, const EVENT_LOG_FILE_HEADER* fileHeader)
+{
+  double milliseconds      = (double)(long long)(record->Timestamp - fileHeader->StartTimestamp) * 1e3 / (double)fileHeader->TimestampFrequency;
+  const char* writerName   = (record->WriterIdx < (sizeof(s_writerNames) / sizeof(s_writerNames[0]))) ? s_writerNames[record->WriterIdx] : "?";
+  const unsigned int* args = record->Args;
+
+  printf("[%12.3f] %-5s ", milliseconds, writerName);
+
+  switch (record->EventId)
+  {
+    case EVENT_LOG_RECORDS_DROPPED:
+      mSetColor(FG_YELLOW);
+      printf("writer #%u dropped %u record(s), %u so far", args[0], args[1], args[2]);
+      break;
+    case EVENT_LOG_INPUT_MESSAGE:
+      mSetColor(FG_BRIGHT_BLUE);
+      printf("device: %u, numReports: %u, numContacts: %u", args[0], args[1], args[2]);
+      break;
+    case EVENT_LOG_TOUCH_CONTACT:
+      mSetColor(FG_GREEN);
+      printf("report: %u, touchID: %u, tipSwitch: %u, position: (%u, %u), eventType: %s", args[0], args[1], (args[4] >> 8) & 1, args[2], args[3], mGetTouchEventTypeName(args[4] & 0xFF));
+      break;
+    case EVENT_LOG_TOUCH_EVENTS_DROPPED:
+      mSetColor(FG_YELLOW);
+      printf("The touch event ring is full, %u event(s) dropped, %u so far", args[0], args[1]);
+      break;
+    case EVENT_LOG_TOUCH_EVENTS_DRAINED:
+      mSetColor(FG_CYAN);
+      printf("%u touch event(s) drained", args[0]);
+      break;
+    case EVENT_LOG_STROKE_EVENT:
+      mSetColor(FG_MAGENTA);
+      printf("%s, stroke: %u, points: %u", mGetStrokeEventName(args[0]), args[1], args[2]);
+      break;
+    case EVENT_LOG_RECOGNITION_RESULT:
+      mSetColor(FG_BRIGHT_WHITE);
+      printf("%u stroke(s) (%.2f ms): %u candidate(s), first U+%04X", args[0], (double)args[3] / 1e3, args[1], args[2]);
+      break;
+    case EVENT_LOG_KEY_UP:
+      mSetColor(FG_GREEN);
+      printf("WM_KEYUP: 0x%x", args[0]);
+      break;
+    case EVENT_LOG_INVALID_DECODE_PLAN:
+      mSetColor(FG_RED);
+      printf("Cannot find the touch data layout of device #%u, its reports are ignored", args[0]);
+      break;
+    case EVENT_LOG_STALE_CONTACTS_EVICTED:
+      mSetColor(FG_YELLOW);
+      printf("device: %u, the contact table is full, %u stale contact(s) evicted, %u so far", args[0], args[1], args[2]);
+      break;
+    default:
+      mSetColor(FG_RED);
+      printf("unknown event %u: %u %u %u %u %u", record->EventId, args[0], args[1], args[2], args[3], args[4]);
+      break;
+  }
+
+  mSetColor(RESET_COLOR);
+  printf("\n");
+}
+
+int main(int argc, char* argv[])
+{
+  const char* filePath = NULL;
+  int isSummary        = 0;
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if (strcmp(argv[argIdx], "--no-color") == 0)
+    {
+      s_isColored = 0;
+    }
+    else if (strcmp(argv[argIdx], "--summary") == 0)
+    {
+      isSummary = 1;
+    }
+    else if ((argv[argIdx][0] != '-') && (filePath == NULL))
+    {
+      filePath = argv[argIdx];
+    }
+    else
+    {
+      filePath = NULL;
+      break;
+    }
+  }
+
+  if (filePath == NULL)
+  {
+    printf("Usage: %s <file> [--no-color] [--summary]\n", argv[0]);
+    return -1;
+  }
+
+  FILE* file = fopen(filePath, "rb");
+  if (file == NULL)
+  {
+    printf(FG_RED);
+    printf("Failed to open %s at %s:%d\n", filePath, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  EVENT_LOG_FILE_HEADER fileHeader;
+  if ((fread(&fileHeader, 1, sizeof(EVENT_LOG_FILE_HEADER), file) != sizeof(EVENT_LOG_FILE_HEADER)) || (fileHeader.Magic != EVENT_LOG_MAGIC) || (fileHeader.Version != EVENT_LOG_VERSION) || (fileHeader.cbRecord != sizeof(EVENT_LOG_RECORD)) || (fileHeader.cbFileHeader < sizeof(EVENT_LOG_FILE_HEADER)) || (fileHeader.TimestampFrequency == 0))
+  {
+    printf(FG_RED);
+    printf("%s is not an event log of a supported version at %s:%d\n", filePath, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    fclose(file);
+    return -1;
+  }
+
+  fseek(file, (long)fileHeader.cbFileHeader, SEEK_SET);
+
+  SORTED_RECORD* records        = NULL;
+  unsigned long long numRecords = 0;
+  unsigned long long capacity   = 0;
+  EVENT_LOG_RECORD record;
+
+  // a truncated last record (the application did not close the log) is ignored
+  while (fread(&record, 1, sizeof(EVENT_LOG_RECORD), file) == sizeof(EVENT_LOG_RECORD))
+  {
+    if (numRecords == capacity)
+    {
+      capacity = (capacity == 0) ? 4096 : (capacity * 2);
+      records  = (SORTED_RECORD*)mRealloc(records, (size_t)capacity * sizeof(SORTED_RECORD), __FILE__, __LINE__);
+    }
+
+    records[numRecords].Record  = record;
+    records[numRecords].FileIdx = numRecords;
+    numRecords++;
+  }
+
+  fclose(file);
+
+  // the drain thread writes the rings one after the other
+  qsort(records, (size_t)numRecords, sizeof(SORTED_RECORD), mCompareSortedRecords);
+
+  unsigned long long numRecordsByEvent[MAX_EVENT_ID + 1];
+  memset(numRecordsByEvent, 0, sizeof(numRecordsByEvent));
+
+  for (unsigned long long recordIdx = 0; recordIdx < numRecords; recordIdx++)
+  {
+    unsigned int eventId = records[recordIdx].Record.EventId;
+    numRecordsByEvent[(eventId < MAX_EVENT_ID) ? eventId : MAX_EVENT_ID]++;
+
+    if (!isSummary)
+    {
+      mPrintEventLogRecord(&records[recordIdx].Record, &fileHeader);
+    }
+  }
+
+  if (isSummary)
+  {
+    double seconds = (numRecords != 0) ? ((double)(records[numRecords - 1].Record.Timestamp - records[0].Record.Timestamp) / (double)fileHeader.TimestampFrequency) : 0.0;
+    printf("%llu record(s) over %.3f s\n", numRecords, seconds);
+
+    for (unsigned int eventId = 0; eventId <= MAX_EVENT_ID; eventId++)
+    {
+      if (numRecordsByEvent[eventId] != 0)
+      {
+        printf("  %-22s %llu\n", (eventId < MAX_EVENT_ID) ? mGetEventName(eventId) : "unknown", numRecordsByEvent[eventId]);
+      }
+    }
+  }
+
+  free(records);
+
+  return 0;
+}
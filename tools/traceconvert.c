@@ -0,0 +1,783 @@
+// Converts recorded writing sessions (the touch traces of
+// `touchpad --record <file>`, see touchpad/touchtrace.h) into training inputs
+// for a handwriting model. Every trace of the input directory is replayed
+// through the same steps as mHandleInputMessage (report decode ->
+// mInterpretRawTouchInputBatch -> mAddTouchEventToStrokes) and the strokes are
+// cut into characters wherever the pen stayed up for longer than --gap ms (the
+// trace does not record the clear key). For a trace named <name> it writes:
+//
+//   <name>.points.npy  float32 (N, --points, 3) the strokes of each character
+//                      resampled at equal arc length and normalized into the
+//                      unit square like for the recognizer: x, y and 1 on the
+//                      last point of a stroke, zero padded
+//   <name>.lengths.npy int32 (N) number of points of each character
+//   <name>.bitmaps.npy uint8 (N, --size, --size) the strokes rasterized with
+//                      the anti-aliased brush of the canvas
+//
+// The traces are spread over a work pool (the largest first) and a character
+// is appended to the files as soon as it ends, so the memory does not grow
+// with the length of a trace. The shape in the .npy headers is rewritten when
+// the trace is done. --scaling converts the directory once more with 1, 2, 4,
+// ... threads up to --threads and reports how the throughput scales.
+//
+//   gcc -O2 -I../touchpad -o traceconvert traceconvert.c ../touchpad/hiddecoder.c ../touchpad/touchevents.c ../touchpad/point2d.c ../touchpad/stroke.c ../touchpad/resampler.c ../touchpad/canvas.c ../touchpad/segmentgrid.c ../touchpad/touchtrace.c ../touchpad/workpool.c ../touchpad/threading.c ../touchpad/hashindex.c ../touchpad/utils.c -lm -lpthread
+//
+// Usage: traceconvert --input <dir> --output <dir> [--threads <count>] [--points <count>] [--size <pixels>] [--gap <ms>] [--scaling]
+//   --threads number of threads, 0 (the default) for one per processor
+//   --points  points of a character in points.npy (default 128)
+//   --size    width and height of a bitmap (default 64)
+//   --gap     the pen is up for longer than this between two characters (default 1000)
+#include "platform.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "termcolor.h"
+#include "utils.h"
+#include "threading.h"
+#include "hiddecoder.h"
+#include "touchevents.h"
+#include "touchtrace.h"
+#include "stroke.h"
+#include "resampler.h"
+#include "canvas.h"
+#include "workpool.h"
+
+#define MAX_FILE_PATH 1024
+#define DEFAULT_SEQUENCE_POINTS 128
+#define DEFAULT_BITMAP_SIZE     64
+#define DEFAULT_GAP_MS          1000
+// the resampled points are at least this far apart in device units (STROKE_RESAMPLE_SPACING of the application)
+#define MIN_RESAMPLE_SPACING 8.0f
+// characters with more strokes are skipped, the longest kanji have about 30
+#define MAX_CHARACTER_STROKES 48
+// brush width relative to the size of the bitmap
+#define BITMAP_STROKE_WIDTH 0.04f
+// every .npy header is padded to this size so that it can be rewritten in place
+#define NPY_HEADER_SIZE 128
+
+// A .npy file (format version 1.0) whose first dimension grows with every
+// appended row.
+struct NPY_WRITER
+{
+  FILE* File;
+  const char* Descr;
+  // the dimensions after the first one
+  unsigned int RowShape[2];
+  unsigned int NumRowDims;
+  size_t cbRow;
+  unsigned long long NumRows;
+};
+
+typedef struct NPY_WRITER NPY_WRITER;
+
+struct CONVERT_OPTIONS
+{
+  unsigned int NumSequencePoints;
+  unsigned int BitmapSize;
+  unsigned int GapMilliseconds;
+  const char* OutputDirectory;
+};
+
+typedef struct CONVERT_OPTIONS CONVERT_OPTIONS;
+
+// scratch memory of a worker of the pool
+struct CONVERT_WORKER
+{
+  TOUCH_DATA_BATCH TouchBatch;
+  StrokeList Strokes;
+  STROKE_RESAMPLER Resampler;
+  float* SequenceRow;
+  unsigned int* Pixels;
+  BYTE* BitmapRow;
+  CANVAS Canvas;
+};
+
+typedef struct CONVERT_WORKER CONVERT_WORKER;
+
+struct CONVERTER
+{
+  CONVERT_OPTIONS Options;
+  CONVERT_WORKER* Workers;
+  unsigned int NumWorkers;
+};
+
+typedef struct CONVERTER CONVERTER;
+
+struct CONVERT_JOB
+{
+  CONVERTER* Converter;
+  char InputPath[MAX_FILE_PATH];
+  char Name[MAX_FILE_PATH];
+  unsigned long long cbFile;
+
+  // results
+  int Retval;
+  // not a touch trace
+  int IsSkipped;
+  unsigned int NumCharacters;
+  unsigned int NumSkippedCharacters;
+  unsigned int NumTruncatedCharacters;
+  unsigned long long NumReports;
+  unsigned long long NumPoints;
+  unsigned long long NumSkippedMessages;
+};
+
+typedef struct CONVERT_JOB CONVERT_JOB;
+
+struct CONVERT_TOTALS
+{
+  unsigned int NumConvertedFiles;
+  unsigned int NumSkippedFiles;
+  unsigned int NumFailedFiles;
+  unsigned int NumCharacters;
+  unsigned int NumSkippedCharacters;
+  unsigned int NumTruncatedCharacters;
+  unsigned long long NumReports;
+  unsigned long long NumPoints;
+  unsigned long long NumSkippedMessages;
+  unsigned long long cbInput;
+};
+
+typedef struct CONVERT_TOTALS CONVERT_TOTALS;
+
+static double mGetSeconds(unsigned long long start, unsigned long long end)
+{
+  return (double)(end - start) / (double)mGetTimestampFrequency();
+}
+
+static int mWriteNpyHeader(NPY_WRITER* writer)
+{
+  char header[NPY_HEADER_SIZE];
+  char shape[64];
+
+  if (writer->NumRowDims == 0)
+  {
+    snprintf(shape, sizeof(shape), "(%llu,)", writer->NumRows);
+  }
+  else if (writer->NumRowDims == 1)
+  {
+    snprintf(shape, sizeof(shape), "(%llu, %u)", writer->NumRows, writer->RowShape[0]);
+  }
+  else
+  {
+    snprintf(shape, sizeof(shape), "(%llu, %u, %u)", writer->NumRows, writer->RowShape[0], writer->RowShape[1]);
+  }
+
+  // magic, version 1.0, little endian length of the dictionary, the dictionary padded with spaces and a newline
+  memset(header, ' ', NPY_HEADER_SIZE);
+  memcpy(header, "\x93NUMPY\x01\x00", 8);
+  header[8] = (char)((NPY_HEADER_SIZE - 10) & 0xff);
+  header[9] = (char)((NPY_HEADER_SIZE - 10) >> 8);
+
+  int cbDictionary = snprintf(header + 10, NPY_HEADER_SIZE - 10, "{'descr': '%s', 'fortran_order': False, 'shape': %s, }", writer->Descr, shape);
+  if ((cbDictionary < 0) || (cbDictionary >= (NPY_HEADER_SIZE - 11)))
+  {
+    return -1;
+  }
+
+  header[10 + cbDictionary]   = ' ';
+  header[NPY_HEADER_SIZE - 1] = '\n';
+
+  if ((fseek(writer->File, 0, SEEK_SET) != 0) || (fwrite(header, 1, NPY_HEADER_SIZE, writer->File) != NPY_HEADER_SIZE))
+  {
+    return -1;
+  }
+
+  return 0;
+}
+
+static int mOpenNpyWriter(NPY_WRITER* writer, const char* filePath, const char* descr, size_t cbElement, unsigned int numRowDims, unsigned int dim0, unsigned int dim1)
+{
+  memset(writer, 0, sizeof(NPY_WRITER));
+  writer->Descr       = descr;
+  writer->NumRowDims  = numRowDims;
+  writer->RowShape[0] = dim0;
+  writer->RowShape[1] = dim1;
+  writer->cbRow       = cbElement * ((numRowDims > 0) ? dim0 : 1) * ((numRowDims > 1) ? dim1 : 1);
+
+  writer->File = fopen(filePath, "wb");
+  if (writer->File == NULL)
+  {
+    printf(FG_RED);
+    printf("Failed to create %s at %s:%d\n", filePath, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  // the shape is rewritten on close
+  return mWriteNpyHeader(writer);
+}
+
+static int mAppendNpyRow(NPY_WRITER* writer, const void* row)
+{
+  if (fwrite(row, 1, writer->cbRow, writer->File) != writer->cbRow)
+  {
+    return -1;
+  }
+
+  writer->NumRows++;
+
+  return 0;
+}
+
+static int mCloseNpyWriter(NPY_WRITER* writer)
+{
+  if (writer->File == NULL)
+  {
+    return 0;
+  }
+
+  int retval = mWriteNpyHeader(writer);
+  retval     = (fclose(writer->File) == 0) ? retval : -1;
+
+  writer->File = NULL;
+
+  return retval;
+}
+
+static void mInitializeConvertWorker(CONVERT_WORKER* worker, const CONVERT_OPTIONS* options)
+{
+  memset(worker, 0, sizeof(CONVERT_WORKER));
+  worker->Strokes = (StrokeList){.Entries = NULL, .Size = 0, .Capacity = 0};
+
+  // the spacing is chosen for every character, a few more points than the sequence holds are dropped
+  mInitializeStrokeResampler(&worker->Resampler, (2 * options->NumSequencePoints) + (2 * MAX_CHARACTER_STROKES), MAX_CHARACTER_STROKES, MIN_RESAMPLE_SPACING);
+
+  unsigned int numPixels = options->BitmapSize * options->BitmapSize;
+  worker->SequenceRow    = (float*)mMalloc(sizeof(float) * 3 * options->NumSequencePoints, __FILE__, __LINE__);
+  worker->Pixels         = (unsigned int*)mMalloc(sizeof(unsigned int) * numPixels, __FILE__, __LINE__);
+  worker->BitmapRow      = (BYTE*)mMalloc(numPixels, __FILE__, __LINE__);
+
+  mInitializeCanvas(&worker->Canvas, worker->Pixels, (int)options->BitmapSize, (int)options->BitmapSize, (int)options->BitmapSize);
+}
+
+static void mFreeConvertWorker(CONVERT_WORKER* worker)
+{
+  mFreeTouchDataBatch(&worker->TouchBatch);
+  mFreeStrokeList(&worker->Strokes);
+  mFreeStrokeResampler(&worker->Resampler);
+  free(worker->SequenceRow);
+  free(worker->Pixels);
+  free(worker->BitmapRow);
+  memset(worker, 0, sizeof(CONVERT_WORKER));
+}
+
+// Resample and rasterize the strokes of the worker as one character and append
+// it to the files. The strokes are cleared.
+static int mEmitCharacter(const CONVERT_OPTIONS* options, CONVERT_WORKER* worker, CONVERT_JOB* job, NPY_WRITER* writers)
+{
+  StrokeList* strokes         = &worker->Strokes;
+  STROKE_RESAMPLER* resampler = &worker->Resampler;
+  unsigned int numPoints      = options->NumSequencePoints;
+
+  // every stroke takes its first and its last point on top of the spacing
+  if ((strokes->Size == 0) || (strokes->Size > MAX_CHARACTER_STROKES) || ((2 * strokes->Size) >= numPoints))
+  {
+    job->NumSkippedCharacters += (strokes->Size != 0);
+    mClearStrokeList(strokes);
+    return 0;
+  }
+
+  float length = 0.0f;
+  for (unsigned int strokeIdx = 0; strokeIdx < strokes->Size; strokeIdx++)
+  {
+    Point2D* strokePoints = mGetStrokePoints(strokes, strokeIdx);
+    for (unsigned int pointIdx = 1; pointIdx < strokes->Entries[strokeIdx].Size; pointIdx++)
+    {
+      float dx = (float)strokePoints[pointIdx].X - (float)strokePoints[pointIdx - 1].X;
+      float dy = (float)strokePoints[pointIdx].Y - (float)strokePoints[pointIdx - 1].Y;
+      length += sqrtf((dx * dx) + (dy * dy));
+    }
+  }
+
+  // spread the points over the whole character instead of cutting it off
+  float spacing = length / (float)(numPoints - (2 * strokes->Size));
+  mClearStrokeResampler(resampler);
+  resampler->Spacing = (spacing > MIN_RESAMPLE_SPACING) ? spacing : MIN_RESAMPLE_SPACING;
+  mUpdateStrokeResampler(resampler, strokes);
+  mFinishResampledStroke(resampler);
+
+  float scale;
+  float offsetX;
+  float offsetY;
+  mGetStrokeResamplerNormalization(resampler, &scale, &offsetX, &offsetY);
+
+  float* row              = worker->SequenceRow;
+  unsigned int numWritten = 0;
+  memset(row, 0, sizeof(float) * 3 * numPoints);
+
+  float brushWidth  = BITMAP_STROKE_WIDTH * (float)options->BitmapSize;
+  float margin      = brushWidth;
+  float bitmapScale = (float)options->BitmapSize - 1.0f - (2.0f * margin);
+  mFillCanvas(&worker->Canvas, CANVAS_COLOR(0, 0, 0));
+
+  for (unsigned int strokeIdx = 0; strokeIdx < resampler->NumStrokes; strokeIdx++)
+  {
+    RESAMPLED_STROKE stroke = resampler->Strokes[strokeIdx];
+    Point2D lastPixel       = (Point2D){.X = 0, .Y = 0};
+
+    for (unsigned int pointIdx = 0; pointIdx < stroke.Size; pointIdx++)
+    {
+      RESAMPLED_POINT point = resampler->Points[stroke.Offset + pointIdx];
+      float x               = (point.X - offsetX) * scale;
+      float y               = (point.Y - offsetY) * scale;
+
+      if (numWritten < numPoints)
+      {
+        row[(3 * numWritten) + 0] = x;
+        row[(3 * numWritten) + 1] = y;
+        row[(3 * numWritten) + 2] = ((pointIdx + 1) == stroke.Size) ? 1.0f : 0.0f;
+        numWritten++;
+      }
+
+      Point2D pixel = (Point2D){.X = (ULONG)(margin + (x * bitmapScale) + 0.5f), .Y = (ULONG)(margin + (y * bitmapScale) + 0.5f)};
+      // a single point stroke is a dot
+      mDrawCanvasSegment(&worker->Canvas, (pointIdx == 0) ? pixel : lastPixel, pixel, brushWidth, CANVAS_COLOR(255, 255, 255));
+      lastPixel = pixel;
+    }
+  }
+
+  if (numWritten < resampler->NumPoints)
+  {
+    job->NumTruncatedCharacters++;
+  }
+
+  // white ink on black: every channel is the coverage
+  unsigned int numPixels = options->BitmapSize * options->BitmapSize;
+  for (unsigned int pixelIdx = 0; pixelIdx < numPixels; pixelIdx++)
+  {
+    worker->BitmapRow[pixelIdx] = (BYTE)(worker->Pixels[pixelIdx] & 0xff);
+  }
+
+  int numRowPoints = (int)numWritten;
+  int retval       = 0;
+  if ((mAppendNpyRow(&writers[0], row) != 0) || (mAppendNpyRow(&writers[1], &numRowPoints) != 0) || (mAppendNpyRow(&writers[2], worker->BitmapRow) != 0))
+  {
+    printf(FG_RED);
+    printf("Failed to write the characters of %s at %s:%d\n", job->Name, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    retval = -1;
+  }
+
+  job->NumCharacters++;
+  job->NumPoints += strokes->Points.Size;
+  mClearStrokeList(strokes);
+
+  return retval;
+}
+
+static int mConvertTrace(const CONVERT_OPTIONS* options, CONVERT_WORKER* worker, CONVERT_JOB* job)
+{
+  TOUCH_TRACE_MAPPING mapping;
+  if (mMapTouchTrace(job->InputPath, &mapping) != 0)
+  {
+    return -1;
+  }
+
+  const TOUCH_TRACE_FILE_HEADER* fileHeader = mGetTouchTraceFileHeader(mapping.Data, mapping.cbData);
+  if (fileHeader == NULL)
+  {
+    printf(FG_YELLOW);
+    printf("Skipping %s (not a touch trace of a supported version)\n", job->InputPath);
+    printf(RESET_COLOR);
+    mUnmapTouchTrace(&mapping);
+    job->IsSkipped = 1;
+    return 0;
+  }
+
+  char outputPath[MAX_FILE_PATH + 64];
+  NPY_WRITER writers[3];
+  memset(writers, 0, sizeof(writers));
+
+  int retval = 0;
+  snprintf(outputPath, sizeof(outputPath), "%s/%s.points.npy", options->OutputDirectory, job->Name);
+  retval = (retval == 0) ? mOpenNpyWriter(&writers[0], outputPath, "<f4", sizeof(float), 2, options->NumSequencePoints, 3) : retval;
+  snprintf(outputPath, sizeof(outputPath), "%s/%s.lengths.npy", options->OutputDirectory, job->Name);
+  retval = (retval == 0) ? mOpenNpyWriter(&writers[1], outputPath, "<i4", sizeof(int), 0, 0, 0) : retval;
+  snprintf(outputPath, sizeof(outputPath), "%s/%s.bitmaps.npy", options->OutputDirectory, job->Name);
+  retval = (retval == 0) ? mOpenNpyWriter(&writers[2], outputPath, "|u1", 1, 2, options->BitmapSize, options->BitmapSize) : retval;
+
+  HID_TOUCH_DECODE_PLAN* decodePlans   = NULL;
+  HID_TOUCH_DECODE_STATE* decodeStates = NULL;
+  unsigned int numDecodePlans          = 0;
+  TOUCH_CONTACT_TABLE previousTouches;
+  ULONG reportSequenceNumber           = 0;
+  ULONG trackingTouchID                = (ULONG)-1;
+  unsigned long long lastInkTime       = 0;
+  unsigned long long gapTicks          = (fileHeader->TimestampFrequency * options->GapMilliseconds) / 1000;
+
+  mResetTouchContactTable(&previousTouches);
+  mClearStrokeList(&worker->Strokes);
+
+  size_t offset = fileHeader->cbFileHeader;
+  const TOUCH_TRACE_RECORD_HEADER* record;
+
+  while ((retval == 0) && ((record = mGetNextTouchTraceRecord(mapping.Data, mapping.cbData, &offset)) != NULL))
+  {
+    if (record->Type == TOUCH_TRACE_RECORD_DECODE_PLAN)
+    {
+      if (record->cbPayload != sizeof(HID_TOUCH_DECODE_PLAN))
+      {
+        continue;
+      }
+
+      if (record->DeviceIdx >= numDecodePlans)
+      {
+        unsigned int newNumDecodePlans = record->DeviceIdx + 1;
+        decodePlans                    = (HID_TOUCH_DECODE_PLAN*)mRealloc(decodePlans, sizeof(HID_TOUCH_DECODE_PLAN) * newNumDecodePlans, __FILE__, __LINE__);
+        decodeStates                   = (HID_TOUCH_DECODE_STATE*)mRealloc(decodeStates, sizeof(HID_TOUCH_DECODE_STATE) * newNumDecodePlans, __FILE__, __LINE__);
+        memset(&decodePlans[numDecodePlans], 0, sizeof(HID_TOUCH_DECODE_PLAN) * (newNumDecodePlans - numDecodePlans));
+        numDecodePlans = newNumDecodePlans;
+      }
+
+      memcpy(&decodePlans[record->DeviceIdx], mGetTouchTraceRecordPayload(record), sizeof(HID_TOUCH_DECODE_PLAN));
+      mResetTouchDecodeState(&decodeStates[record->DeviceIdx]);
+      continue;
+    }
+
+    if (record->Type != TOUCH_TRACE_RECORD_REPORTS)
+    {
+      continue;
+    }
+
+    if ((record->DeviceIdx >= numDecodePlans) || !decodePlans[record->DeviceIdx].IsValid || (record->Count == 0))
+    {
+      job->NumSkippedMessages++;
+      continue;
+    }
+
+    // the pen has been up long enough for the next stroke to start a new character
+    if ((trackingTouchID == (ULONG)-1) && (worker->Strokes.Size != 0) && ((record->Timestamp - lastInkTime) > gapTicks))
+    {
+      retval = mEmitCharacter(options, worker, job, writers);
+    }
+
+    mDecodeTouchReportBatch(&decodePlans[record->DeviceIdx], &decodeStates[record->DeviceIdx], mGetTouchTraceRecordPayload(record), record->cbPayload / record->Count, record->Count, &reportSequenceNumber, &worker->TouchBatch);
+
+    if (mInterpretRawTouchInputBatch(&previousTouches, worker->TouchBatch.Entries, worker->TouchBatch.Size, worker->TouchBatch.EventTypes) != 0)
+    {
+      printf(FG_RED);
+      printf("mInterpretRawTouchInputBatch failed on %s at %s:%d\n", job->InputPath, __FILE__, __LINE__);
+      printf(RESET_COLOR);
+      retval = -1;
+      break;
+    }
+
+    for (unsigned int contactIdx = 0; contactIdx < worker->TouchBatch.Size; contactIdx++)
+    {
+      unsigned int strokeEvent;
+      if (mAddTouchEventToStrokes(worker->TouchBatch.Entries[contactIdx], worker->TouchBatch.EventTypes[contactIdx], &trackingTouchID, &worker->Strokes, &strokeEvent) != 0)
+      {
+        printf(FG_RED);
+        printf("The strokes of %s do not match the contacts at %s:%d\n", job->InputPath, __FILE__, __LINE__);
+        printf(RESET_COLOR);
+        retval = -1;
+        break;
+      }
+
+      if (strokeEvent != STROKE_EVENT_NONE)
+      {
+        lastInkTime = record->Timestamp;
+      }
+    }
+
+    job->NumReports += record->Count;
+  }
+
+  // the last character (and a stroke that was still on the surface when the recording stopped)
+  if (retval == 0)
+  {
+    retval = mEmitCharacter(options, worker, job, writers);
+  }
+
+  for (unsigned int writerIdx = 0; writerIdx < 3; writerIdx++)
+  {
+    if (mCloseNpyWriter(&writers[writerIdx]) != 0)
+    {
+      retval = -1;
+    }
+  }
+
+  free(decodePlans);
+  free(decodeStates);
+  mUnmapTouchTrace(&mapping);
+
+  return retval;
+}
+
+static void mConvertTraceProc(WORK_POOL* pool, unsigned int workerIdx, void* arg)
+{
+  CONVERT_JOB* job       = (CONVERT_JOB*)arg;
+  CONVERTER* converter   = job->Converter;
+  CONVERT_WORKER* worker = &converter->Workers[workerIdx];
+  (void)pool;
+
+  job->NumCharacters          = 0;
+  job->NumSkippedCharacters   = 0;
+  job->NumTruncatedCharacters = 0;
+  job->NumReports             = 0;
+  job->NumPoints              = 0;
+  job->NumSkippedMessages     = 0;
+  job->IsSkipped              = 0;
+  job->Retval                 = mConvertTrace(&converter->Options, worker, job);
+}
+
+// the largest files first so that the pool does not wait for a large one at the end
+static int mCompareConvertJobs(const void* a, const void* b)
+{
+  const CONVERT_JOB* jobA = (const CONVERT_JOB*)a;
+  const CONVERT_JOB* jobB = (const CONVERT_JOB*)b;
+  return (jobA->cbFile < jobB->cbFile) - (jobA->cbFile > jobB->cbFile);
+}
+
+static void mAddConvertJob(CONVERT_JOB** jobs, unsigned int* numJobs, unsigned int* capacity, const char* directory, const char* name, unsigned long long cbFile)
+{
+  if ((*numJobs) == (*capacity))
+  {
+    (*capacity) = ((*capacity) == 0) ? 64 : ((*capacity) * 2);
+    (*jobs)     = (CONVERT_JOB*)mRealloc((*jobs), sizeof(CONVERT_JOB) * (*capacity), __FILE__, __LINE__);
+  }
+
+  CONVERT_JOB* job = &(*jobs)[*numJobs];
+  memset(job, 0, sizeof(CONVERT_JOB));
+  snprintf(job->InputPath, sizeof(job->InputPath), "%s/%s", directory, name);
+  snprintf(job->Name, sizeof(job->Name), "%s", name);
+  job->cbFile = cbFile;
+  (*numJobs)++;
+}
+
+// Returns -1 if the directory cannot be read. Every regular file is a job,
+// the ones that are not touch traces are skipped by mConvertTrace.
+static int mListConvertJobs(const char* directory, CONVERT_JOB** jobs, unsigned int* numJobs)
+{
+  unsigned int capacity = 0;
+  (*jobs)               = NULL;
+  (*numJobs)            = 0;
+
+#ifdef _WIN32
+  char pattern[MAX_FILE_PATH];
+  snprintf(pattern, sizeof(pattern), "%s\\*", directory);
+
+  WIN32_FIND_DATAA findData;
+  HANDLE findHandle = FindFirstFileA(pattern, &findData);
+  if (findHandle == INVALID_HANDLE_VALUE)
+  {
+    return -1;
+  }
+
+  do
+  {
+    if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+    {
+      unsigned long long cbFile = ((unsigned long long)findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+      mAddConvertJob(jobs, numJobs, &capacity, directory, findData.cFileName, cbFile);
+    }
+  } while (FindNextFileA(findHandle, &findData));
+
+  FindClose(findHandle);
+#else
+  DIR* dir = opendir(directory);
+  if (dir == NULL)
+  {
+    return -1;
+  }
+
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL)
+  {
+    char filePath[MAX_FILE_PATH];
+    struct stat fileStat;
+    snprintf(filePath, sizeof(filePath), "%s/%s", directory, entry->d_name);
+
+    if ((stat(filePath, &fileStat) == 0) && S_ISREG(fileStat.st_mode))
+    {
+      mAddConvertJob(jobs, numJobs, &capacity, directory, entry->d_name, (unsigned long long)fileStat.st_size);
+    }
+  }
+
+  closedir(dir);
+#endif
+
+  qsort((*jobs), (*numJobs), sizeof(CONVERT_JOB), mCompareConvertJobs);
+
+  return 0;
+}
+
+// Convert every job on a pool of numThreads threads, returns the seconds that it took.
+static double mRunConversion(const CONVERT_OPTIONS* options, CONVERT_JOB* jobs, unsigned int numJobs, unsigned int numThreads, CONVERT_TOTALS* totals)
+{
+  CONVERTER converter;
+  WORK_POOL pool;
+  WORK_GROUP group;
+
+  mInitializeWorkPool(&pool, numThreads);
+
+  converter.Options    = (*options);
+  converter.NumWorkers = pool.NumThreads;
+  converter.Workers    = (CONVERT_WORKER*)mMalloc(sizeof(CONVERT_WORKER) * pool.NumThreads, __FILE__, __LINE__);
+  for (unsigned int workerIdx = 0; workerIdx < pool.NumThreads; workerIdx++)
+  {
+    mInitializeConvertWorker(&converter.Workers[workerIdx], options);
+  }
+
+  unsigned long long startTime = mGetTimestamp();
+
+  mInitializeWorkGroup(&group);
+  for (unsigned int jobIdx = 0; jobIdx < numJobs; jobIdx++)
+  {
+    jobs[jobIdx].Converter = &converter;
+    mSubmitWork(&pool, 0, &group, mConvertTraceProc, &jobs[jobIdx]);
+  }
+  mWaitForWorkGroup(&pool, 0, &group);
+
+  double seconds = mGetSeconds(startTime, mGetTimestamp());
+
+  memset(totals, 0, sizeof(CONVERT_TOTALS));
+  for (unsigned int jobIdx = 0; jobIdx < numJobs; jobIdx++)
+  {
+    CONVERT_JOB* job = &jobs[jobIdx];
+    if (job->Retval != 0)
+    {
+      totals->NumFailedFiles++;
+      continue;
+    }
+
+    if (job->IsSkipped)
+    {
+      totals->NumSkippedFiles++;
+      continue;
+    }
+
+    totals->NumConvertedFiles++;
+    totals->NumCharacters += job->NumCharacters;
+    totals->NumSkippedCharacters += job->NumSkippedCharacters;
+    totals->NumTruncatedCharacters += job->NumTruncatedCharacters;
+    totals->NumReports += job->NumReports;
+    totals->NumPoints += job->NumPoints;
+    totals->NumSkippedMessages += job->NumSkippedMessages;
+    totals->cbInput += job->cbFile;
+  }
+
+  for (unsigned int workerIdx = 0; workerIdx < pool.NumThreads; workerIdx++)
+  {
+    mFreeConvertWorker(&converter.Workers[workerIdx]);
+  }
+  free(converter.Workers);
+  mFreeWorkPool(&pool);
+
+  return seconds;
+}
+
+int main(int argc, char* argv[])
+{
+  CONVERT_OPTIONS options;
+  options.NumSequencePoints = DEFAULT_SEQUENCE_POINTS;
+  options.BitmapSize        = DEFAULT_BITMAP_SIZE;
+  options.GapMilliseconds   = DEFAULT_GAP_MS;
+  options.OutputDirectory   = NULL;
+
+  const char* inputDirectory = NULL;
+  unsigned int numThreads    = 0;
+  int isScalingReported      = 0;
+
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--input") == 0) && ((argIdx + 1) < argc))
+    {
+      inputDirectory = argv[++argIdx];
+    }
+    else if ((strcmp(argv[argIdx], "--output") == 0) && ((argIdx + 1) < argc))
+    {
+      options.OutputDirectory = argv[++argIdx];
+    }
+    else if ((strcmp(argv[argIdx], "--threads") == 0) && ((argIdx + 1) < argc))
+    {
+      numThreads = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--points") == 0) && ((argIdx + 1) < argc))
+    {
+      options.NumSequencePoints = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--size") == 0) && ((argIdx + 1) < argc))
+    {
+      options.BitmapSize = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if ((strcmp(argv[argIdx], "--gap") == 0) && ((argIdx + 1) < argc))
+    {
+      options.GapMilliseconds = (unsigned int)atoi(argv[++argIdx]);
+    }
+    else if (strcmp(argv[argIdx], "--scaling") == 0)
+    {
+      isScalingReported = 1;
+    }
+    else
+    {
+      inputDirectory = NULL;
+      break;
+    }
+  }
+
+  if ((inputDirectory == NULL) || (options.OutputDirectory == NULL) || (options.NumSequencePoints < 4) || (options.BitmapSize < 8))
+  {
+    printf("Usage: %s --input <dir> --output <dir> [--threads <count>] [--points <count>] [--size <pixels>] [--gap <ms>] [--scaling]\n", argv[0]);
+    return -1;
+  }
+
+  numThreads = (numThreads == 0) ? mGetNumProcessors() : numThreads;
+  numThreads = (numThreads > WORK_POOL_MAX_THREADS) ? WORK_POOL_MAX_THREADS : numThreads;
+
+  CONVERT_JOB* jobs;
+  unsigned int numJobs;
+  if (mListConvertJobs(inputDirectory, &jobs, &numJobs) != 0)
+  {
+    printf(FG_RED);
+    printf("Failed to read the directory %s at %s:%d\n", inputDirectory, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  CONVERT_TOTALS totals;
+  double seconds = mRunConversion(&options, jobs, numJobs, numThreads, &totals);
+
+  printf("%u file(s) converted, %u skipped, %u failed, %u thread(s)\n", totals.NumConvertedFiles, totals.NumSkippedFiles, totals.NumFailedFiles, numThreads);
+  printf("%u characters (%u skipped, %u truncated to %u points), %llu reports, %llu points, %llu messages without a decode plan\n", totals.NumCharacters, totals.NumSkippedCharacters, totals.NumTruncatedCharacters, options.NumSequencePoints, totals.NumReports, totals.NumPoints, totals.NumSkippedMessages);
+  printf("%.3f s: %.1f files/s, %.1f characters/s, %.1f MB/s of traces\n", seconds, totals.NumConvertedFiles / seconds, totals.NumCharacters / seconds, (double)totals.cbInput / (1024.0 * 1024.0) / seconds);
+
+  if (isScalingReported)
+  {
+    // the run above has warmed the page cache
+    double singleThreadSeconds = 0.0;
+
+    printf("%8s %12s %10s %12s\n", "threads", "files/s", "speedup", "efficiency");
+    // 1, 2, 4, ... and numThreads even if it is not a power of 2
+    for (unsigned int scalingThreads = 1;; scalingThreads = ((scalingThreads * 2) < numThreads) ? (scalingThreads * 2) : numThreads)
+    {
+      CONVERT_TOTALS scalingTotals;
+      double scalingSeconds = mRunConversion(&options, jobs, numJobs, scalingThreads, &scalingTotals);
+      singleThreadSeconds   = (scalingThreads == 1) ? scalingSeconds : singleThreadSeconds;
+
+      double speedup = singleThreadSeconds / scalingSeconds;
+      printf("%8u %12.1f %9.2fx %11.0f%%\n", scalingThreads, scalingTotals.NumConvertedFiles / scalingSeconds, speedup, 100.0 * speedup / scalingThreads);
+
+      if (scalingThreads == numThreads)
+      {
+        break;
+      }
+    }
+
+    printf("(%u processor(s))\n", mGetNumProcessors());
+  }
+
+  free(jobs);
+
+  return (totals.NumFailedFiles == 0) ? 0 : -1;
+}
@@ -0,0 +1,487 @@
+#include "platform.h"
+
+#include <math.h>
+
+#include "canvas.h"
+
+// The coverage kernel is picked at compile time from the instruction sets
+// that the compiler targets (/arch:AVX2, -mavx2, ...). SSE2 is the baseline
+// of x64 and of the default /arch of 32-bit MSVC. Define CANVAS_DISABLE_SIMD
+// to build the scalar kernel.
+#if !defined(CANVAS_DISABLE_SIMD) && defined(__AVX2__)
+#define CANVAS_USE_AVX2
+#include <immintrin.h>
+#elif !defined(CANVAS_DISABLE_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define CANVAS_USE_SSE2
+#include <emmintrin.h>
+#elif !defined(CANVAS_DISABLE_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+#define CANVAS_USE_NEON
+#include <arm_neon.h>
+#endif
+
+// a segment of mDrawCanvasSegment relative to its first point
+struct CANVAS_CAPSULE
+{
+  float X0;
+  float Y0;
+  float Dx;
+  float Dy;
+  float InverseLengthSquared;
+  // the coverage of a pixel is CoverageRadius minus the distance from its
+  // center to the segment, clamped to [0, 1]
+  float CoverageRadius;
+  unsigned int Color;
+};
+
+typedef struct CANVAS_CAPSULE CANVAS_CAPSULE;
+
+static void mAddCanvasDirtyRect(CANVAS* canvas, int left, int top, int right, int bottom)
+{
+  if (!canvas->IsDirty)
+  {
+    canvas->DirtyRect = (RECT){.left = left, .top = top, .right = right, .bottom = bottom};
+    canvas->IsDirty   = 1;
+    return;
+  }
+
+  if (left < canvas->DirtyRect.left)
+  {
+    canvas->DirtyRect.left = left;
+  }
+
+  if (top < canvas->DirtyRect.top)
+  {
+    canvas->DirtyRect.top = top;
+  }
+
+  if (right > canvas->DirtyRect.right)
+  {
+    canvas->DirtyRect.right = right;
+  }
+
+  if (bottom > canvas->DirtyRect.bottom)
+  {
+    canvas->DirtyRect.bottom = bottom;
+  }
+}
+
+// alpha is in [0, 256], every channel is (color * alpha + pixel * (256 - alpha)) / 256
+static __inline unsigned int mBlendCanvasPixel(unsigned int pixel, unsigned int color, unsigned int alpha)
+{
+  unsigned int inverseAlpha = 256 - alpha;
+  unsigned int redBlue      = ((((color & 0xff00ff) * alpha) + ((pixel & 0xff00ff) * inverseAlpha)) >> 8) & 0xff00ff;
+  unsigned int green        = ((((color & 0xff00) * alpha) + ((pixel & 0xff00) * inverseAlpha)) >> 8) & 0xff00;
+
+  return redBlue | green;
+}
+
+// The kernels below evaluate the same operations in the same order so that
+// every one of them produces the same pixels as this one.
+static __inline unsigned int mGetCapsuleAlpha(const CANVAS_CAPSULE* capsule, float px, float py, float pyDy)
+{
+  // distance from the pixel to the closest point of the segment
+  float t = ((px * capsule->Dx) + pyDy) * capsule->InverseLengthSquared;
+  t       = (t < 0.0f) ? 0.0f : ((t > 1.0f) ? 1.0f : t);
+
+  float ex       = px - (t * capsule->Dx);
+  float ey       = py - (t * capsule->Dy);
+  float coverage = capsule->CoverageRadius - sqrtf((ex * ex) + (ey * ey));
+  coverage       = (coverage < 0.0f) ? 0.0f : ((coverage > 1.0f) ? 1.0f : coverage);
+
+  return (unsigned int)((coverage * 256.0f) + 0.5f);
+}
+
+#if defined(CANVAS_USE_SSE2)
+// blend 4 pixels with 4 alphas in 16 bits per channel
+static __inline __m128i mBlendCanvasPixelsSse2(__m128i pixels, __m128i color16, __m128i alpha)
+{
+  __m128i zero   = _mm_setzero_si128();
+  __m128i full   = _mm_set1_epi16(256);
+  __m128i alpha16 = _mm_packs_epi32(alpha, alpha);
+  alpha16         = _mm_unpacklo_epi16(alpha16, alpha16);
+  __m128i alphaLo = _mm_unpacklo_epi32(alpha16, alpha16);
+  __m128i alphaHi = _mm_unpackhi_epi32(alpha16, alpha16);
+  __m128i lo     = _mm_unpacklo_epi8(pixels, zero);
+  __m128i hi     = _mm_unpackhi_epi8(pixels, zero);
+
+  lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(color16, alphaLo), _mm_mullo_epi16(lo, _mm_sub_epi16(full, alphaLo))), 8);
+  hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(color16, alphaHi), _mm_mullo_epi16(hi, _mm_sub_epi16(full, alphaHi))), 8);
+
+  return _mm_packus_epi16(lo, hi);
+}
+#elif defined(CANVAS_USE_AVX2)
+// blend 8 pixels with 8 alphas in 16 bits per channel, unpacking works within
+// the 128-bit lanes so lo holds the pixels 0, 1, 4, 5 and hi the pixels 2, 3, 6, 7
+static __inline __m256i mBlendCanvasPixelsAvx2(__m256i pixels, __m256i color16, __m256i alpha)
+{
+  __m256i zero   = _mm256_setzero_si256();
+  __m256i full   = _mm256_set1_epi16(256);
+  __m256i alpha16 = _mm256_packs_epi32(alpha, alpha);
+  alpha16         = _mm256_unpacklo_epi16(alpha16, alpha16);
+  __m256i alphaLo = _mm256_unpacklo_epi32(alpha16, alpha16);
+  __m256i alphaHi = _mm256_unpackhi_epi32(alpha16, alpha16);
+  __m256i lo     = _mm256_unpacklo_epi8(pixels, zero);
+  __m256i hi     = _mm256_unpackhi_epi8(pixels, zero);
+
+  lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(color16, alphaLo), _mm256_mullo_epi16(lo, _mm256_sub_epi16(full, alphaLo))), 8);
+  hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(color16, alphaHi), _mm256_mullo_epi16(hi, _mm256_sub_epi16(full, alphaHi))), 8);
+
+  return _mm256_packus_epi16(lo, hi);
+}
+#endif
+
+// blend the capsule into the pixels [left, right) of a row
+static void mBlendCapsuleSpan(const CANVAS_CAPSULE* capsule, unsigned int* row, int left, int right, float py)
+{
+  float pyDy = py * capsule->Dy;
+  int x      = left;
+
+#if defined(CANVAS_USE_SSE2)
+  __m128 dx       = _mm_set1_ps(capsule->Dx);
+  __m128 dy       = _mm_set1_ps(capsule->Dy);
+  __m128 pyv      = _mm_set1_ps(py);
+  __m128 pyDyv    = _mm_set1_ps(pyDy);
+  __m128 inverse  = _mm_set1_ps(capsule->InverseLengthSquared);
+  __m128 radius   = _mm_set1_ps(capsule->CoverageRadius);
+  __m128 zero     = _mm_setzero_ps();
+  __m128 one      = _mm_set1_ps(1.0f);
+  __m128 scale    = _mm_set1_ps(256.0f);
+  __m128 half     = _mm_set1_ps(0.5f);
+  __m128 step     = _mm_set1_ps(4.0f);
+  __m128i color16 = _mm_unpacklo_epi8(_mm_set1_epi32((int)capsule->Color), _mm_setzero_si128());
+  __m128 px       = _mm_add_ps(_mm_set1_ps((float)left - capsule->X0), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+
+  for (; (x + 4) <= right; x += 4, px = _mm_add_ps(px, step))
+  {
+    __m128 t        = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(px, dx), pyDyv), inverse);
+    t               = _mm_min_ps(_mm_max_ps(t, zero), one);
+    __m128 ex       = _mm_sub_ps(px, _mm_mul_ps(t, dx));
+    __m128 ey       = _mm_sub_ps(pyv, _mm_mul_ps(t, dy));
+    __m128 coverage = _mm_sub_ps(radius, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey))));
+    coverage        = _mm_min_ps(_mm_max_ps(coverage, zero), one);
+    __m128i alpha   = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(coverage, scale), half));
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, _mm_setzero_si128())) == 0xffff)
+    {
+      continue;
+    }
+
+    __m128i pixels = _mm_loadu_si128((const __m128i*)(row + x));
+    _mm_storeu_si128((__m128i*)(row + x), mBlendCanvasPixelsSse2(pixels, color16, alpha));
+  }
+#elif defined(CANVAS_USE_AVX2)
+  __m256 dx       = _mm256_set1_ps(capsule->Dx);
+  __m256 dy       = _mm256_set1_ps(capsule->Dy);
+  __m256 pyv      = _mm256_set1_ps(py);
+  __m256 pyDyv    = _mm256_set1_ps(pyDy);
+  __m256 inverse  = _mm256_set1_ps(capsule->InverseLengthSquared);
+  __m256 radius   = _mm256_set1_ps(capsule->CoverageRadius);
+  __m256 zero     = _mm256_setzero_ps();
+  __m256 one      = _mm256_set1_ps(1.0f);
+  __m256 scale    = _mm256_set1_ps(256.0f);
+  __m256 half     = _mm256_set1_ps(0.5f);
+  __m256 step     = _mm256_set1_ps(8.0f);
+  __m256i color16 = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)capsule->Color), _mm256_setzero_si256());
+  __m256 px       = _mm256_add_ps(_mm256_set1_ps((float)left - capsule->X0), _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f));
+
+  for (; (x + 8) <= right; x += 8, px = _mm256_add_ps(px, step))
+  {
+    __m256 t        = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(px, dx), pyDyv), inverse);
+    t               = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+    __m256 ex       = _mm256_sub_ps(px, _mm256_mul_ps(t, dx));
+    __m256 ey       = _mm256_sub_ps(pyv, _mm256_mul_ps(t, dy));
+    __m256 coverage = _mm256_sub_ps(radius, _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey))));
+    coverage        = _mm256_min_ps(_mm256_max_ps(coverage, zero), one);
+    __m256i alpha   = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(coverage, scale), half));
+
+    if (_mm256_testz_si256(alpha, alpha))
+    {
+      continue;
+    }
+
+    __m256i pixels = _mm256_loadu_si256((const __m256i*)(row + x));
+    _mm256_storeu_si256((__m256i*)(row + x), mBlendCanvasPixelsAvx2(pixels, color16, alpha));
+  }
+#elif defined(CANVAS_USE_NEON)
+  float32x4_t dx       = vdupq_n_f32(capsule->Dx);
+  float32x4_t dy       = vdupq_n_f32(capsule->Dy);
+  float32x4_t pyv      = vdupq_n_f32(py);
+  float32x4_t pyDyv    = vdupq_n_f32(pyDy);
+  float32x4_t inverse  = vdupq_n_f32(capsule->InverseLengthSquared);
+  float32x4_t radius   = vdupq_n_f32(capsule->CoverageRadius);
+  float32x4_t zero     = vdupq_n_f32(0.0f);
+  float32x4_t one      = vdupq_n_f32(1.0f);
+  float32x4_t scale    = vdupq_n_f32(256.0f);
+  float32x4_t half     = vdupq_n_f32(0.5f);
+  float32x4_t step     = vdupq_n_f32(4.0f);
+  uint16x8_t full      = vdupq_n_u16(256);
+  uint16x8_t color16   = vmovl_u8(vget_low_u8(vreinterpretq_u8_u32(vdupq_n_u32(capsule->Color))));
+  const float lanes[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+  float32x4_t px       = vaddq_f32(vdupq_n_f32((float)left - capsule->X0), vld1q_f32(lanes));
+
+  for (; (x + 4) <= right; x += 4, px = vaddq_f32(px, step))
+  {
+    // vmulq/vaddq instead of vmlaq so that nothing is fused
+    float32x4_t t        = vmulq_f32(vaddq_f32(vmulq_f32(px, dx), pyDyv), inverse);
+    t                    = vminq_f32(vmaxq_f32(t, zero), one);
+    float32x4_t ex       = vsubq_f32(px, vmulq_f32(t, dx));
+    float32x4_t ey       = vsubq_f32(pyv, vmulq_f32(t, dy));
+    float32x4_t coverage = vsubq_f32(radius, vsqrtq_f32(vaddq_f32(vmulq_f32(ex, ex), vmulq_f32(ey, ey))));
+    coverage             = vminq_f32(vmaxq_f32(coverage, zero), one);
+    uint32x4_t alpha     = vcvtq_u32_f32(vaddq_f32(vmulq_f32(coverage, scale), half));
+
+    if (vmaxvq_u32(alpha) == 0)
+    {
+      continue;
+    }
+
+    uint16x4_t alpha16 = vmovn_u32(alpha);
+    uint16x8_t alphaLo = vcombine_u16(vdup_lane_u16(alpha16, 0), vdup_lane_u16(alpha16, 1));
+    uint16x8_t alphaHi = vcombine_u16(vdup_lane_u16(alpha16, 2), vdup_lane_u16(alpha16, 3));
+    uint8x16_t pixels  = vreinterpretq_u8_u32(vld1q_u32(row + x));
+    uint16x8_t lo      = vmovl_u8(vget_low_u8(pixels));
+    uint16x8_t hi      = vmovl_u8(vget_high_u8(pixels));
+
+    lo = vmlaq_u16(vmulq_u16(color16, alphaLo), lo, vsubq_u16(full, alphaLo));
+    hi = vmlaq_u16(vmulq_u16(color16, alphaHi), hi, vsubq_u16(full, alphaHi));
+
+    vst1q_u32(row + x, vreinterpretq_u32_u8(vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8))));
+  }
+#endif
+
+  // the remainder of the vector kernels or the whole span
+  for (; x < right; x++)
+  {
+    unsigned int alpha = mGetCapsuleAlpha(capsule, (float)x - capsule->X0, py, pyDy);
+    if (alpha != 0)
+    {
+      row[x] = mBlendCanvasPixel(row[x], capsule->Color, alpha);
+    }
+  }
+}
+
+const char* mGetCanvasKernelName()
+{
+#if defined(CANVAS_USE_SSE2)
+  return "SSE2";
+#elif defined(CANVAS_USE_AVX2)
+  return "AVX2";
+#elif defined(CANVAS_USE_NEON)
+  return "NEON";
+#else
+  return "scalar";
+#endif
+}
+
+void mInitializeCanvas(CANVAS* canvas, unsigned int* pixels, int width, int height, int stride)
+{
+  canvas->Pixels  = pixels;
+  canvas->Width   = width;
+  canvas->Height  = height;
+  canvas->Stride  = stride;
+  canvas->IsDirty = 0;
+}
+
+void mFillCanvas(CANVAS* canvas, unsigned int color)
+{
+  for (int y = 0; y < canvas->Height; y++)
+  {
+    unsigned int* row = canvas->Pixels + ((size_t)y * canvas->Stride);
+    for (int x = 0; x < canvas->Width; x++)
+    {
+      row[x] = color;
+    }
+  }
+
+  mAddCanvasDirtyRect(canvas, 0, 0, canvas->Width, canvas->Height);
+}
+
+// the pixels that a capsule of the given coverage radius around points inside the bounds may touch
+static void mGetCanvasCoverageRect(float minX, float minY, float maxX, float maxY, float radius, int* left, int* top, int* right, int* bottom)
+{
+  (*left)   = (int)floorf(minX - radius);
+  (*top)    = (int)floorf(minY - radius);
+  (*right)  = (int)ceilf(maxX + radius) + 1;
+  (*bottom) = (int)ceilf(maxY + radius) + 1;
+}
+
+// mDrawCanvasSegment that only touches the pixels inside the clip rect
+static void mDrawClippedCanvasSegment(CANVAS* canvas, Point2D from, Point2D to, float width, unsigned int color, const RECT* clipRect)
+{
+  CANVAS_CAPSULE capsule;
+  capsule.X0                   = (float)from.X;
+  capsule.Y0                   = (float)from.Y;
+  capsule.Dx                   = (float)to.X - capsule.X0;
+  capsule.Dy                   = (float)to.Y - capsule.Y0;
+  capsule.CoverageRadius       = (width * 0.5f) + 0.5f;
+  capsule.Color                = color;
+  float lengthSquared          = (capsule.Dx * capsule.Dx) + (capsule.Dy * capsule.Dy);
+  capsule.InverseLengthSquared = (lengthSquared > 0.0f) ? (1.0f / lengthSquared) : 0.0f;
+
+  // bounding box of the pixels with some coverage clipped to the clip rect
+  float radius = capsule.CoverageRadius;
+  int left, top, right, bottom;
+  mGetCanvasCoverageRect(fminf(capsule.X0, (float)to.X), fminf(capsule.Y0, (float)to.Y), fmaxf(capsule.X0, (float)to.X), fmaxf(capsule.Y0, (float)to.Y), radius, &left, &top, &right, &bottom);
+
+  left   = (left < clipRect->left) ? clipRect->left : left;
+  top    = (top < clipRect->top) ? clipRect->top : top;
+  right  = (right > clipRect->right) ? clipRect->right : right;
+  bottom = (bottom > clipRect->bottom) ? clipRect->bottom : bottom;
+
+  if ((left >= right) || (top >= bottom))
+  {
+    return;
+  }
+
+  // The capsule lies inside the band of half width radius around the line
+  // through the segment, so for slanted segments only the part of each row
+  // inside that band is scanned instead of the whole bounding box.
+  float slope    = 0.0f;
+  float halfBand = 0.0f;
+  if (capsule.Dy != 0.0f)
+  {
+    slope    = capsule.Dx / capsule.Dy;
+    halfBand = (radius * sqrtf(lengthSquared)) / fabsf(capsule.Dy);
+  }
+
+  for (int y = top; y < bottom; y++)
+  {
+    float py     = (float)y - capsule.Y0;
+    int rowLeft  = left;
+    int rowRight = right;
+
+    if (capsule.Dy != 0.0f)
+    {
+      float center  = capsule.X0 + (py * slope);
+      int bandLeft  = (int)floorf(center - halfBand) - 1;
+      int bandRight = (int)ceilf(center + halfBand) + 2;
+
+      rowLeft  = (bandLeft > left) ? bandLeft : left;
+      rowRight = (bandRight < right) ? bandRight : right;
+    }
+
+    if (rowLeft < rowRight)
+    {
+      mBlendCapsuleSpan(&capsule, canvas->Pixels + ((size_t)y * canvas->Stride), rowLeft, rowRight, py);
+    }
+  }
+
+  mAddCanvasDirtyRect(canvas, left, top, right, bottom);
+}
+
+void mDrawCanvasSegment(CANVAS* canvas, Point2D from, Point2D to, float width, unsigned int color)
+{
+  RECT canvasRect = {0, 0, canvas->Width, canvas->Height};
+  mDrawClippedCanvasSegment(canvas, from, to, width, color, &canvasRect);
+}
+
+void mDrawCanvasStrokes(CANVAS* canvas, StrokeList* strokes, float width, unsigned int color)
+{
+  for (unsigned int strokeIdx = 0; strokeIdx < strokes->Size; strokeIdx++)
+  {
+    StrokeIndexEntry stroke = strokes->Entries[strokeIdx];
+    Point2D* strokePoints   = mGetSimplifiedStrokePoints(strokes, strokeIdx);
+
+    for (unsigned int pointIdx = 1; pointIdx < stroke.SimplifiedSize; pointIdx++)
+    {
+      mDrawCanvasSegment(canvas, strokePoints[pointIdx - 1], strokePoints[pointIdx], width, color);
+    }
+  }
+}
+
+// Fill the pixels that strokes inside pointBounds may cover with the
+// background. Returns -1 if none of them are on the canvas, otherwise the
+// pixels to redraw the strokes into.
+static int mClearCanvasRedrawRect(CANVAS* canvas, const RECT* pointBounds, float radius, unsigned int backgroundColor, RECT* clipRect)
+{
+  mGetCanvasCoverageRect((float)pointBounds->left, (float)pointBounds->top, (float)pointBounds->right, (float)pointBounds->bottom, radius, &clipRect->left, &clipRect->top, &clipRect->right, &clipRect->bottom);
+
+  clipRect->left   = (clipRect->left < 0) ? 0 : clipRect->left;
+  clipRect->top    = (clipRect->top < 0) ? 0 : clipRect->top;
+  clipRect->right  = (clipRect->right > canvas->Width) ? canvas->Width : clipRect->right;
+  clipRect->bottom = (clipRect->bottom > canvas->Height) ? canvas->Height : clipRect->bottom;
+
+  if ((clipRect->left >= clipRect->right) || (clipRect->top >= clipRect->bottom))
+  {
+    return -1;
+  }
+
+  for (int y = clipRect->top; y < clipRect->bottom; y++)
+  {
+    unsigned int* row = canvas->Pixels + ((size_t)y * canvas->Stride);
+    for (int x = clipRect->left; x < clipRect->right; x++)
+    {
+      row[x] = backgroundColor;
+    }
+  }
+
+  mAddCanvasDirtyRect(canvas, clipRect->left, clipRect->top, clipRect->right, clipRect->bottom);
+
+  return 0;
+}
+
+void mRedrawCanvasRect(CANVAS* canvas, const RECT* pointBounds, StrokeList* strokes, float width, unsigned int color, unsigned int backgroundColor)
+{
+  float radius = (width * 0.5f) + 0.5f;
+  RECT clipRect;
+  if (mClearCanvasRedrawRect(canvas, pointBounds, radius, backgroundColor, &clipRect) != 0)
+  {
+    return;
+  }
+
+  // the strokes are drawn from their simplified view in the same order as
+  // mDrawCanvasStrokes, the blended pixels only match the rest of the canvas
+  // if it was drawn from the same segments, so the live ink uses them too
+  for (unsigned int strokeIdx = 0; strokeIdx < strokes->Size; strokeIdx++)
+  {
+    StrokeIndexEntry stroke = strokes->Entries[strokeIdx];
+
+    int left, top, right, bottom;
+    mGetCanvasCoverageRect((float)stroke.MinX, (float)stroke.MinY, (float)stroke.MaxX, (float)stroke.MaxY, radius, &left, &top, &right, &bottom);
+    if ((left >= clipRect.right) || (right <= clipRect.left) || (top >= clipRect.bottom) || (bottom <= clipRect.top))
+    {
+      continue;
+    }
+
+    Point2D* strokePoints = mGetSimplifiedStrokePoints(strokes, strokeIdx);
+    for (unsigned int pointIdx = 1; pointIdx < stroke.SimplifiedSize; pointIdx++)
+    {
+      mDrawClippedCanvasSegment(canvas, strokePoints[pointIdx - 1], strokePoints[pointIdx], width, color, &clipRect);
+    }
+  }
+}
+
+void mRedrawCanvasRectIndexed(CANVAS* canvas, const RECT* pointBounds, const SEGMENT_GRID* grid, const StrokeList* strokes, unsigned int firstStroke, unsigned int endStroke, STROKE_SEGMENT_LIST* segments, float width, unsigned int color, unsigned int backgroundColor)
+{
+  float radius = (width * 0.5f) + 0.5f;
+  RECT clipRect;
+  if (mClearCanvasRedrawRect(canvas, pointBounds, radius, backgroundColor, &clipRect) != 0)
+  {
+    return;
+  }
+
+  // a segment covers a pixel of the clip rect only if it passes within radius of it
+  int margin     = (int)ceilf(radius) + 1;
+  RECT queryRect = {clipRect.left - margin, clipRect.top - margin, (clipRect.right - 1) + margin, (clipRect.bottom - 1) + margin};
+
+  // in the order of the strokes like mRedrawCanvasRect
+  mQuerySegmentGrid(grid, strokes, firstStroke, endStroke, &queryRect, segments);
+
+  for (unsigned int segmentIdx = 0; segmentIdx < segments->Size; segmentIdx++)
+  {
+    mDrawClippedCanvasSegment(canvas, segments->Entries[segmentIdx].From, segments->Entries[segmentIdx].To, width, color, &clipRect);
+  }
+}
+
+int mTakeCanvasDirtyRect(CANVAS* canvas, RECT* dirtyRect)
+{
+  if (!canvas->IsDirty)
+  {
+    return -1;
+  }
+
+  (*dirtyRect)    = canvas->DirtyRect;
+  canvas->IsDirty = 0;
+
+  return 0;
+}
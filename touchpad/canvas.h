@@ -0,0 +1,54 @@
+#ifndef __CANVAS_H__
+#define __CANVAS_H__
+#include "platform.h"
+
+#include "point2d.h"
+#include "stroke.h"
+#include "segmentgrid.h"
+
+// 0x00RRGGBB like the pixels of a 32 bits per pixel DIB section
+#define CANVAS_COLOR(r, g, b) ((((unsigned int)(r)) << 16) | (((unsigned int)(g)) << 8) | ((unsigned int)(b)))
+
+// An in-memory framebuffer that keeps the ink between paints. New segments
+// are rasterized into it as they arrive and the area that they touched is
+// accumulated in DirtyRect so that painting the window is a single blit of
+// that area instead of replaying every stroke. The pixels are not owned by
+// the canvas (e.g. they are the bits of a DIB section on Windows).
+struct CANVAS
+{
+  unsigned int* Pixels;
+  int Width;
+  int Height;
+  // number of pixels between the starts of two rows (top-down)
+  int Stride;
+  int IsDirty;
+  // exclusive right and bottom like the RECTs of GDI
+  RECT DirtyRect;
+};
+
+typedef struct CANVAS CANVAS;
+
+void mInitializeCanvas(CANVAS* canvas, unsigned int* pixels, int width, int height, int stride);
+void mFillCanvas(CANVAS* canvas, unsigned int color);
+// Draw an anti-aliased line of the given width with round caps (a capsule).
+// The coverage of each pixel is approximated by the distance from its center
+// to the edge of the capsule and the color is blended over the pixel.
+void mDrawCanvasSegment(CANVAS* canvas, Point2D from, Point2D to, float width, unsigned int color);
+// Draw every segment of the simplified view of every stroke, e.g. after the
+// canvas has been resized.
+void mDrawCanvasStrokes(CANVAS* canvas, StrokeList* strokes, float width, unsigned int color);
+// Repaint the part of the canvas that strokes inside pointBounds (the
+// inclusive bounding box of their points) may cover: it is filled with the
+// background and the segments of the strokes that reach into it are drawn
+// again, e.g. after a stroke was hidden. The pixels outside are not touched.
+void mRedrawCanvasRect(CANVAS* canvas, const RECT* pointBounds, StrokeList* strokes, float width, unsigned int color, unsigned int backgroundColor);
+// mRedrawCanvasRect that only draws the segments of the strokes
+// [firstStroke, endStroke) that the grid finds around the area instead of
+// testing every stroke. segments is the memory for the query.
+void mRedrawCanvasRectIndexed(CANVAS* canvas, const RECT* pointBounds, const SEGMENT_GRID* grid, const StrokeList* strokes, unsigned int firstStroke, unsigned int endStroke, STROKE_SEGMENT_LIST* segments, float width, unsigned int color, unsigned int backgroundColor);
+// Returns -1 if nothing has been drawn since the last call, otherwise returns
+// the area to repaint and resets it.
+int mTakeCanvasDirtyRect(CANVAS* canvas, RECT* dirtyRect);
+// "SSE2", "AVX2", "NEON" or "scalar", the kernel that mDrawCanvasSegment was built with
+const char* mGetCanvasKernelName();
+#endif  // __CANVAS_H__
@@ -0,0 +1,26 @@
+#include "deviceregistry.h"
+
+static unsigned long long mGetDeviceHandleKey(void* deviceHandle)
+{
+  return (unsigned long long)(size_t)deviceHandle;
+}
+
+int mFindDeviceInRegistry(DEVICE_REGISTRY* registry, void* deviceHandle, unsigned int* deviceIdx)
+{
+  return mFindInHashIndex(&registry->HandleIndex, mGetDeviceHandleKey(deviceHandle), deviceIdx);
+}
+
+void mAddDeviceToRegistry(DEVICE_REGISTRY* registry, void* deviceHandle, unsigned int deviceIdx)
+{
+  mInsertIntoHashIndex(&registry->HandleIndex, mGetDeviceHandleKey(deviceHandle), deviceIdx);
+}
+
+void mRemoveDeviceFromRegistry(DEVICE_REGISTRY* registry, void* deviceHandle)
+{
+  mRemoveFromHashIndex(&registry->HandleIndex, mGetDeviceHandleKey(deviceHandle));
+}
+
+void mFreeDeviceRegistry(DEVICE_REGISTRY* registry)
+{
+  mFreeHashIndex(&registry->HandleIndex);
+}
@@ -0,0 +1,27 @@
+#ifndef __DEVICEREGISTRY_H__
+#define __DEVICEREGISTRY_H__
+#include "platform.h"
+
+#include "hashindex.h"
+
+// value for handles of devices that are not touchpads (or could not be parsed)
+#define DEVICE_REGISTRY_UNKNOWN_DEVICE ((unsigned int)-1)
+
+// Maps raw input device handles (RAWINPUTHEADER.hDevice) to indices into the
+// device info list. The device name is only resolved the first time that a
+// handle is seen so that WM_INPUT does not query and compare names for every
+// report. Handles must be removed when their device is removed because
+// Windows may reuse them.
+struct DEVICE_REGISTRY
+{
+  HASH_INDEX HandleIndex;
+};
+
+typedef struct DEVICE_REGISTRY DEVICE_REGISTRY;
+
+// returns -1 if the handle has not been seen before
+int mFindDeviceInRegistry(DEVICE_REGISTRY* registry, void* deviceHandle, unsigned int* deviceIdx);
+void mAddDeviceToRegistry(DEVICE_REGISTRY* registry, void* deviceHandle, unsigned int deviceIdx);
+void mRemoveDeviceFromRegistry(DEVICE_REGISTRY* registry, void* deviceHandle);
+void mFreeDeviceRegistry(DEVICE_REGISTRY* registry);
+#endif  // __DEVICEREGISTRY_H__
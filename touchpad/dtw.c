@@ -0,0 +1,402 @@
+#include "platform.h"
+
+#include "dtw.h"
+
+// The kernel is picked at compile time like the coverage kernel of canvas.c.
+// SSE2 is the baseline of x64, the AVX2 kernel also uses 4 wide vectors for
+// the short anti-diagonals of a narrow band. Define DTW_DISABLE_SIMD to build
+// the scalar kernel.
+#if !defined(DTW_DISABLE_SIMD) && defined(__AVX2__)
+#define DTW_USE_AVX2
+#include <immintrin.h>
+#elif !defined(DTW_DISABLE_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define DTW_USE_SSE2
+#include <emmintrin.h>
+#elif !defined(DTW_DISABLE_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+#define DTW_USE_NEON
+#include <arm_neon.h>
+#endif
+
+// the cells outside of the band, large enough to never be the minimum and small enough to add a cost to
+#define DTW_INFINITY 1e30f
+
+const char* mGetDtwKernelName()
+{
+#if defined(DTW_USE_AVX2)
+  return "AVX2";
+#elif defined(DTW_USE_SSE2)
+  return "SSE2";
+#elif defined(DTW_USE_NEON)
+  return "NEON";
+#else
+  return "scalar";
+#endif
+}
+
+void mReverseDtwSequence(const DTW_PARAMETERS* parameters, const float* sequence, float* reversed)
+{
+  unsigned int numPoints = parameters->NumPoints;
+
+  for (unsigned int channelIdx = 0; channelIdx < parameters->NumChannels; channelIdx++)
+  {
+    const float* channel   = sequence + (channelIdx * numPoints);
+    float* reversedChannel = reversed + (channelIdx * numPoints);
+
+    for (unsigned int pointIdx = 0; pointIdx < numPoints; pointIdx++)
+    {
+      reversedChannel[pointIdx] = channel[numPoints - 1 - pointIdx];
+    }
+  }
+}
+
+static __inline float mGetDtwPointDistance(const DTW_PARAMETERS* parameters, const float* a, unsigned int aIdx, const float* b, unsigned int bIdx)
+{
+  float distance = 0.0f;
+
+  for (unsigned int channelIdx = 0; channelIdx < parameters->NumChannels; channelIdx++)
+  {
+    float difference = a[(channelIdx * parameters->NumPoints) + aIdx] - b[(channelIdx * parameters->NumPoints) + bIdx];
+    distance += parameters->Weights[channelIdx] * (difference * difference);
+  }
+
+  return distance;
+}
+
+#if defined(DTW_USE_SSE2) || defined(DTW_USE_AVX2)
+static __inline float mGetDtwMinimum4(__m128 values)
+{
+  values = _mm_min_ps(values, _mm_shuffle_ps(values, values, _MM_SHUFFLE(1, 0, 3, 2)));
+  values = _mm_min_ps(values, _mm_shuffle_ps(values, values, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtss_f32(values);
+}
+
+// the smallest of the 4 cells starting at start that are inside [first, last]
+static __inline float mGetDtwBandMinimum4(__m128 cells, int start, int first, int last)
+{
+  __m128i indices = _mm_add_epi32(_mm_set1_epi32(start), _mm_set_epi32(3, 2, 1, 0));
+  __m128i outside = _mm_or_si128(_mm_cmplt_epi32(indices, _mm_set1_epi32(first)), _mm_cmpgt_epi32(indices, _mm_set1_epi32(last)));
+  __m128 mask     = _mm_castsi128_ps(outside);
+  return mGetDtwMinimum4(_mm_or_ps(_mm_andnot_ps(mask, cells), _mm_and_ps(mask, _mm_set1_ps(DTW_INFINITY))));
+}
+
+static __inline float mGetDtwSum4(__m128 values)
+{
+  values = _mm_add_ps(values, _mm_shuffle_ps(values, values, _MM_SHUFFLE(1, 0, 3, 2)));
+  values = _mm_add_ps(values, _mm_shuffle_ps(values, values, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtss_f32(values);
+}
+
+// 4 cells of an anti-diagonal starting at reference point referenceIdx
+static __inline __m128 mComputeDtwCells4(const DTW_PARAMETERS* parameters, const float* reversedQuery, const float* reference, int referenceIdx, int queryOffset, const float* previous, const float* secondPrevious, float* current)
+{
+  unsigned int numPoints = parameters->NumPoints;
+  __m128 cost            = _mm_setzero_ps();
+
+  for (unsigned int channelIdx = 0; channelIdx < parameters->NumChannels; channelIdx++)
+  {
+    __m128 difference = _mm_sub_ps(_mm_loadu_ps(reference + (channelIdx * numPoints) + referenceIdx), _mm_loadu_ps(reversedQuery + (channelIdx * numPoints) + referenceIdx + queryOffset));
+    cost              = _mm_add_ps(cost, _mm_mul_ps(_mm_set1_ps(parameters->Weights[channelIdx]), _mm_mul_ps(difference, difference)));
+  }
+
+  // up (i - 1, j), left (i, j - 1) and diagonal (i - 1, j - 1), the buffers are offset by one
+  __m128 best  = _mm_min_ps(_mm_loadu_ps(previous + referenceIdx + 1), _mm_min_ps(_mm_loadu_ps(previous + referenceIdx), _mm_loadu_ps(secondPrevious + referenceIdx)));
+  __m128 cells = _mm_add_ps(cost, best);
+  _mm_storeu_ps(current + referenceIdx + 1, cells);
+
+  return cells;
+}
+#endif
+
+#if defined(DTW_USE_AVX2)
+static __inline __m256 mComputeDtwCells8(const DTW_PARAMETERS* parameters, const float* reversedQuery, const float* reference, int referenceIdx, int queryOffset, const float* previous, const float* secondPrevious, float* current)
+{
+  unsigned int numPoints = parameters->NumPoints;
+  __m256 cost            = _mm256_setzero_ps();
+
+  for (unsigned int channelIdx = 0; channelIdx < parameters->NumChannels; channelIdx++)
+  {
+    __m256 difference = _mm256_sub_ps(_mm256_loadu_ps(reference + (channelIdx * numPoints) + referenceIdx), _mm256_loadu_ps(reversedQuery + (channelIdx * numPoints) + referenceIdx + queryOffset));
+    cost              = _mm256_add_ps(cost, _mm256_mul_ps(_mm256_set1_ps(parameters->Weights[channelIdx]), _mm256_mul_ps(difference, difference)));
+  }
+
+  __m256 best  = _mm256_min_ps(_mm256_loadu_ps(previous + referenceIdx + 1), _mm256_min_ps(_mm256_loadu_ps(previous + referenceIdx), _mm256_loadu_ps(secondPrevious + referenceIdx)));
+  __m256 cells = _mm256_add_ps(cost, best);
+  _mm256_storeu_ps(current + referenceIdx + 1, cells);
+
+  return cells;
+}
+#endif
+
+#if defined(DTW_USE_NEON)
+static __inline float32x4_t mComputeDtwCells4(const DTW_PARAMETERS* parameters, const float* reversedQuery, const float* reference, int referenceIdx, int queryOffset, const float* previous, const float* secondPrevious, float* current)
+{
+  unsigned int numPoints = parameters->NumPoints;
+  float32x4_t cost       = vdupq_n_f32(0.0f);
+
+  for (unsigned int channelIdx = 0; channelIdx < parameters->NumChannels; channelIdx++)
+  {
+    float32x4_t difference = vsubq_f32(vld1q_f32(reference + (channelIdx * numPoints) + referenceIdx), vld1q_f32(reversedQuery + (channelIdx * numPoints) + referenceIdx + queryOffset));
+    cost                   = vaddq_f32(cost, vmulq_f32(vdupq_n_f32(parameters->Weights[channelIdx]), vmulq_f32(difference, difference)));
+  }
+
+  float32x4_t best  = vminq_f32(vld1q_f32(previous + referenceIdx + 1), vminq_f32(vld1q_f32(previous + referenceIdx), vld1q_f32(secondPrevious + referenceIdx)));
+  float32x4_t cells = vaddq_f32(cost, best);
+  vst1q_f32(current + referenceIdx + 1, cells);
+
+  return cells;
+}
+
+static __inline float mGetDtwBandMinimum4(float32x4_t cells, int start, int first, int last)
+{
+  const int laneOffsets[4] = {0, 1, 2, 3};
+  int32x4_t indices        = vaddq_s32(vdupq_n_s32(start), vld1q_s32(laneOffsets));
+  uint32x4_t inside        = vandq_u32(vcgeq_s32(indices, vdupq_n_s32(first)), vcleq_s32(indices, vdupq_n_s32(last)));
+  return vminvq_f32(vbslq_f32(inside, cells, vdupq_n_f32(DTW_INFINITY)));
+}
+#endif
+
+// Cell (i, j) of the cost matrix is on anti-diagonal d = i + j. Its three
+// predecessors are on the two previous anti-diagonals, so every cell of an
+// anti-diagonal can be computed at the same time. The anti-diagonals are
+// indexed by the reference point j (shifted by one so that j = -1 is a valid
+// index), the query point i = d - j is point n - 1 - d + j of the reversed query.
+float mGetDtwDistance(const DTW_PARAMETERS* parameters, const float* reversedQuery, const float* reference, float bound)
+{
+  int numPoints = (int)parameters->NumPoints;
+  int window    = (int)parameters->Window;
+  float diagonals[3][DTW_MAX_POINTS + 2];
+
+  for (unsigned int diagonalIdx = 0; diagonalIdx < 3; diagonalIdx++)
+  {
+    for (int pointIdx = 0; pointIdx < (numPoints + 2); pointIdx++)
+    {
+      diagonals[diagonalIdx][pointIdx] = DTW_INFINITY;
+    }
+  }
+
+  // D(-1, -1) = 0 on anti-diagonal -2 starts every path in the corner
+  diagonals[1][0]       = 0.0f;
+  float previousMinimum = DTW_INFINITY;
+  int lastDiagonal      = (2 * numPoints) - 2;
+
+  for (int diagonal = 0; diagonal <= lastDiagonal; diagonal++)
+  {
+    float* current              = diagonals[diagonal % 3];
+    const float* previous       = diagonals[(diagonal + 2) % 3];
+    const float* secondPrevious = diagonals[(diagonal + 1) % 3];
+
+    // the cells with |i - j| <= window and 0 <= i, j < n
+    int first       = (diagonal > window) ? ((diagonal - window + 1) / 2) : 0;
+    int last        = (diagonal + window) / 2;
+    int queryOffset = numPoints - 1 - diagonal;
+    first           = ((diagonal - numPoints + 1) > first) ? (diagonal - numPoints + 1) : first;
+    last            = (last > diagonal) ? diagonal : last;
+    last            = (last > (numPoints - 1)) ? (numPoints - 1) : last;
+
+    float minimum    = DTW_INFINITY;
+    int referenceIdx = first;
+#if defined(DTW_USE_AVX2)
+    __m256 minimum8 = _mm256_set1_ps(DTW_INFINITY);
+    for (; (referenceIdx + 8) <= (last + 1); referenceIdx += 8)
+    {
+      minimum8 = _mm256_min_ps(minimum8, mComputeDtwCells8(parameters, reversedQuery, reference, referenceIdx, queryOffset, previous, secondPrevious, current));
+    }
+    minimum = mGetDtwMinimum4(_mm_min_ps(_mm256_castps256_ps128(minimum8), _mm256_extractf128_ps(minimum8, 1)));
+#endif
+#if defined(DTW_USE_SSE2) || defined(DTW_USE_AVX2)
+    for (; (referenceIdx + 4) <= (last + 1); referenceIdx += 4)
+    {
+      float cellMinimum = mGetDtwMinimum4(mComputeDtwCells4(parameters, reversedQuery, reference, referenceIdx, queryOffset, previous, secondPrevious, current));
+      minimum           = (cellMinimum < minimum) ? cellMinimum : minimum;
+    }
+#elif defined(DTW_USE_NEON)
+    for (; (referenceIdx + 4) <= (last + 1); referenceIdx += 4)
+    {
+      float cellMinimum = vminvq_f32(mComputeDtwCells4(parameters, reversedQuery, reference, referenceIdx, queryOffset, previous, secondPrevious, current));
+      minimum           = (cellMinimum < minimum) ? cellMinimum : minimum;
+    }
+#endif
+#if defined(DTW_USE_SSE2) || defined(DTW_USE_AVX2) || defined(DTW_USE_NEON)
+    // The last 1 to 3 cells (most of a narrow band) go into one more vector
+    // that ends at the last cell or starts at the first column of the matrix.
+    // It computes some cells again or outside of the band, the next two
+    // anti-diagonals never read them except for the two neighbors that are reset
+    // below.
+    int lowestStart  = ((diagonal - numPoints + 1) > 0) ? (diagonal - numPoints + 1) : 0;
+    int highestStart = ((diagonal < (numPoints - 1)) ? diagonal : (numPoints - 1)) - 3;
+    int tailStart    = ((last - 3) > lowestStart) ? (last - 3) : lowestStart;
+    if ((referenceIdx <= last) && (tailStart <= highestStart))
+    {
+      float cellMinimum = mGetDtwBandMinimum4(mComputeDtwCells4(parameters, reversedQuery, reference, tailStart, queryOffset, previous, secondPrevious, current), tailStart, first, last);
+      minimum           = (cellMinimum < minimum) ? cellMinimum : minimum;
+      referenceIdx      = last + 1;
+    }
+#endif
+    for (; referenceIdx <= last; referenceIdx++)
+    {
+      float best = previous[referenceIdx + 1];
+      best       = (previous[referenceIdx] < best) ? previous[referenceIdx] : best;
+      best       = (secondPrevious[referenceIdx] < best) ? secondPrevious[referenceIdx] : best;
+
+      float cell                = mGetDtwPointDistance(parameters, reference, referenceIdx, reversedQuery, referenceIdx + queryOffset) + best;
+      current[referenceIdx + 1] = cell;
+      minimum                   = (cell < minimum) ? cell : minimum;
+    }
+
+    // the neighbors of the band are read by the next two anti-diagonals
+    current[first]    = DTW_INFINITY;
+    current[last + 2] = DTW_INFINITY;
+
+    // a path visits at least one of two consecutive anti-diagonals and the costs are not negative
+    float pathMinimum = (minimum < previousMinimum) ? minimum : previousMinimum;
+    if (pathMinimum >= bound)
+    {
+      return pathMinimum;
+    }
+
+    previousMinimum = minimum;
+  }
+
+  return diagonals[lastDiagonal % 3][numPoints];
+}
+
+float mGetReferenceDtwDistance(const DTW_PARAMETERS* parameters, const float* query, const float* reference)
+{
+  int numPoints = (int)parameters->NumPoints;
+  int window    = (int)parameters->Window;
+  float previousRow[DTW_MAX_POINTS];
+  float currentRow[DTW_MAX_POINTS];
+
+  for (int queryIdx = 0; queryIdx < numPoints; queryIdx++)
+  {
+    int first = (queryIdx > window) ? (queryIdx - window) : 0;
+    int last  = ((queryIdx + window) < numPoints) ? (queryIdx + window) : (numPoints - 1);
+
+    for (int referenceIdx = 0; referenceIdx < numPoints; referenceIdx++)
+    {
+      currentRow[referenceIdx] = DTW_INFINITY;
+    }
+
+    for (int referenceIdx = first; referenceIdx <= last; referenceIdx++)
+    {
+      float best = 0.0f;
+      if ((queryIdx != 0) || (referenceIdx != 0))
+      {
+        best = DTW_INFINITY;
+        if (queryIdx > 0)
+        {
+          best = (previousRow[referenceIdx] < best) ? previousRow[referenceIdx] : best;
+        }
+
+        if (referenceIdx > 0)
+        {
+          best = (currentRow[referenceIdx - 1] < best) ? currentRow[referenceIdx - 1] : best;
+        }
+
+        if ((queryIdx > 0) && (referenceIdx > 0))
+        {
+          best = (previousRow[referenceIdx - 1] < best) ? previousRow[referenceIdx - 1] : best;
+        }
+      }
+
+      currentRow[referenceIdx] = mGetDtwPointDistance(parameters, reference, referenceIdx, query, queryIdx) + best;
+    }
+
+    memcpy(previousRow, currentRow, sizeof(float) * numPoints);
+  }
+
+  return previousRow[numPoints - 1];
+}
+
+void mGetDtwEnvelope(const DTW_PARAMETERS* parameters, const float* sequence, float* lower, float* upper)
+{
+  int numPoints = (int)parameters->NumPoints;
+  int window    = (int)parameters->Window;
+
+  for (unsigned int channelIdx = 0; channelIdx < parameters->NumChannels; channelIdx++)
+  {
+    const float* channel = sequence + (channelIdx * numPoints);
+
+    for (int pointIdx = 0; pointIdx < numPoints; pointIdx++)
+    {
+      int first     = (pointIdx > window) ? (pointIdx - window) : 0;
+      int last      = ((pointIdx + window) < numPoints) ? (pointIdx + window) : (numPoints - 1);
+      float minimum = channel[first];
+      float maximum = channel[first];
+
+      for (int neighborIdx = first + 1; neighborIdx <= last; neighborIdx++)
+      {
+        minimum = (channel[neighborIdx] < minimum) ? channel[neighborIdx] : minimum;
+        maximum = (channel[neighborIdx] > maximum) ? channel[neighborIdx] : maximum;
+      }
+
+      lower[(channelIdx * numPoints) + pointIdx] = minimum;
+      upper[(channelIdx * numPoints) + pointIdx] = maximum;
+    }
+  }
+}
+
+float mGetLbKeoghDistance(const DTW_PARAMETERS* parameters, const float* lower, const float* upper, const float* sequence, float bound)
+{
+  unsigned int numPoints = parameters->NumPoints;
+  float distance         = 0.0f;
+
+  for (unsigned int channelIdx = 0; channelIdx < parameters->NumChannels; channelIdx++)
+  {
+    unsigned int offset   = channelIdx * numPoints;
+    unsigned int pointIdx = 0;
+    float channelDistance = 0.0f;
+
+    if (parameters->Weights[channelIdx] == 0.0f)
+    {
+      continue;
+    }
+
+#if defined(DTW_USE_SSE2) || defined(DTW_USE_AVX2)
+    __m128 sum4 = _mm_setzero_ps();
+    for (; (pointIdx + 4) <= numPoints; pointIdx += 4)
+    {
+      __m128 value   = _mm_loadu_ps(sequence + offset + pointIdx);
+      __m128 above   = _mm_max_ps(_mm_sub_ps(value, _mm_loadu_ps(upper + offset + pointIdx)), _mm_setzero_ps());
+      __m128 below   = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(lower + offset + pointIdx), value), _mm_setzero_ps());
+      __m128 outside = _mm_add_ps(above, below);
+      sum4           = _mm_add_ps(sum4, _mm_mul_ps(outside, outside));
+    }
+    channelDistance = mGetDtwSum4(sum4);
+#elif defined(DTW_USE_NEON)
+    float32x4_t sum4 = vdupq_n_f32(0.0f);
+    for (; (pointIdx + 4) <= numPoints; pointIdx += 4)
+    {
+      float32x4_t value   = vld1q_f32(sequence + offset + pointIdx);
+      float32x4_t above   = vmaxq_f32(vsubq_f32(value, vld1q_f32(upper + offset + pointIdx)), vdupq_n_f32(0.0f));
+      float32x4_t below   = vmaxq_f32(vsubq_f32(vld1q_f32(lower + offset + pointIdx), value), vdupq_n_f32(0.0f));
+      float32x4_t outside = vaddq_f32(above, below);
+      sum4                = vaddq_f32(sum4, vmulq_f32(outside, outside));
+    }
+    channelDistance = vaddvq_f32(sum4);
+#endif
+    for (; pointIdx < numPoints; pointIdx++)
+    {
+      float value   = sequence[offset + pointIdx];
+      float outside = 0.0f;
+      if (value > upper[offset + pointIdx])
+      {
+        outside = value - upper[offset + pointIdx];
+      }
+      else if (value < lower[offset + pointIdx])
+      {
+        outside = lower[offset + pointIdx] - value;
+      }
+
+      channelDistance += outside * outside;
+    }
+
+    distance += parameters->Weights[channelIdx] * channelDistance;
+    if (distance >= bound)
+    {
+      return distance;
+    }
+  }
+
+  return distance;
+}
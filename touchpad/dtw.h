@@ -0,0 +1,42 @@
+#ifndef __DTW_H__
+#define __DTW_H__
+#include "platform.h"
+
+// Dynamic time warping of two sequences of the same length inside a
+// Sakoe-Chiba band. A sequence is stored as NumChannels planes of NumPoints
+// floats (channel c of point i is at [c * NumPoints + i]) so that consecutive
+// points can be loaded into one SIMD register. The distance of two points is
+// the weighted sum of the squared differences of their channels.
+#define DTW_MAX_POINTS   64
+#define DTW_MAX_CHANNELS 8
+
+struct DTW_PARAMETERS
+{
+  unsigned int NumPoints;
+  unsigned int NumChannels;
+  // point i of one sequence is only matched with points i - Window .. i + Window of the other
+  unsigned int Window;
+  float Weights[DTW_MAX_CHANNELS];
+};
+
+typedef struct DTW_PARAMETERS DTW_PARAMETERS;
+
+// "AVX2", "SSE2", "NEON" or "scalar", picked at compile time (define DTW_DISABLE_SIMD for the scalar kernel)
+const char* mGetDtwKernelName();
+// point i of the reversed sequence is point NumPoints - 1 - i of the sequence
+void mReverseDtwSequence(const DTW_PARAMETERS* parameters, const float* sequence, float* reversed);
+// The kernel walks the anti-diagonals of the cost matrix, the query must be
+// reversed with mReverseDtwSequence so that the cells of an anti-diagonal are
+// consecutive in both sequences. Returns a value >= bound as soon as the
+// distance cannot be below bound anymore (FLT_MAX never abandons).
+float mGetDtwDistance(const DTW_PARAMETERS* parameters, const float* reversedQuery, const float* reference, float bound);
+// Straightforward row by row implementation of mGetDtwDistance without early abandoning.
+float mGetReferenceDtwDistance(const DTW_PARAMETERS* parameters, const float* query, const float* reference);
+// The lower and upper envelope of a sequence: the smallest and the largest value
+// of each channel among the points i - Window .. i + Window.
+void mGetDtwEnvelope(const DTW_PARAMETERS* parameters, const float* sequence, float* lower, float* upper);
+// LB_Keogh: the distance of every point of the sequence to the envelope of the
+// other sequence is a lower bound of their DTW distance. Returns a value >=
+// bound as soon as the sum reaches it.
+float mGetLbKeoghDistance(const DTW_PARAMETERS* parameters, const float* lower, const float* upper, const float* sequence, float bound);
+#endif  // __DTW_H__
@@ -0,0 +1,228 @@
+#include "platform.h"
+
+#include "editlog.h"
+
+#include "utils.h"
+
+#define STROKE_EDIT_LOG_MIN_CAPACITY 64
+
+void mInitializeStrokeEditLog(STROKE_EDIT_LOG* log, unsigned int maxEdits)
+{
+  memset(log, 0, sizeof(STROKE_EDIT_LOG));
+  log->MaxEdits = (maxEdits == 0) ? STROKE_EDIT_LOG_DEFAULT_MAX_EDITS : maxEdits;
+  // compaction keeps half of the edits
+  log->MaxEdits = (log->MaxEdits < 2) ? 2 : log->MaxEdits;
+}
+
+void mFreeStrokeEditLog(STROKE_EDIT_LOG* log)
+{
+  free(log->Edits);
+  memset(log, 0, sizeof(STROKE_EDIT_LOG));
+}
+
+static void mApplyStrokeEdit(const STROKE_EDIT* edit, unsigned int* firstVisibleStroke, unsigned int* endVisibleStroke)
+{
+  if (edit->Type == STROKE_EDIT_ADD_STROKE)
+  {
+    (*endVisibleStroke) = edit->StrokeIdx + 1;
+  }
+  else
+  {
+    (*firstVisibleStroke) = (*endVisibleStroke);
+  }
+}
+
+// Fold the oldest edits into the base state and drop the strokes that no
+// remaining edit can show again.
+static void mCompactStrokeEditLog(STROKE_EDIT_LOG* log, StrokeList* strokes)
+{
+  unsigned int numFolded = log->NumEdits - (log->MaxEdits / 2);
+  // undone edits are kept for redo
+  numFolded = (numFolded > log->NumApplied) ? log->NumApplied : numFolded;
+
+  for (unsigned int editIdx = 0; editIdx < numFolded; editIdx++)
+  {
+    mApplyStrokeEdit(&log->Edits[editIdx], &log->BaseFirstVisibleStroke, &log->BaseEndVisibleStroke);
+  }
+
+  memmove(log->Edits, log->Edits + numFolded, sizeof(STROKE_EDIT) * (log->NumEdits - numFolded));
+  log->NumEdits -= numFolded;
+  log->NumApplied -= numFolded;
+
+  // the visible range never starts before the base one
+  unsigned int numRemoved = log->BaseFirstVisibleStroke;
+  if (numRemoved != 0)
+  {
+    mRemoveFirstStrokes(strokes, numRemoved);
+
+    for (unsigned int editIdx = 0; editIdx < log->NumEdits; editIdx++)
+    {
+      log->Edits[editIdx].StrokeIdx -= numRemoved;
+    }
+
+    log->BaseFirstVisibleStroke -= numRemoved;
+    log->BaseEndVisibleStroke -= numRemoved;
+    log->FirstVisibleStroke -= numRemoved;
+    log->EndVisibleStroke -= numRemoved;
+    log->Generation++;
+  }
+
+  log->NumCompactions++;
+}
+
+static void mAppendStrokeEdit(STROKE_EDIT_LOG* log, StrokeList* strokes, const STROKE_EDIT* edit)
+{
+  // a new edit drops the ones that could be redone
+  log->NumEdits = log->NumApplied;
+
+  if (log->NumEdits == log->Capacity)
+  {
+    unsigned int newCapacity = log->Capacity * 2;
+    if (newCapacity < STROKE_EDIT_LOG_MIN_CAPACITY)
+    {
+      newCapacity = STROKE_EDIT_LOG_MIN_CAPACITY;
+    }
+
+    log->Edits    = (STROKE_EDIT*)mRealloc(log->Edits, sizeof(STROKE_EDIT) * newCapacity, __FILE__, __LINE__);
+    log->Capacity = newCapacity;
+  }
+
+  log->Edits[log->NumEdits] = (*edit);
+  log->NumEdits++;
+  log->NumApplied++;
+
+  if (log->NumEdits > log->MaxEdits)
+  {
+    mCompactStrokeEditLog(log, strokes);
+  }
+}
+
+void mRecordNewStroke(STROKE_EDIT_LOG* log, StrokeList* strokes)
+{
+  if (strokes->Size == 0)
+  {
+    return;
+  }
+
+  // The strokes that could be redone are between the visible ones and the new
+  // one, the new stroke (only its first point so far) takes their place.
+  if ((strokes->Size - 1) > log->EndVisibleStroke)
+  {
+    StrokeIndexEntry stroke = strokes->Entries[strokes->Size - 1];
+    Point2D firstPoint      = strokes->Points.Entries[stroke.Offset];
+
+    mTruncateStrokeList(strokes, log->EndVisibleStroke);
+    mCreateNewStroke(firstPoint, strokes);
+
+    strokes->Entries[strokes->Size - 1].StartTimestamp = stroke.StartTimestamp;
+    strokes->Entries[strokes->Size - 1].EndTimestamp   = stroke.EndTimestamp;
+  }
+
+  STROKE_EDIT edit;
+  memset(&edit, 0, sizeof(STROKE_EDIT));
+  edit.Type      = STROKE_EDIT_ADD_STROKE;
+  edit.StrokeIdx = strokes->Size - 1;
+
+  log->EndVisibleStroke = strokes->Size;
+  mAppendStrokeEdit(log, strokes, &edit);
+}
+
+int mRecordClear(STROKE_EDIT_LOG* log, StrokeList* strokes)
+{
+  if (log->FirstVisibleStroke == log->EndVisibleStroke)
+  {
+    return -1;
+  }
+
+  mTruncateStrokeList(strokes, log->EndVisibleStroke);
+
+  STROKE_EDIT edit;
+  edit.Type          = STROKE_EDIT_CLEAR;
+  edit.StrokeIdx     = log->FirstVisibleStroke;
+  edit.Bounds.left   = (LONG)strokes->Entries[log->FirstVisibleStroke].MinX;
+  edit.Bounds.top    = (LONG)strokes->Entries[log->FirstVisibleStroke].MinY;
+  edit.Bounds.right  = (LONG)strokes->Entries[log->FirstVisibleStroke].MaxX;
+  edit.Bounds.bottom = (LONG)strokes->Entries[log->FirstVisibleStroke].MaxY;
+
+  for (unsigned int strokeIdx = log->FirstVisibleStroke + 1; strokeIdx < log->EndVisibleStroke; strokeIdx++)
+  {
+    const StrokeIndexEntry* stroke = &strokes->Entries[strokeIdx];
+    edit.Bounds.left               = ((LONG)stroke->MinX < edit.Bounds.left) ? (LONG)stroke->MinX : edit.Bounds.left;
+    edit.Bounds.top                = ((LONG)stroke->MinY < edit.Bounds.top) ? (LONG)stroke->MinY : edit.Bounds.top;
+    edit.Bounds.right              = ((LONG)stroke->MaxX > edit.Bounds.right) ? (LONG)stroke->MaxX : edit.Bounds.right;
+    edit.Bounds.bottom             = ((LONG)stroke->MaxY > edit.Bounds.bottom) ? (LONG)stroke->MaxY : edit.Bounds.bottom;
+  }
+
+  log->FirstVisibleStroke = log->EndVisibleStroke;
+  log->Generation++;
+  mAppendStrokeEdit(log, strokes, &edit);
+
+  return 0;
+}
+
+static void mGetStrokeEditBounds(const STROKE_EDIT* edit, const StrokeList* strokes, RECT* changedBounds)
+{
+  if (edit->Type == STROKE_EDIT_ADD_STROKE)
+  {
+    const StrokeIndexEntry* stroke = &strokes->Entries[edit->StrokeIdx];
+    changedBounds->left            = (LONG)stroke->MinX;
+    changedBounds->top             = (LONG)stroke->MinY;
+    changedBounds->right           = (LONG)stroke->MaxX;
+    changedBounds->bottom          = (LONG)stroke->MaxY;
+  }
+  else
+  {
+    (*changedBounds) = edit->Bounds;
+  }
+}
+
+int mUndoStrokeEdit(STROKE_EDIT_LOG* log, const StrokeList* strokes, RECT* changedBounds)
+{
+  if (log->NumApplied == 0)
+  {
+    return -1;
+  }
+
+  const STROKE_EDIT* edit = &log->Edits[log->NumApplied - 1];
+  if (edit->Type == STROKE_EDIT_ADD_STROKE)
+  {
+    log->EndVisibleStroke = edit->StrokeIdx;
+  }
+  else
+  {
+    log->FirstVisibleStroke = edit->StrokeIdx;
+  }
+
+  mGetStrokeEditBounds(edit, strokes, changedBounds);
+  log->NumApplied--;
+  log->Generation++;
+
+  return 0;
+}
+
+int mRedoStrokeEdit(STROKE_EDIT_LOG* log, const StrokeList* strokes, RECT* changedBounds)
+{
+  if (log->NumApplied == log->NumEdits)
+  {
+    return -1;
+  }
+
+  const STROKE_EDIT* edit = &log->Edits[log->NumApplied];
+  mApplyStrokeEdit(edit, &log->FirstVisibleStroke, &log->EndVisibleStroke);
+
+  mGetStrokeEditBounds(edit, strokes, changedBounds);
+  log->NumApplied++;
+  log->Generation++;
+
+  return 0;
+}
+
+void mGetVisibleStrokes(const STROKE_EDIT_LOG* log, const StrokeList* strokes, StrokeList* view)
+{
+  (*view)          = (*strokes);
+  view->Entries    = strokes->Entries + log->FirstVisibleStroke;
+  view->Size       = log->EndVisibleStroke - log->FirstVisibleStroke;
+  view->Capacity   = view->Size;
+  // both only go up, so the sum changes whenever either does
+  view->Generation = strokes->Generation + log->Generation;
+}
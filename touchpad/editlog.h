@@ -0,0 +1,76 @@
+#ifndef __EDITLOG_H__
+#define __EDITLOG_H__
+#include "platform.h"
+
+#include "stroke.h"
+
+// STROKE_EDIT.Type
+#define STROKE_EDIT_ADD_STROKE 1
+#define STROKE_EDIT_CLEAR      2
+
+// the edits that are kept for undo when the log is created with 0
+#define STROKE_EDIT_LOG_DEFAULT_MAX_EDITS 1024
+
+struct STROKE_EDIT
+{
+  unsigned int Type;
+  // STROKE_EDIT_ADD_STROKE: the stroke that was added
+  // STROKE_EDIT_CLEAR: the first visible stroke before the clear
+  unsigned int StrokeIdx;
+  // STROKE_EDIT_CLEAR: inclusive bounding box of the strokes that it hid
+  RECT Bounds;
+};
+
+typedef struct STROKE_EDIT STROKE_EDIT;
+
+// An append-only log of the edits of a StrokeList for undo and redo.
+//
+// Strokes are never freed by an edit: the visible strokes are always the
+// range [FirstVisibleStroke, EndVisibleStroke) of the list, a clear moves
+// FirstVisibleStroke to the end and undoing a stroke moves EndVisibleStroke
+// back by one, so undo and redo only move one end of the range. The strokes
+// after EndVisibleStroke are the ones that can be redone, they are dropped
+// from the list when a new edit is recorded.
+//
+// When the log holds more than MaxEdits edits the oldest half is folded into
+// the base state and the strokes that it left hidden for good are removed from
+// the list (mRemoveFirstStrokes), so a long session keeps a bounded history.
+struct STROKE_EDIT_LOG
+{
+  STROKE_EDIT* Edits;
+  unsigned int NumEdits;
+  unsigned int Capacity;
+  unsigned int MaxEdits;
+  // the edits [0, NumApplied) are applied, the others have been undone
+  unsigned int NumApplied;
+  // the visible range before the first edit of the log
+  unsigned int BaseFirstVisibleStroke;
+  unsigned int BaseEndVisibleStroke;
+  unsigned int FirstVisibleStroke;
+  unsigned int EndVisibleStroke;
+  // incremented whenever the visible strokes change other than by growing
+  unsigned int Generation;
+  unsigned int NumCompactions;
+};
+
+typedef struct STROKE_EDIT_LOG STROKE_EDIT_LOG;
+
+// maxEdits 0 is STROKE_EDIT_LOG_DEFAULT_MAX_EDITS
+void mInitializeStrokeEditLog(STROKE_EDIT_LOG* log, unsigned int maxEdits);
+void mFreeStrokeEditLog(STROKE_EDIT_LOG* log);
+// Record the stroke that mAddTouchEventToStrokes just started (it returned
+// STROKE_EVENT_NEW_STROKE) as the last stroke of the list. The strokes that
+// could be redone are removed from the list.
+void mRecordNewStroke(STROKE_EDIT_LOG* log, StrokeList* strokes);
+// Hide the visible strokes, returns -1 if there are none (nothing is recorded).
+int mRecordClear(STROKE_EDIT_LOG* log, StrokeList* strokes);
+// Undo or redo one edit. Returns -1 if there is none, otherwise the inclusive
+// bounding box of the points that appeared or disappeared (see mRedrawCanvasRect).
+int mUndoStrokeEdit(STROKE_EDIT_LOG* log, const StrokeList* strokes, RECT* changedBounds);
+int mRedoStrokeEdit(STROKE_EDIT_LOG* log, const StrokeList* strokes, RECT* changedBounds);
+// Fill view with the visible strokes of the list. The view shares the memory
+// of the list and stays valid until the next edit or stroke event; it is only
+// read (canvas, resampler, export) and never appended to or freed. Its
+// Generation changes whenever the visible strokes change other than by growing.
+void mGetVisibleStrokes(const STROKE_EDIT_LOG* log, const StrokeList* strokes, StrokeList* view);
+#endif  // __EDITLOG_H__
@@ -0,0 +1,192 @@
+#include "platform.h"
+
+#include <stdio.h>
+
+#include "eventlog.h"
+
+#include "utils.h"
+#include "termcolor.h"
+
+#define EVENT_LOG_DRAIN_BATCH_SIZE 1024
+
+// Move the records of every ring to the file, returns the number of records.
+static unsigned long long mDrainEventLog(EVENT_LOG* log)
+{
+  unsigned long long numRecords = 0;
+
+  for (unsigned int writerIdx = 0; writerIdx < log->NumWriters; writerIdx++)
+  {
+    EVENT_LOG_WRITER* writer = &log->Writers[writerIdx];
+
+    // at most one ring of records so that a busy writer cannot keep us on its ring
+    unsigned int numPopped;
+    unsigned int numLeft = writer->Ring.Capacity;
+    while ((numLeft != 0) && ((numPopped = mPopFromSpscRing(&writer->Ring, log->DrainBuffer, EVENT_LOG_DRAIN_BATCH_SIZE)) != 0))
+    {
+      fwrite(log->DrainBuffer, sizeof(EVENT_LOG_RECORD), numPopped, log->File);
+      numRecords += numPopped;
+      numLeft = (numPopped < numLeft) ? (numLeft - numPopped) : 0;
+    }
+
+    unsigned int numDropped = mAtomicLoadAcquire(&writer->NumDroppedRecords);
+    if (numDropped != writer->NumReportedDrops)
+    {
+      // the drops are logged after the records that did fit
+      EVENT_LOG_RECORD record;
+      memset(&record, 0, sizeof(EVENT_LOG_RECORD));
+      record.Timestamp = mGetTimestamp();
+      record.EventId   = EVENT_LOG_RECORDS_DROPPED;
+      record.WriterIdx = (unsigned short)writerIdx;
+      record.Args[0]   = writerIdx;
+      record.Args[1]   = numDropped - writer->NumReportedDrops;
+      record.Args[2]   = numDropped;
+
+      fwrite(&record, sizeof(EVENT_LOG_RECORD), 1, log->File);
+      numRecords++;
+
+      writer->NumReportedDrops = numDropped;
+    }
+  }
+
+  if (numRecords != 0)
+  {
+    fflush(log->File);
+  }
+
+  return numRecords;
+}
+
+static void mEventLogDrainThread(void* arg)
+{
+  EVENT_LOG* log = (EVENT_LOG*)arg;
+
+  while (1)
+  {
+    mLockThreadMutex(&log->Mutex);
+
+    int isStopping = log->IsStopping;
+    if (!isStopping)
+    {
+      mWaitThreadCondition(&log->StopCondition, &log->Mutex, EVENT_LOG_DRAIN_INTERVAL_MS);
+      isStopping = log->IsStopping;
+    }
+
+    mUnlockThreadMutex(&log->Mutex);
+
+    // the writers do not wait for the mutex, the rings are drained without it
+    log->NumWrittenRecords += mDrainEventLog(log);
+
+    if (isStopping)
+    {
+      // drain again, the rings may have held more than one pass took
+      while (mDrainEventLog(log) != 0)
+      {
+      }
+
+      break;
+    }
+  }
+}
+
+int mOpenEventLog(const char* filePath, unsigned int numWriters, unsigned int ringCapacity, EVENT_LOG* log)
+{
+  memset(log, 0, sizeof(EVENT_LOG));
+
+  if ((numWriters == 0) || (numWriters > EVENT_LOG_MAX_WRITERS))
+  {
+    printf(FG_RED);
+    printf("Invalid number of event log writers at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  log->File = fopen(filePath, "wb");
+  if (log->File == NULL)
+  {
+    printf(FG_RED);
+    printf("Failed to create the event log file %s at %s:%d\n", filePath, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  EVENT_LOG_FILE_HEADER fileHeader;
+  memset(&fileHeader, 0, sizeof(EVENT_LOG_FILE_HEADER));
+  fileHeader.Magic              = EVENT_LOG_MAGIC;
+  fileHeader.Version            = EVENT_LOG_VERSION;
+  fileHeader.cbFileHeader       = sizeof(EVENT_LOG_FILE_HEADER);
+  fileHeader.cbRecord           = sizeof(EVENT_LOG_RECORD);
+  fileHeader.TimestampFrequency = mGetTimestampFrequency();
+  fileHeader.StartTimestamp     = mGetTimestamp();
+
+  fwrite(&fileHeader, 1, sizeof(EVENT_LOG_FILE_HEADER), log->File);
+
+  ringCapacity = (ringCapacity == 0) ? EVENT_LOG_DEFAULT_RING_CAPACITY : ringCapacity;
+
+  for (unsigned int writerIdx = 0; writerIdx < numWriters; writerIdx++)
+  {
+    mInitializeSpscRing(&log->Writers[writerIdx].Ring, sizeof(EVENT_LOG_RECORD), ringCapacity);
+    log->Writers[writerIdx].WriterIdx = writerIdx;
+  }
+
+  log->NumWriters  = numWriters;
+  log->DrainBuffer = (EVENT_LOG_RECORD*)mMalloc(sizeof(EVENT_LOG_RECORD) * EVENT_LOG_DRAIN_BATCH_SIZE, __FILE__, __LINE__);
+
+  mInitializeThreadMutex(&log->Mutex);
+  mInitializeThreadCondition(&log->StopCondition);
+
+  if (mCreateThread(&log->DrainThread, mEventLogDrainThread, log) != 0)
+  {
+    printf(FG_RED);
+    printf("Failed to start the event log drain thread at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+
+    mDestroyThreadCondition(&log->StopCondition);
+    mDestroyThreadMutex(&log->Mutex);
+    for (unsigned int writerIdx = 0; writerIdx < numWriters; writerIdx++)
+    {
+      mFreeSpscRing(&log->Writers[writerIdx].Ring);
+    }
+    free(log->DrainBuffer);
+    fclose(log->File);
+    memset(log, 0, sizeof(EVENT_LOG));
+    return -1;
+  }
+
+  return 0;
+}
+
+void mCloseEventLog(EVENT_LOG* log)
+{
+  if (log->File == NULL)
+  {
+    return;
+  }
+
+  mLockThreadMutex(&log->Mutex);
+  log->IsStopping = 1;
+  mSignalThreadCondition(&log->StopCondition);
+  mUnlockThreadMutex(&log->Mutex);
+
+  mJoinThread(&log->DrainThread);
+
+  unsigned long long numDroppedRecords = 0;
+  for (unsigned int writerIdx = 0; writerIdx < log->NumWriters; writerIdx++)
+  {
+    numDroppedRecords += log->Writers[writerIdx].NumDroppedRecords;
+    mFreeSpscRing(&log->Writers[writerIdx].Ring);
+  }
+
+  if (numDroppedRecords != 0)
+  {
+    printf(FG_YELLOW);
+    printf("The event log dropped %llu records\n", numDroppedRecords);
+    printf(RESET_COLOR);
+  }
+
+  mDestroyThreadCondition(&log->StopCondition);
+  mDestroyThreadMutex(&log->Mutex);
+  free(log->DrainBuffer);
+  fclose(log->File);
+
+  memset(log, 0, sizeof(EVENT_LOG));
+}
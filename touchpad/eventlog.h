@@ -0,0 +1,143 @@
+#ifndef __EVENTLOG_H__
+#define __EVENTLOG_H__
+#include "platform.h"
+
+#include <stdio.h>
+
+#include "threading.h"
+#include "spscring.h"
+
+// An event log file is an EVENT_LOG_FILE_HEADER followed by EVENT_LOG_RECORDs.
+// The records of different writers are not in timestamp order in the file
+// (each ring is drained in turn), the decoder sorts them. All fields are
+// little endian (the byte order of every platform we run on).
+#define EVENT_LOG_MAGIC   0x474C5645  // "EVLG"
+#define EVENT_LOG_VERSION 1
+
+#define EVENT_LOG_NUM_ARGS    5
+#define EVENT_LOG_MAX_WRITERS 8
+// records of each writer that wait for the drain thread, 32 bytes each
+#define EVENT_LOG_DEFAULT_RING_CAPACITY 16384
+// the drain thread writes the rings to the file this often
+#define EVENT_LOG_DRAIN_INTERVAL_MS 100
+
+// EVENT_LOG_RECORD.EventId and its Args
+//
+// Written by the drain thread when the ring of a writer was full:
+// writer index, records dropped since the previous one, total records dropped.
+#define EVENT_LOG_RECORDS_DROPPED        1
+// A WM_INPUT message of a touchpad: device index, number of reports, number of contacts.
+#define EVENT_LOG_INPUT_MESSAGE          2
+// A decoded contact: report sequence number, touch ID, x, y, EVENT_TYPE_* | (tip switch << 8).
+#define EVENT_LOG_TOUCH_CONTACT          3
+// The touch event ring was full: events dropped by this message, total events dropped (low 32 bits).
+#define EVENT_LOG_TOUCH_EVENTS_DROPPED   4
+// The UI thread has drained the touch event ring: number of events.
+#define EVENT_LOG_TOUCH_EVENTS_DRAINED   5
+// A STROKE_EVENT_* other than STROKE_EVENT_NONE: event, stroke index, points of the stroke.
+#define EVENT_LOG_STROKE_EVENT           6
+// A recognition result: number of strokes, number of candidates, code point
+// of the first candidate, microseconds since the strokes were submitted.
+#define EVENT_LOG_RECOGNITION_RESULT     7
+// A key that the application handles was released: virtual key code.
+#define EVENT_LOG_KEY_UP                 8
+// The first WM_INPUT message of a device whose touch data layout is unknown
+// (its reports are ignored): device index.
+#define EVENT_LOG_INVALID_DECODE_PLAN    9
+// The contact table was full and contacts that the device stopped reporting
+// (a dropped lift report) were evicted: device index, contacts evicted by this
+// message, total contacts evicted.
+#define EVENT_LOG_STALE_CONTACTS_EVICTED 10
+
+struct EVENT_LOG_FILE_HEADER
+{
+  unsigned int Magic;
+  unsigned int Version;
+  unsigned int cbFileHeader;
+  unsigned int cbRecord;
+  // ticks per second of the record timestamps
+  unsigned long long TimestampFrequency;
+  // timestamp of the moment that the log was opened
+  unsigned long long StartTimestamp;
+};
+
+typedef struct EVENT_LOG_FILE_HEADER EVENT_LOG_FILE_HEADER;
+
+struct EVENT_LOG_RECORD
+{
+  // mGetTimestamp
+  unsigned long long Timestamp;
+  unsigned short EventId;
+  unsigned short WriterIdx;
+  unsigned int Args[EVENT_LOG_NUM_ARGS];
+};
+
+typedef struct EVENT_LOG_RECORD EVENT_LOG_RECORD;
+
+// The ring of one thread. Only that thread logs to it.
+struct EVENT_LOG_WRITER
+{
+  SPSC_RING Ring;
+  unsigned int WriterIdx;
+  // written by the writer thread, read by the drain thread
+  volatile unsigned int NumDroppedRecords;
+  // owned by the drain thread
+  unsigned int NumReportedDrops;
+};
+
+typedef struct EVENT_LOG_WRITER EVENT_LOG_WRITER;
+
+// A binary log of fixed-size records for the threads that cannot afford
+// console output (the input thread, the message loop). Every thread has its
+// own writer: logging an event takes a timestamp and copies 32 bytes into the
+// lock free ring of the writer, it never locks, waits or calls the system. A
+// drain thread writes the rings to the file every EVENT_LOG_DRAIN_INTERVAL_MS.
+// If a ring is full the record is dropped (and counted) instead of waiting
+// for the disk. tools/eventlogdecode.c prints the file.
+struct EVENT_LOG
+{
+  FILE* File;
+  EVENT_LOG_WRITER Writers[EVENT_LOG_MAX_WRITERS];
+  unsigned int NumWriters;
+  int IsStopping;
+  THREAD_MUTEX Mutex;
+  THREAD_CONDITION StopCondition;
+  THREAD_HANDLE DrainThread;
+  // owned by the drain thread
+  EVENT_LOG_RECORD* DrainBuffer;
+  unsigned long long NumWrittenRecords;
+};
+
+typedef struct EVENT_LOG EVENT_LOG;
+
+// Create the file and start the drain thread. ringCapacity 0 is
+// EVENT_LOG_DEFAULT_RING_CAPACITY. Returns -1 if the log is not open.
+int mOpenEventLog(const char* filePath, unsigned int numWriters, unsigned int ringCapacity, EVENT_LOG* log);
+// Write the remaining records and close the file. The writers must not log anymore.
+void mCloseEventLog(EVENT_LOG* log);
+
+// Log an event from the thread of the writer. writer can be NULL (no log).
+static __inline void mLogEvent(EVENT_LOG_WRITER* writer, unsigned int eventId, unsigned int arg0, unsigned int arg1, unsigned int arg2, unsigned int arg3, unsigned int arg4)
+{
+  if (writer == NULL)
+  {
+    return;
+  }
+
+  EVENT_LOG_RECORD record;
+  record.Timestamp = mGetTimestamp();
+  record.EventId   = (unsigned short)eventId;
+  record.WriterIdx = (unsigned short)writer->WriterIdx;
+  record.Args[0]   = arg0;
+  record.Args[1]   = arg1;
+  record.Args[2]   = arg2;
+  record.Args[3]   = arg3;
+  record.Args[4]   = arg4;
+
+  if (mPushToSpscRing(&writer->Ring, &record, 1) == 0)
+  {
+    // only this thread writes the counter
+    mAtomicStoreRelease(&writer->NumDroppedRecords, writer->NumDroppedRecords + 1);
+  }
+}
+#endif  // __EVENTLOG_H__
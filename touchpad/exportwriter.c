@@ -0,0 +1,274 @@
+#include "platform.h"
+
+#include <stdio.h>
+
+#include "exportwriter.h"
+
+#include "utils.h"
+#include "termcolor.h"
+
+void mInitializeStrokeSnapshot(STROKE_SNAPSHOT* snapshot)
+{
+  memset(snapshot, 0, sizeof(STROKE_SNAPSHOT));
+}
+
+void mUpdateStrokeSnapshot(STROKE_SNAPSHOT* snapshot, const StrokeList* strokes)
+{
+  // the points of the strokes are one range of the pool (a view of the edit
+  // log shares the pool with the hidden strokes around it)
+  unsigned int pointOffset = 0;
+  unsigned int numPoints   = 0;
+  if (strokes->Size != 0)
+  {
+    StrokeIndexEntry lastStroke = strokes->Entries[strokes->Size - 1];
+    pointOffset                 = strokes->Entries[0].Offset;
+    numPoints                   = (lastStroke.Offset + lastStroke.Size) - pointOffset;
+  }
+
+  unsigned int firstStrokeIdx = 0;
+  unsigned int firstPointIdx  = 0;
+
+  // same generation: what was copied is still valid except for the last stroke that may have grown since
+  if ((snapshot->Generation == strokes->Generation) && (snapshot->PointOffset == pointOffset) && (snapshot->NumStrokes <= strokes->Size) && (snapshot->NumPoints <= numPoints))
+  {
+    firstStrokeIdx = (snapshot->NumStrokes != 0) ? (snapshot->NumStrokes - 1) : 0;
+    firstPointIdx  = snapshot->NumPoints;
+  }
+
+  if (strokes->Size > snapshot->StrokeCapacity)
+  {
+    unsigned int capacity    = (strokes->Size > (2 * snapshot->StrokeCapacity)) ? strokes->Size : (2 * snapshot->StrokeCapacity);
+    snapshot->Entries        = (StrokeIndexEntry*)mRealloc(snapshot->Entries, (size_t)capacity * sizeof(StrokeIndexEntry), __FILE__, __LINE__);
+    snapshot->StrokeCapacity = capacity;
+  }
+
+  if (numPoints > snapshot->PointCapacity)
+  {
+    unsigned int capacity   = (numPoints > (2 * snapshot->PointCapacity)) ? numPoints : (2 * snapshot->PointCapacity);
+    snapshot->Points        = (Point2D*)mRealloc(snapshot->Points, (size_t)capacity * sizeof(Point2D), __FILE__, __LINE__);
+    snapshot->PointCapacity = capacity;
+  }
+
+  // the offsets of the copy are relative to its first point
+  for (unsigned int strokeIdx = firstStrokeIdx; strokeIdx < strokes->Size; strokeIdx++)
+  {
+    snapshot->Entries[strokeIdx] = strokes->Entries[strokeIdx];
+    snapshot->Entries[strokeIdx].Offset -= pointOffset;
+  }
+
+  if (numPoints > firstPointIdx)
+  {
+    memcpy(snapshot->Points + firstPointIdx, strokes->Points.Entries + pointOffset + firstPointIdx, (size_t)(numPoints - firstPointIdx) * sizeof(Point2D));
+  }
+
+  snapshot->NumStrokes  = strokes->Size;
+  snapshot->NumPoints   = numPoints;
+  snapshot->PointOffset = pointOffset;
+  snapshot->Generation  = strokes->Generation;
+}
+
+void mFreeStrokeSnapshot(STROKE_SNAPSHOT* snapshot)
+{
+  free(snapshot->Entries);
+  free(snapshot->Points);
+  memset(snapshot, 0, sizeof(STROKE_SNAPSHOT));
+}
+
+// with the mutex held
+static void mAddStrokeExportCompletion(STROKE_EXPORT_WRITER* writer, const STROKE_EXPORT_COMPLETION* completion)
+{
+  if (writer->NumCompletions == STROKE_EXPORT_WRITER_MAX_COMPLETIONS)
+  {
+    writer->FirstCompletion = (writer->FirstCompletion + 1) % STROKE_EXPORT_WRITER_MAX_COMPLETIONS;
+    writer->NumCompletions--;
+    writer->NumDroppedCompletions++;
+  }
+
+  writer->Completions[(writer->FirstCompletion + writer->NumCompletions) % STROKE_EXPORT_WRITER_MAX_COMPLETIONS] = (*completion);
+  writer->NumCompletions++;
+}
+
+static void mStrokeExportWriterThread(void* arg)
+{
+  STROKE_EXPORT_WRITER* writer = (STROKE_EXPORT_WRITER*)arg;
+  STROKE_EXPORT_COMPLETION completion;
+
+  mLockThreadMutex(&writer->Mutex);
+
+  while (1)
+  {
+    // the pending request is written before stopping
+    if (!writer->IsRequestPending)
+    {
+      if (writer->IsStopping)
+      {
+        break;
+      }
+
+      mWaitThreadCondition(&writer->RequestCondition, &writer->Mutex, THREAD_WAIT_INFINITE);
+      continue;
+    }
+
+    // the next request fills the other snapshot while we write this one
+    unsigned int writingSnapshot = writer->PendingSnapshot;
+    writer->PendingSnapshot      = writingSnapshot ^ 1;
+    writer->IsRequestPending     = 0;
+
+    const STROKE_SNAPSHOT* snapshot      = &writer->Snapshots[writingSnapshot];
+    const STROKE_EXPORT_REQUEST* request = &writer->Requests[writingSnapshot];
+
+    memset(&completion, 0, sizeof(STROKE_EXPORT_COMPLETION));
+    completion.RequestIdx      = request->RequestIdx;
+    completion.NumStrokes      = snapshot->NumStrokes;
+    completion.NumPoints       = snapshot->NumPoints;
+    completion.SubmitTimestamp = request->SubmitTimestamp;
+    memcpy(completion.FilePath, request->FilePath, sizeof(completion.FilePath));
+
+    mUnlockThreadMutex(&writer->Mutex);
+
+    int retval = mEncodeStrokeExport(snapshot->Entries, snapshot->NumStrokes, snapshot->Points, &request->PhysicalRect, &writer->Buffer);
+    if (retval == 0)
+    {
+      retval = mWriteStrokeExportBuffer(request->FilePath, &writer->Buffer);
+    }
+
+    completion.Status          = (retval == 0) ? STROKE_EXPORT_STATUS_WRITTEN : STROKE_EXPORT_STATUS_FAILED;
+    completion.cbFile          = (retval == 0) ? writer->Buffer.cbData : 0;
+    completion.FinishTimestamp = mGetTimestamp();
+
+    mLockThreadMutex(&writer->Mutex);
+
+    mAddStrokeExportCompletion(writer, &completion);
+    writer->NumWrittenRequests++;
+
+    if (writer->NotifyProc != NULL)
+    {
+      mUnlockThreadMutex(&writer->Mutex);
+      writer->NotifyProc(writer->NotifyArg);
+      mLockThreadMutex(&writer->Mutex);
+    }
+  }
+
+  mUnlockThreadMutex(&writer->Mutex);
+}
+
+int mStartStrokeExportWriter(STROKE_EXPORT_WRITER* writer, STROKE_EXPORT_NOTIFY_PROC notifyProc, void* notifyArg)
+{
+  memset(writer, 0, sizeof(STROKE_EXPORT_WRITER));
+  writer->NotifyProc = notifyProc;
+  writer->NotifyArg  = notifyArg;
+
+  mInitializeStrokeSnapshot(&writer->Snapshots[0]);
+  mInitializeStrokeSnapshot(&writer->Snapshots[1]);
+
+  mInitializeThreadMutex(&writer->Mutex);
+  mInitializeThreadCondition(&writer->RequestCondition);
+
+  if (mCreateThread(&writer->Thread, mStrokeExportWriterThread, writer) != 0)
+  {
+    printf(FG_RED);
+    printf("Failed to start the export writer at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+
+    mDestroyThreadCondition(&writer->RequestCondition);
+    mDestroyThreadMutex(&writer->Mutex);
+    memset(writer, 0, sizeof(STROKE_EXPORT_WRITER));
+    return -1;
+  }
+
+  return 0;
+}
+
+void mStopStrokeExportWriter(STROKE_EXPORT_WRITER* writer)
+{
+  mLockThreadMutex(&writer->Mutex);
+  writer->IsStopping = 1;
+  mSignalThreadCondition(&writer->RequestCondition);
+  mUnlockThreadMutex(&writer->Mutex);
+
+  mJoinThread(&writer->Thread);
+
+  mDestroyThreadCondition(&writer->RequestCondition);
+  mDestroyThreadMutex(&writer->Mutex);
+  mFreeStrokeSnapshot(&writer->Snapshots[0]);
+  mFreeStrokeSnapshot(&writer->Snapshots[1]);
+  mFreeStrokeExportBuffer(&writer->Buffer);
+  memset(writer, 0, sizeof(STROKE_EXPORT_WRITER));
+}
+
+unsigned int mRequestStrokeExport(STROKE_EXPORT_WRITER* writer, const StrokeList* strokes, const char* filePath, const RECT* physicalRect)
+{
+  int isCoalesced = 0;
+
+  mLockThreadMutex(&writer->Mutex);
+
+  STROKE_SNAPSHOT* snapshot      = &writer->Snapshots[writer->PendingSnapshot];
+  STROKE_EXPORT_REQUEST* request = &writer->Requests[writer->PendingSnapshot];
+
+  if (writer->IsRequestPending)
+  {
+    // the writer thread did not get to it, this request takes its place
+    STROKE_EXPORT_COMPLETION completion;
+    memset(&completion, 0, sizeof(STROKE_EXPORT_COMPLETION));
+    completion.RequestIdx      = request->RequestIdx;
+    completion.Status          = STROKE_EXPORT_STATUS_COALESCED;
+    completion.NumStrokes      = snapshot->NumStrokes;
+    completion.NumPoints       = snapshot->NumPoints;
+    completion.SubmitTimestamp = request->SubmitTimestamp;
+    completion.FinishTimestamp = mGetTimestamp();
+    memcpy(completion.FilePath, request->FilePath, sizeof(completion.FilePath));
+
+    mAddStrokeExportCompletion(writer, &completion);
+    writer->NumCoalescedRequests++;
+    isCoalesced = 1;
+  }
+
+  // only the strokes since the previous request that used this snapshot are copied
+  mUpdateStrokeSnapshot(snapshot, strokes);
+
+  writer->LastRequestIdx++;
+  request->RequestIdx      = writer->LastRequestIdx;
+  request->SubmitTimestamp = mGetTimestamp();
+  snprintf(request->FilePath, sizeof(request->FilePath), "%s", filePath);
+
+  if (physicalRect != NULL)
+  {
+    request->PhysicalRect = (*physicalRect);
+  }
+  else
+  {
+    memset(&request->PhysicalRect, 0, sizeof(RECT));
+  }
+
+  unsigned int requestIdx  = writer->LastRequestIdx;
+  writer->IsRequestPending = 1;
+
+  mSignalThreadCondition(&writer->RequestCondition);
+  mUnlockThreadMutex(&writer->Mutex);
+
+  if (isCoalesced && (writer->NotifyProc != NULL))
+  {
+    writer->NotifyProc(writer->NotifyArg);
+  }
+
+  return requestIdx;
+}
+
+int mTakeStrokeExportCompletion(STROKE_EXPORT_WRITER* writer, STROKE_EXPORT_COMPLETION* completion)
+{
+  int retval = -1;
+
+  mLockThreadMutex(&writer->Mutex);
+
+  if (writer->NumCompletions != 0)
+  {
+    (*completion)           = writer->Completions[writer->FirstCompletion];
+    writer->FirstCompletion = (writer->FirstCompletion + 1) % STROKE_EXPORT_WRITER_MAX_COMPLETIONS;
+    writer->NumCompletions--;
+    retval                  = 0;
+  }
+
+  mUnlockThreadMutex(&writer->Mutex);
+
+  return retval;
+}
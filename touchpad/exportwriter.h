@@ -0,0 +1,124 @@
+#ifndef __EXPORTWRITER_H__
+#define __EXPORTWRITER_H__
+#include "platform.h"
+
+#include "threading.h"
+#include "stroke.h"
+#include "strokeexport.h"
+
+#define STROKE_EXPORT_WRITER_MAX_PATH 260
+// completions that are kept until they are taken, the oldest one is dropped after that
+#define STROKE_EXPORT_WRITER_MAX_COMPLETIONS 16
+
+// STROKE_EXPORT_COMPLETION.Status
+#define STROKE_EXPORT_STATUS_WRITTEN   0
+#define STROKE_EXPORT_STATUS_FAILED    1
+// a newer request replaced it before the writer thread got to it, no file was written
+#define STROKE_EXPORT_STATUS_COALESCED 2
+
+// called on the writer thread (or in mRequestStrokeExport for a coalesced
+// request) when a completion can be taken
+typedef void (*STROKE_EXPORT_NOTIFY_PROC)(void* arg);
+
+// A copy of the strokes of a StrokeList. It is refreshed by copying only what
+// was appended since the last copy: the strokes of a generation are never
+// modified except for the last one that grows at the end of the point pool.
+// Only the points of the strokes are copied, so Entries[].Offset is relative
+// to Points.
+struct STROKE_SNAPSHOT
+{
+  StrokeIndexEntry* Entries;
+  unsigned int NumStrokes;
+  unsigned int StrokeCapacity;
+  Point2D* Points;
+  unsigned int NumPoints;
+  unsigned int PointCapacity;
+  // offset in StrokeList.Points of Points[0]
+  unsigned int PointOffset;
+  // StrokeList.Generation of the copy
+  unsigned int Generation;
+};
+
+typedef struct STROKE_SNAPSHOT STROKE_SNAPSHOT;
+
+struct STROKE_EXPORT_REQUEST
+{
+  // the value that mRequestStrokeExport returned for it
+  unsigned int RequestIdx;
+  char FilePath[STROKE_EXPORT_WRITER_MAX_PATH];
+  RECT PhysicalRect;
+  unsigned long long SubmitTimestamp;
+};
+
+typedef struct STROKE_EXPORT_REQUEST STROKE_EXPORT_REQUEST;
+
+struct STROKE_EXPORT_COMPLETION
+{
+  unsigned int RequestIdx;
+  int Status;
+  char FilePath[STROKE_EXPORT_WRITER_MAX_PATH];
+  unsigned int NumStrokes;
+  unsigned int NumPoints;
+  size_t cbFile;
+  // mGetTimestamp when the request was submitted and when it was written (or replaced)
+  unsigned long long SubmitTimestamp;
+  unsigned long long FinishTimestamp;
+};
+
+typedef struct STROKE_EXPORT_COMPLETION STROKE_EXPORT_COMPLETION;
+
+// Writes stroke export files (see strokeexport.h) on a background thread so
+// that the message loop never waits for the disk. A request copies the new
+// part of the strokes into one of two snapshots while the writer thread
+// encodes the other one and writes it to the file.
+//
+// At most one request waits behind the one that is being written: a newer
+// request takes its place (and its file is never written) so repeated saves
+// coalesce into the newest one instead of piling up.
+struct STROKE_EXPORT_WRITER
+{
+  STROKE_EXPORT_NOTIFY_PROC NotifyProc;
+  void* NotifyArg;
+
+  THREAD_MUTEX Mutex;
+  THREAD_CONDITION RequestCondition;
+  THREAD_HANDLE Thread;
+
+  // guarded by Mutex, except Snapshots[WritingSnapshot] and
+  // Requests[WritingSnapshot] that the writer thread reads while it writes
+  STROKE_SNAPSHOT Snapshots[2];
+  STROKE_EXPORT_REQUEST Requests[2];
+  // index of the snapshot that the next request fills
+  unsigned int PendingSnapshot;
+  int IsRequestPending;
+  int IsStopping;
+  unsigned int LastRequestIdx;
+  STROKE_EXPORT_COMPLETION Completions[STROKE_EXPORT_WRITER_MAX_COMPLETIONS];
+  unsigned int FirstCompletion;
+  unsigned int NumCompletions;
+  unsigned int NumDroppedCompletions;
+  unsigned int NumCoalescedRequests;
+  unsigned int NumWrittenRequests;
+
+  // owned by the writer thread
+  STROKE_EXPORT_BUFFER Buffer;
+};
+
+typedef struct STROKE_EXPORT_WRITER STROKE_EXPORT_WRITER;
+
+void mInitializeStrokeSnapshot(STROKE_SNAPSHOT* snapshot);
+// Make the snapshot a copy of the strokes, the last stroke included even if it
+// has not ended yet.
+void mUpdateStrokeSnapshot(STROKE_SNAPSHOT* snapshot, const StrokeList* strokes);
+void mFreeStrokeSnapshot(STROKE_SNAPSHOT* snapshot);
+
+// Returns -1 if the thread did not start. notifyProc can be NULL.
+int mStartStrokeExportWriter(STROKE_EXPORT_WRITER* writer, STROKE_EXPORT_NOTIFY_PROC notifyProc, void* notifyArg);
+// write the pending request and stop the thread
+void mStopStrokeExportWriter(STROKE_EXPORT_WRITER* writer);
+// Snapshot the strokes (on the calling thread) and queue the file, returns
+// the index of the request. physicalRect can be NULL.
+unsigned int mRequestStrokeExport(STROKE_EXPORT_WRITER* writer, const StrokeList* strokes, const char* filePath, const RECT* physicalRect);
+// Returns 0 and the oldest completion that was not taken yet, -1 if there is none.
+int mTakeStrokeExportCompletion(STROKE_EXPORT_WRITER* writer, STROKE_EXPORT_COMPLETION* completion);
+#endif  // __EXPORTWRITER_H__
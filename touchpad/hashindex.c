@@ -0,0 +1,173 @@
+#include <stdio.h>
+
+#include "hashindex.h"
+#include "utils.h"
+
+static unsigned long long mMixHashKey(unsigned long long key)
+{
+  // splitmix64 finalizer so that small consecutive keys (e.g. link collection IDs) and aligned pointers spread over the slots
+  key ^= key >> 30;
+  key *= 0xBF58476D1CE4E5B9ULL;
+  key ^= key >> 27;
+  key *= 0x94D049BB133111EBULL;
+  key ^= key >> 31;
+  return key;
+}
+
+static unsigned int mGetHomeSlot(const HASH_INDEX* index, unsigned long long key)
+{
+  return (unsigned int)(mMixHashKey(key) & (index->Capacity - 1));
+}
+
+static void mGrowHashIndex(HASH_INDEX* index)
+{
+  HASH_INDEX_SLOT* oldSlots = index->Slots;
+  unsigned int oldCapacity  = index->Capacity;
+
+  index->Capacity = (oldCapacity == 0) ? HASH_INDEX_MIN_CAPACITY : (oldCapacity * 2);
+  index->Slots    = (HASH_INDEX_SLOT*)mMalloc(sizeof(HASH_INDEX_SLOT) * index->Capacity, __FILE__, __LINE__);
+  index->Size     = 0;
+
+  memset(index->Slots, 0, sizeof(HASH_INDEX_SLOT) * index->Capacity);
+
+  for (unsigned int slotIdx = 0; slotIdx < oldCapacity; slotIdx++)
+  {
+    if (oldSlots[slotIdx].IsOccupied)
+    {
+      mInsertIntoHashIndex(index, oldSlots[slotIdx].Key, oldSlots[slotIdx].Value);
+    }
+  }
+
+  free(oldSlots);
+}
+
+static int mFindHashIndexSlot(const HASH_INDEX* index, unsigned long long key, unsigned int* slotIdx)
+{
+  if (index->Capacity == 0)
+  {
+    return -1;
+  }
+
+  unsigned int curSlotIdx = mGetHomeSlot(index, key);
+
+  // the index is never full so the loop always reaches an empty slot
+  while (index->Slots[curSlotIdx].IsOccupied)
+  {
+    if (index->Slots[curSlotIdx].Key == key)
+    {
+      (*slotIdx) = curSlotIdx;
+      return 0;
+    }
+
+    curSlotIdx = (curSlotIdx + 1) & (index->Capacity - 1);
+  }
+
+  return -1;
+}
+
+unsigned long long mHashBytes(const void* data, size_t cbData)
+{
+  // 64-bit FNV-1a
+  const BYTE* bytes       = (const BYTE*)data;
+  unsigned long long hash = 0xCBF29CE484222325ULL;
+
+  for (size_t byteIdx = 0; byteIdx < cbData; byteIdx++)
+  {
+    hash ^= bytes[byteIdx];
+    hash *= 0x100000001B3ULL;
+  }
+
+  return hash;
+}
+
+int mFindInHashIndex(const HASH_INDEX* index, unsigned long long key, unsigned int* value)
+{
+  unsigned int slotIdx;
+  if (mFindHashIndexSlot(index, key, &slotIdx) != 0)
+  {
+    return -1;
+  }
+
+  (*value) = index->Slots[slotIdx].Value;
+  return 0;
+}
+
+void mInsertIntoHashIndex(HASH_INDEX* index, unsigned long long key, unsigned int value)
+{
+  unsigned int slotIdx;
+  if (mFindHashIndexSlot(index, key, &slotIdx) == 0)
+  {
+    index->Slots[slotIdx].Value = value;
+    return;
+  }
+
+  // keep the load factor at or below 1/2 so that the probe sequences stay short
+  if (((index->Size + 1) * 2) > index->Capacity)
+  {
+    mGrowHashIndex(index);
+  }
+
+  slotIdx = mGetHomeSlot(index, key);
+  while (index->Slots[slotIdx].IsOccupied)
+  {
+    slotIdx = (slotIdx + 1) & (index->Capacity - 1);
+  }
+
+  index->Slots[slotIdx].Key        = key;
+  index->Slots[slotIdx].Value      = value;
+  index->Slots[slotIdx].IsOccupied = 1;
+  index->Size++;
+}
+
+int mRemoveFromHashIndex(HASH_INDEX* index, unsigned long long key)
+{
+  unsigned int emptySlotIdx;
+  if (mFindHashIndexSlot(index, key, &emptySlotIdx) != 0)
+  {
+    return -1;
+  }
+
+  // backward shift deletion keeps the probe sequences intact without tombstones
+  unsigned int nextSlotIdx = emptySlotIdx;
+  while (1)
+  {
+    nextSlotIdx = (nextSlotIdx + 1) & (index->Capacity - 1);
+    if (!index->Slots[nextSlotIdx].IsOccupied)
+    {
+      break;
+    }
+
+    unsigned int homeSlotIdx     = mGetHomeSlot(index, index->Slots[nextSlotIdx].Key);
+    unsigned int distToEmptySlot = (emptySlotIdx - homeSlotIdx) & (index->Capacity - 1);
+    unsigned int distToNextSlot  = (nextSlotIdx - homeSlotIdx) & (index->Capacity - 1);
+
+    if (distToEmptySlot < distToNextSlot)
+    {
+      index->Slots[emptySlotIdx] = index->Slots[nextSlotIdx];
+      emptySlotIdx               = nextSlotIdx;
+    }
+  }
+
+  index->Slots[emptySlotIdx].IsOccupied = 0;
+  index->Size--;
+
+  return 0;
+}
+
+void mClearHashIndex(HASH_INDEX* index)
+{
+  if (index->Slots != NULL)
+  {
+    memset(index->Slots, 0, sizeof(HASH_INDEX_SLOT) * index->Capacity);
+  }
+
+  index->Size = 0;
+}
+
+void mFreeHashIndex(HASH_INDEX* index)
+{
+  free(index->Slots);
+  index->Slots    = NULL;
+  index->Capacity = 0;
+  index->Size     = 0;
+}
@@ -0,0 +1,40 @@
+#ifndef __HASHINDEX_H__
+#define __HASHINDEX_H__
+#include "platform.h"
+
+// The first allocation of a hash index will hold this many slots. It must be a power of 2.
+#define HASH_INDEX_MIN_CAPACITY 8
+
+struct HASH_INDEX_SLOT
+{
+  unsigned long long Key;
+  unsigned int Value;
+  int IsOccupied;
+};
+
+typedef struct HASH_INDEX_SLOT HASH_INDEX_SLOT;
+
+// Maps 64-bit keys to unsigned int values (usually an index into an array of
+// entries) with open addressing and linear probing. Keys that are not integers
+// (e.g. device names) are hashed with mHashBytes and the caller compares the
+// entry it gets back with the key it was looking for.
+// A zero initialized HASH_INDEX is a valid empty index.
+struct HASH_INDEX
+{
+  HASH_INDEX_SLOT* Slots;
+  unsigned int Capacity;
+  unsigned int Size;
+};
+
+typedef struct HASH_INDEX HASH_INDEX;
+
+unsigned long long mHashBytes(const void* data, size_t cbData);
+// returns 0 and sets value if the key exists, returns -1 otherwise
+int mFindInHashIndex(const HASH_INDEX* index, unsigned long long key, unsigned int* value);
+// inserts the key or overwrites its value
+void mInsertIntoHashIndex(HASH_INDEX* index, unsigned long long key, unsigned int value);
+// returns -1 if the key does not exist
+int mRemoveFromHashIndex(HASH_INDEX* index, unsigned long long key);
+void mClearHashIndex(HASH_INDEX* index);
+void mFreeHashIndex(HASH_INDEX* index);
+#endif  // __HASHINDEX_H__
@@ -0,0 +1,223 @@
+#include <stdio.h>
+
+#include "hiddecoder.h"
+#include "utils.h"
+#include "termcolor.h"
+
+static int mIsHidReportFieldValid(const HID_REPORT_FIELD* field)
+{
+  return (field->BitSize != 0) && (field->BitSize <= 32);
+}
+
+static unsigned int mGetHidReportFieldEndByte(const HID_REPORT_FIELD* field)
+{
+  return (field->BitOffset + field->BitSize + 7) >> 3;
+}
+
+void mInitializeTouchDecodePlan(HID_TOUCH_DECODE_PLAN* plan)
+{
+  memset(plan, 0, sizeof(HID_TOUCH_DECODE_PLAN));
+}
+
+int mFinalizeTouchDecodePlan(HID_TOUCH_DECODE_PLAN* plan)
+{
+  plan->IsValid     = 0;
+  plan->cbMinReport = 0;
+
+  if ((plan->NumContacts == 0) || (plan->NumContacts > HID_TOUCH_DECODE_PLAN_MAX_CONTACTS))
+  {
+    return -1;
+  }
+
+  if (!mIsHidReportFieldValid(&plan->ContactCount))
+  {
+    return -1;
+  }
+
+  unsigned int cbMinReport = mGetHidReportFieldEndByte(&plan->ContactCount);
+
+  for (unsigned int contactIdx = 0; contactIdx < plan->NumContacts; contactIdx++)
+  {
+    const HID_REPORT_FIELD* fields[4] = {&plan->Contacts[contactIdx].X, &plan->Contacts[contactIdx].Y, &plan->Contacts[contactIdx].ContactID, &plan->Contacts[contactIdx].TipSwitch};
+
+    for (unsigned int fieldIdx = 0; fieldIdx < 4; fieldIdx++)
+    {
+      if (!mIsHidReportFieldValid(fields[fieldIdx]))
+      {
+        return -1;
+      }
+
+      unsigned int endByte = mGetHidReportFieldEndByte(fields[fieldIdx]);
+      if (endByte > cbMinReport)
+      {
+        cbMinReport = endByte;
+      }
+    }
+  }
+
+  plan->cbMinReport = cbMinReport;
+  plan->IsValid     = 1;
+
+  return 0;
+}
+
+ULONG mReadHidReportField(const BYTE* report, const HID_REPORT_FIELD* field)
+{
+  // a field of at most 32 bits spans at most 5 bytes
+  const BYTE* firstByte  = report + (field->BitOffset >> 3);
+  unsigned int bitShift  = field->BitOffset & 7;
+  unsigned int numBytes  = (bitShift + field->BitSize + 7) >> 3;
+  unsigned long long raw = 0;
+
+  for (unsigned int byteIdx = 0; byteIdx < numBytes; byteIdx++)
+  {
+    raw |= ((unsigned long long)firstByte[byteIdx]) << (8 * byteIdx);
+  }
+
+  raw >>= bitShift;
+
+  if (field->BitSize < 32)
+  {
+    raw &= (1ULL << field->BitSize) - 1;
+  }
+
+  return (ULONG)raw;
+}
+
+void mResetTouchDecodeState(HID_TOUCH_DECODE_STATE* state)
+{
+  state->NumPendingContacts = 0;
+}
+
+int mDecodeTouchReport(const HID_TOUCH_DECODE_PLAN* plan, HID_TOUCH_DECODE_STATE* state, const BYTE* report, unsigned int cbReport, TOUCH_DATA* touches, unsigned int* numTouches)
+{
+  if ((plan == NULL) || (state == NULL) || (report == NULL) || (touches == NULL) || (numTouches == NULL))
+  {
+    printf(FG_RED);
+    printf("mDecodeTouchReport received a NULL argument at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    exit(-1);
+    return -1;
+  }
+
+  (*numTouches) = 0;
+
+  if (!plan->IsValid || (cbReport == 0) || (cbReport < plan->cbMinReport))
+  {
+    return -1;
+  }
+
+  if ((plan->ReportID != 0) && (report[0] != plan->ReportID))
+  {
+    // e.g. a mouse report of a touchpad in mouse mode
+    return -1;
+  }
+
+  ULONG contactCount = mReadHidReportField(report, &plan->ContactCount);
+
+  // a report with a contact count starts a frame, a report with 0 continues it
+  if (contactCount != 0)
+  {
+    state->NumPendingContacts = (contactCount < HID_TOUCH_DECODE_MAX_FRAME_CONTACTS) ? contactCount : HID_TOUCH_DECODE_MAX_FRAME_CONTACTS;
+  }
+
+  ULONG numContacts = (state->NumPendingContacts < plan->NumContacts) ? state->NumPendingContacts : plan->NumContacts;
+  state->NumPendingContacts -= numContacts;
+
+  for (ULONG contactIdx = 0; contactIdx < numContacts; contactIdx++)
+  {
+    const HID_TOUCH_CONTACT_LAYOUT* layout = &plan->Contacts[contactIdx];
+
+    touches[contactIdx].TouchID        = mReadHidReportField(report, &layout->ContactID);
+    touches[contactIdx].X              = mReadHidReportField(report, &layout->X);
+    touches[contactIdx].Y              = mReadHidReportField(report, &layout->Y);
+    touches[contactIdx].OnSurface      = (mReadHidReportField(report, &layout->TipSwitch) != 0);
+    touches[contactIdx].SequenceNumber = 0;
+  }
+
+  (*numTouches) = numContacts;
+
+  return 0;
+}
+
+static void mReserveTouchDataBatch(unsigned int capacity, TOUCH_DATA_BATCH* batch)
+{
+  if (capacity <= batch->Capacity)
+  {
+    return;
+  }
+
+  // grow geometrically because the number of reports per message varies
+  unsigned int newCapacity = (batch->Capacity == 0) ? HID_TOUCH_DECODE_PLAN_MAX_CONTACTS : batch->Capacity;
+  while (newCapacity < capacity)
+  {
+    newCapacity *= 2;
+  }
+
+  batch->Entries    = (TOUCH_DATA*)mRealloc(batch->Entries, sizeof(TOUCH_DATA) * newCapacity, __FILE__, __LINE__);
+  batch->EventTypes = (unsigned int*)mRealloc(batch->EventTypes, sizeof(unsigned int) * newCapacity, __FILE__, __LINE__);
+  batch->Capacity   = newCapacity;
+}
+
+int mDecodeTouchReportBatch(const HID_TOUCH_DECODE_PLAN* plan, HID_TOUCH_DECODE_STATE* state, const BYTE* reports, unsigned int cbReport, unsigned int numReports, ULONG* sequenceNumber, TOUCH_DATA_BATCH* batch)
+{
+  if ((plan == NULL) || (state == NULL) || (sequenceNumber == NULL) || (batch == NULL) || ((reports == NULL) && (numReports != 0)))
+  {
+    printf(FG_RED);
+    printf("mDecodeTouchReportBatch received a NULL argument at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    exit(-1);
+    return -1;
+  }
+
+  batch->Size       = 0;
+  batch->NumReports = numReports;
+
+  if (numReports == 0)
+  {
+    return 0;
+  }
+
+  // reserve the worst case once so that the loop below never reallocates
+  mReserveTouchDataBatch(numReports * HID_TOUCH_DECODE_PLAN_MAX_CONTACTS, batch);
+
+  const BYTE* report = reports;
+
+  for (unsigned int reportIdx = 0; reportIdx < numReports; reportIdx++)
+  {
+    ULONG reportSequenceNumber = (*sequenceNumber)++;
+    TOUCH_DATA* touches        = &batch->Entries[batch->Size];
+    unsigned int numTouches;
+
+    if (mDecodeTouchReport(plan, state, report, cbReport, touches, &numTouches) == 0)
+    {
+      for (unsigned int touchIdx = 0; touchIdx < numTouches; touchIdx++)
+      {
+        touches[touchIdx].SequenceNumber = reportSequenceNumber;
+      }
+
+      batch->Size += numTouches;
+    }
+
+    report += cbReport;
+  }
+
+  return 0;
+}
+
+void mFreeTouchDataBatch(TOUCH_DATA_BATCH* batch)
+{
+  if (batch == NULL)
+  {
+    return;
+  }
+
+  free(batch->Entries);
+  free(batch->EventTypes);
+
+  batch->Entries    = NULL;
+  batch->EventTypes = NULL;
+  batch->Size       = 0;
+  batch->Capacity   = 0;
+  batch->NumReports = 0;
+}
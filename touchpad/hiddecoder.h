@@ -0,0 +1,99 @@
+#ifndef __HIDDECODER_H__
+#define __HIDDECODER_H__
+#include "platform.h"
+
+#include "touchevents.h"
+
+// maximum number of contact link collections in a single input report
+#define HID_TOUCH_DECODE_PLAN_MAX_CONTACTS 16
+// a larger contact count is corrupt, no digitizer tracks that many fingers
+#define HID_TOUCH_DECODE_MAX_FRAME_CONTACTS 64
+
+// location of a single usage value inside an input report
+struct HID_REPORT_FIELD
+{
+  // offset from the start of the report (including the report ID byte)
+  unsigned int BitOffset;
+  // at most 32 bits
+  unsigned int BitSize;
+  LONG LogicalMin;
+  LONG LogicalMax;
+};
+
+typedef struct HID_REPORT_FIELD HID_REPORT_FIELD;
+
+struct HID_TOUCH_CONTACT_LAYOUT
+{
+  USHORT LinkColID;
+  HID_REPORT_FIELD X;
+  HID_REPORT_FIELD Y;
+  HID_REPORT_FIELD ContactID;
+  HID_REPORT_FIELD TipSwitch;
+};
+
+typedef struct HID_TOUCH_CONTACT_LAYOUT HID_TOUCH_CONTACT_LAYOUT;
+
+// The layout of a touchpad's input report. It is compiled once per device so
+// that decoding a report is only a few shifts and masks per field instead of
+// several HidP_* calls that walk the preparsed data again and again.
+struct HID_TOUCH_DECODE_PLAN
+{
+  int IsValid;
+  // 0 if the device does not use report IDs
+  BYTE ReportID;
+  // number of bytes that a report must have to contain all the fields
+  unsigned int cbMinReport;
+  HID_REPORT_FIELD ContactCount;
+  HID_TOUCH_CONTACT_LAYOUT Contacts[HID_TOUCH_DECODE_PLAN_MAX_CONTACTS];
+  unsigned int NumContacts;
+};
+
+typedef struct HID_TOUCH_DECODE_PLAN HID_TOUCH_DECODE_PLAN;
+
+// A device in hybrid reporting mode has fewer contact collections than it
+// tracks fingers and splits a frame over several reports: the first report
+// carries the contact count of the whole frame, the following ones carry 0.
+// The state keeps the number of contacts that the next reports still hold.
+struct HID_TOUCH_DECODE_STATE
+{
+  unsigned int NumPendingContacts;
+};
+
+typedef struct HID_TOUCH_DECODE_STATE HID_TOUCH_DECODE_STATE;
+
+// Contacts of all the input reports of a single WM_INPUT message (Windows
+// packs RAWHID.dwCount reports of RAWHID.dwSizeHid bytes each into one
+// message when the device reports faster than we read). The contacts are
+// stored contiguously in report order. The memory is reused between batches.
+struct TOUCH_DATA_BATCH
+{
+  TOUCH_DATA* Entries;
+  // the event type of each contact for mInterpretRawTouchInputBatch
+  unsigned int* EventTypes;
+  unsigned int Size;
+  unsigned int Capacity;
+  // number of reports in the batch including the ones without contacts
+  unsigned int NumReports;
+};
+
+typedef struct TOUCH_DATA_BATCH TOUCH_DATA_BATCH;
+
+void mInitializeTouchDecodePlan(HID_TOUCH_DECODE_PLAN* plan);
+// validate the fields and compute cbMinReport, sets plan->IsValid
+int mFinalizeTouchDecodePlan(HID_TOUCH_DECODE_PLAN* plan);
+// Returns the raw (unsigned) bits of the field like HidP_GetUsageValue does.
+// The report must be long enough to hold the field.
+ULONG mReadHidReportField(const BYTE* report, const HID_REPORT_FIELD* field);
+void mResetTouchDecodeState(HID_TOUCH_DECODE_STATE* state);
+// Decode all contacts of a single input report. touches must hold HID_TOUCH_DECODE_PLAN_MAX_CONTACTS entries.
+// The reports of a device must be decoded in order with the same state.
+// Returns -1 if the report does not belong to the plan (wrong report ID or too short).
+int mDecodeTouchReport(const HID_TOUCH_DECODE_PLAN* plan, HID_TOUCH_DECODE_STATE* state, const BYTE* report, unsigned int cbReport, TOUCH_DATA* touches, unsigned int* numTouches);
+// Decode numReports consecutive reports of cbReport bytes each (RAWHID.bRawData)
+// into the batch in a single pass. Every report gets the next sequence number
+// from (*sequenceNumber), including reports that are skipped because they do
+// not belong to the plan, so that gaps are visible to the consumer. The state
+// is the device's, a frame may continue in the next WM_INPUT message.
+int mDecodeTouchReportBatch(const HID_TOUCH_DECODE_PLAN* plan, HID_TOUCH_DECODE_STATE* state, const BYTE* reports, unsigned int cbReport, unsigned int numReports, ULONG* sequenceNumber, TOUCH_DATA_BATCH* batch);
+void mFreeTouchDataBatch(TOUCH_DATA_BATCH* batch);
+#endif  // __HIDDECODER_H__
@@ -0,0 +1,581 @@
+#include <stdio.h>
+
+#include "hiddescriptor.h"
+#include "termcolor.h"
+
+// https://www.usb.org/sites/default/files/hid1_11.pdf (6.2.2 Report Descriptor)
+
+#define HID_ITEM_TYPE_MAIN   0
+#define HID_ITEM_TYPE_GLOBAL 1
+#define HID_ITEM_TYPE_LOCAL  2
+#define HID_ITEM_LONG_PREFIX 0xFE
+
+#define HID_MAIN_ITEM_INPUT          0x8
+#define HID_MAIN_ITEM_OUTPUT         0x9
+#define HID_MAIN_ITEM_COLLECTION     0xA
+#define HID_MAIN_ITEM_FEATURE        0xB
+#define HID_MAIN_ITEM_END_COLLECTION 0xC
+
+#define HID_GLOBAL_ITEM_USAGE_PAGE   0x0
+#define HID_GLOBAL_ITEM_LOGICAL_MIN  0x1
+#define HID_GLOBAL_ITEM_LOGICAL_MAX  0x2
+#define HID_GLOBAL_ITEM_PHYSICAL_MIN 0x3
+#define HID_GLOBAL_ITEM_PHYSICAL_MAX 0x4
+#define HID_GLOBAL_ITEM_REPORT_SIZE  0x7
+#define HID_GLOBAL_ITEM_REPORT_ID    0x8
+#define HID_GLOBAL_ITEM_REPORT_COUNT 0x9
+#define HID_GLOBAL_ITEM_PUSH         0xA
+#define HID_GLOBAL_ITEM_POP          0xB
+
+#define HID_LOCAL_ITEM_USAGE     0x0
+#define HID_LOCAL_ITEM_USAGE_MIN 0x1
+#define HID_LOCAL_ITEM_USAGE_MAX 0x2
+
+#define HID_MAIN_ITEM_FLAG_CONSTANT 0x01
+#define HID_MAIN_ITEM_FLAG_VARIABLE 0x02
+#define HID_MAIN_ITEM_FLAG_RELATIVE 0x04
+
+// usages are stored with their usage page in the upper 16 bits
+#define HID_EXTENDED_USAGE(usagePage, usage) ((((ULONG)(usagePage)) << 16) | ((ULONG)(usage)))
+
+// indices into HID_DESCRIPTOR_PARSER.FieldReportIDs
+#define HID_CONTACT_FIELD_X          0
+#define HID_CONTACT_FIELD_Y          1
+#define HID_CONTACT_FIELD_CONTACT_ID 2
+#define HID_CONTACT_FIELD_TIP_SWITCH 3
+
+struct HID_DESCRIPTOR_GLOBAL_STATE
+{
+  USHORT UsagePage;
+  LONG LogicalMin;
+  LONG LogicalMax;
+  LONG PhysicalMin;
+  LONG PhysicalMax;
+  ULONG ReportSize;
+  ULONG ReportCount;
+  BYTE ReportID;
+};
+
+typedef struct HID_DESCRIPTOR_GLOBAL_STATE HID_DESCRIPTOR_GLOBAL_STATE;
+
+struct HID_DESCRIPTOR_LOCAL_STATE
+{
+  ULONG Usages[HID_DESCRIPTOR_MAX_USAGES];
+  unsigned int NumUsages;
+  ULONG UsageMin;
+  ULONG UsageMax;
+  int HasUsageRange;
+};
+
+typedef struct HID_DESCRIPTOR_LOCAL_STATE HID_DESCRIPTOR_LOCAL_STATE;
+
+struct HID_DESCRIPTOR_PARSER
+{
+  HID_DESCRIPTOR_GLOBAL_STATE Global;
+  HID_DESCRIPTOR_GLOBAL_STATE GlobalStack[HID_DESCRIPTOR_MAX_GLOBAL_STACK];
+  unsigned int GlobalStackSize;
+  HID_DESCRIPTOR_LOCAL_STATE Local;
+
+  // link collection IDs of the open collections (only inside the selected top-level collection)
+  USHORT CollectionStack[HID_DESCRIPTOR_MAX_COLLECTION_DEPTH];
+  unsigned int CollectionDepth;
+  USHORT NextLinkColID;
+  int IsInSelectedCollection;
+  int HasFoundSelectedCollection;
+
+  // bit offset of the next input field of every report ID, after the ID byte
+  unsigned int InputBitOffsets[256];
+
+  // touch fields of every link collection to build the decode plan
+  HID_TOUCH_CONTACT_LAYOUT Layouts[HID_DESCRIPTOR_MAX_LINK_COLLECTIONS];
+  BYTE FieldReportIDs[HID_DESCRIPTOR_MAX_LINK_COLLECTIONS][4];
+  BYTE ContactCountReportID;
+};
+
+typedef struct HID_DESCRIPTOR_PARSER HID_DESCRIPTOR_PARSER;
+
+static ULONG mReadHidItemData(const BYTE* data, unsigned int size)
+{
+  ULONG value = 0;
+  for (unsigned int byteIdx = 0; byteIdx < size; byteIdx++)
+  {
+    value |= ((ULONG)data[byteIdx]) << (8 * byteIdx);
+  }
+
+  return value;
+}
+
+static LONG mSignExtendHidItemData(ULONG value, unsigned int size)
+{
+  if ((size == 1) && (value & 0x80))
+  {
+    return (LONG)(value | 0xFFFFFF00);
+  }
+  else if ((size == 2) && (value & 0x8000))
+  {
+    return (LONG)(value | 0xFFFF0000);
+  }
+
+  return (LONG)value;
+}
+
+static ULONG mGetHidFieldUsage(HID_DESCRIPTOR_LOCAL_STATE* local, ULONG fieldIdx, int* isRange)
+{
+  (*isRange) = 0;
+
+  if (local->NumUsages != 0)
+  {
+    // the last usage applies to the rest of the fields
+    return local->Usages[(fieldIdx < local->NumUsages) ? fieldIdx : (local->NumUsages - 1)];
+  }
+  else if (local->HasUsageRange)
+  {
+    (*isRange) = 1;
+
+    ULONG usage = local->UsageMin + fieldIdx;
+    return (usage > local->UsageMax) ? local->UsageMax : usage;
+  }
+
+  return 0;
+}
+
+static HID_TOUCH_LINK_COL_INFO* mGetHidLinkCollectionInfo(HID_DEVICE_INFO* deviceInfo, USHORT linkColID)
+{
+  unsigned int foundLinkColIdx;
+  FindLinkCollectionInList(&deviceInfo->LinkColInfoList, linkColID, &foundLinkColIdx);
+
+  return &deviceInfo->LinkColInfoList.Entries[foundLinkColIdx];
+}
+
+// mirror how mParseConnectedInputDevices interprets HidP value and button caps
+static void mRecordHidInputField(HID_DESCRIPTOR_PARSER* parser, HID_DEVICE_INFO* deviceInfo, ULONG extendedUsage, int isRange, int isRelative, unsigned int bitOffset)
+{
+  USHORT usagePage  = (USHORT)(extendedUsage >> 16);
+  USHORT usage      = (USHORT)(extendedUsage & 0xFFFF);
+  USHORT linkColID  = parser->CollectionStack[parser->CollectionDepth - 1];
+  BYTE reportId     = parser->Global.ReportID;
+  int hasLayoutSlot = (linkColID < HID_DESCRIPTOR_MAX_LINK_COLLECTIONS);
+
+  HID_REPORT_FIELD field;
+  field.BitOffset  = bitOffset;
+  field.BitSize    = parser->Global.ReportSize;
+  field.LogicalMin = parser->Global.LogicalMin;
+  field.LogicalMax = parser->Global.LogicalMax;
+
+  if (isRange)
+  {
+    return;
+  }
+
+  if (parser->Global.ReportSize == 1)
+  {
+    // button caps
+    if (usagePage != HID_USAGE_PAGE_DIGITIZER)
+    {
+      return;
+    }
+
+    if (usage == HID_USAGE_DIGITIZER_TIP_SWITCH)
+    {
+      mGetHidLinkCollectionInfo(deviceInfo, linkColID)->HasTipSwitch = 1;
+
+      if (hasLayoutSlot)
+      {
+        parser->Layouts[linkColID].TipSwitch                            = field;
+        parser->FieldReportIDs[linkColID][HID_CONTACT_FIELD_TIP_SWITCH] = reportId;
+      }
+    }
+    else if (usage == HID_USAGE_DIGITIZER_CONFIDENCE)
+    {
+      mGetHidLinkCollectionInfo(deviceInfo, linkColID)->HasConfidence = 1;
+    }
+
+    return;
+  }
+
+  // value caps
+  if (isRelative)
+  {
+    return;
+  }
+
+  HID_TOUCH_LINK_COL_INFO* linkColInfo = mGetHidLinkCollectionInfo(deviceInfo, linkColID);
+
+  if (usagePage == HID_USAGE_PAGE_GENERIC)
+  {
+    if (usage == HID_USAGE_GENERIC_X)
+    {
+      linkColInfo->HasX               = 1;
+      linkColInfo->PhysicalRect.left  = parser->Global.PhysicalMin;
+      linkColInfo->PhysicalRect.right = parser->Global.PhysicalMax;
+
+      if (hasLayoutSlot)
+      {
+        parser->Layouts[linkColID].X                          = field;
+        parser->FieldReportIDs[linkColID][HID_CONTACT_FIELD_X] = reportId;
+      }
+    }
+    else if (usage == HID_USAGE_GENERIC_Y)
+    {
+      linkColInfo->HasY                = 1;
+      linkColInfo->PhysicalRect.top    = parser->Global.PhysicalMin;
+      linkColInfo->PhysicalRect.bottom = parser->Global.PhysicalMax;
+
+      if (hasLayoutSlot)
+      {
+        parser->Layouts[linkColID].Y                          = field;
+        parser->FieldReportIDs[linkColID][HID_CONTACT_FIELD_Y] = reportId;
+      }
+    }
+  }
+  else if (usagePage == HID_USAGE_PAGE_DIGITIZER)
+  {
+    if (usage == HID_USAGE_DIGITIZER_CONTACT_ID)
+    {
+      linkColInfo->HasContactID = 1;
+
+      if (hasLayoutSlot)
+      {
+        parser->Layouts[linkColID].ContactID                            = field;
+        parser->FieldReportIDs[linkColID][HID_CONTACT_FIELD_CONTACT_ID] = reportId;
+      }
+    }
+    else if (usage == HID_USAGE_DIGITIZER_CONTACT_COUNT)
+    {
+      deviceInfo->ContactCountLinkCollection = linkColID;
+      deviceInfo->DecodePlan.ContactCount    = field;
+      parser->ContactCountReportID           = reportId;
+    }
+    else if (usage == HID_USAGE_DIGITIZER_WIDTH)
+    {
+      linkColInfo->HasWidth = 1;
+    }
+    else if (usage == HID_USAGE_DIGITIZER_HEIGHT)
+    {
+      linkColInfo->HasHeight = 1;
+    }
+    else if (usage == HID_USAGE_DIGITIZER_TIP_PRESSURE)
+    {
+      linkColInfo->HasPressure = 1;
+    }
+  }
+}
+
+static int mParseHidInputItem(HID_DESCRIPTOR_PARSER* parser, HID_DEVICE_INFO* deviceInfo, ULONG flags)
+{
+  unsigned int bitOffset = parser->InputBitOffsets[parser->Global.ReportID];
+
+  // bounds the loop below, a malformed Report Count can be up to 2^32 - 1
+  unsigned long long endBitOffset = bitOffset + ((unsigned long long)parser->Global.ReportSize * parser->Global.ReportCount);
+  if (endBitOffset > (HID_DESCRIPTOR_MAX_REPORT_BYTES * 8))
+  {
+    printf(FG_RED);
+    printf("Input report %d is larger than %d bytes at %s:%d\n", parser->Global.ReportID, HID_DESCRIPTOR_MAX_REPORT_BYTES, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  int isConstant = (flags & HID_MAIN_ITEM_FLAG_CONSTANT) != 0;
+  int isVariable = (flags & HID_MAIN_ITEM_FLAG_VARIABLE) != 0;
+  int isRelative = (flags & HID_MAIN_ITEM_FLAG_RELATIVE) != 0;
+
+  // constant fields are padding and array fields are never used for touch data
+  if (parser->IsInSelectedCollection && !isConstant && isVariable)
+  {
+    for (ULONG fieldIdx = 0; fieldIdx < parser->Global.ReportCount; fieldIdx++)
+    {
+      int isRange;
+      ULONG extendedUsage = mGetHidFieldUsage(&parser->Local, fieldIdx, &isRange);
+
+      mRecordHidInputField(parser, deviceInfo, extendedUsage, isRange, isRelative, bitOffset + (fieldIdx * parser->Global.ReportSize));
+    }
+  }
+
+  parser->InputBitOffsets[parser->Global.ReportID] = (unsigned int)endBitOffset;
+
+  return 0;
+}
+
+static void mBuildHidDecodePlan(HID_DESCRIPTOR_PARSER* parser, HID_DEVICE_INFO* deviceInfo)
+{
+  HID_TOUCH_DECODE_PLAN* plan = &deviceInfo->DecodePlan;
+
+  if (deviceInfo->ContactCountLinkCollection == (USHORT)-1)
+  {
+    return;
+  }
+
+  plan->ReportID    = parser->ContactCountReportID;
+  plan->NumContacts = 0;
+
+  for (unsigned int linkColIdx = 0; linkColIdx < deviceInfo->LinkColInfoList.Size; linkColIdx++)
+  {
+    HID_TOUCH_LINK_COL_INFO collectionInfo = deviceInfo->LinkColInfoList.Entries[linkColIdx];
+    if (!(collectionInfo.HasX && collectionInfo.HasY && collectionInfo.HasContactID && collectionInfo.HasTipSwitch))
+    {
+      continue;
+    }
+
+    USHORT linkColID = collectionInfo.LinkColID;
+    if ((linkColID >= HID_DESCRIPTOR_MAX_LINK_COLLECTIONS) || (plan->NumContacts == HID_TOUCH_DECODE_PLAN_MAX_CONTACTS))
+    {
+      continue;
+    }
+
+    int isSameReport = 1;
+    for (unsigned int fieldIdx = 0; fieldIdx < 4; fieldIdx++)
+    {
+      if (parser->FieldReportIDs[linkColID][fieldIdx] != plan->ReportID)
+      {
+        isSameReport = 0;
+      }
+    }
+
+    if (isSameReport)
+    {
+      plan->Contacts[plan->NumContacts]           = parser->Layouts[linkColID];
+      plan->Contacts[plan->NumContacts].LinkColID = linkColID;
+      plan->NumContacts++;
+    }
+  }
+
+  mFinalizeTouchDecodePlan(plan);
+}
+
+int mParseHidReportDescriptor(const BYTE* descriptor, unsigned int cbDescriptor, USHORT topLevelUsagePage, USHORT topLevelUsage, HID_DEVICE_INFO* deviceInfo)
+{
+  if ((descriptor == NULL) || (deviceInfo == NULL))
+  {
+    printf(FG_RED);
+    printf("mParseHidReportDescriptor received a NULL argument at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    exit(-1);
+    return -1;
+  }
+
+  HID_DESCRIPTOR_PARSER parserState;
+  HID_DESCRIPTOR_PARSER* parser = &parserState;
+  memset(parser, 0, sizeof(HID_DESCRIPTOR_PARSER));
+
+  // every report starts with the report ID byte, which is 0 without report IDs
+  for (unsigned int reportID = 0; reportID < 256; reportID++)
+  {
+    parser->InputBitOffsets[reportID] = 8;
+  }
+
+  deviceInfo->ContactCountLinkCollection = (USHORT)-1;
+  mInitializeTouchDecodePlan(&deviceInfo->DecodePlan);
+
+  unsigned int itemIdx = 0;
+  while (itemIdx < cbDescriptor)
+  {
+    BYTE prefix = descriptor[itemIdx];
+
+    if (prefix == HID_ITEM_LONG_PREFIX)
+    {
+      // long items are reserved and carry no information that we need
+      if ((itemIdx + 1) >= cbDescriptor)
+      {
+        break;
+      }
+
+      itemIdx += 3 + descriptor[itemIdx + 1];
+      continue;
+    }
+
+    unsigned int dataSize = prefix & 0x3;
+    if (dataSize == 3)
+    {
+      dataSize = 4;
+    }
+
+    unsigned int itemType = (prefix >> 2) & 0x3;
+    unsigned int itemTag  = (prefix >> 4) & 0xF;
+
+    if ((itemIdx + 1 + dataSize) > cbDescriptor)
+    {
+      printf(FG_RED);
+      printf("The report descriptor is truncated at byte %d at %s:%d\n", itemIdx, __FILE__, __LINE__);
+      printf(RESET_COLOR);
+      return -1;
+    }
+
+    ULONG data = mReadHidItemData(&descriptor[itemIdx + 1], dataSize);
+    itemIdx += 1 + dataSize;
+
+    if (itemType == HID_ITEM_TYPE_MAIN)
+    {
+      if (itemTag == HID_MAIN_ITEM_INPUT)
+      {
+        if (parser->CollectionDepth == 0)
+        {
+          printf(FG_RED);
+          printf("Input item outside of any collection at %s:%d\n", __FILE__, __LINE__);
+          printf(RESET_COLOR);
+          return -1;
+        }
+
+        if (mParseHidInputItem(parser, deviceInfo, data) != 0)
+        {
+          return -1;
+        }
+      }
+      else if (itemTag == HID_MAIN_ITEM_COLLECTION)
+      {
+        if (parser->CollectionDepth == HID_DESCRIPTOR_MAX_COLLECTION_DEPTH)
+        {
+          printf(FG_RED);
+          printf("The collections are nested too deep at %s:%d\n", __FILE__, __LINE__);
+          printf(RESET_COLOR);
+          return -1;
+        }
+
+        if (parser->CollectionDepth == 0)
+        {
+          int isRange;
+          ULONG collectionUsage = mGetHidFieldUsage(&parser->Local, 0, &isRange);
+
+          if (!parser->HasFoundSelectedCollection && (collectionUsage == HID_EXTENDED_USAGE(topLevelUsagePage, topLevelUsage)))
+          {
+            parser->HasFoundSelectedCollection = 1;
+            parser->IsInSelectedCollection     = 1;
+            parser->NextLinkColID              = 0;
+          }
+        }
+
+        USHORT linkColID = (USHORT)-1;
+        if (parser->IsInSelectedCollection)
+        {
+          linkColID = parser->NextLinkColID;
+          parser->NextLinkColID++;
+        }
+
+        parser->CollectionStack[parser->CollectionDepth] = linkColID;
+        parser->CollectionDepth++;
+      }
+      else if (itemTag == HID_MAIN_ITEM_END_COLLECTION)
+      {
+        if (parser->CollectionDepth == 0)
+        {
+          printf(FG_RED);
+          printf("Unbalanced End Collection item at %s:%d\n", __FILE__, __LINE__);
+          printf(RESET_COLOR);
+          return -1;
+        }
+
+        parser->CollectionDepth--;
+        if (parser->CollectionDepth == 0)
+        {
+          parser->IsInSelectedCollection = 0;
+        }
+      }
+
+      // Output and Feature items do not affect the input report layout
+
+      memset(&parser->Local, 0, sizeof(HID_DESCRIPTOR_LOCAL_STATE));
+    }
+    else if (itemType == HID_ITEM_TYPE_GLOBAL)
+    {
+      if (itemTag == HID_GLOBAL_ITEM_USAGE_PAGE)
+      {
+        parser->Global.UsagePage = (USHORT)data;
+      }
+      else if (itemTag == HID_GLOBAL_ITEM_LOGICAL_MIN)
+      {
+        parser->Global.LogicalMin = mSignExtendHidItemData(data, dataSize);
+      }
+      else if (itemTag == HID_GLOBAL_ITEM_LOGICAL_MAX)
+      {
+        // a non-negative minimum means that the maximum is unsigned (e.g. 0x00 - 0xFF)
+        parser->Global.LogicalMax = (parser->Global.LogicalMin >= 0) ? (LONG)data : mSignExtendHidItemData(data, dataSize);
+      }
+      else if (itemTag == HID_GLOBAL_ITEM_PHYSICAL_MIN)
+      {
+        parser->Global.PhysicalMin = mSignExtendHidItemData(data, dataSize);
+      }
+      else if (itemTag == HID_GLOBAL_ITEM_PHYSICAL_MAX)
+      {
+        parser->Global.PhysicalMax = (parser->Global.PhysicalMin >= 0) ? (LONG)data : mSignExtendHidItemData(data, dataSize);
+      }
+      else if (itemTag == HID_GLOBAL_ITEM_REPORT_SIZE)
+      {
+        parser->Global.ReportSize = data;
+      }
+      else if (itemTag == HID_GLOBAL_ITEM_REPORT_ID)
+      {
+        if ((data == 0) || (data > 0xFF))
+        {
+          printf(FG_RED);
+          printf("Invalid report ID %d at %s:%d\n", data, __FILE__, __LINE__);
+          printf(RESET_COLOR);
+          return -1;
+        }
+
+        parser->Global.ReportID = (BYTE)data;
+      }
+      else if (itemTag == HID_GLOBAL_ITEM_REPORT_COUNT)
+      {
+        parser->Global.ReportCount = data;
+      }
+      else if (itemTag == HID_GLOBAL_ITEM_PUSH)
+      {
+        if (parser->GlobalStackSize == HID_DESCRIPTOR_MAX_GLOBAL_STACK)
+        {
+          printf(FG_RED);
+          printf("Too many Push items at %s:%d\n", __FILE__, __LINE__);
+          printf(RESET_COLOR);
+          return -1;
+        }
+
+        parser->GlobalStack[parser->GlobalStackSize] = parser->Global;
+        parser->GlobalStackSize++;
+      }
+      else if (itemTag == HID_GLOBAL_ITEM_POP)
+      {
+        if (parser->GlobalStackSize == 0)
+        {
+          printf(FG_RED);
+          printf("Pop item without Push item at %s:%d\n", __FILE__, __LINE__);
+          printf(RESET_COLOR);
+          return -1;
+        }
+
+        parser->GlobalStackSize--;
+        parser->Global = parser->GlobalStack[parser->GlobalStackSize];
+      }
+    }
+    else if (itemType == HID_ITEM_TYPE_LOCAL)
+    {
+      // 4-byte usages already contain their usage page
+      ULONG extendedUsage = (dataSize == 4) ? data : HID_EXTENDED_USAGE(parser->Global.UsagePage, data);
+
+      if (itemTag == HID_LOCAL_ITEM_USAGE)
+      {
+        if (parser->Local.NumUsages < HID_DESCRIPTOR_MAX_USAGES)
+        {
+          parser->Local.Usages[parser->Local.NumUsages] = extendedUsage;
+          parser->Local.NumUsages++;
+        }
+      }
+      else if (itemTag == HID_LOCAL_ITEM_USAGE_MIN)
+      {
+        parser->Local.UsageMin      = extendedUsage;
+        parser->Local.HasUsageRange = 1;
+      }
+      else if (itemTag == HID_LOCAL_ITEM_USAGE_MAX)
+      {
+        parser->Local.UsageMax      = extendedUsage;
+        parser->Local.HasUsageRange = 1;
+      }
+    }
+  }
+
+  if (!parser->HasFoundSelectedCollection)
+  {
+    return -1;
+  }
+
+  mBuildHidDecodePlan(parser, deviceInfo);
+
+  return 0;
+}
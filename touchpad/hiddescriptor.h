@@ -0,0 +1,26 @@
+#ifndef __HIDDESCRIPTOR_H__
+#define __HIDDESCRIPTOR_H__
+#include "platform.h"
+
+#include "utils.h"
+
+// Limits of the descriptor parser. The parser does not allocate memory except
+// for the entries of deviceInfo->LinkColInfoList.
+#define HID_DESCRIPTOR_MAX_USAGES           64
+#define HID_DESCRIPTOR_MAX_GLOBAL_STACK     8
+#define HID_DESCRIPTOR_MAX_COLLECTION_DEPTH 16
+#define HID_DESCRIPTOR_MAX_LINK_COLLECTIONS 64
+// an input report larger than this makes the descriptor invalid
+#define HID_DESCRIPTOR_MAX_REPORT_BYTES     16384
+
+// Parse a raw HID report descriptor into the same HID_DEVICE_INFO fields that
+// mParseConnectedInputDevices fills from HidP_GetValueCaps/HidP_GetButtonCaps
+// (LinkColInfoList, PhysicalRect, Has* flags, ContactCountLinkCollection) and
+// compile its DecodePlan. Only the first top-level collection with the given
+// usage (e.g. HID_USAGE_PAGE_DIGITIZER/HID_USAGE_DIGITIZER_TOUCH_PAD) is parsed
+// because Windows exposes every top-level collection as a separate device.
+// Link collections are numbered the way HidP numbers them: the top-level
+// collection is 0 and nested collections follow in the order they appear.
+// deviceInfo->LinkColInfoList must be initialized (e.g. empty).
+int mParseHidReportDescriptor(const BYTE* descriptor, unsigned int cbDescriptor, USHORT topLevelUsagePage, USHORT topLevelUsage, HID_DEVICE_INFO* deviceInfo);
+#endif  // __HIDDESCRIPTOR_H__
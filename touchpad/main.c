@@ -13,28 +13,133 @@
 #include "utils.h"
 #include "touchpad.h"
 #include "touchevents.h"
+#include "hiddecoder.h"
+#include "deviceregistry.h"
 #include "point2d.h"
 #include "stroke.h"
-
-#define LOG_EVERY_INPUT_MESSAGES
-#undef LOG_EVERY_INPUT_MESSAGES
+#include "editlog.h"
+#include "segmentgrid.h"
+#include "resampler.h"
+#include "recognizer.h"
+#include "recognitionworker.h"
+#include "strokeexport.h"
+#include "exportwriter.h"
+#include "tracerecorder.h"
+#include "threading.h"
+#include "spscring.h"
+#include "eventlog.h"
+#include "canvas.h"
 
 static TCHAR szWindowClass[] = _T("DesktopApp");
-static TCHAR szTitle[]       = _T("F3: start writing - ESC: stop writing - C: clear - Q: close the application");
+// message-only window of the input thread that receives WM_INPUT
+static TCHAR szInputWindowClass[] = _T("DesktopAppInput");
+static TCHAR szTitle[]       = _T("F3: start writing - ESC: stop writing - C: clear - Z: undo - Y: redo - S: save the strokes - Q: close the application");
 
 // https://docs.microsoft.com/en-us/windows/win32/inputdev/virtual-key-codes
 #define VK_C_KEY 0x43;
 #define VK_Q_KEY 0x51;
 #define VK_S_KEY 0x53;
+#define VK_Y_KEY 0x59;
+#define VK_Z_KEY 0x5A;
+
+// posted to the main window when the input thread has pushed touch events to the ring
+#define WM_APP_TOUCH_EVENTS (WM_APP + 1)
+// posted to the main window when the recognition worker has a result
+#define WM_APP_RECOGNITION_RESULT (WM_APP + 2)
+// posted to the main window when the export writer has finished (or coalesced) a save
+#define WM_APP_STROKE_EXPORT_DONE (WM_APP + 3)
+// a Precision Touchpad sends at most a few hundred events per second so this holds several seconds of input
+#define TOUCH_EVENT_RING_CAPACITY    4096
+#define TOUCH_EVENT_DRAIN_BATCH_SIZE 256
+
+#define STROKE_WIDTH     20.0f
+#define STROKE_COLOR     CANVAS_COLOR(255, 255, 255)
+// points closer than this (in device units) to the simplified stroke are dropped from it, well below the stroke width
+#define STROKE_SIMPLIFY_TOLERANCE 2.0f
+// resampled copy of the strokes for the recognizer, the buffers hold a few pages of writing
+#define STROKE_RESAMPLE_SPACING      8.0f
+#define STROKE_RESAMPLER_MAX_POINTS  65536
+#define STROKE_RESAMPLER_MAX_STROKES 4096
+// number of candidates that are printed after every stroke
+#define RECOGNIZER_NUM_CANDIDATES 5
+// templates that the index passes on to the elastic matching (see recognizebench.c for the recall)
+#define RECOGNIZER_SHORTLIST_SIZE 200
+// the strokes are exported to strokes-YYYYMMDD-HHMMSS.strk in the working directory
+#define STROKE_EXPORT_FILE_NAME_FORMAT "strokes-%Y%m%d-%H%M%S.strk"
+// cells of the segment grid in device units, a few times the width of a stroke
+#define SEGMENT_GRID_CELL_SIZE 64
+// --log <file> writes the events of these threads to a binary event log (see tools/eventlogdecode.c)
+#define EVENT_LOG_WRITER_INPUT_THREAD 0
+#define EVENT_LOG_WRITER_UI_THREAD    1
+#define EVENT_LOG_NUM_WRITERS         2
+// black is the color key of the layered window (transparent)
+#define BACKGROUND_COLOR CANVAS_COLOR(0, 0, 0)
 
 struct ApplicationState
 {
+  // owned by the input thread after it has started
   HID_DEVICE_INFO_LIST device_info_list;
-  TOUCH_DATA_LIST previous_touches;
+  DEVICE_REGISTRY device_registry;
+  TOUCH_CONTACT_TABLE previous_touches;
+  // decoded contacts of the last WM_INPUT message
+  TOUCH_DATA_BATCH touch_batch;
+  // sequence number of the next input report
+  ULONG report_sequence_number;
+  // --record <file> writes every input report to a touch trace file
+  int is_recording_trace;
+  TOUCH_TRACE_RECORDER trace_recorder;
+  // devices of device_info_list that have been written to the trace
+  unsigned int num_traced_devices;
+  unsigned long long num_dropped_touch_events;
+  // NULL if there is no event log
+  EVENT_LOG_WRITER* input_log_writer;
+
+  // touch events from the input thread (producer) to the UI thread (consumer)
+  SPSC_RING touch_event_ring;
+  // set by the input thread when it posts WM_APP_TOUCH_EVENTS, cleared by the UI thread before it drains the ring
+  volatile unsigned int is_touch_event_message_posted;
+  // the UI thread asks the input thread to forget the contacts (e.g. clearing the canvas)
+  volatile unsigned int is_contact_table_reset_requested;
+  HWND main_window;
+  HWND input_window;
+  HANDLE input_window_ready_event;
+  THREAD_HANDLE input_thread;
+  // --log <file>, the input thread and the UI thread log to their own writer
+  int is_event_log_open;
+  EVENT_LOG event_log;
+
+  // owned by the UI thread
+  // NULL if there is no event log
+  EVENT_LOG_WRITER* ui_log_writer;
+  // every stroke since the application started (up to the compaction of the edit log)
   StrokeList strokes;
+  // undo and redo, the visible strokes are a range of strokes (see mGetVisibleStrokes)
+  STROKE_EDIT_LOG edit_log;
+  // the segments of strokes by area of the touchpad, for the partial redraws of undo and redo
+  int is_segment_grid_ready;
+  SEGMENT_GRID segment_grid;
+  STROKE_SEGMENT_LIST redraw_segments;
   ULONG tracking_touch_id;
-  // flag to toggle drawing state
-  int is_drawing;
+  // points of the simplified view of the last stroke whose segments are on the canvas
+  unsigned int num_drawn_simplified_points;
+  // the geometry of the touchpad that is stored with the exported strokes
+  RECT touchpad_physical_rect;
+  // the strokes are saved on a background thread, the files are written synchronously if it did not start
+  int is_export_writer_running;
+  STROKE_EXPORT_WRITER export_writer;
+  STROKE_RESAMPLER stroke_resampler;
+  // --templates <file> loads the templates of the recognizer, --index <file> maps them
+  int is_recognizer_loaded;
+  RECOGNIZER_DATABASE recognizer_database;
+  // the strokes are submitted when a stroke ends and scored on every processor in the background
+  RECOGNITION_WORKER recognition_worker;
+  // the ink is drawn into the DIB section of canvas_dc and WM_PAINT only copies it to the window
+  CANVAS canvas;
+  HDC canvas_dc;
+  HBITMAP canvas_bitmap;
+  HGDIOBJ canvas_last_bitmap;
+  // flag to toggle drawing state (read by the input thread)
+  volatile unsigned int is_drawing;
 
   // TODO add option to change the key bindings
   // TODO add option to add multiple key bindings (array of key bindings for each actions)
@@ -44,6 +149,8 @@ struct ApplicationState
   int export_writing_data_key_code;
   int quit_application_key_code;
   int clear_drawing_canvas_key_code;
+  int undo_stroke_key_code;
+  int redo_stroke_key_code;
   int call_block_input_flag;
   int call_unblock_input_flag;
 };
@@ -65,6 +172,25 @@ LRESULT CALLBACK mBlockMouseInputHookProc(_In_ int nCode, _In_ WPARAM wParam, _I
   }
 }
 
+// Write the devices that are not in the trace yet so that the reports can be decoded when the trace is replayed.
+void mTraceNewInputDevices()
+{
+  if (!g_app_state->is_recording_trace)
+  {
+    return;
+  }
+
+  for (unsigned int deviceIdx = g_app_state->num_traced_devices; deviceIdx < g_app_state->device_info_list.Size; deviceIdx++)
+  {
+    HID_DEVICE_INFO* deviceInfo = &g_app_state->device_info_list.Entries[deviceIdx];
+
+    mRecordTouchTrace(&g_app_state->trace_recorder, TOUCH_TRACE_RECORD_PREPARSED_DATA, deviceIdx, 0, deviceInfo->PreparedData, deviceInfo->cbPreparsedData);
+    mRecordTouchTrace(&g_app_state->trace_recorder, TOUCH_TRACE_RECORD_DECODE_PLAN, deviceIdx, 0, &deviceInfo->DecodePlan, sizeof(HID_TOUCH_DECODE_PLAN));
+  }
+
+  g_app_state->num_traced_devices = g_app_state->device_info_list.Size;
+}
+
 void mParseConnectedInputDevices()
 {
   printf(FG_BLUE);
@@ -273,6 +399,21 @@ void mParseConnectedInputDevices()
         free(buttonCaps);
       }
 
+      HID_DEVICE_INFO* deviceInfo = &g_app_state->device_info_list.Entries[foundHidIdx];
+      mResetTouchDecodeState(&deviceInfo->DecodeState);
+      if (mCompileTouchDecodePlan(preparsedData, &deviceInfo->LinkColInfoList, deviceInfo->ContactCountLinkCollection, &deviceInfo->DecodePlan) == 0)
+      {
+        printf(FG_GREEN);
+        printf("Compiled decode plan - ReportID: %d, contacts per report: %d, minimum report size: %d byte(s)\n", deviceInfo->DecodePlan.ReportID, deviceInfo->DecodePlan.NumContacts, deviceInfo->DecodePlan.cbMinReport);
+        printf(RESET_COLOR);
+      }
+      else
+      {
+        printf(FG_BRIGHT_YELLOW);
+        printf("The device does not look like a touchpad. Its input reports will be ignored.\n");
+        printf(RESET_COLOR);
+      }
+
       free(deviceName);
     }
 
@@ -280,6 +421,8 @@ void mParseConnectedInputDevices()
   }
 
   free(rawInputDeviceList);
+
+  mTraceNewInputDevices();
 }
 
 void mRegisterRawInput(HWND hwnd)
@@ -290,7 +433,8 @@ void mRegisterRawInput(HWND hwnd)
 
   rid.usUsagePage = HID_USAGE_PAGE_DIGITIZER;
   rid.usUsage     = HID_USAGE_DIGITIZER_TOUCH_PAD;
-  rid.dwFlags     = RIDEV_INPUTSINK;
+  // RIDEV_DEVNOTIFY for WM_INPUT_DEVICE_CHANGE so that we can forget the handles of removed devices
+  rid.dwFlags     = RIDEV_INPUTSINK | RIDEV_DEVNOTIFY;
   rid.hwndTarget  = hwnd;
 
   if (RegisterRawInputDevices(&rid, 1, sizeof(RAWINPUTDEVICE)))
@@ -309,20 +453,47 @@ void mRegisterRawInput(HWND hwnd)
   }
 }
 
-void mHandleCreateMessage(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
+// Find the device of a raw input handle by its name. It is only called the
+// first time that we receive a report from the handle.
+unsigned int mResolveInputDevice(HANDLE hDevice)
+{
+  UINT deviceNameLength;
+  TCHAR* deviceName = NULL;
+  unsigned int cbDeviceName;
+
+  mGetRawInputDeviceName(hDevice, &deviceName, &deviceNameLength, &cbDeviceName);
+
+  unsigned int foundHidIdx = DEVICE_REGISTRY_UNKNOWN_DEVICE;
+
+  if (LookupInputDeviceInList(&g_app_state->device_info_list, deviceName, &foundHidIdx) != 0)
+  {
+    // the device has been connected after we parsed the devices
+    mParseConnectedInputDevices();
+
+    if (LookupInputDeviceInList(&g_app_state->device_info_list, deviceName, &foundHidIdx) != 0)
+    {
+      foundHidIdx = DEVICE_REGISTRY_UNKNOWN_DEVICE;
+    }
+  }
+
+  free(deviceName);
+
+  return foundHidIdx;
+}
+
+void mHandleInputDeviceChangeMessage(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
-  mRegisterRawInput(hwnd);
+  // Windows may reuse the handle of a removed device and a new device needs to be resolved by name
+  mRemoveDeviceFromRegistry(&g_app_state->device_registry, (HANDLE)lParam);
 }
 
 void mHandleInputMessage(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
-  clock_t ts = clock();
-
   // following guide: https://docs.microsoft.com/en-us/windows/win32/inputdev/using-raw-input#performing-a-standard-read-of-raw-input
 
   // Get the size of RAWINPUT by calling GetRawInputData() with pData = NULL
 
-  if (g_app_state->is_drawing != 0)
+  if (mAtomicLoadAcquire(&g_app_state->is_drawing) != 0)
   {
     UINT rawInputSize;
     PRAWINPUT rawInputData = NULL;
@@ -332,295 +503,114 @@ void mHandleInputMessage(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
     // Parse the RAWINPUT data.
     if (rawInputData->header.dwType == RIM_TYPEHID)
     {
-      // TODO what does `dwCount` represent?
+      // number of reports of `dwSizeHid` bytes in `bRawData`
       DWORD count   = rawInputData->data.hid.dwCount;
       BYTE* rawData = rawInputData->data.hid.bRawData;
 
       if (count != 0)
       {
-        UINT deviceNameLength;
-        TCHAR* deviceName = NULL;
-        unsigned int cbDeviceName;
-
-        mGetRawInputDeviceName(rawInputData->header.hDevice, &deviceName, &deviceNameLength, &cbDeviceName);
-
-        unsigned int foundHidIdx = (unsigned int)-1;
+        HANDLE hDevice           = rawInputData->header.hDevice;
+        unsigned int foundHidIdx = DEVICE_REGISTRY_UNKNOWN_DEVICE;
 
-        int isTouchpadsNull              = (g_app_state->device_info_list.Entries == NULL);
-        int isTouchpadsRecordedSizeEmpty = (g_app_state->device_info_list.Size == 0);
-        if (isTouchpadsNull || isTouchpadsRecordedSizeEmpty)
-        {
-          // TODO parse new connected device data
-        }
-        else
+        if (mFindDeviceInRegistry(&g_app_state->device_registry, hDevice, &foundHidIdx) != 0)
         {
-          for (unsigned int touchpadIndex = 0; touchpadIndex < g_app_state->device_info_list.Size; touchpadIndex++)
-          {
-            int compareNameResult = _tcscmp(deviceName, g_app_state->device_info_list.Entries[touchpadIndex].Name);
-            if (compareNameResult == 0)
-            {
-              foundHidIdx = touchpadIndex;
-              break;
-            }
-          }
+          foundHidIdx = mResolveInputDevice(hDevice);
+          mAddDeviceToRegistry(&g_app_state->device_registry, hDevice, foundHidIdx);
         }
 
-        if (foundHidIdx == (unsigned int)-1)
+        if (foundHidIdx == DEVICE_REGISTRY_UNKNOWN_DEVICE)
         {
-          // TODO parse new connected device data
+          // not a touchpad
         }
         else
         {
-          int isLinkColArrayNull  = (g_app_state->device_info_list.Entries[foundHidIdx].LinkColInfoList.Entries == NULL);
-          int isLinkColArrayEmpty = (g_app_state->device_info_list.Entries[foundHidIdx].LinkColInfoList.Size == 0);
-          int isPreparsedDataNull = (g_app_state->device_info_list.Entries[foundHidIdx].PreparedData == NULL);
-
-          if (isLinkColArrayNull || isLinkColArrayEmpty)
+          if (g_app_state->is_recording_trace)
           {
-            printf(FG_RED);
-            printf("Cannot find any LinkCollection(s). Try parse the PREPARED_DATA may help. TODO\n");
-            printf(RESET_COLOR);
+            // record the raw reports before they are decoded so that decoder bugs can be replayed too
+            mRecordTouchTrace(&g_app_state->trace_recorder, TOUCH_TRACE_RECORD_REPORTS, foundHidIdx, count, rawData, count * rawInputData->data.hid.dwSizeHid);
           }
-          else if (isPreparsedDataNull)
+
+          HID_DEVICE_INFO* deviceInfo       = &g_app_state->device_info_list.Entries[foundHidIdx];
+          HID_TOUCH_DECODE_PLAN* decodePlan = &deviceInfo->DecodePlan;
+
+          if (!decodePlan->IsValid)
           {
-            printf(FG_RED);
-            printf("Cannot find PreparsedData at %s:%d\n", __FILE__, __LINE__);
-            printf(RESET_COLOR);
+            // the device keeps sending reports at its report rate
+            if (!deviceInfo->HasReportedInvalidDecodePlan)
+            {
+              deviceInfo->HasReportedInvalidDecodePlan = 1;
+              mLogEvent(g_app_state->input_log_writer, EVENT_LOG_INVALID_DECODE_PLAN, foundHidIdx, 0, 0, 0, 0);
+            }
           }
           else
           {
-#ifdef LOG_EVERY_INPUT_MESSAGES
-            printf("[%d]", ts);
-#endif
-            NTSTATUS hidpReturnCode;
-            ULONG usageValue;
+            TOUCH_DATA_BATCH* batch = &g_app_state->touch_batch;
+
+            // reports that do not contain touch data (e.g. wrong report ID) are skipped
+            mDecodeTouchReportBatch(decodePlan, &deviceInfo->DecodeState, rawData, rawInputData->data.hid.dwSizeHid, count, &g_app_state->report_sequence_number, batch);
+
+            TOUCH_DATA* curTouches   = batch->Entries;
+            unsigned int* touchTypes = batch->EventTypes;
+            unsigned int numContacts = batch->Size;
+
+            mLogEvent(g_app_state->input_log_writer, EVENT_LOG_INPUT_MESSAGE, foundHidIdx, count, numContacts, 0, 0);
 
-            PHIDP_PREPARSED_DATA preparsedHIDData = g_app_state->device_info_list.Entries[foundHidIdx].PreparedData;
+            if (mAtomicExchange(&g_app_state->is_contact_table_reset_requested, 0) != 0)
+            {
+              mResetTouchContactTable(&g_app_state->previous_touches);
+            }
 
-            if (g_app_state->device_info_list.Entries[foundHidIdx].ContactCountLinkCollection == (USHORT)-1)
+            unsigned int numEvictedContacts = g_app_state->previous_touches.NumEvictedContacts;
+            int cStyleFunctionReturnCode    = mInterpretRawTouchInputBatch(&g_app_state->previous_touches, curTouches, numContacts, touchTypes);
+            if (cStyleFunctionReturnCode != 0)
             {
               printf(FG_RED);
-              printf("Cannot find contact count Link Collection!\n");
+              printf("mInterpretRawTouchInputBatch failed at %s:%d\n", __FILE__, __LINE__);
               printf(RESET_COLOR);
+              exit(-1);
             }
-            else
+
+            if (g_app_state->previous_touches.NumEvictedContacts != numEvictedContacts)
             {
-              hidpReturnCode = HidP_GetUsageValue(HidP_Input, HID_USAGE_PAGE_DIGITIZER, g_app_state->device_info_list.Entries[foundHidIdx].ContactCountLinkCollection, HID_USAGE_DIGITIZER_CONTACT_COUNT, &usageValue, preparsedHIDData, (PCHAR)rawInputData->data.hid.bRawData, rawInputData->data.hid.dwSizeHid);
+              // the device dropped the lift reports of contacts that are still in the table
+              mLogEvent(g_app_state->input_log_writer, EVENT_LOG_STALE_CONTACTS_EVICTED, foundHidIdx, g_app_state->previous_touches.NumEvictedContacts - numEvictedContacts, g_app_state->previous_touches.NumEvictedContacts, 0, 0);
+            }
 
-              if (hidpReturnCode != HIDP_STATUS_SUCCESS)
-              {
-                printf(FG_RED);
-                printf("Failed to read number of contacts!\n");
-                printf(RESET_COLOR);
-                print_HidP_errors(hidpReturnCode, __FILE__, __LINE__);
-                exit(-1);
-              }
+            TOUCH_EVENT touchEvents[HID_TOUCH_DECODE_PLAN_MAX_CONTACTS];
+            unsigned int numTouchEvents  = 0;
+            unsigned long long timestamp = mGetTimestamp();
 
-              ULONG numContacts = usageValue;
+            for (unsigned int contactIdx = 0; contactIdx < numContacts; contactIdx++)
+            {
+              TOUCH_DATA curTouch    = curTouches[contactIdx];
+              unsigned int touchType = touchTypes[contactIdx];
 
-#ifdef LOG_EVERY_INPUT_MESSAGES
-              printf(FG_BRIGHT_BLUE);
-              printf("numContacts: %d\n", numContacts);
-              printf(RESET_COLOR);
-#endif
+              touchEvents[numTouchEvents] = (TOUCH_EVENT){.Touch = curTouch, .EventType = touchType, .Timestamp = timestamp};
+              numTouchEvents++;
 
-              if (numContacts > g_app_state->device_info_list.Entries[foundHidIdx].LinkColInfoList.Size)
-              {
-                // TODO how should we deal with this edge case
-                printf(FG_RED);
-                printf("number of contacts is greater than Link Collection Array size at %s:%d\n", __FILE__, __LINE__);
-                printf(RESET_COLOR);
-                exit(-1);
-              }
-              else
+              if ((numTouchEvents == HID_TOUCH_DECODE_PLAN_MAX_CONTACTS) || ((contactIdx + 1) == numContacts))
               {
-                for (unsigned int linkColIdx = 0; linkColIdx < numContacts; linkColIdx++)
+                unsigned int numPushed = mPushToSpscRing(&g_app_state->touch_event_ring, touchEvents, numTouchEvents);
+                if (numPushed != numTouchEvents)
                 {
-                  HID_TOUCH_LINK_COL_INFO collectionInfo = g_app_state->device_info_list.Entries[foundHidIdx].LinkColInfoList.Entries[linkColIdx];
-
-                  if (collectionInfo.HasX && collectionInfo.HasY && collectionInfo.HasContactID && collectionInfo.HasTipSwitch)
-                  {
-                    hidpReturnCode = HidP_GetUsageValue(HidP_Input, 0x01, collectionInfo.LinkColID, 0x30, &usageValue, preparsedHIDData, (PCHAR)rawInputData->data.hid.bRawData, rawInputData->data.hid.dwSizeHid);
-
-                    if (hidpReturnCode != HIDP_STATUS_SUCCESS)
-                    {
-                      printf(FG_RED);
-                      printf("Failed to read x position!\n");
-                      printf(RESET_COLOR);
-                      print_HidP_errors(hidpReturnCode, __FILE__, __LINE__);
-                      exit(-1);
-                    }
-
-                    ULONG xPos = usageValue;
-
-                    hidpReturnCode = HidP_GetUsageValue(HidP_Input, 0x01, collectionInfo.LinkColID, 0x31, &usageValue, preparsedHIDData, (PCHAR)rawInputData->data.hid.bRawData, rawInputData->data.hid.dwSizeHid);
-                    if (hidpReturnCode != HIDP_STATUS_SUCCESS)
-                    {
-                      printf(FG_RED);
-                      printf("Failed to read y position!\n");
-                      printf(RESET_COLOR);
-                      print_HidP_errors(hidpReturnCode, __FILE__, __LINE__);
-                      exit(-1);
-                    }
-
-                    ULONG yPos = usageValue;
-
-                    hidpReturnCode = HidP_GetUsageValue(HidP_Input, HID_USAGE_PAGE_DIGITIZER, collectionInfo.LinkColID, HID_USAGE_DIGITIZER_CONTACT_ID, &usageValue, preparsedHIDData, (PCHAR)rawInputData->data.hid.bRawData, rawInputData->data.hid.dwSizeHid);
-                    if (hidpReturnCode != HIDP_STATUS_SUCCESS)
-                    {
-                      printf(FG_RED);
-                      printf("Failed to read touch ID!\n");
-                      printf(RESET_COLOR);
-                      print_HidP_errors(hidpReturnCode, __FILE__, __LINE__);
-                      exit(-1);
-                    }
-
-                    ULONG touchId = usageValue;
-
-                    const ULONG maxNumButtons = HidP_MaxUsageListLength(HidP_Input, HID_USAGE_PAGE_DIGITIZER, preparsedHIDData);
-
-                    ULONG _maxNumButtons = maxNumButtons;
-
-                    USAGE* buttonUsageArray = (USAGE*)mMalloc(sizeof(USAGE) * maxNumButtons, __FILE__, __LINE__);
-
-                    hidpReturnCode = HidP_GetUsages(HidP_Input, HID_USAGE_PAGE_DIGITIZER, collectionInfo.LinkColID, buttonUsageArray, &_maxNumButtons, preparsedHIDData, (PCHAR)rawInputData->data.hid.bRawData, rawInputData->data.hid.dwSizeHid);
-
-                    if (hidpReturnCode != HIDP_STATUS_SUCCESS)
-                    {
-                      printf(FG_RED);
-                      printf("HidP_GetUsages failed!\n");
-                      printf(RESET_COLOR);
-                      print_HidP_errors(hidpReturnCode, __FILE__, __LINE__);
-                      exit(-1);
-                    }
-
-                    int isContactOnSurface = 0;
-
-                    for (ULONG usageIdx = 0; usageIdx < maxNumButtons; usageIdx++)
-                    {
-                      if (buttonUsageArray[usageIdx] == HID_USAGE_DIGITIZER_TIP_SWITCH)
-                      {
-                        isContactOnSurface = 1;
-                        break;
-                      }
-                    }
-
-                    free(buttonUsageArray);
-
-                    TOUCH_DATA curTouch;
-                    curTouch.TouchID   = touchId;
-                    curTouch.X         = xPos;
-                    curTouch.Y         = yPos;
-                    curTouch.OnSurface = isContactOnSurface;
-
-                    unsigned int touchType;
-                    int cStyleFunctionReturnCode = mInterpretRawTouchInput(&g_app_state->previous_touches, curTouch, &touchType);
-                    if (cStyleFunctionReturnCode != 0)
-                    {
-                      printf(FG_RED);
-                      printf("mInterpretRawTouchInput failed at %s:%d\n", __FILE__, __LINE__);
-                      printf(RESET_COLOR);
-                      exit(-1);
-                    }
-
-                    Point2D touchPos = (Point2D){.X = curTouch.X, .Y = curTouch.Y};
-
-                    if (g_app_state->tracking_touch_id == (ULONG)-1)
-                    {
-                      if (touchType == EVENT_TYPE_TOUCH_DOWN)
-                      {
-                        g_app_state->tracking_touch_id = curTouch.TouchID;
-                        // TODO create new stroke
-                        // TODO check return value for indication of errors
-                        mCreateNewStroke(touchPos, &g_app_state->strokes);
-                      }
-                      else
-                      {
-                        // wait for touch down event to register new stroke
-                      }
-                    }
-                    else if (curTouch.TouchID == g_app_state->tracking_touch_id)
-                    {
-                      if (touchType == EVENT_TYPE_TOUCH_MOVE)
-                      {
-                        // we skip EVENT_TYPE_TOUCH_MOVE_UNCHANGED here
-                        // TODO append touch position to the last stroke
-                        if ((g_app_state->strokes.Entries == NULL) || (g_app_state->strokes.Size == 0))
-                        {
-                          printf(FG_RED);
-                          printf("The application state is broken!\n");
-                          printf(RESET_COLOR);
-                          exit(-1);
-                        }
-                        else
-                        {
-                          // TODO check return value for indication of errors
-                          mAppendPoint2DToList(touchPos, &g_app_state->strokes.Entries[g_app_state->strokes.Size - 1]);
-
-                          Point2DList stroke = g_app_state->strokes.Entries[g_app_state->strokes.Size - 1];
-                          if (stroke.Size < 2)
-                          {
-                            printf(FG_RED);
-                            printf("The application state is broken!\n");
-                            printf(RESET_COLOR);
-                            exit(-1);
-                          }
-                          else
-                          {
-                            HDC hdc        = GetDC(hwnd);
-                            HPEN strokePen = CreatePen(PS_SOLID, 20, RGB(255, 255, 255));
-                            SelectObject(hdc, strokePen);
-                            MoveToEx(hdc, (int)stroke.Entries[stroke.Size - 2].X, (int)stroke.Entries[stroke.Size - 2].Y, (LPPOINT)NULL);
-                            LineTo(hdc, (int)stroke.Entries[stroke.Size - 1].X, (int)stroke.Entries[stroke.Size - 1].Y);
-                            ReleaseDC(hwnd, hdc);
-                          }
-                        }
-                      }
-                      else if (touchType == EVENT_TYPE_TOUCH_UP)
-                      {
-                        // I sure that the touch position is the same with the last touch position
-                        g_app_state->tracking_touch_id = (ULONG)-1;
-                      }
-                    }
-
-#ifdef LOG_EVERY_INPUT_MESSAGES
-                    const char* touchTypeStr;
-
-                    if (touchType == EVENT_TYPE_TOUCH_UP)
-                    {
-                      touchTypeStr = "touch up";
-                    }
-                    else if (touchType == EVENT_TYPE_TOUCH_MOVE)
-                    {
-                      touchTypeStr = "touch move";
-                    }
-                    else if (touchType == EVENT_TYPE_TOUCH_DOWN)
-                    {
-                      touchTypeStr = "touch down";
-                    }
-                    else if (touchType == EVENT_TYPE_TOUCH_MOVE_UNCHANGED)
-                    {
-                      touchTypeStr = "touch move unchanged";
-                    }
-                    else
-                    {
-                      printf(FG_RED);
-                      printf("unknown event type: %d\n", touchType);
-                      printf(RESET_COLOR);
-                      exit(-1);
-                    }
-
-                    printf(FG_GREEN);
-                    printf("LinkColId: %d, touchID: %d, tipSwitch: %d, position: (%d, %d), eventType: %s\n", collectionInfo.LinkColID, touchId, isContactOnSurface, xPos, yPos, touchTypeStr);
-                    printf(RESET_COLOR);
-#endif
-                  }
+                  // the UI thread is stuck, do not block the input thread for it
+                  g_app_state->num_dropped_touch_events += numTouchEvents - numPushed;
+
+                  mLogEvent(g_app_state->input_log_writer, EVENT_LOG_TOUCH_EVENTS_DROPPED, numTouchEvents - numPushed, (unsigned int)g_app_state->num_dropped_touch_events, 0, 0, 0);
                 }
+
+                numTouchEvents = 0;
               }
+
+              mLogEvent(g_app_state->input_log_writer, EVENT_LOG_TOUCH_CONTACT, curTouch.SequenceNumber, curTouch.TouchID, curTouch.X, curTouch.Y, touchType | ((curTouch.OnSurface ? 1 : 0) << 8));
             }
-          }
 
-          free(deviceName);
+            // wake up the UI thread once, it drains everything that is in the ring
+            if ((numContacts != 0) && (mAtomicExchange(&g_app_state->is_touch_event_message_posted, 1) == 0))
+            {
+              PostMessage(g_app_state->main_window, WM_APP_TOUCH_EVENTS, 0, 0);
+            }
+          }
         }
       }
 
@@ -629,61 +619,372 @@ void mHandleInputMessage(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
   }
 }
 
-void mHandleResizeMessage(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam)
+// called on the recognition worker thread
+void mPostRecognitionResult(void* arg)
 {
-  InvalidateRect(hwnd, NULL, FALSE);
+  PostMessage(g_app_state->main_window, WM_APP_RECOGNITION_RESULT, 0, 0);
 }
 
-void mHandlePaintMessage(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam)
+// Print the candidates of the strokes since the canvas was cleared (recognized as one character).
+void mHandleRecognitionResultMessage(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
-  // clock_t ts = clock();
-  HDC hdc;
-  PAINTSTRUCT ps;
-  RECT rc;
+  RECOGNITION_RESULT result;
+  if (mTakeRecognitionResult(&g_app_state->recognition_worker, &result) != 0)
+  {
+    // replaced by a newer stroke or cleared
+    return;
+  }
 
-  GetClientRect(hwnd, &rc);
+  double milliseconds = (double)(mGetTimestamp() - result.SubmitTimestamp) * 1e3 / (double)mGetTimestampFrequency();
+
+  unsigned int firstCodePoint = (result.NumCandidates != 0) ? result.Candidates[0].CodePoint : 0;
+  mLogEvent(g_app_state->ui_log_writer, EVENT_LOG_RECOGNITION_RESULT, result.NumStrokes, result.NumCandidates, firstCodePoint, (unsigned int)(milliseconds * 1e3), 0);
 
-  if (rc.bottom == 0)
+  printf("%u stroke(s) (%.2f ms):", result.NumStrokes, milliseconds);
+  for (unsigned int candidateIdx = 0; candidateIdx < result.NumCandidates; candidateIdx++)
   {
-    return;
+    printf(" U+%04X (%.2f)", result.Candidates[candidateIdx].CodePoint, result.Candidates[candidateIdx].Distance);
   }
+  printf("\n");
+}
 
-  hdc = BeginPaint(hwnd, &ps);
+// Draw the segments of the simplified view of the last stroke up to its
+// endPointIdx-th point. The live ink is drawn from the same geometry as the
+// repaints (mDrawCanvasStrokes and mRedrawCanvasRect) so that a partial
+// repaint matches the pixels around it.
+void mDrawLastStrokeSegments(unsigned int endPointIdx)
+{
+  Point2D* simplifiedPoints = mGetSimplifiedStrokePoints(&g_app_state->strokes, g_app_state->strokes.Size - 1);
 
-  // draw black background
-  HBRUSH bgBrush = CreateSolidBrush(RGB(0, 0, 0));
-  FillRect(hdc, &rc, bgBrush);
+  for (; g_app_state->num_drawn_simplified_points < endPointIdx; g_app_state->num_drawn_simplified_points++)
+  {
+    unsigned int pointIdx = g_app_state->num_drawn_simplified_points;
+    if ((pointIdx != 0) && (g_app_state->canvas_dc != NULL))
+    {
+      mDrawCanvasSegment(&g_app_state->canvas, simplifiedPoints[pointIdx - 1], simplifiedPoints[pointIdx], STROKE_WIDTH, STROKE_COLOR);
+    }
+  }
+}
 
-  // TODO change color for every strokes
-  HPEN strokePen = CreatePen(PS_SOLID, 20, RGB(255, 255, 255));
-  SelectObject(hdc, strokePen);
+// Build the strokes from the touch events of the input thread, draw the new segments and resample them.
+void mHandleTouchEventsMessage(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+  // Clear the flag before draining so that the input thread posts a new
+  // message for the events that it pushes after we have looked at the ring.
+  // It must be a full barrier so that the ring is not read before the flag is cleared.
+  mAtomicExchange(&g_app_state->is_touch_event_message_posted, 0);
 
-  if ((g_app_state->strokes.Entries != NULL) && (g_app_state->strokes.Size != 0))
+  TOUCH_EVENT touchEvents[TOUCH_EVENT_DRAIN_BATCH_SIZE];
+  unsigned int numTouchEvents;
+  unsigned int numDrainedTouchEvents = 0;
+
+  while ((numTouchEvents = mPopFromSpscRing(&g_app_state->touch_event_ring, touchEvents, TOUCH_EVENT_DRAIN_BATCH_SIZE)) != 0)
   {
-    for (unsigned int strokeIdx = 0; strokeIdx < g_app_state->strokes.Size; strokeIdx++)
+    numDrainedTouchEvents += numTouchEvents;
+
+    for (unsigned int eventIdx = 0; eventIdx < numTouchEvents; eventIdx++)
     {
-      // TODO change rendering color for each strokes
-      Point2DList strokeData = g_app_state->strokes.Entries[strokeIdx];
-      if (strokeData.Size < 2)
+      unsigned int strokeEvent;
+      if (mAddTouchEventToStrokes(touchEvents[eventIdx].Touch, touchEvents[eventIdx].EventType, &g_app_state->tracking_touch_id, &g_app_state->strokes, &strokeEvent) != 0)
       {
-        // TODO improve rendering strokes logic
-        continue;
+        printf(FG_RED);
+        printf("The application state is broken!\n");
+        printf(RESET_COLOR);
+        exit(-1);
       }
-      else
+
+      if (strokeEvent != STROKE_EVENT_NONE)
+      {
+        mSetLastStrokeTimestamp(&g_app_state->strokes, touchEvents[eventIdx].Timestamp);
+      }
+
+      if (strokeEvent == STROKE_EVENT_NEW_STROKE)
+      {
+        // drops the strokes that could be redone
+        mRecordNewStroke(&g_app_state->edit_log, &g_app_state->strokes);
+        g_app_state->num_drawn_simplified_points = 0;
+      }
+      else if (strokeEvent == STROKE_EVENT_NEW_SEGMENT)
+      {
+        StrokeIndexEntry stroke = g_app_state->strokes.Entries[g_app_state->strokes.Size - 1];
+        if (stroke.Size < 2)
+        {
+          printf(FG_RED);
+          printf("The application state is broken!\n");
+          printf(RESET_COLOR);
+          exit(-1);
+        }
+
+        // the last point of the simplified view can still move
+        mDrawLastStrokeSegments(mGetFinalSimplifiedSize(&g_app_state->strokes));
+      }
+      else if (strokeEvent == STROKE_EVENT_END_STROKE)
       {
-        MoveToEx(hdc, (int)strokeData.Entries[0].X, (int)strokeData.Entries[0].Y, (LPPOINT)NULL);
+        mDrawLastStrokeSegments(g_app_state->strokes.Entries[g_app_state->strokes.Size - 1].SimplifiedSize);
+
+        StrokeList visibleStrokes;
+        mGetVisibleStrokes(&g_app_state->edit_log, &g_app_state->strokes, &visibleStrokes);
 
-        for (unsigned int pointIdx = 1; pointIdx < strokeData.Size; pointIdx++)
+        // points that do not fit are counted in NumDroppedPoints
+        mUpdateStrokeResampler(&g_app_state->stroke_resampler, &visibleStrokes);
+        mFinishResampledStroke(&g_app_state->stroke_resampler);
+
+        if (g_app_state->is_recognizer_loaded)
         {
-          LineTo(hdc, (int)strokeData.Entries[pointIdx].X, (int)strokeData.Entries[pointIdx].Y);
+          mSubmitRecognitionRequest(&g_app_state->recognition_worker, &g_app_state->stroke_resampler);
         }
       }
+
+      if (strokeEvent != STROKE_EVENT_NONE)
+      {
+        // the index of the stroke after the edit log has moved it
+        unsigned int lastStrokeIdx = g_app_state->strokes.Size - 1;
+        mLogEvent(g_app_state->ui_log_writer, EVENT_LOG_STROKE_EVENT, strokeEvent, lastStrokeIdx, g_app_state->strokes.Entries[lastStrokeIdx].Size, 0, 0);
+      }
     }
   }
 
+  mLogEvent(g_app_state->ui_log_writer, EVENT_LOG_TOUCH_EVENTS_DRAINED, numDrainedTouchEvents, 0, 0, 0, 0);
+
+  // resample the new points of the whole burst at once
+  StrokeList visibleStrokes;
+  mGetVisibleStrokes(&g_app_state->edit_log, &g_app_state->strokes, &visibleStrokes);
+  mUpdateStrokeResampler(&g_app_state->stroke_resampler, &visibleStrokes);
+
+  if (g_app_state->is_segment_grid_ready)
+  {
+    mUpdateSegmentGrid(&g_app_state->segment_grid, &g_app_state->strokes);
+  }
+
+  // repaint only the area of the new segments
+  RECT dirtyRect;
+  if (mTakeCanvasDirtyRect(&g_app_state->canvas, &dirtyRect) == 0)
+  {
+    InvalidateRect(hwnd, &dirtyRect, FALSE);
+  }
+}
+
+void mFreeCanvasBackbuffer()
+{
+  if (g_app_state->canvas_dc != NULL)
+  {
+    SelectObject(g_app_state->canvas_dc, g_app_state->canvas_last_bitmap);
+    DeleteObject(g_app_state->canvas_bitmap);
+    DeleteDC(g_app_state->canvas_dc);
+
+    g_app_state->canvas_dc          = NULL;
+    g_app_state->canvas_bitmap      = NULL;
+    g_app_state->canvas_last_bitmap = NULL;
+  }
+}
+
+// (Re)create the backbuffer with the size of the client area and redraw all the strokes into it.
+void mResizeCanvasBackbuffer(HWND hwnd)
+{
+  RECT rc;
+  GetClientRect(hwnd, &rc);
+
+  int width  = rc.right - rc.left;
+  int height = rc.bottom - rc.top;
+
+  if ((width <= 0) || (height <= 0))
+  {
+    // minimized, keep the old backbuffer
+    return;
+  }
+
+  if ((g_app_state->canvas_dc != NULL) && (g_app_state->canvas.Width == width) && (g_app_state->canvas.Height == height))
+  {
+    return;
+  }
+
+  mFreeCanvasBackbuffer();
+
+  BITMAPINFO bitmapInfo;
+  memset(&bitmapInfo, 0, sizeof(BITMAPINFO));
+  bitmapInfo.bmiHeader.biSize  = sizeof(BITMAPINFOHEADER);
+  bitmapInfo.bmiHeader.biWidth = width;
+  // negative height for a top-down bitmap like the canvas
+  bitmapInfo.bmiHeader.biHeight      = -height;
+  bitmapInfo.bmiHeader.biPlanes      = 1;
+  bitmapInfo.bmiHeader.biBitCount    = 32;
+  bitmapInfo.bmiHeader.biCompression = BI_RGB;
+
+  void* pixels         = NULL;
+  HBITMAP canvasBitmap = CreateDIBSection(NULL, &bitmapInfo, DIB_RGB_COLORS, &pixels, NULL, 0);
+  HDC canvasDC         = CreateCompatibleDC(NULL);
+
+  if ((canvasBitmap == NULL) || (canvasDC == NULL))
+  {
+    printf(FG_RED);
+    printf("Failed to create the %dx%d backbuffer at %s:%d\n", width, height, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    mGetLastError();
+
+    if (canvasBitmap != NULL)
+    {
+      DeleteObject(canvasBitmap);
+    }
+
+    if (canvasDC != NULL)
+    {
+      DeleteDC(canvasDC);
+    }
+
+    return;
+  }
+
+  g_app_state->canvas_dc          = canvasDC;
+  g_app_state->canvas_bitmap      = canvasBitmap;
+  g_app_state->canvas_last_bitmap = SelectObject(canvasDC, canvasBitmap);
+
+  // a 32 bits per pixel DIB section has no padding between the rows
+  mInitializeCanvas(&g_app_state->canvas, (unsigned int*)pixels, width, height, width);
+  StrokeList visibleStrokes;
+  mGetVisibleStrokes(&g_app_state->edit_log, &g_app_state->strokes, &visibleStrokes);
+
+  mFillCanvas(&g_app_state->canvas, BACKGROUND_COLOR);
+  mDrawCanvasStrokes(&g_app_state->canvas, &visibleStrokes, STROKE_WIDTH, STROKE_COLOR);
+
+  // the stroke that is being drawn continues from its last final point
+  g_app_state->num_drawn_simplified_points = mGetFinalSimplifiedSize(&g_app_state->strokes);
+}
+
+void mHandleResizeMessage(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam)
+{
+  mResizeCanvasBackbuffer(hwnd);
+
+  // the whole backbuffer is copied below
+  RECT dirtyRect;
+  mTakeCanvasDirtyRect(&g_app_state->canvas, &dirtyRect);
+
+  InvalidateRect(hwnd, NULL, FALSE);
+}
+
+void mHandlePaintMessage(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam)
+{
+  PAINTSTRUCT ps;
+  HDC hdc = BeginPaint(hwnd, &ps);
+
+  // the strokes are already in the backbuffer, copy the invalidated area
+  if (g_app_state->canvas_dc != NULL)
+  {
+    int width  = ps.rcPaint.right - ps.rcPaint.left;
+    int height = ps.rcPaint.bottom - ps.rcPaint.top;
+
+    BitBlt(hdc, ps.rcPaint.left, ps.rcPaint.top, width, height, g_app_state->canvas_dc, ps.rcPaint.left, ps.rcPaint.top, SRCCOPY);
+  }
+
   EndPaint(hwnd, &ps);
 }
 
+// called on the export writer thread
+void mPostStrokeExportDone(void* arg)
+{
+  PostMessage(g_app_state->main_window, WM_APP_STROKE_EXPORT_DONE, 0, 0);
+}
+
+void mHandleStrokeExportDoneMessage(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+  STROKE_EXPORT_COMPLETION completion;
+  while (mTakeStrokeExportCompletion(&g_app_state->export_writer, &completion) == 0)
+  {
+    double milliseconds = (double)(completion.FinishTimestamp - completion.SubmitTimestamp) * 1e3 / (double)mGetTimestampFrequency();
+
+    if (completion.Status == STROKE_EXPORT_STATUS_WRITTEN)
+    {
+      printf(FG_GREEN);
+      printf("Exported %u stroke(s) to %s (%llu bytes, %.2f ms)\n", completion.NumStrokes, completion.FilePath, (unsigned long long)completion.cbFile, milliseconds);
+      printf(RESET_COLOR);
+    }
+    else if (completion.Status == STROKE_EXPORT_STATUS_COALESCED)
+    {
+      printf("Skipped %s, a newer save replaced it\n", completion.FilePath);
+    }
+  }
+}
+
+// Write the strokes since the canvas was cleared to a new file.
+void mExportStrokes()
+{
+  char filePath[64];
+  time_t now = time(NULL);
+  strftime(filePath, sizeof(filePath), STROKE_EXPORT_FILE_NAME_FORMAT, localtime(&now));
+
+  StrokeList visibleStrokes;
+  mGetVisibleStrokes(&g_app_state->edit_log, &g_app_state->strokes, &visibleStrokes);
+
+  if (g_app_state->is_export_writer_running)
+  {
+    // only the snapshot is taken here, the writer thread reports the file with WM_APP_STROKE_EXPORT_DONE
+    mRequestStrokeExport(&g_app_state->export_writer, &visibleStrokes, filePath, &g_app_state->touchpad_physical_rect);
+    return;
+  }
+
+  unsigned long long startTime = mGetTimestamp();
+  if (mWriteStrokeExport(filePath, &visibleStrokes, &g_app_state->touchpad_physical_rect) != 0)
+  {
+    return;
+  }
+  double milliseconds = (double)(mGetTimestamp() - startTime) * 1e3 / (double)mGetTimestampFrequency();
+
+  printf(FG_GREEN);
+  printf("Exported %u stroke(s) to %s (%.2f ms)\n", visibleStrokes.Size, filePath, milliseconds);
+  printf(RESET_COLOR);
+}
+
+// Undo or redo one edit, only the area of the strokes that appeared or disappeared is repainted.
+void mUndoRedoStrokeEdit(HWND hwnd, int isRedo)
+{
+  RECT changedBounds;
+  int retval = isRedo ? mRedoStrokeEdit(&g_app_state->edit_log, &g_app_state->strokes, &changedBounds) : mUndoStrokeEdit(&g_app_state->edit_log, &g_app_state->strokes, &changedBounds);
+  if (retval != 0)
+  {
+    return;
+  }
+
+  // the stroke that is being drawn may have been undone, wait for the next touch down
+  g_app_state->tracking_touch_id = (ULONG)-1;
+  mAtomicStoreRelease(&g_app_state->is_contact_table_reset_requested, 1);
+
+  StrokeList visibleStrokes;
+  mGetVisibleStrokes(&g_app_state->edit_log, &g_app_state->strokes, &visibleStrokes);
+
+  // the visible strokes are recognized again as one character
+  mClearStrokeResampler(&g_app_state->stroke_resampler);
+  mUpdateStrokeResampler(&g_app_state->stroke_resampler, &visibleStrokes);
+  mFinishResampledStroke(&g_app_state->stroke_resampler);
+
+  if (g_app_state->is_recognizer_loaded)
+  {
+    mResetRecognitionWorker(&g_app_state->recognition_worker);
+
+    if (visibleStrokes.Size != 0)
+    {
+      mSubmitRecognitionRequest(&g_app_state->recognition_worker, &g_app_state->stroke_resampler);
+    }
+  }
+
+  if (g_app_state->canvas_dc != NULL)
+  {
+    RECT dirtyRect;
+    if (g_app_state->is_segment_grid_ready)
+    {
+      mUpdateSegmentGrid(&g_app_state->segment_grid, &g_app_state->strokes);
+      mRedrawCanvasRectIndexed(&g_app_state->canvas, &changedBounds, &g_app_state->segment_grid, &g_app_state->strokes, g_app_state->edit_log.FirstVisibleStroke, g_app_state->edit_log.EndVisibleStroke, &g_app_state->redraw_segments, STROKE_WIDTH, STROKE_COLOR, BACKGROUND_COLOR);
+    }
+    else
+    {
+      mRedrawCanvasRect(&g_app_state->canvas, &changedBounds, &visibleStrokes, STROKE_WIDTH, STROKE_COLOR, BACKGROUND_COLOR);
+    }
+
+    if (mTakeCanvasDirtyRect(&g_app_state->canvas, &dirtyRect) == 0)
+    {
+      InvalidateRect(hwnd, &dirtyRect, FALSE);
+    }
+  }
+}
+
 void mHandleKeyUpMessage(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam)
 {
   clock_t ts = clock();
@@ -692,16 +993,18 @@ void mHandleKeyUpMessage(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In
   printf("[%d] WM_KEYUP: 0x%x\n", ts, wParam);
   printf(RESET_COLOR);
 
+  mLogEvent(g_app_state->ui_log_writer, EVENT_LOG_KEY_UP, (unsigned int)wParam, 0, 0, 0, 0);
+
   int virtual_key_code = (int)wParam;
   if (virtual_key_code == g_app_state->turn_off_drawing_key_code)
   {
-    g_app_state->is_drawing = 0;
+    mAtomicStoreRelease(&g_app_state->is_drawing, 0);
 
     g_app_state->call_unblock_input_flag = 1;
   }
   else if (virtual_key_code == g_app_state->turn_on_drawing_key_code)
   {
-    g_app_state->is_drawing = 1;
+    mAtomicStoreRelease(&g_app_state->is_drawing, 1);
 
     g_app_state->call_block_input_flag = 1;
   }
@@ -709,33 +1012,39 @@ void mHandleKeyUpMessage(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In
   {
     g_app_state->tracking_touch_id = (ULONG)-1;
 
-    if (g_app_state->previous_touches.Entries != NULL)
+    // the contact table belongs to the input thread
+    mAtomicStoreRelease(&g_app_state->is_contact_table_reset_requested, 1);
+
+    // the strokes are only hidden so that the clear can be undone
+    mRecordClear(&g_app_state->edit_log, &g_app_state->strokes);
+    mClearStrokeResampler(&g_app_state->stroke_resampler);
+
+    if (g_app_state->is_recognizer_loaded)
     {
-      free(g_app_state->previous_touches.Entries);
-      g_app_state->previous_touches.Entries = NULL;
-      g_app_state->previous_touches.Size    = 0;
+      mResetRecognitionWorker(&g_app_state->recognition_worker);
     }
 
-    if (g_app_state->strokes.Entries != NULL)
+    if (g_app_state->canvas_dc != NULL)
     {
-      for (unsigned int strokeIdx = 0; strokeIdx < g_app_state->strokes.Size; strokeIdx++)
-      {
-        Point2DList stroke = g_app_state->strokes.Entries[strokeIdx];
-        if (stroke.Entries != NULL)
-        {
-          free(stroke.Entries);
-          stroke.Entries = NULL;
-          stroke.Size    = 0;
-        }
-      }
-
-      free(g_app_state->strokes.Entries);
-      g_app_state->strokes.Entries = NULL;
-      g_app_state->strokes.Size    = 0;
+      RECT dirtyRect;
+      mFillCanvas(&g_app_state->canvas, BACKGROUND_COLOR);
+      mTakeCanvasDirtyRect(&g_app_state->canvas, &dirtyRect);
     }
 
     InvalidateRect(hwnd, NULL, FALSE);
   }
+  else if (virtual_key_code == g_app_state->undo_stroke_key_code)
+  {
+    mUndoRedoStrokeEdit(hwnd, 0);
+  }
+  else if (virtual_key_code == g_app_state->redo_stroke_key_code)
+  {
+    mUndoRedoStrokeEdit(hwnd, 1);
+  }
+  else if (virtual_key_code == g_app_state->export_writing_data_key_code)
+  {
+    mExportStrokes();
+  }
   else if (virtual_key_code == g_app_state->quit_application_key_code)
   {
     PostQuitMessage(0);
@@ -748,14 +1057,19 @@ LRESULT CALLBACK WndProc(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In
 
   switch (uMsg)
   {
-    case WM_CREATE:
+    case WM_APP_TOUCH_EVENTS:
     {
-      mHandleCreateMessage(hwnd, uMsg, wParam, lParam);
+      mHandleTouchEventsMessage(hwnd, uMsg, wParam, lParam);
       break;
     }
-    case WM_INPUT:
+    case WM_APP_RECOGNITION_RESULT:
     {
-      mHandleInputMessage(hwnd, uMsg, wParam, lParam);
+      mHandleRecognitionResultMessage(hwnd, uMsg, wParam, lParam);
+      break;
+    }
+    case WM_APP_STROKE_EXPORT_DONE:
+    {
+      mHandleStrokeExportDoneMessage(hwnd, uMsg, wParam, lParam);
       break;
     }
     case WM_PAINT:
@@ -794,6 +1108,88 @@ LRESULT CALLBACK WndProc(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In
   return 0;
 }
 
+LRESULT CALLBACK InputWndProc(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam)
+{
+  switch (uMsg)
+  {
+    case WM_INPUT:
+    {
+      mHandleInputMessage(hwnd, uMsg, wParam, lParam);
+      break;
+    }
+    case WM_INPUT_DEVICE_CHANGE:
+    {
+      mHandleInputDeviceChangeMessage(hwnd, uMsg, wParam, lParam);
+      break;
+    }
+    case WM_DESTROY:
+    {
+      PostQuitMessage(0);
+      break;
+    }
+    default:
+    {
+      return DefWindowProc(hwnd, uMsg, wParam, lParam);
+    }
+  }
+
+  return 0;
+}
+
+// The input thread only decodes the reports and interprets the touch events
+// so that WM_INPUT is never queued behind painting on the UI thread. It
+// receives raw input through a message-only window.
+void mInputThread(void* arg)
+{
+  HINSTANCE hInstance = GetModuleHandle(NULL);
+
+  // the touch events are latency sensitive, the drawing is not
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL);
+
+  WNDCLASSEX wcex;
+  memset(&wcex, 0, sizeof(WNDCLASSEX));
+
+  wcex.cbSize        = sizeof(WNDCLASSEX);
+  wcex.lpfnWndProc   = InputWndProc;
+  wcex.hInstance     = hInstance;
+  wcex.lpszClassName = szInputWindowClass;
+
+  HWND inputWindow = NULL;
+
+  if (!RegisterClassEx(&wcex))
+  {
+    printf("RegisterClassEx failed at %s:%d\n", __FILE__, __LINE__);
+    mGetLastError();
+  }
+  else
+  {
+    inputWindow = CreateWindowEx(0, szInputWindowClass, NULL, 0, 0, 0, 0, 0, HWND_MESSAGE, NULL, hInstance, NULL);
+    if (inputWindow == NULL)
+    {
+      printf("CreateWindowEx failed at %s:%d\n", __FILE__, __LINE__);
+      mGetLastError();
+    }
+    else
+    {
+      mRegisterRawInput(inputWindow);
+    }
+  }
+
+  g_app_state->input_window = inputWindow;
+  SetEvent(g_app_state->input_window_ready_event);
+
+  if (inputWindow == NULL)
+  {
+    return;
+  }
+
+  MSG msg;
+  while (GetMessage(&msg, NULL, 0, 0))
+  {
+    DispatchMessage(&msg);
+  }
+}
+
 int CALLBACK wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow)
 {
   mParseConnectedInputDevices();
@@ -830,6 +1226,11 @@ int CALLBACK wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
           {
             // TODO Should we need to parse every single touch link collections? For now, I think one is sufficient.
             // TODO validate values (e.g. 0 or > screen size)
+            if ((g_app_state->touchpad_physical_rect.right == 0) && (g_app_state->touchpad_physical_rect.bottom == 0))
+            {
+              g_app_state->touchpad_physical_rect = linkCollectionInfo.PhysicalRect;
+            }
+
             if (linkCollectionInfo.PhysicalRect.right > nWidth)
             {
               nWidth = linkCollectionInfo.PhysicalRect.right;
@@ -854,6 +1255,14 @@ int CALLBACK wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
     return -1;
   }
 
+  // the touch points are in the coordinates of the touchpad
+  RECT gridBounds = g_app_state->touchpad_physical_rect;
+  if ((gridBounds.right <= gridBounds.left) || (gridBounds.bottom <= gridBounds.top))
+  {
+    gridBounds = (RECT){.left = 0, .top = 0, .right = nWidth, .bottom = nHeight};
+  }
+  g_app_state->is_segment_grid_ready = (mInitializeSegmentGrid(&g_app_state->segment_grid, &gridBounds, SEGMENT_GRID_CELL_SIZE) == 0);
+
   WNDCLASSEX wcex;
 
   wcex.cbSize        = sizeof(WNDCLASSEX);
@@ -885,6 +1294,25 @@ int CALLBACK wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
     return -1;
   }
 
+  g_app_state->main_window = hwnd;
+
+  mInitializeSpscRing(&g_app_state->touch_event_ring, sizeof(TOUCH_EVENT), TOUCH_EVENT_RING_CAPACITY);
+
+  g_app_state->input_window_ready_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+  if (mCreateThread(&g_app_state->input_thread, mInputThread, NULL) != 0)
+  {
+    return -1;
+  }
+
+  WaitForSingleObject(g_app_state->input_window_ready_event, INFINITE);
+  CloseHandle(g_app_state->input_window_ready_event);
+
+  if (g_app_state->input_window == NULL)
+  {
+    mJoinThread(&g_app_state->input_thread);
+    return -1;
+  }
+
   // make the window transparent
   SetWindowLong(hwnd, GWL_EXSTYLE, GetWindowLong(hwnd, GWL_EXSTYLE) | WS_EX_LAYERED);
   SetLayeredWindowAttributes(hwnd, RGB(0, 0, 0), 255, LWA_ALPHA | LWA_COLORKEY);
@@ -925,27 +1353,154 @@ int CALLBACK wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
     }
   }
 
+  // DefWindowProc destroys the input window and the input thread quits its message loop
+  PostMessage(g_app_state->input_window, WM_CLOSE, 0, 0);
+  mJoinThread(&g_app_state->input_thread);
+
+  mFreeCanvasBackbuffer();
+
   return (int)msg.wParam;
 }
 
-int main()
+int main(int argc, char* argv[])
 {
   g_app_state = (ApplicationState*)mMalloc(sizeof(ApplicationState), __FILE__, __LINE__);
 
-  g_app_state->device_info_list  = (HID_DEVICE_INFO_LIST){.Entries = NULL, .Size = 0};
-  g_app_state->previous_touches  = (TOUCH_DATA_LIST){.Entries = NULL, .Size = 0};
-  g_app_state->strokes           = (StrokeList){.Entries = NULL, .Size = 0};
-  g_app_state->tracking_touch_id = -1;
-  g_app_state->is_drawing        = 0;
+  g_app_state->device_info_list                 = (HID_DEVICE_INFO_LIST){.Entries = NULL, .Size = 0, .Capacity = 0};
+  g_app_state->device_registry                  = (DEVICE_REGISTRY){.HandleIndex = {.Slots = NULL, .Capacity = 0, .Size = 0}};
+  g_app_state->strokes                          = (StrokeList){.Entries = NULL, .Size = 0, .Capacity = 0, .SimplifyTolerance = STROKE_SIMPLIFY_TOLERANCE};
+  g_app_state->is_segment_grid_ready            = 0;
+  g_app_state->redraw_segments                  = (STROKE_SEGMENT_LIST){.Entries = NULL, .Size = 0, .Capacity = 0};
+  g_app_state->tracking_touch_id                = -1;
+  g_app_state->num_drawn_simplified_points      = 0;
+  g_app_state->touchpad_physical_rect           = (RECT){.left = 0, .top = 0, .right = 0, .bottom = 0};
+  g_app_state->touch_batch                      = (TOUCH_DATA_BATCH){.Entries = NULL, .EventTypes = NULL, .Size = 0, .Capacity = 0, .NumReports = 0};
+  g_app_state->report_sequence_number           = 0;
+  g_app_state->is_recording_trace               = 0;
+  g_app_state->num_traced_devices               = 0;
+  g_app_state->is_drawing                       = 0;
+  g_app_state->num_dropped_touch_events         = 0;
+  g_app_state->is_event_log_open                = 0;
+  g_app_state->input_log_writer                 = NULL;
+  g_app_state->ui_log_writer                    = NULL;
+  g_app_state->is_touch_event_message_posted    = 0;
+  g_app_state->is_contact_table_reset_requested = 0;
+  g_app_state->main_window                      = NULL;
+  g_app_state->input_window                     = NULL;
+  g_app_state->canvas                           = (CANVAS){.Pixels = NULL, .Width = 0, .Height = 0, .Stride = 0, .IsDirty = 0};
+  g_app_state->canvas_dc                        = NULL;
+  g_app_state->canvas_bitmap                    = NULL;
+  g_app_state->canvas_last_bitmap               = NULL;
+
+  mResetTouchContactTable(&g_app_state->previous_touches);
+  mInitializeStrokeEditLog(&g_app_state->edit_log, 0);
+  mInitializeStrokeResampler(&g_app_state->stroke_resampler, STROKE_RESAMPLER_MAX_POINTS, STROKE_RESAMPLER_MAX_STROKES, STROKE_RESAMPLE_SPACING);
+  mInitializeRecognizerDatabase(&g_app_state->recognizer_database);
+  g_app_state->recognizer_database.ShortlistSize = RECOGNIZER_SHORTLIST_SIZE;
+  g_app_state->is_recognizer_loaded              = 0;
 
   g_app_state->turn_off_drawing_key_code     = VK_ESCAPE;
   g_app_state->turn_on_drawing_key_code      = VK_F3;
   g_app_state->quit_application_key_code     = VK_Q_KEY;
   g_app_state->export_writing_data_key_code  = VK_S_KEY;
   g_app_state->clear_drawing_canvas_key_code = VK_C_KEY;
+  g_app_state->undo_stroke_key_code          = VK_Z_KEY;
+  g_app_state->redo_stroke_key_code          = VK_Y_KEY;
 
   g_app_state->call_block_input_flag   = 0;
   g_app_state->call_unblock_input_flag = 0;
 
-  return wWinMain(GetModuleHandle(NULL), NULL, GetCommandLine(), SW_SHOWNORMAL);
+  for (int argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if ((strcmp(argv[argIdx], "--record") == 0) && ((argIdx + 1) < argc))
+    {
+      argIdx++;
+      if (mOpenTouchTraceRecorder(argv[argIdx], &g_app_state->trace_recorder) == 0)
+      {
+        g_app_state->is_recording_trace = 1;
+
+        printf(FG_GREEN);
+        printf("Recording input reports to %s\n", argv[argIdx]);
+        printf(RESET_COLOR);
+      }
+    }
+    else if ((strcmp(argv[argIdx], "--log") == 0) && ((argIdx + 1) < argc))
+    {
+      argIdx++;
+      if (mOpenEventLog(argv[argIdx], EVENT_LOG_NUM_WRITERS, 0, &g_app_state->event_log) == 0)
+      {
+        g_app_state->is_event_log_open = 1;
+        g_app_state->input_log_writer  = &g_app_state->event_log.Writers[EVENT_LOG_WRITER_INPUT_THREAD];
+        g_app_state->ui_log_writer     = &g_app_state->event_log.Writers[EVENT_LOG_WRITER_UI_THREAD];
+
+        printf(FG_GREEN);
+        printf("Logging events to %s\n", argv[argIdx]);
+        printf(RESET_COLOR);
+      }
+    }
+    else if ((strcmp(argv[argIdx], "--templates") == 0) && ((argIdx + 1) < argc))
+    {
+      argIdx++;
+      if (mLoadRecognizerDatabase(argv[argIdx], &g_app_state->recognizer_database) == 0)
+      {
+        g_app_state->is_recognizer_loaded = 1;
+
+        printf(FG_GREEN);
+        printf("Loaded %u recognizer templates from %s\n", g_app_state->recognizer_database.NumTemplates, argv[argIdx]);
+        printf(RESET_COLOR);
+      }
+    }
+    else if ((strcmp(argv[argIdx], "--index") == 0) && ((argIdx + 1) < argc))
+    {
+      argIdx++;
+      if (mMapRecognizerIndex(argv[argIdx], &g_app_state->recognizer_database) == 0)
+      {
+        g_app_state->is_recognizer_loaded = 1;
+
+        printf(FG_GREEN);
+        printf("Mapped %u recognizer templates from %s\n", g_app_state->recognizer_database.NumTemplates, argv[argIdx]);
+        printf(RESET_COLOR);
+      }
+    }
+  }
+
+  if (g_app_state->is_recognizer_loaded && (mStartRecognitionWorker(&g_app_state->recognition_worker, &g_app_state->recognizer_database, RECOGNIZER_NUM_CANDIDATES, 0, mPostRecognitionResult, NULL) != 0))
+  {
+    g_app_state->is_recognizer_loaded = 0;
+  }
+
+  g_app_state->is_export_writer_running = (mStartStrokeExportWriter(&g_app_state->export_writer, mPostStrokeExportDone, NULL) == 0);
+
+  int exitCode = wWinMain(GetModuleHandle(NULL), NULL, GetCommandLine(), SW_SHOWNORMAL);
+
+  if (g_app_state->is_recording_trace)
+  {
+    mCloseTouchTraceRecorder(&g_app_state->trace_recorder);
+  }
+
+  if (g_app_state->is_recognizer_loaded)
+  {
+    mStopRecognitionWorker(&g_app_state->recognition_worker);
+  }
+
+  // the last save is written before the application exits
+  if (g_app_state->is_export_writer_running)
+  {
+    mStopStrokeExportWriter(&g_app_state->export_writer);
+  }
+
+  if (g_app_state->num_dropped_touch_events != 0)
+  {
+    printf(FG_YELLOW);
+    printf("The touch event ring was full, %llu event(s) dropped\n", g_app_state->num_dropped_touch_events);
+    printf(RESET_COLOR);
+  }
+
+  // the input thread has been joined by wWinMain, nothing logs anymore
+  if (g_app_state->is_event_log_open)
+  {
+    mCloseEventLog(&g_app_state->event_log);
+  }
+
+  return exitCode;
 };
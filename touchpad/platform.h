@@ -0,0 +1,33 @@
+#ifndef __PLATFORM_H__
+#define __PLATFORM_H__
+// Modules that do not call the Windows API only need a handful of its types.
+// Including this header instead of Windows.h lets them be built and profiled
+// on other platforms (e.g. Linux).
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Windows uses the LLP64 data model so LONG and ULONG are 32 bits wide.
+typedef unsigned char BYTE;
+typedef unsigned short USHORT;
+typedef int LONG;
+typedef unsigned int ULONG;
+typedef unsigned int UINT;
+typedef char TCHAR;
+
+#define _tcscmp strcmp
+
+struct tagRECT
+{
+  LONG left;
+  LONG top;
+  LONG right;
+  LONG bottom;
+};
+
+typedef struct tagRECT RECT;
+#endif
+#endif  // __PLATFORM_H__
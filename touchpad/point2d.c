@@ -1,4 +1,4 @@
-#include <Windows.h>
+#include "platform.h"
 
 #include <stdio.h>
 
@@ -7,6 +7,11 @@
 #include "utils.h"
 #include "termcolor.h"
 
+static int mIsPoint2DListInline(Point2DList* list)
+{
+  return (list->Capacity != 0) && (list->Capacity <= POINT2D_LIST_INLINE_CAPACITY);
+}
+
 int mInitializePoint2DList(Point2D point, Point2DList* list)
 {
   int retval = 0;
@@ -20,11 +25,13 @@ int mInitializePoint2DList(Point2D point, Point2DList* list)
   }
   else
   {
-    list->Size    = 1;
-    list->Entries = (Point2D*)mMalloc(sizeof(Point2D), __FILE__, __LINE__);
+    // keep the memory that the list already owns (if any)
+    list->Size = 0;
+    retval     = mReservePoint2DList(1, list);
 
     list->Entries[0].X = point.X;
     list->Entries[0].Y = point.Y;
+    list->Size         = 1;
   }
 
   return retval;
@@ -49,24 +56,132 @@ int mAppendPoint2DToList(Point2D point, Point2DList* list)
     }
     else
     {
-      unsigned int newArraySize = list->Size + 1;
-      Point2D* newArray         = (Point2D*)mMalloc(sizeof(Point2D) * newArraySize, __FILE__, __LINE__);
-
-      for (unsigned int pIdx = 0; pIdx < list->Size; pIdx++)
+      if (list->Size == list->Capacity)
       {
-        newArray[pIdx].X = list->Entries[pIdx].X;
-        newArray[pIdx].Y = list->Entries[pIdx].Y;
+        // grow geometrically so that appending is amortized O(1)
+        retval = mReservePoint2DList(list->Capacity * 2, list);
       }
 
-      newArray[list->Size].X = point.X;
-      newArray[list->Size].Y = point.Y;
-
-      free(list->Entries);
-
-      list->Entries = newArray;
-      list->Size    = newArraySize;
+      list->Entries[list->Size].X = point.X;
+      list->Entries[list->Size].Y = point.Y;
+      list->Size++;
     }
   }
 
   return retval;
 }
+
+int mReservePoint2DList(unsigned int capacity, Point2DList* list)
+{
+  if (list == NULL)
+  {
+    printf(FG_RED);
+    printf("list argument is NULL!\n");
+    printf(RESET_COLOR);
+    exit(-1);
+    return -1;
+  }
+
+  if (capacity <= list->Capacity)
+  {
+    return 0;
+  }
+
+  if (capacity <= POINT2D_LIST_INLINE_CAPACITY)
+  {
+#if POINT2D_LIST_INLINE_CAPACITY > 0
+    // the list is empty at this point because it does not own any memory
+    list->Entries  = list->InlineEntries;
+    list->Capacity = POINT2D_LIST_INLINE_CAPACITY;
+#endif
+    return 0;
+  }
+
+  if (capacity < POINT2D_LIST_MIN_HEAP_CAPACITY)
+  {
+    capacity = POINT2D_LIST_MIN_HEAP_CAPACITY;
+  }
+
+  if (mIsPoint2DListInline(list))
+  {
+    Point2D* newArray = (Point2D*)mMalloc(sizeof(Point2D) * capacity, __FILE__, __LINE__);
+    memcpy(newArray, list->Entries, sizeof(Point2D) * list->Size);
+    list->Entries = newArray;
+  }
+  else
+  {
+    // realloc(NULL, size) behaves like malloc(size)
+    list->Entries = (Point2D*)mRealloc(list->Entries, sizeof(Point2D) * capacity, __FILE__, __LINE__);
+  }
+
+  list->Capacity = capacity;
+
+  return 0;
+}
+
+int mShrinkPoint2DListToFit(Point2DList* list)
+{
+  if (list == NULL)
+  {
+    printf(FG_RED);
+    printf("list argument is NULL!\n");
+    printf(RESET_COLOR);
+    exit(-1);
+    return -1;
+  }
+
+  if ((list->Capacity == list->Size) || mIsPoint2DListInline(list))
+  {
+    return 0;
+  }
+
+  if (list->Size == 0)
+  {
+    mFreePoint2DList(list);
+  }
+#if POINT2D_LIST_INLINE_CAPACITY > 0
+  else if (list->Size <= POINT2D_LIST_INLINE_CAPACITY)
+  {
+    Point2D* heapArray = list->Entries;
+    memcpy(list->InlineEntries, heapArray, sizeof(Point2D) * list->Size);
+    free(heapArray);
+
+    list->Entries  = list->InlineEntries;
+    list->Capacity = POINT2D_LIST_INLINE_CAPACITY;
+  }
+#endif
+  else
+  {
+    list->Entries  = (Point2D*)mRealloc(list->Entries, sizeof(Point2D) * list->Size, __FILE__, __LINE__);
+    list->Capacity = list->Size;
+  }
+
+  return 0;
+}
+
+void mRelocatePoint2DList(Point2DList* list)
+{
+#if POINT2D_LIST_INLINE_CAPACITY > 0
+  if (mIsPoint2DListInline(list))
+  {
+    list->Entries = list->InlineEntries;
+  }
+#endif
+}
+
+void mFreePoint2DList(Point2DList* list)
+{
+  if (list == NULL)
+  {
+    return;
+  }
+
+  if (!mIsPoint2DListInline(list))
+  {
+    free(list->Entries);
+  }
+
+  list->Entries  = NULL;
+  list->Size     = 0;
+  list->Capacity = 0;
+}
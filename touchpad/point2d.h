@@ -1,6 +1,17 @@
 #ifndef __POINT2D_H__
 #define __POINT2D_H__
-#include <Windows.h>
+#include "platform.h"
+
+// Number of points that are stored inside the Point2DList struct itself before
+// we have to allocate memory on the heap. Most strokes of a kanji are short so
+// this saves us from calling malloc for them at all.
+// Define it as 0 to disable the inline buffer.
+#ifndef POINT2D_LIST_INLINE_CAPACITY
+#define POINT2D_LIST_INLINE_CAPACITY 16
+#endif
+
+// The first heap allocation will hold at least this many points.
+#define POINT2D_LIST_MIN_HEAP_CAPACITY 64
 
 struct Point2D
 {
@@ -14,10 +25,22 @@ struct Point2DList
 {
   Point2D* Entries;
   unsigned int Size;
+  // number of points that Entries can hold without reallocating
+  // Capacity == 0 means that the list does not own any memory
+  // 0 < Capacity <= POINT2D_LIST_INLINE_CAPACITY means that Entries points to InlineEntries
+  unsigned int Capacity;
+#if POINT2D_LIST_INLINE_CAPACITY > 0
+  Point2D InlineEntries[POINT2D_LIST_INLINE_CAPACITY];
+#endif
 };
 
 typedef struct Point2DList Point2DList;
 
 int mInitializePoint2DList(Point2D point, Point2DList* list);
 int mAppendPoint2DToList(Point2D point, Point2DList* list);
+int mReservePoint2DList(unsigned int capacity, Point2DList* list);
+int mShrinkPoint2DListToFit(Point2DList* list);
+// Must be called after the Point2DList struct has been copied or moved to a new address (e.g. growing an array of lists).
+void mRelocatePoint2DList(Point2DList* list);
+void mFreePoint2DList(Point2DList* list);
 #endif  // __POINT2D_H__
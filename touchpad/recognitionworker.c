@@ -0,0 +1,194 @@
+#include "platform.h"
+
+#include <stdio.h>
+
+#include "recognitionworker.h"
+
+#include "utils.h"
+#include "termcolor.h"
+
+static void mRecognitionWorkerThread(void* arg)
+{
+  RECOGNITION_WORKER* worker = (RECOGNITION_WORKER*)arg;
+  RECOGNITION_RESULT result;
+
+  // created here so that this thread is worker 0 of the pool
+  mInitializeWorkPool(&worker->ScoringPool, worker->NumScoringThreads);
+
+  mLockThreadMutex(&worker->Mutex);
+
+  while (1)
+  {
+    if (worker->IsStopping)
+    {
+      break;
+    }
+
+    if (worker->IsResetPending)
+    {
+      mResetRecognizerSession(&worker->Session);
+      worker->IsResetPending = 0;
+      continue;
+    }
+
+    if (worker->TakenRequestIdx == worker->LastRequestIdx)
+    {
+      mWaitThreadCondition(&worker->RequestCondition, &worker->Mutex, THREAD_WAIT_INFINITE);
+      continue;
+    }
+
+    mCopyStrokeResampler(&worker->Strokes, &worker->PendingStrokes, RECOGNIZER_MAX_STROKES);
+    worker->TakenRequestIdx = worker->LastRequestIdx;
+    mAtomicStoreRelease(&worker->IsCancelRequested, 0);
+
+    memset(&result, 0, sizeof(RECOGNITION_RESULT));
+    result.RequestIdx      = worker->TakenRequestIdx;
+    result.NumStrokes      = worker->Strokes.NumStrokes;
+    result.SubmitTimestamp = worker->PendingTimestamp;
+
+    // the message loop can submit the next stroke while we score this one
+    mUnlockThreadMutex(&worker->Mutex);
+    int retval             = mRecognizeStrokesIncremental(worker->Database, &worker->Session, &worker->Strokes, &worker->ScoringPool, &worker->IsCancelRequested, result.Candidates, worker->MaxCandidates, &result.NumCandidates);
+    result.FinishTimestamp = mGetTimestamp();
+    mLockThreadMutex(&worker->Mutex);
+
+    // a newer request or a reset may have come in after the scoring finished
+    if ((retval != 0) || (result.RequestIdx != worker->LastRequestIdx) || worker->IsResetPending)
+    {
+      worker->NumCancelledRequests++;
+      continue;
+    }
+
+    worker->Result        = result;
+    worker->IsResultReady = 1;
+    worker->NumCompletedRequests++;
+
+    if (worker->ResultProc != NULL)
+    {
+      mUnlockThreadMutex(&worker->Mutex);
+      worker->ResultProc(worker->ResultArg);
+      mLockThreadMutex(&worker->Mutex);
+    }
+  }
+
+  mUnlockThreadMutex(&worker->Mutex);
+
+  mFreeWorkPool(&worker->ScoringPool);
+}
+
+int mStartRecognitionWorker(RECOGNITION_WORKER* worker, const RECOGNIZER_DATABASE* database, unsigned int maxCandidates, unsigned int numScoringThreads, RECOGNITION_RESULT_PROC resultProc, void* resultArg)
+{
+  memset(worker, 0, sizeof(RECOGNITION_WORKER));
+  worker->Database          = database;
+  worker->MaxCandidates     = (maxCandidates < RECOGNIZER_MAX_PARALLEL_CANDIDATES) ? maxCandidates : RECOGNIZER_MAX_PARALLEL_CANDIDATES;
+  worker->NumScoringThreads = numScoringThreads;
+  worker->ResultProc        = resultProc;
+  worker->ResultArg         = resultArg;
+
+  // the copies are never resampled so the spacing does not matter
+  mInitializeStrokeResampler(&worker->PendingStrokes, RECOGNITION_WORKER_POINT_CAPACITY, RECOGNIZER_MAX_STROKES, 1.0f);
+  mInitializeStrokeResampler(&worker->Strokes, RECOGNITION_WORKER_POINT_CAPACITY, RECOGNIZER_MAX_STROKES, 1.0f);
+  mInitializeRecognizerSession(&worker->Session, database);
+
+  mInitializeThreadMutex(&worker->Mutex);
+  mInitializeThreadCondition(&worker->RequestCondition);
+
+  if (mCreateThread(&worker->Thread, mRecognitionWorkerThread, worker) != 0)
+  {
+    printf(FG_RED);
+    printf("Failed to start the recognition worker at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+
+    mDestroyThreadCondition(&worker->RequestCondition);
+    mDestroyThreadMutex(&worker->Mutex);
+    mFreeRecognizerSession(&worker->Session);
+    mFreeStrokeResampler(&worker->Strokes);
+    mFreeStrokeResampler(&worker->PendingStrokes);
+    memset(worker, 0, sizeof(RECOGNITION_WORKER));
+    return -1;
+  }
+
+  return 0;
+}
+
+void mStopRecognitionWorker(RECOGNITION_WORKER* worker)
+{
+  if (worker->Database == NULL)
+  {
+    return;
+  }
+
+  mLockThreadMutex(&worker->Mutex);
+  worker->IsStopping = 1;
+  mAtomicStoreRelease(&worker->IsCancelRequested, 1);
+  mSignalThreadCondition(&worker->RequestCondition);
+  mUnlockThreadMutex(&worker->Mutex);
+
+  mJoinThread(&worker->Thread);
+
+  mDestroyThreadCondition(&worker->RequestCondition);
+  mDestroyThreadMutex(&worker->Mutex);
+  mFreeRecognizerSession(&worker->Session);
+  mFreeStrokeResampler(&worker->Strokes);
+  mFreeStrokeResampler(&worker->PendingStrokes);
+  memset(worker, 0, sizeof(RECOGNITION_WORKER));
+}
+
+unsigned int mSubmitRecognitionRequest(RECOGNITION_WORKER* worker, const STROKE_RESAMPLER* resampler)
+{
+  mLockThreadMutex(&worker->Mutex);
+
+  if (worker->TakenRequestIdx != worker->LastRequestIdx)
+  {
+    // the worker thread did not get to it
+    worker->NumReplacedRequests++;
+  }
+
+  mCopyStrokeResampler(&worker->PendingStrokes, resampler, RECOGNIZER_MAX_STROKES);
+  worker->PendingTimestamp = mGetTimestamp();
+  worker->LastRequestIdx++;
+  unsigned int requestIdx = worker->LastRequestIdx;
+
+  mAtomicStoreRelease(&worker->IsCancelRequested, 1);
+  mSignalThreadCondition(&worker->RequestCondition);
+  mUnlockThreadMutex(&worker->Mutex);
+
+  return requestIdx;
+}
+
+void mResetRecognitionWorker(RECOGNITION_WORKER* worker)
+{
+  mLockThreadMutex(&worker->Mutex);
+
+  if (worker->TakenRequestIdx != worker->LastRequestIdx)
+  {
+    worker->NumReplacedRequests++;
+  }
+
+  // forget the pending request without reusing its index
+  worker->TakenRequestIdx = worker->LastRequestIdx;
+  worker->IsResetPending  = 1;
+  worker->IsResultReady   = 0;
+
+  mAtomicStoreRelease(&worker->IsCancelRequested, 1);
+  mSignalThreadCondition(&worker->RequestCondition);
+  mUnlockThreadMutex(&worker->Mutex);
+}
+
+int mTakeRecognitionResult(RECOGNITION_WORKER* worker, RECOGNITION_RESULT* result)
+{
+  int retval = -1;
+
+  mLockThreadMutex(&worker->Mutex);
+
+  if (worker->IsResultReady)
+  {
+    (*result)             = worker->Result;
+    worker->IsResultReady = 0;
+    retval                = 0;
+  }
+
+  mUnlockThreadMutex(&worker->Mutex);
+
+  return retval;
+}
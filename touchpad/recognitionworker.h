@@ -0,0 +1,90 @@
+#ifndef __RECOGNITIONWORKER_H__
+#define __RECOGNITIONWORKER_H__
+#include "platform.h"
+
+#include "threading.h"
+#include "resampler.h"
+#include "workpool.h"
+#include "recognizer.h"
+
+// points of the strokes that a request can hold
+#define RECOGNITION_WORKER_POINT_CAPACITY 8192
+
+// called on the worker thread when a result can be taken
+typedef void (*RECOGNITION_RESULT_PROC)(void* arg);
+
+struct RECOGNITION_RESULT
+{
+  // the value that mSubmitRecognitionRequest returned for the request
+  unsigned int RequestIdx;
+  unsigned int NumStrokes;
+  RECOGNIZER_CANDIDATE Candidates[RECOGNIZER_MAX_PARALLEL_CANDIDATES];
+  unsigned int NumCandidates;
+  // mGetTimestamp when the request was submitted and when its scoring finished
+  unsigned long long SubmitTimestamp;
+  unsigned long long FinishTimestamp;
+};
+
+typedef struct RECOGNITION_RESULT RECOGNITION_RESULT;
+
+// Recognizes the character on a background thread so that the message loop
+// never waits for the scoring. The message loop submits the strokes when a
+// stroke ends, the worker thread scores them with a RECOGNIZER_SESSION (only
+// the new stroke is compared to most templates) on its own work pool and calls
+// ResultProc, e.g. to post a message to the window that takes the result.
+//
+// Only the newest request matters: a request that is still waiting is
+// replaced and one that is being scored is cancelled, its result is never
+// reported. The same happens to every request on mResetRecognitionWorker.
+struct RECOGNITION_WORKER
+{
+  const RECOGNIZER_DATABASE* Database;
+  unsigned int MaxCandidates;
+  unsigned int NumScoringThreads;
+  RECOGNITION_RESULT_PROC ResultProc;
+  void* ResultArg;
+
+  THREAD_MUTEX Mutex;
+  THREAD_CONDITION RequestCondition;
+  THREAD_HANDLE Thread;
+
+  // guarded by Mutex
+  STROKE_RESAMPLER PendingStrokes;
+  unsigned long long PendingTimestamp;
+  // index of the last submitted request (0 before the first one)
+  unsigned int LastRequestIdx;
+  // index of the last request that the worker thread took
+  unsigned int TakenRequestIdx;
+  int IsResetPending;
+  int IsStopping;
+  RECOGNITION_RESULT Result;
+  int IsResultReady;
+  unsigned int NumCancelledRequests;
+  unsigned int NumReplacedRequests;
+  unsigned int NumCompletedRequests;
+
+  // set when the request that is being scored is out of date
+  volatile unsigned int IsCancelRequested;
+
+  // owned by the worker thread
+  STROKE_RESAMPLER Strokes;
+  RECOGNIZER_SESSION Session;
+  WORK_POOL ScoringPool;
+};
+
+typedef struct RECOGNITION_WORKER RECOGNITION_WORKER;
+
+// numScoringThreads is the size of the work pool of the worker thread (0 for
+// one thread per processor), maxCandidates is at most
+// RECOGNIZER_MAX_PARALLEL_CANDIDATES. Returns -1 if the thread did not start.
+int mStartRecognitionWorker(RECOGNITION_WORKER* worker, const RECOGNIZER_DATABASE* database, unsigned int maxCandidates, unsigned int numScoringThreads, RECOGNITION_RESULT_PROC resultProc, void* resultArg);
+void mStopRecognitionWorker(RECOGNITION_WORKER* worker);
+// Queue the finished strokes of the resampler (they are copied), returns the
+// index of the request. Call it when a stroke ends.
+unsigned int mSubmitRecognitionRequest(RECOGNITION_WORKER* worker, const STROKE_RESAMPLER* resampler);
+// the strokes were cleared: drop the pending request and the session
+void mResetRecognitionWorker(RECOGNITION_WORKER* worker);
+// Returns 0 and the result of the newest request once per result, -1 if there
+// is none.
+int mTakeRecognitionResult(RECOGNITION_WORKER* worker, RECOGNITION_RESULT* result);
+#endif  // __RECOGNITIONWORKER_H__
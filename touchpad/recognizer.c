@@ -0,0 +1,1188 @@
+#include "platform.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "recognizer.h"
+
+#include "utils.h"
+#include "termcolor.h"
+
+// The first allocations of the database will hold at least this many templates / strokes.
+#define RECOGNIZER_MIN_TEMPLATE_CAPACITY 256
+#define RECOGNIZER_MIN_FEATURE_CAPACITY  (RECOGNIZER_MIN_TEMPLATE_CAPACITY * 8)
+
+#define RECOGNIZER_PI 3.14159265358979f
+
+// a template that made it through the index
+struct RECOGNIZER_SHORTLIST_ENTRY
+{
+  float Distance;
+  unsigned int TemplateIdx;
+};
+
+typedef struct RECOGNIZER_SHORTLIST_ENTRY RECOGNIZER_SHORTLIST_ENTRY;
+
+static void mUnmapRecognizerIndex(RECOGNIZER_INDEX_MAPPING* mapping);
+
+void mInitializeRecognizerDatabase(RECOGNIZER_DATABASE* database)
+{
+  memset(database, 0, sizeof(RECOGNIZER_DATABASE));
+#ifndef _WIN32
+  database->Mapping.File = -1;
+#endif
+}
+
+void mFreeRecognizerDatabase(RECOGNIZER_DATABASE* database)
+{
+  if (database->Mapping.Data != NULL)
+  {
+    mUnmapRecognizerIndex(&database->Mapping);
+  }
+  else
+  {
+    free(database->Templates);
+    free(database->Keys);
+    free(database->Features);
+  }
+
+  mInitializeRecognizerDatabase(database);
+}
+
+// Reduce a stroke to RECOGNIZER_POINTS_PER_STROKE points equally spaced along
+// its length after mapping it into the unit square, then add the direction and
+// the curvature at every point.
+static void mExtractStrokeFeatures(const RESAMPLED_POINT* points, unsigned int numPoints, float scale, float offsetX, float offsetY, RECOGNIZER_STROKE_FEATURES* features)
+{
+  float totalLength = 0.0f;
+  for (unsigned int pointIdx = 1; pointIdx < numPoints; pointIdx++)
+  {
+    float dx = (points[pointIdx].X - points[pointIdx - 1].X) * scale;
+    float dy = (points[pointIdx].Y - points[pointIdx - 1].Y) * scale;
+    totalLength += sqrtf((dx * dx) + (dy * dy));
+  }
+
+  // walk along the stroke once, segmentIdx is the segment that contains the target length
+  unsigned int segmentIdx = 1;
+  float segmentStart      = 0.0f;
+
+  for (unsigned int featureIdx = 0; featureIdx < RECOGNIZER_POINTS_PER_STROKE; featureIdx++)
+  {
+    float target = totalLength * (float)featureIdx / (float)(RECOGNIZER_POINTS_PER_STROKE - 1);
+    float x      = points[0].X;
+    float y      = points[0].Y;
+
+    while (segmentIdx < numPoints)
+    {
+      float dx            = points[segmentIdx].X - points[segmentIdx - 1].X;
+      float dy            = points[segmentIdx].Y - points[segmentIdx - 1].Y;
+      float segmentLength = sqrtf((dx * dx) + (dy * dy)) * scale;
+
+      if (((segmentStart + segmentLength) >= target) || (segmentIdx == (numPoints - 1)))
+      {
+        float t = (segmentLength > 0.0f) ? ((target - segmentStart) / segmentLength) : 1.0f;
+        t       = (t < 0.0f) ? 0.0f : ((t > 1.0f) ? 1.0f : t);
+        x       = points[segmentIdx - 1].X + (dx * t);
+        y       = points[segmentIdx - 1].Y + (dy * t);
+        break;
+      }
+
+      segmentStart += segmentLength;
+      segmentIdx++;
+    }
+
+    features->X[featureIdx] = (x - offsetX) * scale;
+    features->Y[featureIdx] = (y - offsetY) * scale;
+  }
+
+  for (unsigned int featureIdx = 0; featureIdx < RECOGNIZER_POINTS_PER_STROKE; featureIdx++)
+  {
+    unsigned int previousIdx = (featureIdx == 0) ? 0 : (featureIdx - 1);
+    unsigned int nextIdx     = (featureIdx == (RECOGNIZER_POINTS_PER_STROKE - 1)) ? featureIdx : (featureIdx + 1);
+    float dx                 = features->X[nextIdx] - features->X[previousIdx];
+    float dy                 = features->Y[nextIdx] - features->Y[previousIdx];
+    float length             = sqrtf((dx * dx) + (dy * dy));
+
+    features->DirX[featureIdx] = (length > 0.0f) ? (dx / length) : 0.0f;
+    features->DirY[featureIdx] = (length > 0.0f) ? (dy / length) : 0.0f;
+  }
+
+  features->Curvature[0]                                = 0.0f;
+  features->Curvature[RECOGNIZER_POINTS_PER_STROKE - 1] = 0.0f;
+  for (unsigned int featureIdx = 1; featureIdx < (RECOGNIZER_POINTS_PER_STROKE - 1); featureIdx++)
+  {
+    unsigned int previousIdx = featureIdx - 1;
+    unsigned int nextIdx     = featureIdx + 1;
+
+    features->Curvature[featureIdx] = (features->DirX[previousIdx] * features->DirY[nextIdx]) - (features->DirY[previousIdx] * features->DirX[nextIdx]);
+  }
+}
+
+// Extract the features of a stroke of a character, scale and offset map the
+// character into its unit square.
+static void mExtractCharacterStrokeFeatures(const RESAMPLED_POINT* points, unsigned int numPoints, float scale, float offsetX, float offsetY, RECOGNIZER_STROKE_FEATURES* features)
+{
+  float minX = points[0].X;
+  float minY = points[0].Y;
+  float maxX = points[0].X;
+  float maxY = points[0].Y;
+
+  for (unsigned int pointIdx = 1; pointIdx < numPoints; pointIdx++)
+  {
+    minX = (points[pointIdx].X < minX) ? points[pointIdx].X : minX;
+    minY = (points[pointIdx].Y < minY) ? points[pointIdx].Y : minY;
+    maxX = (points[pointIdx].X > maxX) ? points[pointIdx].X : maxX;
+    maxY = (points[pointIdx].Y > maxY) ? points[pointIdx].Y : maxY;
+  }
+
+  float width   = maxX - minX;
+  float height  = maxY - minY;
+  float size    = (width > height) ? width : height;
+  float centerX = (minX + maxX) * 0.5f;
+  float centerY = (minY + maxY) * 0.5f;
+
+  // a dot stays in the middle of its square
+  float side = (size > 0.0f) ? size : 1.0f;
+  mExtractStrokeFeatures(points, numPoints, 1.0f / side, centerX - (side * 0.5f), centerY - (side * 0.5f), features);
+
+  features->CenterX = (centerX - offsetX) * scale;
+  features->CenterY = (centerY - offsetY) * scale;
+  features->Size    = size * scale;
+}
+
+// map the points of a character into the unit square like mGetStrokeResamplerNormalization
+static void mGetCharacterNormalization(const RESAMPLED_POINT* points, unsigned int numPoints, float* scale, float* offsetX, float* offsetY, float* aspect)
+{
+  float minX = points[0].X;
+  float minY = points[0].Y;
+  float maxX = points[0].X;
+  float maxY = points[0].Y;
+
+  for (unsigned int pointIdx = 1; pointIdx < numPoints; pointIdx++)
+  {
+    minX = (points[pointIdx].X < minX) ? points[pointIdx].X : minX;
+    minY = (points[pointIdx].Y < minY) ? points[pointIdx].Y : minY;
+    maxX = (points[pointIdx].X > maxX) ? points[pointIdx].X : maxX;
+    maxY = (points[pointIdx].Y > maxY) ? points[pointIdx].Y : maxY;
+  }
+
+  float width  = maxX - minX;
+  float height = maxY - minY;
+  float size   = (width > height) ? width : height;
+
+  (*scale)   = (size > 0.0f) ? (1.0f / size) : 1.0f;
+  (*offsetX) = minX - ((size - width) * 0.5f);
+  (*offsetY) = minY - ((size - height) * 0.5f);
+  (*aspect)  = (size > 0.0f) ? ((width - height) / size) : 0.0f;
+}
+
+// Histogram of the directions of the segments between the features weighted by
+// their length. A segment is shared by the two nearest bins so that a stroke
+// close to a bin boundary does not jump from one bin to the other.
+static void mGetDirectionHistogram(const RECOGNIZER_STROKE_FEATURES* features, unsigned int numStrokes, unsigned char* directions)
+{
+  float bins[RECOGNIZER_NUM_DIRECTIONS] = {0};
+  float totalLength                     = 0.0f;
+
+  for (unsigned int strokeIdx = 0; strokeIdx < numStrokes; strokeIdx++)
+  {
+    const RECOGNIZER_STROKE_FEATURES* strokeFeatures = &features[strokeIdx];
+
+    for (unsigned int featureIdx = 1; featureIdx < RECOGNIZER_POINTS_PER_STROKE; featureIdx++)
+    {
+      // in the unit square of the character
+      float dx     = strokeFeatures->X[featureIdx] - strokeFeatures->X[featureIdx - 1];
+      float dy     = strokeFeatures->Y[featureIdx] - strokeFeatures->Y[featureIdx - 1];
+      float length = sqrtf((dx * dx) + (dy * dy)) * strokeFeatures->Size;
+      if (!(length > 0.0f))
+      {
+        continue;
+      }
+
+      // y grows downwards so a positive angle turns clockwise on screen
+      float position = atan2f(dy, dx) * ((float)RECOGNIZER_NUM_DIRECTIONS / (2.0f * RECOGNIZER_PI));
+      if (position < 0.0f)
+      {
+        position += (float)RECOGNIZER_NUM_DIRECTIONS;
+      }
+
+      unsigned int lowerBin = (unsigned int)position % RECOGNIZER_NUM_DIRECTIONS;
+      unsigned int upperBin = (lowerBin + 1) % RECOGNIZER_NUM_DIRECTIONS;
+      float upperShare      = position - floorf(position);
+
+      bins[lowerBin] += length * (1.0f - upperShare);
+      bins[upperBin] += length * upperShare;
+      totalLength += length;
+    }
+  }
+
+  for (unsigned int binIdx = 0; binIdx < RECOGNIZER_NUM_DIRECTIONS; binIdx++)
+  {
+    directions[binIdx] = (totalLength > 0.0f) ? (unsigned char)((255.0f * bins[binIdx] / totalLength) + 0.5f) : 0;
+  }
+}
+
+static __inline float mGetIndexKeyDistance(const RECOGNIZER_INDEX_KEY* a, const RECOGNIZER_INDEX_KEY* b)
+{
+  int directionDistance = 0;
+  for (unsigned int binIdx = 0; binIdx < RECOGNIZER_NUM_DIRECTIONS; binIdx++)
+  {
+    int difference = (int)a->Directions[binIdx] - (int)b->Directions[binIdx];
+    directionDistance += (difference < 0) ? -difference : difference;
+  }
+
+  return ((float)directionDistance * (1.0f / 255.0f)) + (RECOGNIZER_INDEX_ASPECT_WEIGHT * fabsf(a->Aspect - b->Aspect));
+}
+
+int mAddRecognizerTemplate(RECOGNIZER_DATABASE* database, unsigned int codePoint, const RESAMPLED_POINT* points, const RESAMPLED_STROKE* strokes, unsigned int numStrokes)
+{
+  if ((numStrokes == 0) || (numStrokes > RECOGNIZER_MAX_STROKES) || (database->Mapping.Data != NULL))
+  {
+    return -1;
+  }
+
+  for (unsigned int strokeIdx = 0; strokeIdx < numStrokes; strokeIdx++)
+  {
+    if (strokes[strokeIdx].Size == 0)
+    {
+      return -1;
+    }
+  }
+
+  if (database->NumTemplates == database->TemplateCapacity)
+  {
+    unsigned int newCapacity = database->TemplateCapacity * 2;
+    if (newCapacity < RECOGNIZER_MIN_TEMPLATE_CAPACITY)
+    {
+      newCapacity = RECOGNIZER_MIN_TEMPLATE_CAPACITY;
+    }
+
+    database->Templates        = (RECOGNIZER_TEMPLATE*)mRealloc(database->Templates, sizeof(RECOGNIZER_TEMPLATE) * newCapacity, __FILE__, __LINE__);
+    database->Keys             = (RECOGNIZER_INDEX_KEY*)mRealloc(database->Keys, sizeof(RECOGNIZER_INDEX_KEY) * newCapacity, __FILE__, __LINE__);
+    database->TemplateCapacity = newCapacity;
+  }
+
+  if ((database->NumFeatures + numStrokes) > database->FeatureCapacity)
+  {
+    unsigned int newCapacity = database->FeatureCapacity * 2;
+    if (newCapacity < RECOGNIZER_MIN_FEATURE_CAPACITY)
+    {
+      newCapacity = RECOGNIZER_MIN_FEATURE_CAPACITY;
+    }
+
+    while (newCapacity < (database->NumFeatures + numStrokes))
+    {
+      newCapacity *= 2;
+    }
+
+    database->Features        = (RECOGNIZER_STROKE_FEATURES*)mRealloc(database->Features, sizeof(RECOGNIZER_STROKE_FEATURES) * newCapacity, __FILE__, __LINE__);
+    database->FeatureCapacity = newCapacity;
+  }
+
+  // the strokes are stored one after another
+  const RESAMPLED_STROKE* lastStroke = &strokes[numStrokes - 1];
+  unsigned int numPoints             = lastStroke->Offset + lastStroke->Size;
+
+  float scale;
+  float offsetX;
+  float offsetY;
+  RECOGNIZER_INDEX_KEY key;
+  mGetCharacterNormalization(points + strokes[0].Offset, numPoints - strokes[0].Offset, &scale, &offsetX, &offsetY, &key.Aspect);
+
+  RECOGNIZER_STROKE_FEATURES* features = database->Features + database->NumFeatures;
+  for (unsigned int strokeIdx = 0; strokeIdx < numStrokes; strokeIdx++)
+  {
+    mExtractCharacterStrokeFeatures(points + strokes[strokeIdx].Offset, strokes[strokeIdx].Size, scale, offsetX, offsetY, &features[strokeIdx]);
+  }
+
+  mGetDirectionHistogram(features, numStrokes, key.Directions);
+
+  // the features are appended but the template goes to the end of the templates with as many strokes
+  unsigned int insertIdx = database->StrokeCountOffsets[numStrokes + 1];
+  memmove(&database->Templates[insertIdx + 1], &database->Templates[insertIdx], sizeof(RECOGNIZER_TEMPLATE) * (database->NumTemplates - insertIdx));
+  memmove(&database->Keys[insertIdx + 1], &database->Keys[insertIdx], sizeof(RECOGNIZER_INDEX_KEY) * (database->NumTemplates - insertIdx));
+
+  database->Templates[insertIdx] = (RECOGNIZER_TEMPLATE){.CodePoint = codePoint, .NumStrokes = numStrokes, .FeatureOffset = database->NumFeatures};
+  database->Keys[insertIdx]      = key;
+
+  for (unsigned int strokeCount = numStrokes + 1; strokeCount <= (RECOGNIZER_MAX_STROKES + 1); strokeCount++)
+  {
+    database->StrokeCountOffsets[strokeCount]++;
+  }
+
+  database->NumFeatures += numStrokes;
+  database->NumTemplates++;
+
+  return 0;
+}
+
+int mLoadRecognizerDatabase(const char* filePath, RECOGNIZER_DATABASE* database)
+{
+  FILE* file = fopen(filePath, "rb");
+  if (file == NULL)
+  {
+    printf(FG_RED);
+    printf("Failed to open the template file %s\n", filePath);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  int retval                 = 0;
+  RESAMPLED_POINT* points    = NULL;
+  unsigned int pointCapacity = 0;
+
+  RECOGNIZER_FILE_HEADER header;
+  if ((fread(&header, sizeof(RECOGNIZER_FILE_HEADER), 1, file) != 1) || (header.Magic != RECOGNIZER_FILE_MAGIC) || (header.Version != RECOGNIZER_FILE_VERSION))
+  {
+    retval = -1;
+  }
+
+  for (unsigned int templateIdx = 0; (retval == 0) && (templateIdx < header.NumTemplates); templateIdx++)
+  {
+    RECOGNIZER_FILE_TEMPLATE fileTemplate;
+    unsigned int strokeSizes[RECOGNIZER_MAX_STROKES];
+    RESAMPLED_STROKE strokes[RECOGNIZER_MAX_STROKES];
+
+    if ((fread(&fileTemplate, sizeof(RECOGNIZER_FILE_TEMPLATE), 1, file) != 1) || (fileTemplate.NumStrokes == 0) || (fileTemplate.NumStrokes > RECOGNIZER_MAX_STROKES))
+    {
+      retval = -1;
+      break;
+    }
+
+    if (fread(strokeSizes, sizeof(unsigned int), fileTemplate.NumStrokes, file) != fileTemplate.NumStrokes)
+    {
+      retval = -1;
+      break;
+    }
+
+    unsigned int numPoints = 0;
+    for (unsigned int strokeIdx = 0; strokeIdx < fileTemplate.NumStrokes; strokeIdx++)
+    {
+      strokes[strokeIdx] = (RESAMPLED_STROKE){.Offset = numPoints, .Size = strokeSizes[strokeIdx]};
+      numPoints += strokeSizes[strokeIdx];
+    }
+
+    if (numPoints > pointCapacity)
+    {
+      pointCapacity = numPoints;
+      points        = (RESAMPLED_POINT*)mRealloc(points, sizeof(RESAMPLED_POINT) * pointCapacity, __FILE__, __LINE__);
+    }
+
+    if ((fread(points, sizeof(RESAMPLED_POINT), numPoints, file) != numPoints) || (mAddRecognizerTemplate(database, fileTemplate.CodePoint, points, strokes, fileTemplate.NumStrokes) != 0))
+    {
+      retval = -1;
+      break;
+    }
+  }
+
+  if (retval != 0)
+  {
+    printf(FG_RED);
+    printf("%s is not a valid template file\n", filePath);
+    printf(RESET_COLOR);
+  }
+
+  free(points);
+  fclose(file);
+
+  return retval;
+}
+
+static unsigned long long mAlignRecognizerIndexOffset(unsigned long long offset)
+{
+  return (offset + (RECOGNIZER_INDEX_ALIGNMENT - 1)) & ~(unsigned long long)(RECOGNIZER_INDEX_ALIGNMENT - 1);
+}
+
+// pad the file from (*position) up to offset and write a section there
+static int mWriteRecognizerIndexSection(FILE* file, unsigned long long* position, unsigned long long offset, const void* data, size_t cbData)
+{
+  static const BYTE padding[RECOGNIZER_INDEX_ALIGNMENT] = {0};
+  size_t cbPadding                                      = (size_t)(offset - (*position));
+
+  if ((cbPadding != 0) && (fwrite(padding, 1, cbPadding, file) != cbPadding))
+  {
+    return -1;
+  }
+
+  if ((cbData != 0) && (fwrite(data, 1, cbData, file) != cbData))
+  {
+    return -1;
+  }
+
+  (*position) = offset + cbData;
+
+  return 0;
+}
+
+int mWriteRecognizerIndex(const char* filePath, const RECOGNIZER_DATABASE* database)
+{
+  FILE* file = fopen(filePath, "wb");
+  if (file == NULL)
+  {
+    printf(FG_RED);
+    printf("Failed to create the index file %s at %s:%d\n", filePath, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  RECOGNIZER_INDEX_FILE_HEADER header;
+  memset(&header, 0, sizeof(RECOGNIZER_INDEX_FILE_HEADER));
+  header.Magic           = RECOGNIZER_INDEX_MAGIC;
+  header.Version         = RECOGNIZER_INDEX_VERSION;
+  header.cbFileHeader    = sizeof(RECOGNIZER_INDEX_FILE_HEADER);
+  header.PointsPerStroke = RECOGNIZER_POINTS_PER_STROKE;
+  header.NumDirections   = RECOGNIZER_NUM_DIRECTIONS;
+  header.NumTemplates    = database->NumTemplates;
+  header.NumFeatures     = database->NumFeatures;
+  header.TemplatesOffset = mAlignRecognizerIndexOffset(sizeof(RECOGNIZER_INDEX_FILE_HEADER));
+  header.KeysOffset      = mAlignRecognizerIndexOffset(header.TemplatesOffset + (sizeof(RECOGNIZER_TEMPLATE) * database->NumTemplates));
+  header.FeaturesOffset  = mAlignRecognizerIndexOffset(header.KeysOffset + (sizeof(RECOGNIZER_INDEX_KEY) * database->NumTemplates));
+  memcpy(header.StrokeCountOffsets, database->StrokeCountOffsets, sizeof(header.StrokeCountOffsets));
+
+  unsigned long long position = 0;
+  int retval                  = 0;
+
+  if ((mWriteRecognizerIndexSection(file, &position, 0, &header, sizeof(RECOGNIZER_INDEX_FILE_HEADER)) != 0) ||
+      (mWriteRecognizerIndexSection(file, &position, header.TemplatesOffset, database->Templates, sizeof(RECOGNIZER_TEMPLATE) * database->NumTemplates) != 0) ||
+      (mWriteRecognizerIndexSection(file, &position, header.KeysOffset, database->Keys, sizeof(RECOGNIZER_INDEX_KEY) * database->NumTemplates) != 0) ||
+      (mWriteRecognizerIndexSection(file, &position, header.FeaturesOffset, database->Features, sizeof(RECOGNIZER_STROKE_FEATURES) * database->NumFeatures) != 0))
+  {
+    printf(FG_RED);
+    printf("Failed to write the index file %s at %s:%d\n", filePath, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    retval = -1;
+  }
+
+  if (fclose(file) != 0)
+  {
+    retval = -1;
+  }
+
+  return retval;
+}
+
+static void mUnmapRecognizerIndex(RECOGNIZER_INDEX_MAPPING* mapping)
+{
+#ifdef _WIN32
+  if (mapping->Data != NULL)
+  {
+    UnmapViewOfFile(mapping->Data);
+  }
+
+  if (mapping->Mapping != NULL)
+  {
+    CloseHandle(mapping->Mapping);
+  }
+
+  if ((mapping->File != NULL) && (mapping->File != INVALID_HANDLE_VALUE))
+  {
+    CloseHandle(mapping->File);
+  }
+#else
+  if (mapping->Data != NULL)
+  {
+    munmap((void*)mapping->Data, mapping->cbData);
+  }
+
+  if (mapping->File >= 0)
+  {
+    close(mapping->File);
+  }
+#endif
+
+  memset(mapping, 0, sizeof(RECOGNIZER_INDEX_MAPPING));
+#ifndef _WIN32
+  mapping->File = -1;
+#endif
+}
+
+// Check everything that the recognizer relies on without touching the features
+// so that mapping a large index stays cheap.
+static int mValidateRecognizerIndex(const BYTE* data, size_t cbData)
+{
+  const RECOGNIZER_INDEX_FILE_HEADER* header = (const RECOGNIZER_INDEX_FILE_HEADER*)data;
+
+  if ((cbData < sizeof(RECOGNIZER_INDEX_FILE_HEADER)) || (header->Magic != RECOGNIZER_INDEX_MAGIC) || (header->Version != RECOGNIZER_INDEX_VERSION) || (header->cbFileHeader < sizeof(RECOGNIZER_INDEX_FILE_HEADER)))
+  {
+    return -1;
+  }
+
+  if ((header->PointsPerStroke != RECOGNIZER_POINTS_PER_STROKE) || (header->NumDirections != RECOGNIZER_NUM_DIRECTIONS))
+  {
+    return -1;
+  }
+
+  int areOffsetsAligned = ((header->TemplatesOffset % RECOGNIZER_INDEX_ALIGNMENT) == 0) && ((header->KeysOffset % RECOGNIZER_INDEX_ALIGNMENT) == 0) && ((header->FeaturesOffset % RECOGNIZER_INDEX_ALIGNMENT) == 0);
+  int areSectionsInside = (header->TemplatesOffset <= cbData) && ((sizeof(RECOGNIZER_TEMPLATE) * (unsigned long long)header->NumTemplates) <= (cbData - header->TemplatesOffset)) &&
+                          (header->KeysOffset <= cbData) && ((sizeof(RECOGNIZER_INDEX_KEY) * (unsigned long long)header->NumTemplates) <= (cbData - header->KeysOffset)) &&
+                          (header->FeaturesOffset <= cbData) && ((sizeof(RECOGNIZER_STROKE_FEATURES) * (unsigned long long)header->NumFeatures) <= (cbData - header->FeaturesOffset));
+
+  if (!areOffsetsAligned || !areSectionsInside || (header->StrokeCountOffsets[0] != 0) || (header->StrokeCountOffsets[RECOGNIZER_MAX_STROKES + 1] != header->NumTemplates))
+  {
+    return -1;
+  }
+
+  const RECOGNIZER_TEMPLATE* templates = (const RECOGNIZER_TEMPLATE*)(data + header->TemplatesOffset);
+  for (unsigned int strokeCount = 0; strokeCount <= RECOGNIZER_MAX_STROKES; strokeCount++)
+  {
+    if (header->StrokeCountOffsets[strokeCount] > header->StrokeCountOffsets[strokeCount + 1])
+    {
+      return -1;
+    }
+
+    for (unsigned int templateIdx = header->StrokeCountOffsets[strokeCount]; templateIdx < header->StrokeCountOffsets[strokeCount + 1]; templateIdx++)
+    {
+      if ((strokeCount == 0) || (templates[templateIdx].NumStrokes != strokeCount) || (templates[templateIdx].FeatureOffset > header->NumFeatures) ||
+          (strokeCount > (header->NumFeatures - templates[templateIdx].FeatureOffset)))
+      {
+        return -1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+int mMapRecognizerIndex(const char* filePath, RECOGNIZER_DATABASE* database)
+{
+  if ((database->NumTemplates != 0) || (database->Mapping.Data != NULL))
+  {
+    return -1;
+  }
+
+  RECOGNIZER_INDEX_MAPPING mapping;
+  memset(&mapping, 0, sizeof(RECOGNIZER_INDEX_MAPPING));
+
+#ifdef _WIN32
+  mapping.File = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (mapping.File == INVALID_HANDLE_VALUE)
+  {
+    printf(FG_RED);
+    printf("Failed to open the index file %s at %s:%d\n", filePath, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  LARGE_INTEGER fileSize;
+  GetFileSizeEx(mapping.File, &fileSize);
+  mapping.cbData = (size_t)fileSize.QuadPart;
+
+  if (mapping.cbData != 0)
+  {
+    mapping.Mapping = CreateFileMappingA(mapping.File, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping.Mapping != NULL)
+    {
+      mapping.Data = (const BYTE*)MapViewOfFile(mapping.Mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+  }
+#else
+  mapping.File = open(filePath, O_RDONLY);
+  if (mapping.File < 0)
+  {
+    printf(FG_RED);
+    printf("Failed to open the index file %s at %s:%d\n", filePath, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  struct stat fileStat;
+  fstat(mapping.File, &fileStat);
+  mapping.cbData = (size_t)fileStat.st_size;
+
+  if (mapping.cbData != 0)
+  {
+    // the pages are read in when a query first needs them
+    void* data = mmap(NULL, mapping.cbData, PROT_READ, MAP_PRIVATE, mapping.File, 0);
+    if (data != MAP_FAILED)
+    {
+      mapping.Data = (const BYTE*)data;
+    }
+  }
+#endif
+
+  if ((mapping.Data == NULL) || (mValidateRecognizerIndex(mapping.Data, mapping.cbData) != 0))
+  {
+    printf(FG_RED);
+    printf("%s is not a valid index file for this recognizer\n", filePath);
+    printf(RESET_COLOR);
+    mUnmapRecognizerIndex(&mapping);
+    return -1;
+  }
+
+  const RECOGNIZER_INDEX_FILE_HEADER* header = (const RECOGNIZER_INDEX_FILE_HEADER*)mapping.Data;
+
+  // the database does not write through these pointers once it is mapped
+  database->Templates        = (RECOGNIZER_TEMPLATE*)(mapping.Data + header->TemplatesOffset);
+  database->Keys             = (RECOGNIZER_INDEX_KEY*)(mapping.Data + header->KeysOffset);
+  database->NumTemplates     = header->NumTemplates;
+  database->TemplateCapacity = header->NumTemplates;
+  database->Features         = (RECOGNIZER_STROKE_FEATURES*)(mapping.Data + header->FeaturesOffset);
+  database->NumFeatures      = header->NumFeatures;
+  database->FeatureCapacity  = header->NumFeatures;
+  database->Mapping          = mapping;
+  memcpy(database->StrokeCountOffsets, header->StrokeCountOffsets, sizeof(database->StrokeCountOffsets));
+
+  return 0;
+}
+
+// insert a candidate into the list sorted by increasing distance, the worst one falls off when the list is full
+static void mInsertRecognizerCandidate(RECOGNIZER_CANDIDATE* candidates, unsigned int maxCandidates, unsigned int* numCandidates, unsigned int codePoint, float distance)
+{
+  unsigned int insertIdx = (*numCandidates);
+  while ((insertIdx > 0) && (candidates[insertIdx - 1].Distance > distance))
+  {
+    insertIdx--;
+  }
+
+  if (insertIdx >= maxCandidates)
+  {
+    return;
+  }
+
+  unsigned int lastIdx = ((*numCandidates) < maxCandidates) ? (*numCandidates) : (maxCandidates - 1);
+  memmove(&candidates[insertIdx + 1], &candidates[insertIdx], sizeof(RECOGNIZER_CANDIDATE) * (lastIdx - insertIdx));
+
+  candidates[insertIdx] = (RECOGNIZER_CANDIDATE){.CodePoint = codePoint, .Distance = distance};
+  if ((*numCandidates) < maxCandidates)
+  {
+    (*numCandidates)++;
+  }
+}
+
+// a max-heap of the shortlist, the worst entry is at the top
+static void mSiftShortlistEntryDown(RECOGNIZER_SHORTLIST_ENTRY* shortlist, unsigned int numEntries, unsigned int entryIdx)
+{
+  RECOGNIZER_SHORTLIST_ENTRY entry = shortlist[entryIdx];
+
+  while (((2 * entryIdx) + 1) < numEntries)
+  {
+    unsigned int childIdx = (2 * entryIdx) + 1;
+    if (((childIdx + 1) < numEntries) && (shortlist[childIdx + 1].Distance > shortlist[childIdx].Distance))
+    {
+      childIdx++;
+    }
+
+    if (shortlist[childIdx].Distance <= entry.Distance)
+    {
+      break;
+    }
+
+    shortlist[entryIdx] = shortlist[childIdx];
+    entryIdx            = childIdx;
+  }
+
+  shortlist[entryIdx] = entry;
+}
+
+static void mPushShortlistEntry(RECOGNIZER_SHORTLIST_ENTRY* shortlist, unsigned int* numEntries, RECOGNIZER_SHORTLIST_ENTRY entry)
+{
+  unsigned int entryIdx = (*numEntries);
+  (*numEntries)++;
+
+  while (entryIdx > 0)
+  {
+    unsigned int parentIdx = (entryIdx - 1) / 2;
+    if (shortlist[parentIdx].Distance >= entry.Distance)
+    {
+      break;
+    }
+
+    shortlist[entryIdx] = shortlist[parentIdx];
+    entryIdx            = parentIdx;
+  }
+
+  shortlist[entryIdx] = entry;
+}
+
+// the features of the written character and the templates that it is compared to
+struct RECOGNIZER_QUERY
+{
+  RECOGNIZER_STROKE_FEATURES Features[RECOGNIZER_MAX_STROKES];
+  unsigned int NumStrokes;
+  // the strokes backwards for mGetDtwDistance and their envelopes for mGetLbKeoghDistance
+  RECOGNIZER_STROKE_FEATURES ReversedFeatures[RECOGNIZER_MAX_STROKES];
+  RECOGNIZER_STROKE_FEATURES LowerEnvelopes[RECOGNIZER_MAX_STROKES];
+  RECOGNIZER_STROKE_FEATURES UpperEnvelopes[RECOGNIZER_MAX_STROKES];
+  DTW_PARAMETERS DtwParameters;
+  // the templates [FirstTemplateIdx, EndTemplateIdx) or the first NumShortlisted entries of Shortlist
+  int IsShortlisted;
+  unsigned int FirstTemplateIdx;
+  unsigned int EndTemplateIdx;
+  RECOGNIZER_SHORTLIST_ENTRY Shortlist[RECOGNIZER_MAX_SHORTLIST_SIZE];
+  unsigned int NumShortlisted;
+};
+
+typedef struct RECOGNIZER_QUERY RECOGNIZER_QUERY;
+
+// the best candidates of one worker, they are merged when every worker is done
+struct RECOGNIZER_WORKER_CANDIDATES
+{
+  RECOGNIZER_CANDIDATE Candidates[RECOGNIZER_MAX_PARALLEL_CANDIDATES];
+  unsigned int NumCandidates;
+  BYTE Padding[WORK_POOL_CACHE_LINE_SIZE];
+};
+
+typedef struct RECOGNIZER_WORKER_CANDIDATES RECOGNIZER_WORKER_CANDIDATES;
+
+// halving the ranges down to RECOGNIZER_TASKS_PER_WORKER tasks per worker makes at most twice as many
+#define RECOGNIZER_MAX_SCORING_TASKS (2 * WORK_POOL_MAX_THREADS * RECOGNIZER_TASKS_PER_WORKER)
+
+// a range of the templates of the query
+struct RECOGNIZER_SCORING_TASK
+{
+  struct RECOGNIZER_SCORING_CONTEXT* Context;
+  unsigned int First;
+  unsigned int End;
+};
+
+typedef struct RECOGNIZER_SCORING_TASK RECOGNIZER_SCORING_TASK;
+
+struct RECOGNIZER_SCORING_CONTEXT
+{
+  const RECOGNIZER_DATABASE* Database;
+  const RECOGNIZER_QUERY* Query;
+  // NULL or the partial matches of every template of the database
+  RECOGNIZER_PARTIAL_MATCH* Matches;
+  // NULL or set to non-zero to stop the scoring
+  volatile unsigned int* Cancel;
+  unsigned int MaxCandidates;
+  // the smallest distance of the last candidate of any worker (as the bits of a float)
+  volatile unsigned int SharedBound;
+  RECOGNIZER_WORKER_CANDIDATES WorkerCandidates[WORK_POOL_MAX_THREADS];
+  // the ranges that the workers split off while scoring, claimed with NumTasks
+  WORK_GROUP Group;
+  RECOGNIZER_SCORING_TASK Tasks[RECOGNIZER_MAX_SCORING_TASKS];
+  volatile unsigned int NumTasks;
+  // a range with more templates than this is split in half
+  unsigned int MaxTaskSize;
+};
+
+typedef struct RECOGNIZER_SCORING_CONTEXT RECOGNIZER_SCORING_CONTEXT;
+
+static __inline unsigned int mGetQueryTemplateCount(const RECOGNIZER_QUERY* query)
+{
+  return query->IsShortlisted ? query->NumShortlisted : (query->EndTemplateIdx - query->FirstTemplateIdx);
+}
+
+static __inline unsigned int mGetQueryTemplateIdx(const RECOGNIZER_QUERY* query, unsigned int position)
+{
+  return query->IsShortlisted ? query->Shortlist[position].TemplateIdx : (query->FirstTemplateIdx + position);
+}
+
+// how far apart two strokes are in their characters, their shapes aside
+static __inline float mGetStrokeLayoutDistance(const RECOGNIZER_STROKE_FEATURES* a, const RECOGNIZER_STROKE_FEATURES* b)
+{
+  float dx    = a->CenterX - b->CenterX;
+  float dy    = a->CenterY - b->CenterY;
+  float dSize = a->Size - b->Size;
+
+  return RECOGNIZER_LAYOUT_WEIGHT * ((dx * dx) + (dy * dy) + (dSize * dSize));
+}
+
+// Compare the strokes of a template to the query and keep it if it is one of
+// the best candidates. The layouts of the strokes are compared first, then
+// their shapes. A template that gets worse than the last candidate or than the
+// bound of the other workers is abandoned, LB_Keogh usually rejects a stroke
+// before the alignment has to be computed. With a partial match the shapes are
+// compared after the strokes that it has and the shapes that are compared
+// completely are added to it.
+static void mMatchRecognizerTemplate(const RECOGNIZER_DATABASE* database, unsigned int templateIdx, const RECOGNIZER_QUERY* query, RECOGNIZER_PARTIAL_MATCH* match, float bound, RECOGNIZER_CANDIDATE* candidates, unsigned int maxCandidates, unsigned int* numCandidates)
+{
+  const RECOGNIZER_TEMPLATE* reference = &database->Templates[templateIdx];
+  unsigned int numStrokes              = query->NumStrokes;
+  unsigned int numCommonStrokes        = (reference->NumStrokes < numStrokes) ? reference->NumStrokes : numStrokes;
+
+  unsigned int strokeCountDifference = (reference->NumStrokes > numStrokes) ? (reference->NumStrokes - numStrokes) : (numStrokes - reference->NumStrokes);
+  float worstDistance                = ((*numCandidates) == maxCandidates) ? candidates[maxCandidates - 1].Distance : FLT_MAX;
+  float distance                     = RECOGNIZER_MISSING_STROKE_PENALTY * (float)strokeCountDifference;
+  unsigned int firstStrokeIdx        = 0;
+
+  if ((match != NULL) && (match->NumMatchedStrokes > numCommonStrokes))
+  {
+    match->Distance          = 0.0f;
+    match->NumMatchedStrokes = 0;
+  }
+
+  if (match != NULL)
+  {
+    distance += match->Distance;
+    firstStrokeIdx = match->NumMatchedStrokes;
+  }
+
+  const RECOGNIZER_STROKE_FEATURES* referenceFeatures = &database->Features[reference->FeatureOffset];
+  for (unsigned int strokeIdx = 0; strokeIdx < numCommonStrokes; strokeIdx++)
+  {
+    distance += mGetStrokeLayoutDistance(&query->Features[strokeIdx], &referenceFeatures[strokeIdx]);
+  }
+
+  worstDistance = (bound < worstDistance) ? bound : worstDistance;
+  if (distance >= worstDistance)
+  {
+    return;
+  }
+
+  // the shapes are compared in writing order
+  for (unsigned int strokeIdx = firstStrokeIdx; strokeIdx < numCommonStrokes; strokeIdx++)
+  {
+    const float* referenceStroke = (const float*)&referenceFeatures[strokeIdx];
+    float strokeBound            = worstDistance - distance;
+
+    // the positions are in the square of the stroke, weigh them by its size in the template
+    DTW_PARAMETERS dtwParameters = query->DtwParameters;
+    float sizeSquared            = referenceFeatures[strokeIdx].Size * referenceFeatures[strokeIdx].Size;
+    dtwParameters.Weights[0]     = RECOGNIZER_POSITION_WEIGHT * sizeSquared;
+    dtwParameters.Weights[1]     = RECOGNIZER_POSITION_WEIGHT * sizeSquared;
+
+    if (mGetLbKeoghDistance(&dtwParameters, (const float*)&query->LowerEnvelopes[strokeIdx], (const float*)&query->UpperEnvelopes[strokeIdx], referenceStroke, strokeBound) >= strokeBound)
+    {
+      return;
+    }
+
+    float strokeDistance = mGetDtwDistance(&dtwParameters, (const float*)&query->ReversedFeatures[strokeIdx], referenceStroke, strokeBound);
+    if (strokeDistance >= strokeBound)
+    {
+      return;
+    }
+
+    distance += strokeDistance;
+    if (match != NULL)
+    {
+      match->Distance += strokeDistance;
+      match->NumMatchedStrokes = strokeIdx + 1;
+    }
+  }
+
+  if (distance < worstDistance)
+  {
+    mInsertRecognizerCandidate(candidates, maxCandidates, numCandidates, reference->CodePoint, distance);
+  }
+}
+
+// Extract the features of the resampled strokes and pick the templates to
+// compare them to. Returns -1 if there is nothing to recognize.
+static int mPrepareRecognizerQuery(const RECOGNIZER_DATABASE* database, const STROKE_RESAMPLER* resampler, RECOGNIZER_QUERY* query)
+{
+  unsigned int numStrokes = resampler->NumStrokes;
+  if (numStrokes == 0)
+  {
+    return -1;
+  }
+
+  if (numStrokes > RECOGNIZER_MAX_STROKES)
+  {
+    numStrokes = RECOGNIZER_MAX_STROKES;
+  }
+
+  float scale;
+  float offsetX;
+  float offsetY;
+  mGetStrokeResamplerNormalization(resampler, &scale, &offsetX, &offsetY);
+
+  DTW_PARAMETERS* dtwParameters = &query->DtwParameters;
+  memset(dtwParameters, 0, sizeof(DTW_PARAMETERS));
+  dtwParameters->NumPoints   = RECOGNIZER_POINTS_PER_STROKE;
+  dtwParameters->NumChannels = RECOGNIZER_NUM_FEATURE_CHANNELS;
+  dtwParameters->Window      = RECOGNIZER_DTW_WINDOW;
+  dtwParameters->Weights[0]  = RECOGNIZER_POSITION_WEIGHT;
+  dtwParameters->Weights[1]  = RECOGNIZER_POSITION_WEIGHT;
+  dtwParameters->Weights[2]  = RECOGNIZER_DIRECTION_WEIGHT;
+  dtwParameters->Weights[3]  = RECOGNIZER_DIRECTION_WEIGHT;
+  dtwParameters->Weights[4]  = RECOGNIZER_CURVATURE_WEIGHT;
+
+  for (unsigned int strokeIdx = 0; strokeIdx < numStrokes; strokeIdx++)
+  {
+    RESAMPLED_STROKE stroke = resampler->Strokes[strokeIdx];
+    if (stroke.Size == 0)
+    {
+      return -1;
+    }
+
+    const float* features = (const float*)&query->Features[strokeIdx];
+    mExtractCharacterStrokeFeatures(resampler->Points + stroke.Offset, stroke.Size, scale, offsetX, offsetY, &query->Features[strokeIdx]);
+    mReverseDtwSequence(dtwParameters, features, (float*)&query->ReversedFeatures[strokeIdx]);
+    mGetDtwEnvelope(dtwParameters, features, (float*)&query->LowerEnvelopes[strokeIdx], (float*)&query->UpperEnvelopes[strokeIdx]);
+  }
+
+  // the templates with a similar number of strokes are next to each other
+  unsigned int minStrokeCount = (numStrokes > RECOGNIZER_MAX_STROKE_COUNT_DIFFERENCE) ? (numStrokes - RECOGNIZER_MAX_STROKE_COUNT_DIFFERENCE) : 1;
+  unsigned int maxStrokeCount = ((numStrokes + RECOGNIZER_MAX_STROKE_COUNT_DIFFERENCE) < RECOGNIZER_MAX_STROKES) ? (numStrokes + RECOGNIZER_MAX_STROKE_COUNT_DIFFERENCE) : RECOGNIZER_MAX_STROKES;
+  unsigned int shortlistSize  = (database->ShortlistSize < RECOGNIZER_MAX_SHORTLIST_SIZE) ? database->ShortlistSize : RECOGNIZER_MAX_SHORTLIST_SIZE;
+
+  query->NumStrokes       = numStrokes;
+  query->FirstTemplateIdx = database->StrokeCountOffsets[minStrokeCount];
+  query->EndTemplateIdx   = database->StrokeCountOffsets[maxStrokeCount + 1];
+  query->IsShortlisted    = (shortlistSize != 0) && ((query->EndTemplateIdx - query->FirstTemplateIdx) > shortlistSize);
+  query->NumShortlisted   = 0;
+
+  if (!query->IsShortlisted)
+  {
+    return 0;
+  }
+
+  RECOGNIZER_INDEX_KEY queryKey;
+  float width     = resampler->MaxX - resampler->MinX;
+  float height    = resampler->MaxY - resampler->MinY;
+  float size      = (width > height) ? width : height;
+  queryKey.Aspect = (size > 0.0f) ? ((width - height) / size) : 0.0f;
+  mGetDirectionHistogram(query->Features, numStrokes, queryKey.Directions);
+
+  // keep the shortlistSize templates with the closest keys
+  RECOGNIZER_SHORTLIST_ENTRY* shortlist = query->Shortlist;
+  for (unsigned int strokeCount = minStrokeCount; strokeCount <= maxStrokeCount; strokeCount++)
+  {
+    float strokeCountDistance = RECOGNIZER_INDEX_STROKE_WEIGHT * (float)((strokeCount > numStrokes) ? (strokeCount - numStrokes) : (numStrokes - strokeCount));
+
+    for (unsigned int templateIdx = database->StrokeCountOffsets[strokeCount]; templateIdx < database->StrokeCountOffsets[strokeCount + 1]; templateIdx++)
+    {
+      RECOGNIZER_SHORTLIST_ENTRY entry = {.Distance = strokeCountDistance + mGetIndexKeyDistance(&queryKey, &database->Keys[templateIdx]), .TemplateIdx = templateIdx};
+
+      if (query->NumShortlisted < shortlistSize)
+      {
+        mPushShortlistEntry(shortlist, &query->NumShortlisted, entry);
+      }
+      else if (entry.Distance < shortlist[0].Distance)
+      {
+        shortlist[0] = entry;
+        mSiftShortlistEntryDown(shortlist, query->NumShortlisted, 0);
+      }
+    }
+  }
+
+  // sort the heap so that the closest keys are matched first and the early abandoning starts with a tight bound
+  for (unsigned int lastIdx = query->NumShortlisted - 1; lastIdx > 0; lastIdx--)
+  {
+    RECOGNIZER_SHORTLIST_ENTRY worst = shortlist[0];
+    shortlist[0]                     = shortlist[lastIdx];
+    shortlist[lastIdx]               = worst;
+    mSiftShortlistEntryDown(shortlist, lastIdx, 0);
+  }
+
+  return 0;
+}
+
+int mRecognizeStrokes(const RECOGNIZER_DATABASE* database, const STROKE_RESAMPLER* resampler, RECOGNIZER_CANDIDATE* candidates, unsigned int maxCandidates, unsigned int* numCandidates)
+{
+  (*numCandidates) = 0;
+
+  RECOGNIZER_QUERY query;
+  if ((maxCandidates == 0) || (mPrepareRecognizerQuery(database, resampler, &query) != 0))
+  {
+    return -1;
+  }
+
+  unsigned int numTemplates = mGetQueryTemplateCount(&query);
+  for (unsigned int position = 0; position < numTemplates; position++)
+  {
+    mMatchRecognizerTemplate(database, mGetQueryTemplateIdx(&query, position), &query, NULL, FLT_MAX, candidates, maxCandidates, numCandidates);
+  }
+
+  return 0;
+}
+
+static __inline unsigned int mGetFloatBits(float value)
+{
+  unsigned int bits;
+  memcpy(&bits, &value, sizeof(unsigned int));
+  return bits;
+}
+
+static __inline float mGetFloatFromBits(unsigned int bits)
+{
+  float value;
+  memcpy(&value, &bits, sizeof(float));
+  return value;
+}
+
+// the distances are never negative and the bits of non-negative floats sort like the floats
+static void mLowerSharedBound(volatile unsigned int* sharedBound, float bound)
+{
+  unsigned int boundBits   = mGetFloatBits(bound);
+  unsigned int currentBits = mAtomicLoadAcquire(sharedBound);
+
+  while (boundBits < currentBits)
+  {
+    unsigned int previousBits = mAtomicCompareExchange(sharedBound, currentBits, boundBits);
+    if (previousBits == currentBits)
+    {
+      break;
+    }
+
+    currentBits = previousBits;
+  }
+}
+
+static void mScoreRecognizerTemplates(WORK_POOL* pool, unsigned int workerIdx, void* arg)
+{
+  RECOGNIZER_SCORING_TASK* task        = (RECOGNIZER_SCORING_TASK*)arg;
+  RECOGNIZER_SCORING_CONTEXT* context  = task->Context;
+  RECOGNIZER_WORKER_CANDIDATES* worker = &context->WorkerCandidates[workerIdx];
+  unsigned int maxCandidates           = context->MaxCandidates;
+  unsigned int first                   = task->First;
+  unsigned int end                     = task->End;
+
+  // Submit the upper half of the range until it is small enough. An idle
+  // worker steals the largest half first and we keep the closest templates,
+  // which tighten the shared bound the most.
+  while ((pool != NULL) && ((end - first) > context->MaxTaskSize))
+  {
+    unsigned int taskIdx = mAtomicAdd(&context->NumTasks, 1) - 1;
+    if (taskIdx >= RECOGNIZER_MAX_SCORING_TASKS)
+    {
+      break;
+    }
+
+    unsigned int middle     = first + ((end - first) / 2);
+    context->Tasks[taskIdx] = (RECOGNIZER_SCORING_TASK){.Context = context, .First = middle, .End = end};
+    mSubmitWork(pool, workerIdx, &context->Group, mScoreRecognizerTemplates, &context->Tasks[taskIdx]);
+    end = middle;
+  }
+
+  for (unsigned int position = first; position < end; position++)
+  {
+    if ((context->Cancel != NULL) && mAtomicLoadAcquire(context->Cancel))
+    {
+      return;
+    }
+
+    unsigned int templateIdx        = mGetQueryTemplateIdx(context->Query, position);
+    RECOGNIZER_PARTIAL_MATCH* match = (context->Matches != NULL) ? &context->Matches[templateIdx] : NULL;
+    float bound                     = mGetFloatFromBits(mAtomicLoadAcquire(&context->SharedBound));
+    mMatchRecognizerTemplate(context->Database, templateIdx, context->Query, match, bound, worker->Candidates, maxCandidates, &worker->NumCandidates);
+
+    // no other worker has to keep a template that is worse than our last candidate
+    if (worker->NumCandidates == maxCandidates)
+    {
+      mLowerSharedBound(&context->SharedBound, worker->Candidates[maxCandidates - 1].Distance);
+    }
+  }
+}
+
+// Score the templates of a prepared query on the workers of the pool (or on
+// the calling thread without a pool). Returns -1 if it was cancelled.
+static int mScoreRecognizerQuery(const RECOGNIZER_DATABASE* database, const RECOGNIZER_QUERY* query, RECOGNIZER_PARTIAL_MATCH* matches, WORK_POOL* pool, volatile unsigned int* cancel, RECOGNIZER_CANDIDATE* candidates, unsigned int maxCandidates, unsigned int* numCandidates)
+{
+  unsigned int numWorkers = (pool != NULL) ? pool->NumThreads : 1;
+
+  // the workers only see the context while we wait for them below
+  RECOGNIZER_SCORING_CONTEXT context;
+  context.Database      = database;
+  context.Query         = query;
+  context.Matches       = matches;
+  context.Cancel        = cancel;
+  context.MaxCandidates = maxCandidates;
+  context.SharedBound   = mGetFloatBits(FLT_MAX);
+  for (unsigned int workerIdx = 0; workerIdx < numWorkers; workerIdx++)
+  {
+    context.WorkerCandidates[workerIdx].NumCandidates = 0;
+  }
+
+  unsigned int numTemplates     = mGetQueryTemplateCount(query);
+  RECOGNIZER_SCORING_TASK task = {.Context = &context, .First = 0, .End = numTemplates};
+
+  if ((pool == NULL) || (pool->NumThreads == 1))
+  {
+    // the templates in order, the closest first
+    mScoreRecognizerTemplates(NULL, 0, &task);
+  }
+  else
+  {
+    // a few tasks per worker so that a worker that drew the expensive templates can be helped
+    unsigned int numTasks = pool->NumThreads * RECOGNIZER_TASKS_PER_WORKER;
+    context.MaxTaskSize   = (numTemplates + numTasks - 1) / numTasks;
+    context.NumTasks      = 0;
+    mInitializeWorkGroup(&context.Group);
+
+    // we are worker 0, the others take the halves that we split off
+    mScoreRecognizerTemplates(pool, 0, &task);
+    mWaitForWorkGroup(pool, 0, &context.Group);
+  }
+
+  if ((cancel != NULL) && mAtomicLoadAcquire(cancel))
+  {
+    return -1;
+  }
+
+  for (unsigned int workerIdx = 0; workerIdx < numWorkers; workerIdx++)
+  {
+    const RECOGNIZER_WORKER_CANDIDATES* worker = &context.WorkerCandidates[workerIdx];
+    for (unsigned int candidateIdx = 0; candidateIdx < worker->NumCandidates; candidateIdx++)
+    {
+      mInsertRecognizerCandidate(candidates, maxCandidates, numCandidates, worker->Candidates[candidateIdx].CodePoint, worker->Candidates[candidateIdx].Distance);
+    }
+  }
+
+  return 0;
+}
+
+int mRecognizeStrokesParallel(const RECOGNIZER_DATABASE* database, const STROKE_RESAMPLER* resampler, WORK_POOL* pool, RECOGNIZER_CANDIDATE* candidates, unsigned int maxCandidates, unsigned int* numCandidates)
+{
+  (*numCandidates) = 0;
+
+  if (maxCandidates > RECOGNIZER_MAX_PARALLEL_CANDIDATES)
+  {
+    maxCandidates = RECOGNIZER_MAX_PARALLEL_CANDIDATES;
+  }
+
+  RECOGNIZER_QUERY query;
+  if ((maxCandidates == 0) || (mPrepareRecognizerQuery(database, resampler, &query) != 0))
+  {
+    return -1;
+  }
+
+  return mScoreRecognizerQuery(database, &query, NULL, pool, NULL, candidates, maxCandidates, numCandidates);
+}
+
+void mInitializeRecognizerSession(RECOGNIZER_SESSION* session, const RECOGNIZER_DATABASE* database)
+{
+  memset(session, 0, sizeof(RECOGNIZER_SESSION));
+  session->NumTemplates = database->NumTemplates;
+  session->Matches      = (RECOGNIZER_PARTIAL_MATCH*)mMalloc(sizeof(RECOGNIZER_PARTIAL_MATCH) * ((database->NumTemplates != 0) ? database->NumTemplates : 1), __FILE__, __LINE__);
+  mResetRecognizerSession(session);
+}
+
+void mFreeRecognizerSession(RECOGNIZER_SESSION* session)
+{
+  free(session->Matches);
+  memset(session, 0, sizeof(RECOGNIZER_SESSION));
+}
+
+void mResetRecognizerSession(RECOGNIZER_SESSION* session)
+{
+  memset(session->Matches, 0, sizeof(RECOGNIZER_PARTIAL_MATCH) * session->NumTemplates);
+  session->NumStrokes        = 0;
+  session->NumResumedStrokes = 0;
+}
+
+int mRecognizeStrokesIncremental(const RECOGNIZER_DATABASE* database, RECOGNIZER_SESSION* session, const STROKE_RESAMPLER* resampler, WORK_POOL* pool, volatile unsigned int* cancel, RECOGNIZER_CANDIDATE* candidates, unsigned int maxCandidates, unsigned int* numCandidates)
+{
+  (*numCandidates) = 0;
+
+  if (maxCandidates > RECOGNIZER_MAX_PARALLEL_CANDIDATES)
+  {
+    maxCandidates = RECOGNIZER_MAX_PARALLEL_CANDIDATES;
+  }
+
+  RECOGNIZER_QUERY query;
+  if ((maxCandidates == 0) || (session->NumTemplates != database->NumTemplates) || (mPrepareRecognizerQuery(database, resampler, &query) != 0))
+  {
+    return -1;
+  }
+
+  // strokes were removed (e.g. undone), the shapes of the others do not depend on the bounding box
+  if (query.NumStrokes < session->NumStrokes)
+  {
+    mResetRecognizerSession(session);
+  }
+
+  session->NumResumedStrokes = session->NumStrokes;
+  session->NumStrokes        = query.NumStrokes;
+
+  return mScoreRecognizerQuery(database, &query, session->Matches, pool, cancel, candidates, maxCandidates, numCandidates);
+}
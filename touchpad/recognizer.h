@@ -0,0 +1,246 @@
+#ifndef __RECOGNIZER_H__
+#define __RECOGNIZER_H__
+#include "platform.h"
+
+#include "dtw.h"
+#include "resampler.h"
+#include "workpool.h"
+
+// Every stroke is reduced to this many points equally spaced along its length.
+#define RECOGNIZER_POINTS_PER_STROKE 16
+// the longest kanji of the jōyō set has 29 strokes
+#define RECOGNIZER_MAX_STROKES 32
+// templates with more or fewer strokes than the query are not compared
+#define RECOGNIZER_MAX_STROKE_COUNT_DIFFERENCE 2
+// added to the distance for each stroke that only one side has
+#define RECOGNIZER_MISSING_STROKE_PENALTY 4.0f
+// width of the Sakoe-Chiba band of the stroke alignment (in points)
+#define RECOGNIZER_DTW_WINDOW 3
+
+// Coarse-to-fine: the templates are first ranked by a small key (stroke count,
+// aspect of the bounding box and a histogram of the writing directions) and
+// only the best ShortlistSize of them go through the elastic matching.
+#define RECOGNIZER_NUM_DIRECTIONS      8
+#define RECOGNIZER_MAX_SHORTLIST_SIZE  1024
+#define RECOGNIZER_INDEX_ASPECT_WEIGHT 1.0f
+#define RECOGNIZER_INDEX_STROKE_WEIGHT 0.25f
+
+// mRecognizeStrokesParallel splits the templates into about this many tasks
+// per worker and returns at most RECOGNIZER_MAX_PARALLEL_CANDIDATES candidates
+#define RECOGNIZER_TASKS_PER_WORKER        4
+#define RECOGNIZER_MAX_PARALLEL_CANDIDATES 32
+
+// x, y, the direction and the curvature of a point
+#define RECOGNIZER_NUM_FEATURE_CHANNELS 5
+// weights of the feature differences in the distance between two points
+#define RECOGNIZER_POSITION_WEIGHT  1.0f
+#define RECOGNIZER_DIRECTION_WEIGHT 0.05f
+#define RECOGNIZER_CURVATURE_WEIGHT 0.05f
+// weight of the squared differences of the center and the size of two strokes
+// in their characters, a misplaced stroke costs about as much as all of its
+// points misplaced
+#define RECOGNIZER_LAYOUT_WEIGHT (RECOGNIZER_POINTS_PER_STROKE * RECOGNIZER_POSITION_WEIGHT)
+
+// "KRTM" in little endian
+#define RECOGNIZER_FILE_MAGIC   0x4d54524b
+#define RECOGNIZER_FILE_VERSION 1
+
+// "KRTX" in little endian
+#define RECOGNIZER_INDEX_MAGIC     0x5854524b
+#define RECOGNIZER_INDEX_VERSION   3
+#define RECOGNIZER_INDEX_ALIGNMENT 16
+
+// The template file is
+//   RECOGNIZER_FILE_HEADER
+//   NumTemplates x (RECOGNIZER_FILE_TEMPLATE, NumStrokes x unsigned int number
+//                   of points, the points of every stroke as RESAMPLED_POINTs)
+// in the byte order of the machine. The points can use any unit, every
+// character is normalized to its bounding box.
+struct RECOGNIZER_FILE_HEADER
+{
+  unsigned int Magic;
+  unsigned int Version;
+  unsigned int NumTemplates;
+};
+
+typedef struct RECOGNIZER_FILE_HEADER RECOGNIZER_FILE_HEADER;
+
+struct RECOGNIZER_FILE_TEMPLATE
+{
+  // Unicode code point of the character
+  unsigned int CodePoint;
+  unsigned int NumStrokes;
+};
+
+typedef struct RECOGNIZER_FILE_TEMPLATE RECOGNIZER_FILE_TEMPLATE;
+
+// The points of a stroke in its own unit square (the square around its
+// bounding box) so that they do not depend on the other strokes of the
+// character, and where that square is in the unit square of the character.
+// The channels are stored one after another like the sequences of dtw.h.
+struct RECOGNIZER_STROKE_FEATURES
+{
+  float X[RECOGNIZER_POINTS_PER_STROKE];
+  float Y[RECOGNIZER_POINTS_PER_STROKE];
+  // unit vector of the writing direction (0 for a dot)
+  float DirX[RECOGNIZER_POINTS_PER_STROKE];
+  float DirY[RECOGNIZER_POINTS_PER_STROKE];
+  // sine of the turn of the direction around the point, positive for clockwise on screen
+  float Curvature[RECOGNIZER_POINTS_PER_STROKE];
+  // the square of the stroke in the unit square of the character
+  float CenterX;
+  float CenterY;
+  float Size;
+};
+
+typedef struct RECOGNIZER_STROKE_FEATURES RECOGNIZER_STROKE_FEATURES;
+
+// the coarse description of a character that the index ranks the templates by
+struct RECOGNIZER_INDEX_KEY
+{
+  // (width - height) / max(width, height) of the bounding box
+  float Aspect;
+  // share of the stroke length written in each direction (the bins add up to
+  // about 255), bin 0 is to the right and the bins turn clockwise on screen
+  unsigned char Directions[RECOGNIZER_NUM_DIRECTIONS];
+};
+
+typedef struct RECOGNIZER_INDEX_KEY RECOGNIZER_INDEX_KEY;
+
+// the strokes of a template are the NumStrokes stroke features starting at FeatureOffset
+struct RECOGNIZER_TEMPLATE
+{
+  unsigned int CodePoint;
+  unsigned int NumStrokes;
+  unsigned int FeatureOffset;
+};
+
+typedef struct RECOGNIZER_TEMPLATE RECOGNIZER_TEMPLATE;
+
+// The index file is a RECOGNIZER_INDEX_FILE_HEADER followed by the templates,
+// the keys and the features of a database at the given offsets (multiples of
+// RECOGNIZER_INDEX_ALIGNMENT) so that it can be mapped and used in place.
+struct RECOGNIZER_INDEX_FILE_HEADER
+{
+  unsigned int Magic;
+  unsigned int Version;
+  unsigned int cbFileHeader;
+  // the layout of the features depends on these
+  unsigned int PointsPerStroke;
+  unsigned int NumDirections;
+  unsigned int NumTemplates;
+  unsigned int NumFeatures;
+  unsigned int StrokeCountOffsets[RECOGNIZER_MAX_STROKES + 2];
+  unsigned long long TemplatesOffset;
+  unsigned long long KeysOffset;
+  unsigned long long FeaturesOffset;
+};
+
+typedef struct RECOGNIZER_INDEX_FILE_HEADER RECOGNIZER_INDEX_FILE_HEADER;
+
+// A read only view of an index file.
+struct RECOGNIZER_INDEX_MAPPING
+{
+  const BYTE* Data;
+  size_t cbData;
+#ifdef _WIN32
+  HANDLE File;
+  HANDLE Mapping;
+#else
+  int File;
+#endif
+};
+
+typedef struct RECOGNIZER_INDEX_MAPPING RECOGNIZER_INDEX_MAPPING;
+
+// The templates are sorted by their number of strokes, the templates with n
+// strokes are [StrokeCountOffsets[n], StrokeCountOffsets[n + 1]) and Keys[i]
+// is the key of Templates[i].
+//
+// A database that was mapped from an index file points into the mapping and
+// cannot take more templates.
+struct RECOGNIZER_DATABASE
+{
+  RECOGNIZER_TEMPLATE* Templates;
+  RECOGNIZER_INDEX_KEY* Keys;
+  unsigned int NumTemplates;
+  unsigned int TemplateCapacity;
+  unsigned int StrokeCountOffsets[RECOGNIZER_MAX_STROKES + 2];
+  RECOGNIZER_STROKE_FEATURES* Features;
+  unsigned int NumFeatures;
+  unsigned int FeatureCapacity;
+  // templates that the index passes on to the elastic matching (0 compares all of them)
+  unsigned int ShortlistSize;
+  RECOGNIZER_INDEX_MAPPING Mapping;
+};
+
+typedef struct RECOGNIZER_DATABASE RECOGNIZER_DATABASE;
+
+struct RECOGNIZER_CANDIDATE
+{
+  unsigned int CodePoint;
+  float Distance;
+};
+
+typedef struct RECOGNIZER_CANDIDATE RECOGNIZER_CANDIDATE;
+
+// the distance of the shapes of the first NumMatchedStrokes strokes of a template to the query
+struct RECOGNIZER_PARTIAL_MATCH
+{
+  float Distance;
+  unsigned int NumMatchedStrokes;
+};
+
+typedef struct RECOGNIZER_PARTIAL_MATCH RECOGNIZER_PARTIAL_MATCH;
+
+// The state that mRecognizeStrokesIncremental keeps between the strokes of a
+// character. The shapes of the strokes that were already compared to a
+// template are not compared again. They do not depend on the bounding box of
+// the character, only the cheap distance of the stroke layouts is computed
+// again when a new stroke grows it.
+struct RECOGNIZER_SESSION
+{
+  // one per template of the database
+  RECOGNIZER_PARTIAL_MATCH* Matches;
+  unsigned int NumTemplates;
+  unsigned int NumStrokes;
+  // the strokes of the last call whose shapes the templates resumed from (0 if the session was reset)
+  unsigned int NumResumedStrokes;
+};
+
+typedef struct RECOGNIZER_SESSION RECOGNIZER_SESSION;
+
+void mInitializeRecognizerDatabase(RECOGNIZER_DATABASE* database);
+void mFreeRecognizerDatabase(RECOGNIZER_DATABASE* database);
+// Add a character from its strokes (RESAMPLED_STROKE ranges of points), the
+// points do not have to be resampled. Returns -1 if it has no stroke or too many.
+int mAddRecognizerTemplate(RECOGNIZER_DATABASE* database, unsigned int codePoint, const RESAMPLED_POINT* points, const RESAMPLED_STROKE* strokes, unsigned int numStrokes);
+// Add the templates of a template file. Returns -1 if the file cannot be read or is not a template file.
+int mLoadRecognizerDatabase(const char* filePath, RECOGNIZER_DATABASE* database);
+// Write the database as an index file for mMapRecognizerIndex.
+int mWriteRecognizerIndex(const char* filePath, const RECOGNIZER_DATABASE* database);
+// Use the templates of an index file without copying them, the database must be empty.
+// Returns -1 if the file cannot be mapped or was written with other recognizer parameters.
+int mMapRecognizerIndex(const char* filePath, RECOGNIZER_DATABASE* database);
+// Rank the templates by their distance to the resampled strokes. The best
+// (*numCandidates) <= maxCandidates candidates are written in increasing
+// distance. Returns -1 if there is nothing to recognize.
+int mRecognizeStrokes(const RECOGNIZER_DATABASE* database, const STROKE_RESAMPLER* resampler, RECOGNIZER_CANDIDATE* candidates, unsigned int maxCandidates, unsigned int* numCandidates);
+// The same ranking with the templates split across the workers of the pool,
+// a worker abandons a template as soon as it is worse than the last candidate
+// of any worker. Must be called from worker 0 of the pool (the thread that
+// created it), the candidates are the same as with mRecognizeStrokes.
+int mRecognizeStrokesParallel(const RECOGNIZER_DATABASE* database, const STROKE_RESAMPLER* resampler, WORK_POOL* pool, RECOGNIZER_CANDIDATE* candidates, unsigned int maxCandidates, unsigned int* numCandidates);
+
+void mInitializeRecognizerSession(RECOGNIZER_SESSION* session, const RECOGNIZER_DATABASE* database);
+void mFreeRecognizerSession(RECOGNIZER_SESSION* session);
+// forget the strokes, e.g. when the canvas is cleared
+void mResetRecognizerSession(RECOGNIZER_SESSION* session);
+// mRecognizeStrokesParallel for strokes that grow one stroke at a time: the
+// templates resume from the strokes that the session has already compared, so
+// it must only be called with finished strokes (e.g. when a stroke ends).
+// pool can be NULL to score on the calling thread. The scoring stops soon
+// after (*cancel) becomes non-zero and -1 is returned, the session is still
+// valid then.
+int mRecognizeStrokesIncremental(const RECOGNIZER_DATABASE* database, RECOGNIZER_SESSION* session, const STROKE_RESAMPLER* resampler, WORK_POOL* pool, volatile unsigned int* cancel, RECOGNIZER_CANDIDATE* candidates, unsigned int maxCandidates, unsigned int* numCandidates);
+#endif  // __RECOGNIZER_H__
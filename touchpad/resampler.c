@@ -0,0 +1,237 @@
+#include "platform.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include "resampler.h"
+
+#include "utils.h"
+#include "termcolor.h"
+
+void mInitializeStrokeResampler(STROKE_RESAMPLER* resampler, unsigned int pointCapacity, unsigned int strokeCapacity, float spacing)
+{
+  if ((pointCapacity == 0) || (strokeCapacity == 0) || !(spacing > 0.0f))
+  {
+    printf(FG_RED);
+    printf("Invalid stroke resampler parameters at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    exit(-1);
+  }
+
+  memset(resampler, 0, sizeof(STROKE_RESAMPLER));
+  resampler->Points         = (RESAMPLED_POINT*)mMalloc(sizeof(RESAMPLED_POINT) * pointCapacity, __FILE__, __LINE__);
+  resampler->PointCapacity  = pointCapacity;
+  resampler->Strokes        = (RESAMPLED_STROKE*)mMalloc(sizeof(RESAMPLED_STROKE) * strokeCapacity, __FILE__, __LINE__);
+  resampler->StrokeCapacity = strokeCapacity;
+  resampler->Spacing        = spacing;
+}
+
+void mFreeStrokeResampler(STROKE_RESAMPLER* resampler)
+{
+  free(resampler->Points);
+  free(resampler->Strokes);
+  memset(resampler, 0, sizeof(STROKE_RESAMPLER));
+}
+
+void mClearStrokeResampler(STROKE_RESAMPLER* resampler)
+{
+  resampler->NumPoints        = 0;
+  resampler->NumStrokes       = 0;
+  resampler->NumSourceStrokes = 0;
+  resampler->NumSourcePoints  = 0;
+  resampler->Travelled        = 0.0f;
+}
+
+// append a resampled point to the last stroke
+static int mEmitResampledPoint(STROKE_RESAMPLER* resampler, float x, float y)
+{
+  if (resampler->NumPoints == resampler->PointCapacity)
+  {
+    resampler->NumDroppedPoints++;
+    return -1;
+  }
+
+  if (resampler->NumPoints == 0)
+  {
+    resampler->MinX = x;
+    resampler->MinY = y;
+    resampler->MaxX = x;
+    resampler->MaxY = y;
+  }
+  else
+  {
+    resampler->MinX = (x < resampler->MinX) ? x : resampler->MinX;
+    resampler->MinY = (y < resampler->MinY) ? y : resampler->MinY;
+    resampler->MaxX = (x > resampler->MaxX) ? x : resampler->MaxX;
+    resampler->MaxY = (y > resampler->MaxY) ? y : resampler->MaxY;
+  }
+
+  resampler->Points[resampler->NumPoints] = (RESAMPLED_POINT){.X = x, .Y = y};
+  resampler->NumPoints++;
+  resampler->Strokes[resampler->NumStrokes - 1].Size++;
+
+  return 0;
+}
+
+// walk from the last processed raw point to this one and emit a point every Spacing
+static int mResampleSourcePoint(STROKE_RESAMPLER* resampler, Point2D point, int isFirstPoint)
+{
+  int retval = 0;
+  float x    = (float)point.X;
+  float y    = (float)point.Y;
+
+  if (isFirstPoint)
+  {
+    retval = mEmitResampledPoint(resampler, x, y);
+  }
+  else
+  {
+    float dx            = x - resampler->LastSourcePoint.X;
+    float dy            = y - resampler->LastSourcePoint.Y;
+    float segmentLength = sqrtf((dx * dx) + (dy * dy));
+    float position      = 0.0f;
+
+    // Travelled < Spacing so a zero length segment never emits
+    while ((resampler->Travelled + (segmentLength - position)) >= resampler->Spacing)
+    {
+      position += resampler->Spacing - resampler->Travelled;
+      float t = position / segmentLength;
+
+      if (mEmitResampledPoint(resampler, resampler->LastSourcePoint.X + (dx * t), resampler->LastSourcePoint.Y + (dy * t)) != 0)
+      {
+        retval = -1;
+      }
+
+      resampler->Travelled = 0.0f;
+    }
+
+    resampler->Travelled += segmentLength - position;
+  }
+
+  resampler->LastSourcePoint = (RESAMPLED_POINT){.X = x, .Y = y};
+
+  return retval;
+}
+
+int mUpdateStrokeResampler(STROKE_RESAMPLER* resampler, StrokeList* strokes)
+{
+  int retval = 0;
+
+  // the stroke list has been cleared (or replaced), start over
+  if (strokes->Size < resampler->NumSourceStrokes)
+  {
+    mClearStrokeResampler(resampler);
+  }
+
+  // only the last stroke that we have seen can have grown
+  unsigned int strokeIdx = (resampler->NumSourceStrokes == 0) ? 0 : (resampler->NumSourceStrokes - 1);
+
+  for (; strokeIdx < strokes->Size; strokeIdx++)
+  {
+    if (strokeIdx == resampler->NumSourceStrokes)
+    {
+      if ((resampler->NumSourceStrokes != 0) && (mFinishResampledStroke(resampler) != 0))
+      {
+        retval = -1;
+      }
+
+      resampler->NumSourceStrokes++;
+      resampler->NumSourcePoints = 0;
+      resampler->Travelled       = 0.0f;
+
+      if (resampler->NumStrokes == resampler->StrokeCapacity)
+      {
+        // the points of this stroke are counted as dropped below
+        retval = -1;
+      }
+      else
+      {
+        resampler->Strokes[resampler->NumStrokes] = (RESAMPLED_STROKE){.Offset = resampler->NumPoints, .Size = 0};
+        resampler->NumStrokes++;
+      }
+    }
+
+    StrokeIndexEntry stroke = strokes->Entries[strokeIdx];
+    Point2D* strokePoints   = mGetStrokePoints(strokes, strokeIdx);
+
+    if (resampler->NumStrokes < resampler->NumSourceStrokes)
+    {
+      resampler->NumDroppedPoints += stroke.Size - resampler->NumSourcePoints;
+    }
+    else
+    {
+      for (unsigned int pointIdx = resampler->NumSourcePoints; pointIdx < stroke.Size; pointIdx++)
+      {
+        if (mResampleSourcePoint(resampler, strokePoints[pointIdx], pointIdx == 0) != 0)
+        {
+          retval = -1;
+        }
+      }
+    }
+
+    resampler->NumSourcePoints = stroke.Size;
+  }
+
+  return retval;
+}
+
+int mFinishResampledStroke(STROKE_RESAMPLER* resampler)
+{
+  if ((resampler->NumStrokes == 0) || (resampler->NumStrokes < resampler->NumSourceStrokes) || !(resampler->Travelled > 0.0f))
+  {
+    return 0;
+  }
+
+  resampler->Travelled = 0.0f;
+
+  return mEmitResampledPoint(resampler, resampler->LastSourcePoint.X, resampler->LastSourcePoint.Y);
+}
+
+void mGetStrokeResamplerNormalization(const STROKE_RESAMPLER* resampler, float* scale, float* offsetX, float* offsetY)
+{
+  if (resampler->NumPoints == 0)
+  {
+    (*scale)   = 1.0f;
+    (*offsetX) = 0.0f;
+    (*offsetY) = 0.0f;
+    return;
+  }
+
+  float width  = resampler->MaxX - resampler->MinX;
+  float height = resampler->MaxY - resampler->MinY;
+  float size   = (width > height) ? width : height;
+
+  (*scale)   = (size > 0.0f) ? (1.0f / size) : 1.0f;
+  (*offsetX) = resampler->MinX - ((size - width) * 0.5f);
+  (*offsetY) = resampler->MinY - ((size - height) * 0.5f);
+}
+
+int mCopyStrokeResampler(STROKE_RESAMPLER* destination, const STROKE_RESAMPLER* source, unsigned int maxStrokes)
+{
+  unsigned int numStrokes = (source->NumStrokes < maxStrokes) ? source->NumStrokes : maxStrokes;
+  numStrokes              = (numStrokes < destination->StrokeCapacity) ? numStrokes : destination->StrokeCapacity;
+
+  mClearStrokeResampler(destination);
+
+  for (unsigned int strokeIdx = 0; strokeIdx < numStrokes; strokeIdx++)
+  {
+    RESAMPLED_STROKE stroke = source->Strokes[strokeIdx];
+    if ((destination->NumPoints + stroke.Size) > destination->PointCapacity)
+    {
+      break;
+    }
+
+    memcpy(destination->Points + destination->NumPoints, source->Points + stroke.Offset, sizeof(RESAMPLED_POINT) * stroke.Size);
+    destination->Strokes[strokeIdx] = (RESAMPLED_STROKE){.Offset = destination->NumPoints, .Size = stroke.Size};
+    destination->NumPoints += stroke.Size;
+    destination->NumStrokes++;
+  }
+
+  // the normalization stays the one of all the strokes
+  destination->MinX = source->MinX;
+  destination->MinY = source->MinY;
+  destination->MaxX = source->MaxX;
+  destination->MaxY = source->MaxY;
+
+  return (destination->NumStrokes == numStrokes) ? 0 : -1;
+}
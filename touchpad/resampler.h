@@ -0,0 +1,84 @@
+#ifndef __RESAMPLER_H__
+#define __RESAMPLER_H__
+#include "platform.h"
+
+#include "point2d.h"
+#include "stroke.h"
+
+struct RESAMPLED_POINT
+{
+  float X;
+  float Y;
+};
+
+typedef struct RESAMPLED_POINT RESAMPLED_POINT;
+
+// location of a stroke's points inside STROKE_RESAMPLER.Points
+struct RESAMPLED_STROKE
+{
+  unsigned int Offset;
+  unsigned int Size;
+};
+
+typedef struct RESAMPLED_STROKE RESAMPLED_STROKE;
+
+// Keeps a copy of the strokes of a StrokeList resampled at equal arc length
+// (Spacing device units between two points) so that the recognizer and the
+// exporters get points that do not depend on the report rate of the touchpad.
+// Only the raw points that were appended since the last update are processed,
+// the distance walked since the last resampled point is carried over.
+//
+// Normalizing the points to the bounding box of the character would move every
+// point whenever the box grows, so the points stay in device units and the box
+// is tracked instead. mGetStrokeResamplerNormalization returns the transform
+// into the unit square.
+//
+// All the memory is allocated by mInitializeStrokeResampler. Points that do
+// not fit are dropped and counted.
+struct STROKE_RESAMPLER
+{
+  RESAMPLED_POINT* Points;
+  unsigned int NumPoints;
+  unsigned int PointCapacity;
+  RESAMPLED_STROKE* Strokes;
+  unsigned int NumStrokes;
+  unsigned int StrokeCapacity;
+  float Spacing;
+
+  // strokes of the StrokeList that have been seen
+  unsigned int NumSourceStrokes;
+  // raw points of the last stroke that have been processed
+  unsigned int NumSourcePoints;
+  // the last processed raw point and the distance walked since the last resampled point
+  RESAMPLED_POINT LastSourcePoint;
+  float Travelled;
+
+  // bounding box of the resampled points
+  float MinX;
+  float MinY;
+  float MaxX;
+  float MaxY;
+
+  unsigned long long NumDroppedPoints;
+};
+
+typedef struct STROKE_RESAMPLER STROKE_RESAMPLER;
+
+void mInitializeStrokeResampler(STROKE_RESAMPLER* resampler, unsigned int pointCapacity, unsigned int strokeCapacity, float spacing);
+void mFreeStrokeResampler(STROKE_RESAMPLER* resampler);
+// forget all strokes, e.g. after mClearStrokeList
+void mClearStrokeResampler(STROKE_RESAMPLER* resampler);
+// Resample the points that have been appended to the strokes since the last
+// call. Returns -1 if some points did not fit in the buffers.
+int mUpdateStrokeResampler(STROKE_RESAMPLER* resampler, StrokeList* strokes);
+// Add the last raw point of the last stroke if the resampling stopped short of
+// it (call it when the stroke ends).
+int mFinishResampledStroke(STROKE_RESAMPLER* resampler);
+// x' = (x - offsetX) * scale (the same for y) maps the resampled points into
+// the unit square keeping the aspect ratio, the shorter side is centered
+void mGetStrokeResamplerNormalization(const STROKE_RESAMPLER* resampler, float* scale, float* offsetX, float* offsetY);
+// Copy the points of the first maxStrokes strokes and the bounding box of all
+// of them into a resampler of another thread. The copy cannot be updated
+// anymore. Returns -1 if some strokes did not fit.
+int mCopyStrokeResampler(STROKE_RESAMPLER* destination, const STROKE_RESAMPLER* source, unsigned int maxStrokes);
+#endif  // __RESAMPLER_H__
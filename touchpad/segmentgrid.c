@@ -0,0 +1,427 @@
+#include "platform.h"
+
+#include <stdio.h>
+#include <float.h>
+#include <math.h>
+
+#include "segmentgrid.h"
+
+#include "utils.h"
+#include "termcolor.h"
+
+#define STROKE_SEGMENT_LIST_MIN_CAPACITY 8
+
+int mInitializeSegmentGrid(SEGMENT_GRID* grid, const RECT* bounds, int cellSize)
+{
+  memset(grid, 0, sizeof(SEGMENT_GRID));
+
+  if ((bounds->right <= bounds->left) || (bounds->bottom <= bounds->top) || (cellSize <= 0))
+  {
+    printf(FG_RED);
+    printf("Invalid segment grid (%ld, %ld, %ld, %ld) with cells of %d at %s:%d\n", (long)bounds->left, (long)bounds->top, (long)bounds->right, (long)bounds->bottom, cellSize, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  grid->Bounds     = (*bounds);
+  grid->CellSize   = cellSize;
+  grid->NumColumns = (int)((((long long)bounds->right - bounds->left) + cellSize - 1) / cellSize);
+  grid->NumRows    = (int)((((long long)bounds->bottom - bounds->top) + cellSize - 1) / cellSize);
+  grid->Cells      = (STROKE_SEGMENT_LIST*)mMalloc(sizeof(STROKE_SEGMENT_LIST) * grid->NumColumns * grid->NumRows, __FILE__, __LINE__);
+  memset(grid->Cells, 0, sizeof(STROKE_SEGMENT_LIST) * grid->NumColumns * grid->NumRows);
+
+  return 0;
+}
+
+void mFreeStrokeSegmentList(STROKE_SEGMENT_LIST* segments)
+{
+  free(segments->Entries);
+  memset(segments, 0, sizeof(STROKE_SEGMENT_LIST));
+}
+
+void mFreeSegmentGrid(SEGMENT_GRID* grid)
+{
+  if (grid->Cells != NULL)
+  {
+    for (int cellIdx = 0; cellIdx < (grid->NumColumns * grid->NumRows); cellIdx++)
+    {
+      free(grid->Cells[cellIdx].Entries);
+    }
+    free(grid->Cells);
+  }
+
+  memset(grid, 0, sizeof(SEGMENT_GRID));
+}
+
+static void mAppendStrokeSegment(STROKE_SEGMENT_LIST* segments, const STROKE_SEGMENT* segment)
+{
+  if (segments->Size == segments->Capacity)
+  {
+    unsigned int newCapacity = segments->Capacity * 2;
+    if (newCapacity < STROKE_SEGMENT_LIST_MIN_CAPACITY)
+    {
+      newCapacity = STROKE_SEGMENT_LIST_MIN_CAPACITY;
+    }
+
+    segments->Entries  = (STROKE_SEGMENT*)mRealloc(segments->Entries, sizeof(STROKE_SEGMENT) * newCapacity, __FILE__, __LINE__);
+    segments->Capacity = newCapacity;
+  }
+
+  segments->Entries[segments->Size] = (*segment);
+  segments->Size++;
+}
+
+// the cells of the border also hold what is outside the bounds
+static __inline int mGetSegmentGridColumn(const SEGMENT_GRID* grid, long long x)
+{
+  long long column = (x < grid->Bounds.left) ? 0 : ((x - grid->Bounds.left) / grid->CellSize);
+  return (column >= grid->NumColumns) ? (grid->NumColumns - 1) : (int)column;
+}
+
+static __inline int mGetSegmentGridRow(const SEGMENT_GRID* grid, long long y)
+{
+  long long row = (y < grid->Bounds.top) ? 0 : ((y - grid->Bounds.top) / grid->CellSize);
+  return (row >= grid->NumRows) ? (grid->NumRows - 1) : (int)row;
+}
+
+static void mGetStrokeSegment(const StrokeList* strokes, unsigned int strokeIdx, unsigned int pointIdx, STROKE_SEGMENT* segment)
+{
+  const Point2D* strokePoints = strokes->SimplifiedPoints.Entries + strokes->Entries[strokeIdx].SimplifiedOffset;
+
+  segment->StrokeIdx = strokeIdx;
+  segment->PointIdx  = pointIdx;
+  segment->From      = strokePoints[pointIdx - 1];
+  segment->To        = strokePoints[pointIdx];
+}
+
+static void mAddSegmentToGrid(SEGMENT_GRID* grid, const STROKE_SEGMENT* segment)
+{
+  int firstColumn = mGetSegmentGridColumn(grid, (segment->From.X < segment->To.X) ? segment->From.X : segment->To.X);
+  int lastColumn  = mGetSegmentGridColumn(grid, (segment->From.X > segment->To.X) ? segment->From.X : segment->To.X);
+  int firstRow    = mGetSegmentGridRow(grid, (segment->From.Y < segment->To.Y) ? segment->From.Y : segment->To.Y);
+  int lastRow     = mGetSegmentGridRow(grid, (segment->From.Y > segment->To.Y) ? segment->From.Y : segment->To.Y);
+
+  for (int row = firstRow; row <= lastRow; row++)
+  {
+    for (int column = firstColumn; column <= lastColumn; column++)
+    {
+      mAppendStrokeSegment(&grid->Cells[(row * grid->NumColumns) + column], segment);
+    }
+  }
+
+  grid->NumSegments++;
+  grid->NumCellEntries += (unsigned int)((lastRow - firstRow + 1) * (lastColumn - firstColumn + 1));
+}
+
+void mUpdateSegmentGrid(SEGMENT_GRID* grid, const StrokeList* strokes)
+{
+  STROKE_SEGMENT segment;
+
+  if (grid->Generation != strokes->Generation)
+  {
+    // strokes have been removed, index the list again (the memory of the cells is reused)
+    for (int cellIdx = 0; cellIdx < (grid->NumColumns * grid->NumRows); cellIdx++)
+    {
+      grid->Cells[cellIdx].Size = 0;
+    }
+
+    grid->NumIndexedStrokes = 0;
+    grid->NumIndexedPoints  = 0;
+    grid->NumSegments       = 0;
+    grid->NumCellEntries    = 0;
+    grid->Generation        = strokes->Generation;
+  }
+
+  while (grid->NumIndexedStrokes < strokes->Size)
+  {
+    unsigned int strokeIdx  = grid->NumIndexedStrokes;
+    StrokeIndexEntry stroke = strokes->Entries[strokeIdx];
+    int isLastStroke        = (strokeIdx == (strokes->Size - 1));
+
+    // the last point of the last stroke may still be replaced
+    unsigned int endPointIdx = stroke.SimplifiedSize;
+    if (isLastStroke && (endPointIdx != 0))
+    {
+      endPointIdx--;
+    }
+
+    for (unsigned int pointIdx = (grid->NumIndexedPoints > 1) ? grid->NumIndexedPoints : 1; pointIdx < endPointIdx; pointIdx++)
+    {
+      mGetStrokeSegment(strokes, strokeIdx, pointIdx, &segment);
+      mAddSegmentToGrid(grid, &segment);
+    }
+
+    if (isLastStroke)
+    {
+      grid->NumIndexedPoints = (endPointIdx > grid->NumIndexedPoints) ? endPointIdx : grid->NumIndexedPoints;
+      break;
+    }
+
+    grid->NumIndexedStrokes++;
+    grid->NumIndexedPoints = 0;
+  }
+}
+
+// first segment of the cell that belongs to firstStroke or a later stroke
+static unsigned int mFindFirstCellSegment(const STROKE_SEGMENT_LIST* cell, unsigned int firstStroke)
+{
+  unsigned int low  = 0;
+  unsigned int high = cell->Size;
+
+  while (low < high)
+  {
+    unsigned int middle = low + ((high - low) / 2);
+    if (cell->Entries[middle].StrokeIdx < firstStroke)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+
+  return low;
+}
+
+static int mIsSegmentInRect(const STROKE_SEGMENT* segment, const RECT* rect)
+{
+  double fromX = (double)segment->From.X;
+  double fromY = (double)segment->From.Y;
+  double toX   = (double)segment->To.X;
+  double toY   = (double)segment->To.Y;
+
+  if ((fmax(fromX, toX) < (double)rect->left) || (fmin(fromX, toX) > (double)rect->right) || (fmax(fromY, toY) < (double)rect->top) || (fmin(fromY, toY) > (double)rect->bottom))
+  {
+    return 0;
+  }
+
+  // the bounding boxes overlap, the segment misses the rect only if every
+  // corner of the rect is on the same side of its line
+  double dx         = toX - fromX;
+  double dy         = toY - fromY;
+  double corners[4] = {(dx * ((double)rect->top - fromY)) - (dy * ((double)rect->left - fromX)), (dx * ((double)rect->top - fromY)) - (dy * ((double)rect->right - fromX)),
+                       (dx * ((double)rect->bottom - fromY)) - (dy * ((double)rect->left - fromX)), (dx * ((double)rect->bottom - fromY)) - (dy * ((double)rect->right - fromX))};
+
+  int numPositive = 0;
+  int numNegative = 0;
+  for (int cornerIdx = 0; cornerIdx < 4; cornerIdx++)
+  {
+    numPositive += (corners[cornerIdx] > 0.0);
+    numNegative += (corners[cornerIdx] < 0.0);
+  }
+
+  return (numPositive != 4) && (numNegative != 4);
+}
+
+static int mCompareStrokeSegments(const void* a, const void* b)
+{
+  const STROKE_SEGMENT* first  = (const STROKE_SEGMENT*)a;
+  const STROKE_SEGMENT* second = (const STROKE_SEGMENT*)b;
+
+  if (first->StrokeIdx != second->StrokeIdx)
+  {
+    return (first->StrokeIdx < second->StrokeIdx) ? -1 : 1;
+  }
+
+  return (first->PointIdx < second->PointIdx) ? -1 : ((first->PointIdx > second->PointIdx) ? 1 : 0);
+}
+
+// Returns 0 and the next segment of [firstStroke, endStroke) that is not in
+// the grid yet, -1 after the last one. (*strokeIdx) and (*pointIdx) start at
+// NumIndexedStrokes and NumIndexedPoints of the grid.
+static int mGetNextUnindexedSegment(const StrokeList* strokes, unsigned int firstStroke, unsigned int endStroke, unsigned int* strokeIdx, unsigned int* pointIdx, STROKE_SEGMENT* segment)
+{
+  if ((*strokeIdx) < firstStroke)
+  {
+    (*strokeIdx) = firstStroke;
+    (*pointIdx)  = 0;
+  }
+
+  endStroke = (endStroke < strokes->Size) ? endStroke : strokes->Size;
+
+  while ((*strokeIdx) < endStroke)
+  {
+    (*pointIdx) = ((*pointIdx) > 1) ? (*pointIdx) : 1;
+
+    if ((*pointIdx) < strokes->Entries[*strokeIdx].SimplifiedSize)
+    {
+      mGetStrokeSegment(strokes, (*strokeIdx), (*pointIdx), segment);
+      (*pointIdx)++;
+      return 0;
+    }
+
+    (*strokeIdx)++;
+    (*pointIdx) = 0;
+  }
+
+  return -1;
+}
+
+void mQuerySegmentGrid(const SEGMENT_GRID* grid, const StrokeList* strokes, unsigned int firstStroke, unsigned int endStroke, const RECT* rect, STROKE_SEGMENT_LIST* result)
+{
+  result->Size = 0;
+
+  if ((firstStroke >= endStroke) || (rect->right < rect->left) || (rect->bottom < rect->top))
+  {
+    return;
+  }
+
+  int firstColumn = mGetSegmentGridColumn(grid, rect->left);
+  int lastColumn  = mGetSegmentGridColumn(grid, rect->right);
+  int firstRow    = mGetSegmentGridRow(grid, rect->top);
+  int lastRow     = mGetSegmentGridRow(grid, rect->bottom);
+
+  for (int row = firstRow; row <= lastRow; row++)
+  {
+    for (int column = firstColumn; column <= lastColumn; column++)
+    {
+      const STROKE_SEGMENT_LIST* cell = &grid->Cells[(row * grid->NumColumns) + column];
+
+      for (unsigned int segmentIdx = mFindFirstCellSegment(cell, firstStroke); segmentIdx < cell->Size; segmentIdx++)
+      {
+        const STROKE_SEGMENT* segment = &cell->Entries[segmentIdx];
+        if (segment->StrokeIdx >= endStroke)
+        {
+          break;
+        }
+
+        if (!mIsSegmentInRect(segment, rect))
+        {
+          continue;
+        }
+
+        // A segment is in every cell of its bounding box, report it only from
+        // the cell of the top left corner of its overlap with the rect.
+        long long overlapLeft = (segment->From.X < segment->To.X) ? segment->From.X : segment->To.X;
+        long long overlapTop  = (segment->From.Y < segment->To.Y) ? segment->From.Y : segment->To.Y;
+        overlapLeft           = (overlapLeft > rect->left) ? overlapLeft : rect->left;
+        overlapTop            = (overlapTop > rect->top) ? overlapTop : rect->top;
+
+        if ((mGetSegmentGridColumn(grid, overlapLeft) == column) && (mGetSegmentGridRow(grid, overlapTop) == row))
+        {
+          mAppendStrokeSegment(result, segment);
+        }
+      }
+    }
+  }
+
+  unsigned int strokeIdx = grid->NumIndexedStrokes;
+  unsigned int pointIdx  = grid->NumIndexedPoints;
+  STROKE_SEGMENT segment;
+  while (mGetNextUnindexedSegment(strokes, firstStroke, endStroke, &strokeIdx, &pointIdx, &segment) == 0)
+  {
+    if (mIsSegmentInRect(&segment, rect))
+    {
+      mAppendStrokeSegment(result, &segment);
+    }
+  }
+
+  qsort(result->Entries, result->Size, sizeof(STROKE_SEGMENT), mCompareStrokeSegments);
+}
+
+static float mGetSquaredDistanceToStrokeSegment(Point2D point, const STROKE_SEGMENT* segment)
+{
+  float dx = (float)segment->To.X - (float)segment->From.X;
+  float dy = (float)segment->To.Y - (float)segment->From.Y;
+  float px = (float)point.X - (float)segment->From.X;
+  float py = (float)point.Y - (float)segment->From.Y;
+
+  float lengthSquared = (dx * dx) + (dy * dy);
+  float t             = (lengthSquared > 0.0f) ? (((px * dx) + (py * dy)) / lengthSquared) : 0.0f;
+  t                   = (t < 0.0f) ? 0.0f : ((t > 1.0f) ? 1.0f : t);
+
+  float ex = px - (t * dx);
+  float ey = py - (t * dy);
+
+  return (ex * ex) + (ey * ey);
+}
+
+int mFindNearestStroke(const SEGMENT_GRID* grid, const StrokeList* strokes, unsigned int firstStroke, unsigned int endStroke, Point2D point, float maxDistance, unsigned int* strokeIdx, float* distance)
+{
+  float bestSquared  = (maxDistance < sqrtf(FLT_MAX)) ? (maxDistance * maxDistance) : FLT_MAX;
+  int isFound        = 0;
+  int centerColumn   = mGetSegmentGridColumn(grid, point.X);
+  int centerRow      = mGetSegmentGridRow(grid, point.Y);
+  int maxRing        = (grid->NumColumns > grid->NumRows) ? grid->NumColumns : grid->NumRows;
+  unsigned int found = 0;
+
+  if (firstStroke >= endStroke)
+  {
+    return -1;
+  }
+
+  // The cells are searched in rings of growing distance around the cell of
+  // the point. The segments of ring r are at least (r - 1) cells away, so the
+  // search stops once that is farther than the closest segment found so far.
+  for (int ring = 0; ring <= maxRing; ring++)
+  {
+    float ringDistance = (float)((ring > 0) ? (ring - 1) : 0) * (float)grid->CellSize;
+    if ((ringDistance * ringDistance) > bestSquared)
+    {
+      break;
+    }
+
+    for (int row = centerRow - ring; row <= (centerRow + ring); row++)
+    {
+      if ((row < 0) || (row >= grid->NumRows))
+      {
+        continue;
+      }
+
+      // only the border of the ring, its inside was searched before
+      int columnStep = ((row == (centerRow - ring)) || (row == (centerRow + ring))) ? 1 : (2 * ring);
+      columnStep     = (columnStep > 0) ? columnStep : 1;
+
+      for (int column = centerColumn - ring; column <= (centerColumn + ring); column += columnStep)
+      {
+        if ((column < 0) || (column >= grid->NumColumns))
+        {
+          continue;
+        }
+
+        const STROKE_SEGMENT_LIST* cell = &grid->Cells[(row * grid->NumColumns) + column];
+        for (unsigned int segmentIdx = mFindFirstCellSegment(cell, firstStroke); segmentIdx < cell->Size; segmentIdx++)
+        {
+          const STROKE_SEGMENT* segment = &cell->Entries[segmentIdx];
+          if (segment->StrokeIdx >= endStroke)
+          {
+            break;
+          }
+
+          float squared = mGetSquaredDistanceToStrokeSegment(point, segment);
+          if (squared <= bestSquared)
+          {
+            bestSquared = squared;
+            found       = segment->StrokeIdx;
+            isFound     = 1;
+          }
+        }
+      }
+    }
+  }
+
+  unsigned int unindexedStrokeIdx = grid->NumIndexedStrokes;
+  unsigned int unindexedPointIdx  = grid->NumIndexedPoints;
+  STROKE_SEGMENT segment;
+  while (mGetNextUnindexedSegment(strokes, firstStroke, endStroke, &unindexedStrokeIdx, &unindexedPointIdx, &segment) == 0)
+  {
+    float squared = mGetSquaredDistanceToStrokeSegment(point, &segment);
+    if (squared <= bestSquared)
+    {
+      bestSquared = squared;
+      found       = segment.StrokeIdx;
+      isFound     = 1;
+    }
+  }
+
+  if (!isFound)
+  {
+    return -1;
+  }
+
+  (*strokeIdx) = found;
+  (*distance)  = sqrtf(bestSquared);
+
+  return 0;
+}
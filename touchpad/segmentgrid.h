@@ -0,0 +1,79 @@
+#ifndef __SEGMENTGRID_H__
+#define __SEGMENTGRID_H__
+#include "platform.h"
+
+#include "point2d.h"
+#include "stroke.h"
+
+// a segment of the simplified view of a stroke, from its point PointIdx - 1 to its point PointIdx
+struct STROKE_SEGMENT
+{
+  unsigned int StrokeIdx;
+  unsigned int PointIdx;
+  Point2D From;
+  Point2D To;
+};
+
+typedef struct STROKE_SEGMENT STROKE_SEGMENT;
+
+struct STROKE_SEGMENT_LIST
+{
+  STROKE_SEGMENT* Entries;
+  unsigned int Size;
+  unsigned int Capacity;
+};
+
+typedef struct STROKE_SEGMENT_LIST STROKE_SEGMENT_LIST;
+
+// A uniform grid of square cells over the area of the touchpad that holds
+// every segment of the simplified strokes of a StrokeList in the cells that
+// its bounding box overlaps. Points outside Bounds go to the cells of the
+// border. Hit tests and partial redraws only look at the cells around the
+// area they ask for, so they cost as much as the ink there and not as much as
+// all the ink of the list.
+//
+// The grid follows the list with mUpdateSegmentGrid like the resampler: only
+// the segments that were appended since the last update are added. The last
+// segment of the last stroke is not added because its end point moves until
+// the next point is kept (see StrokeList); the queries test the segments that
+// are not in the grid yet directly. The segments of a cell are in the order
+// of the list, so the strokes of a range (e.g. the visible ones of an edit
+// log) start at a binary search in every cell. A new generation of the list
+// (strokes removed) indexes it again from the start.
+struct SEGMENT_GRID
+{
+  RECT Bounds;
+  // in device units
+  int CellSize;
+  int NumColumns;
+  int NumRows;
+  // NumColumns * NumRows, row by row
+  STROKE_SEGMENT_LIST* Cells;
+  // strokes [0, NumIndexedStrokes) are in the grid, and the segments of the
+  // next one that end before its simplified point NumIndexedPoints
+  unsigned int NumIndexedStrokes;
+  unsigned int NumIndexedPoints;
+  // StrokeList.Generation of the indexed strokes
+  unsigned int Generation;
+  unsigned int NumSegments;
+  // a segment is in every cell that its bounding box overlaps
+  unsigned int NumCellEntries;
+};
+
+typedef struct SEGMENT_GRID SEGMENT_GRID;
+
+// bounds are the device coordinates of the touchpad (HID_TOUCH_LINK_COL_INFO.PhysicalRect).
+// Returns -1 if bounds is empty or cellSize is not positive.
+int mInitializeSegmentGrid(SEGMENT_GRID* grid, const RECT* bounds, int cellSize);
+void mFreeSegmentGrid(SEGMENT_GRID* grid);
+void mFreeStrokeSegmentList(STROKE_SEGMENT_LIST* segments);
+// Add the segments of the strokes that are not in the grid yet.
+void mUpdateSegmentGrid(SEGMENT_GRID* grid, const StrokeList* strokes);
+// Replace the content of result with the segments of the strokes
+// [firstStroke, endStroke) that intersect rect (inclusive bounds in device
+// units), in the order of the list. The grid must be up to date with strokes.
+void mQuerySegmentGrid(const SEGMENT_GRID* grid, const StrokeList* strokes, unsigned int firstStroke, unsigned int endStroke, const RECT* rect, STROKE_SEGMENT_LIST* result);
+// Find the stroke of [firstStroke, endStroke) with the segment that is the
+// closest to point. Returns -1 if no segment is within maxDistance.
+int mFindNearestStroke(const SEGMENT_GRID* grid, const StrokeList* strokes, unsigned int firstStroke, unsigned int endStroke, Point2D point, float maxDistance, unsigned int* strokeIdx, float* distance);
+#endif  // __SEGMENTGRID_H__
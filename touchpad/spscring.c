@@ -0,0 +1,113 @@
+#include "platform.h"
+
+#include <stdio.h>
+
+#include "spscring.h"
+
+#include "utils.h"
+#include "threading.h"
+#include "termcolor.h"
+
+void mInitializeSpscRing(SPSC_RING* ring, unsigned int cbEntry, unsigned int capacity)
+{
+  if ((cbEntry == 0) || (capacity == 0) || (capacity > (1u << 31)))
+  {
+    printf(FG_RED);
+    printf("Invalid ring buffer size at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    exit(-1);
+  }
+
+  unsigned int roundedCapacity = 1;
+  while (roundedCapacity < capacity)
+  {
+    roundedCapacity <<= 1;
+  }
+
+  memset(ring, 0, sizeof(SPSC_RING));
+  ring->Entries  = (BYTE*)mMalloc((size_t)cbEntry * roundedCapacity, __FILE__, __LINE__);
+  ring->cbEntry  = cbEntry;
+  ring->Capacity = roundedCapacity;
+}
+
+void mFreeSpscRing(SPSC_RING* ring)
+{
+  free(ring->Entries);
+  memset(ring, 0, sizeof(SPSC_RING));
+}
+
+// copy count entries between the ring and a linear array, the range may wrap around the end of the ring
+static void mCopySpscRingEntries(SPSC_RING* ring, unsigned int position, BYTE* entries, unsigned int count, int isPush)
+{
+  unsigned int ringIdx   = position & (ring->Capacity - 1);
+  unsigned int firstPart = ring->Capacity - ringIdx;
+  if (firstPart > count)
+  {
+    firstPart = count;
+  }
+
+  BYTE* ringEntries = ring->Entries + ((size_t)ringIdx * ring->cbEntry);
+  size_t cbFirst    = (size_t)firstPart * ring->cbEntry;
+  size_t cbSecond   = (size_t)(count - firstPart) * ring->cbEntry;
+
+  if (isPush)
+  {
+    memcpy(ringEntries, entries, cbFirst);
+    memcpy(ring->Entries, entries + cbFirst, cbSecond);
+  }
+  else
+  {
+    memcpy(entries, ringEntries, cbFirst);
+    memcpy(entries + cbFirst, ring->Entries, cbSecond);
+  }
+}
+
+unsigned int mPushToSpscRing(SPSC_RING* ring, const void* entries, unsigned int numEntries)
+{
+  unsigned int tail     = ring->Tail;
+  unsigned int freeSize = ring->Capacity - (tail - ring->CachedHead);
+
+  if (freeSize < numEntries)
+  {
+    ring->CachedHead = mAtomicLoadAcquire(&ring->Head);
+    freeSize         = ring->Capacity - (tail - ring->CachedHead);
+  }
+
+  unsigned int count = (numEntries < freeSize) ? numEntries : freeSize;
+  if (count == 0)
+  {
+    return 0;
+  }
+
+  mCopySpscRingEntries(ring, tail, (BYTE*)entries, count, 1);
+
+  // publish the entries after they have been written
+  mAtomicStoreRelease(&ring->Tail, tail + count);
+
+  return count;
+}
+
+unsigned int mPopFromSpscRing(SPSC_RING* ring, void* entries, unsigned int maxEntries)
+{
+  unsigned int head = ring->Head;
+  unsigned int size = ring->CachedTail - head;
+
+  if (size < maxEntries)
+  {
+    ring->CachedTail = mAtomicLoadAcquire(&ring->Tail);
+    size             = ring->CachedTail - head;
+  }
+
+  unsigned int count = (maxEntries < size) ? maxEntries : size;
+  if (count == 0)
+  {
+    return 0;
+  }
+
+  mCopySpscRingEntries(ring, head, (BYTE*)entries, count, 0);
+
+  // give the slots back to the producer after they have been read
+  mAtomicStoreRelease(&ring->Head, head + count);
+
+  return count;
+}
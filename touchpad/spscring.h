@@ -0,0 +1,44 @@
+#ifndef __SPSCRING_H__
+#define __SPSCRING_H__
+#include "platform.h"
+
+// the indices of the producer and the consumer are kept on separate cache lines
+#define SPSC_RING_CACHE_LINE_SIZE 64
+
+// Lock free ring buffer of fixed-size entries for exactly one producer thread
+// and one consumer thread. Head and Tail count entries since the start and
+// wrap around naturally, Capacity must be a power of 2 so that they can be
+// masked into an index. Each thread keeps a cached copy of the other thread's
+// index so that it only reads the shared cache line when the cached copy says
+// that the ring is full (producer) or empty (consumer).
+struct SPSC_RING
+{
+  BYTE* Entries;
+  unsigned int cbEntry;
+  unsigned int Capacity;
+  BYTE Padding0[SPSC_RING_CACHE_LINE_SIZE];
+
+  // written by the consumer
+  volatile unsigned int Head;
+  // the consumer's copy of Tail
+  unsigned int CachedTail;
+  BYTE Padding1[SPSC_RING_CACHE_LINE_SIZE - (2 * sizeof(unsigned int))];
+
+  // written by the producer
+  volatile unsigned int Tail;
+  // the producer's copy of Head
+  unsigned int CachedHead;
+  BYTE Padding2[SPSC_RING_CACHE_LINE_SIZE - (2 * sizeof(unsigned int))];
+};
+
+typedef struct SPSC_RING SPSC_RING;
+
+// capacity is rounded up to a power of 2
+void mInitializeSpscRing(SPSC_RING* ring, unsigned int cbEntry, unsigned int capacity);
+void mFreeSpscRing(SPSC_RING* ring);
+// Producer: copy up to numEntries entries into the ring. Returns the number
+// of entries that fit, the remaining entries are not pushed.
+unsigned int mPushToSpscRing(SPSC_RING* ring, const void* entries, unsigned int numEntries);
+// Consumer: move up to maxEntries entries out of the ring. Returns the number of entries.
+unsigned int mPopFromSpscRing(SPSC_RING* ring, void* entries, unsigned int maxEntries);
+#endif  // __SPSCRING_H__
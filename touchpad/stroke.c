@@ -1,4 +1,4 @@
-#include <Windows.h>
+#include "platform.h"
 
 #include <stdio.h>
 
@@ -6,6 +6,9 @@
 #include "utils.h"
 #include "stroke.h"
 
+// The first allocation of the stroke index will hold at least this many strokes.
+#define STROKE_LIST_MIN_CAPACITY 32
+
 int mCreateNewStroke(Point2D point, StrokeList* strokes)
 {
   if (strokes == NULL)
@@ -17,33 +20,280 @@ int mCreateNewStroke(Point2D point, StrokeList* strokes)
     return -1;
   }
 
-  if ((strokes->Entries == NULL) || (strokes->Size == 0))
+  if ((strokes->Entries == NULL) || (strokes->Size == strokes->Capacity))
+  {
+    unsigned int newCapacity = strokes->Capacity * 2;
+    if (newCapacity < STROKE_LIST_MIN_CAPACITY)
+    {
+      newCapacity = STROKE_LIST_MIN_CAPACITY;
+    }
+
+    // realloc(NULL, size) behaves like malloc(size)
+    strokes->Entries  = (StrokeIndexEntry*)mRealloc(strokes->Entries, sizeof(StrokeIndexEntry) * newCapacity, __FILE__, __LINE__);
+    strokes->Capacity = newCapacity;
+  }
+
+  strokes->Entries[strokes->Size] = (StrokeIndexEntry){.Offset = strokes->Points.Size, .Size = 0, .SimplifiedOffset = strokes->SimplifiedPoints.Size, .SimplifiedSize = 0, .MinX = point.X, .MinY = point.Y, .MaxX = point.X, .MaxY = point.Y};
+  strokes->Size++;
+
+  return mAppendPoint2DToLastStroke(point, strokes);
+}
+
+// squared distance from point to the segment [from, to]
+static float mGetSquaredDistanceToSegment(Point2D point, Point2D from, Point2D to)
+{
+  float dx = (float)to.X - (float)from.X;
+  float dy = (float)to.Y - (float)from.Y;
+  float px = (float)point.X - (float)from.X;
+  float py = (float)point.Y - (float)from.Y;
+
+  float lengthSquared = (dx * dx) + (dy * dy);
+  float t             = (lengthSquared > 0.0f) ? (((px * dx) + (py * dy)) / lengthSquared) : 0.0f;
+  t                   = (t < 0.0f) ? 0.0f : ((t > 1.0f) ? 1.0f : t);
+
+  float ex = px - (t * dx);
+  float ey = py - (t * dy);
+
+  return (ex * ex) + (ey * ey);
+}
+
+// Update the simplified view of the last stroke after its newest raw point
+// has been appended to strokes->Points.
+static int mSimplifyLastStroke(StrokeList* strokes)
+{
+  StrokeIndexEntry* stroke = &strokes->Entries[strokes->Size - 1];
+  unsigned int newestIdx   = strokes->Points.Size - 1;
+  Point2D newest           = strokes->Points.Entries[newestIdx];
+
+  if (stroke->SimplifiedSize == 0)
   {
-    strokes->Size    = 1;
-    strokes->Entries = (Point2DList*)mMalloc(sizeof(Point2DList), __FILE__, __LINE__);
+    strokes->SimplifyAnchor = newestIdx;
+  }
+  else if ((strokes->SimplifyTolerance > 0.0f) && (stroke->SimplifiedSize >= 2) && ((newestIdx - strokes->SimplifyAnchor) <= STROKE_SIMPLIFY_MAX_WINDOW))
+  {
+    // the previous point is the provisional last point of the view, replace
+    // it with the newest point if the chord still fits the raw points
+    Point2D anchor         = strokes->Points.Entries[strokes->SimplifyAnchor];
+    float toleranceSquared = strokes->SimplifyTolerance * strokes->SimplifyTolerance;
+    int isWithinTolerance  = 1;
 
-    // TODO check for memory access violation
-    strokes->Entries[0].Entries = NULL;
-    strokes->Entries[0].Size    = 0;
-    return mAppendPoint2DToList(point, &(strokes->Entries[0]));
+    for (unsigned int pointIdx = strokes->SimplifyAnchor + 1; pointIdx < newestIdx; pointIdx++)
+    {
+      if (mGetSquaredDistanceToSegment(strokes->Points.Entries[pointIdx], anchor, newest) > toleranceSquared)
+      {
+        isWithinTolerance = 0;
+        break;
+      }
+    }
+
+    if (isWithinTolerance)
+    {
+      strokes->SimplifiedPoints.Entries[strokes->SimplifiedPoints.Size - 1] = newest;
+      return 0;
+    }
+
+    strokes->SimplifyAnchor = newestIdx - 1;
   }
   else
   {
-    unsigned int newStrokeArraySize = strokes->Size + 1;
-    Point2DList* newStrokeArray     = (Point2DList*)mMalloc(sizeof(Point2DList) * newStrokeArraySize, __FILE__, __LINE__);
+    // keep the previous point
+    strokes->SimplifyAnchor = newestIdx - 1;
+  }
+
+  int retval = mAppendPoint2DToList(newest, &strokes->SimplifiedPoints);
+  if (retval == 0)
+  {
+    stroke->SimplifiedSize++;
+  }
+
+  return retval;
+}
+
+int mAppendPoint2DToLastStroke(Point2D point, StrokeList* strokes)
+{
+  if (strokes == NULL)
+  {
+    printf(FG_RED);
+    printf("strokes argument is NULL!\n");
+    printf(RESET_COLOR);
+    exit(-1);
+    return -1;
+  }
+
+  if ((strokes->Entries == NULL) || (strokes->Size == 0))
+  {
+    printf(FG_RED);
+    printf("There is no stroke to append the point to! Call mCreateNewStroke first.\n");
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  int retval = mAppendPoint2DToList(point, &strokes->Points);
+  if (retval != 0)
+  {
+    return retval;
+  }
 
-    for (unsigned int strokeIdx = 0; strokeIdx < strokes->Size; strokeIdx++)
+  StrokeIndexEntry* stroke = &strokes->Entries[strokes->Size - 1];
+  stroke->Size++;
+  stroke->MinX = (point.X < stroke->MinX) ? point.X : stroke->MinX;
+  stroke->MinY = (point.Y < stroke->MinY) ? point.Y : stroke->MinY;
+  stroke->MaxX = (point.X > stroke->MaxX) ? point.X : stroke->MaxX;
+  stroke->MaxY = (point.Y > stroke->MaxY) ? point.Y : stroke->MaxY;
+
+  return mSimplifyLastStroke(strokes);
+}
+
+Point2D* mGetStrokePoints(StrokeList* strokes, unsigned int strokeIdx)
+{
+  return strokes->Points.Entries + strokes->Entries[strokeIdx].Offset;
+}
+
+Point2D* mGetSimplifiedStrokePoints(StrokeList* strokes, unsigned int strokeIdx)
+{
+  return strokes->SimplifiedPoints.Entries + strokes->Entries[strokeIdx].SimplifiedOffset;
+}
+
+unsigned int mGetFinalSimplifiedSize(const StrokeList* strokes)
+{
+  if (strokes->Size == 0)
+  {
+    return 0;
+  }
+
+  unsigned int simplifiedSize = strokes->Entries[strokes->Size - 1].SimplifiedSize;
+  if ((strokes->SimplifyTolerance <= 0.0f) || (simplifiedSize < 2))
+  {
+    return simplifiedSize;
+  }
+
+  return simplifiedSize - 1;
+}
+
+void mSetLastStrokeTimestamp(StrokeList* strokes, unsigned long long timestamp)
+{
+  if (strokes->Size == 0)
+  {
+    return;
+  }
+
+  StrokeIndexEntry* stroke = &strokes->Entries[strokes->Size - 1];
+  if (stroke->StartTimestamp == 0)
+  {
+    stroke->StartTimestamp = timestamp;
+  }
+
+  stroke->EndTimestamp = timestamp;
+}
+
+void mClearStrokeList(StrokeList* strokes)
+{
+  strokes->Points.Size           = 0;
+  strokes->SimplifiedPoints.Size = 0;
+  strokes->Size                  = 0;
+  strokes->Generation++;
+}
+
+void mTruncateStrokeList(StrokeList* strokes, unsigned int numStrokes)
+{
+  if (numStrokes >= strokes->Size)
+  {
+    return;
+  }
+
+  strokes->Points.Size           = strokes->Entries[numStrokes].Offset;
+  strokes->SimplifiedPoints.Size = strokes->Entries[numStrokes].SimplifiedOffset;
+  strokes->Size                  = numStrokes;
+  strokes->Generation++;
+}
+
+void mRemoveFirstStrokes(StrokeList* strokes, unsigned int numStrokes)
+{
+  if (numStrokes >= strokes->Size)
+  {
+    mClearStrokeList(strokes);
+    return;
+  }
+
+  if (numStrokes == 0)
+  {
+    return;
+  }
+
+  unsigned int numRemovedPoints           = strokes->Entries[numStrokes].Offset;
+  unsigned int numRemovedSimplifiedPoints = strokes->Entries[numStrokes].SimplifiedOffset;
+
+  memmove(strokes->Points.Entries, strokes->Points.Entries + numRemovedPoints, sizeof(Point2D) * (strokes->Points.Size - numRemovedPoints));
+  memmove(strokes->SimplifiedPoints.Entries, strokes->SimplifiedPoints.Entries + numRemovedSimplifiedPoints, sizeof(Point2D) * (strokes->SimplifiedPoints.Size - numRemovedSimplifiedPoints));
+  memmove(strokes->Entries, strokes->Entries + numStrokes, sizeof(StrokeIndexEntry) * (strokes->Size - numStrokes));
+
+  strokes->Points.Size -= numRemovedPoints;
+  strokes->SimplifiedPoints.Size -= numRemovedSimplifiedPoints;
+  strokes->Size -= numStrokes;
+
+  for (unsigned int strokeIdx = 0; strokeIdx < strokes->Size; strokeIdx++)
+  {
+    strokes->Entries[strokeIdx].Offset -= numRemovedPoints;
+    strokes->Entries[strokeIdx].SimplifiedOffset -= numRemovedSimplifiedPoints;
+  }
+
+  // the anchor is in the last stroke which is never removed here
+  strokes->SimplifyAnchor -= numRemovedPoints;
+  strokes->Generation++;
+}
+
+void mFreeStrokeList(StrokeList* strokes)
+{
+  mFreePoint2DList(&strokes->Points);
+  mFreePoint2DList(&strokes->SimplifiedPoints);
+
+  free(strokes->Entries);
+  strokes->Entries  = NULL;
+  strokes->Size     = 0;
+  strokes->Capacity = 0;
+}
+
+int mAddTouchEventToStrokes(TOUCH_DATA touch, unsigned int eventType, ULONG* trackingTouchID, StrokeList* strokes, unsigned int* strokeEvent)
+{
+  (*strokeEvent) = STROKE_EVENT_NONE;
+
+  Point2D touchPos = (Point2D){.X = touch.X, .Y = touch.Y};
+
+  if ((*trackingTouchID) == (ULONG)-1)
+  {
+    if (eventType == EVENT_TYPE_TOUCH_DOWN)
     {
-      newStrokeArray[strokeIdx] = strokes->Entries[strokeIdx];
+      (*trackingTouchID) = touch.TouchID;
+      (*strokeEvent)     = STROKE_EVENT_NEW_STROKE;
+      return mCreateNewStroke(touchPos, strokes);
     }
 
-    // memcpy(newStrokeArray, strokes->Entries, sizeof(Point2DList) * strokes->Size);
-    free(strokes->Entries);
+    // wait for touch down event to register new stroke
+  }
+  else if (touch.TouchID == (*trackingTouchID))
+  {
+    if (eventType == EVENT_TYPE_TOUCH_MOVE)
+    {
+      // we skip EVENT_TYPE_TOUCH_MOVE_UNCHANGED here
+      if ((strokes->Entries == NULL) || (strokes->Size == 0))
+      {
+        return -1;
+      }
+
+      int retval = mAppendPoint2DToLastStroke(touchPos, strokes);
+      if (retval != 0)
+      {
+        return retval;
+      }
 
-    strokes->Entries                    = newStrokeArray;
-    strokes->Size                       = newStrokeArraySize;
-    strokes->Entries[strokes->Size - 1] = (Point2DList){.Entries = NULL, .Size = 0};
-    return mAppendPoint2DToList(point, &(strokes->Entries[strokes->Size - 1]));
+      (*strokeEvent) = STROKE_EVENT_NEW_SEGMENT;
+    }
+    else if (eventType == EVENT_TYPE_TOUCH_UP)
+    {
+      // I sure that the touch position is the same with the last touch position
+      (*trackingTouchID) = (ULONG)-1;
+      (*strokeEvent)     = STROKE_EVENT_END_STROKE;
+    }
   }
 
   return 0;
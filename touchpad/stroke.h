@@ -1,14 +1,93 @@
 #ifndef __STROKE_H__
 #define __STROKE_H__
 #include "point2d.h"
+#include "touchevents.h"
 
+// results of mAddTouchEventToStrokes
+#define STROKE_EVENT_NONE        0
+#define STROKE_EVENT_NEW_STROKE  1
+// a point has been appended to the last stroke (draw its last segment)
+#define STROKE_EVENT_NEW_SEGMENT 2
+#define STROKE_EVENT_END_STROKE  3
+
+// Strokes longer than this many raw points since their last kept point keep
+// the point anyway, so that appending a point is O(1) on long straight lines.
+#define STROKE_SIMPLIFY_MAX_WINDOW 64
+
+// location of a stroke's points inside StrokeList.Points and StrokeList.SimplifiedPoints
+struct StrokeIndexEntry
+{
+  unsigned int Offset;
+  unsigned int Size;
+  unsigned int SimplifiedOffset;
+  unsigned int SimplifiedSize;
+  // mGetTimestamp of the first and the last touch event of the stroke, 0 if unknown
+  unsigned long long StartTimestamp;
+  unsigned long long EndTimestamp;
+  // bounding box of the points (inclusive)
+  ULONG MinX;
+  ULONG MinY;
+  ULONG MaxX;
+  ULONG MaxY;
+};
+
+typedef struct StrokeIndexEntry StrokeIndexEntry;
+
+// All strokes share a single point pool. Strokes are stored one after another
+// and only the last stroke can grow, so every stroke is a contiguous range of
+// the pool described by its (Offset, Size) entry.
+//
+// Every stroke also has a simplified view that is built while the points are
+// appended (a streaming Ramer-Douglas-Peucker). The last point of the view is
+// always the newest raw point. When a point arrives, the previous one is
+// dropped from the view if every raw point since the last kept point is within
+// SimplifyTolerance of the chord from the kept point to the new point,
+// otherwise it is kept. Slow writing produces long runs of nearly collinear
+// points that collapse into a single segment this way.
 struct StrokeList
 {
-  Point2DList* Entries;
+  Point2DList Points;
+  Point2DList SimplifiedPoints;
+  StrokeIndexEntry* Entries;
   unsigned int Size;
+  unsigned int Capacity;
+  // in device units, 0 keeps every point in the simplified view
+  float SimplifyTolerance;
+  // index in Points of the last kept point of the last stroke
+  unsigned int SimplifyAnchor;
+  // incremented whenever strokes are removed, the strokes of a generation are only appended to
+  unsigned int Generation;
 };
 
 typedef struct StrokeList StrokeList;
 
 int mCreateNewStroke(Point2D point, StrokeList* strokes);
+int mAppendPoint2DToLastStroke(Point2D point, StrokeList* strokes);
+// strokes->Entries[strokeIdx].Size points starting at the returned pointer
+// The pointer is invalidated by the next append.
+Point2D* mGetStrokePoints(StrokeList* strokes, unsigned int strokeIdx);
+// strokes->Entries[strokeIdx].SimplifiedSize points, invalidated by the next append
+Point2D* mGetSimplifiedStrokePoints(StrokeList* strokes, unsigned int strokeIdx);
+// Number of points at the start of the simplified view of the last stroke
+// that the next appends cannot change. The last point of the view is replaced
+// while the chord to it still fits the raw points, so it is final only when the
+// stroke ends.
+unsigned int mGetFinalSimplifiedSize(const StrokeList* strokes);
+// Extend the time span of the last stroke to the timestamp of a touch event
+// (the first call after mCreateNewStroke also sets its start).
+void mSetLastStrokeTimestamp(StrokeList* strokes, unsigned long long timestamp);
+// remove all strokes but keep the allocated memory for reuse
+void mClearStrokeList(StrokeList* strokes);
+// keep the first numStrokes strokes
+void mTruncateStrokeList(StrokeList* strokes, unsigned int numStrokes);
+// Remove the first numStrokes strokes and move the others to the front of
+// the point pools, the stroke indices go down by numStrokes.
+void mRemoveFirstStrokes(StrokeList* strokes, unsigned int numStrokes);
+void mFreeStrokeList(StrokeList* strokes);
+
+// Turn the touch events of the tracked contact into strokes. The first contact
+// that touches down is tracked until it is lifted, other contacts are ignored.
+// (*trackingTouchID) is (ULONG)-1 while no contact is tracked.
+// Returns -1 if the stroke list does not match the tracking state.
+int mAddTouchEventToStrokes(TOUCH_DATA touch, unsigned int eventType, ULONG* trackingTouchID, StrokeList* strokes, unsigned int* strokeEvent);
 #endif  // __STROKE_H__
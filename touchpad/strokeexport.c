@@ -0,0 +1,302 @@
+#include "platform.h"
+
+#include <stdio.h>
+
+#include "strokeexport.h"
+
+#include "utils.h"
+#include "threading.h"
+#include "termcolor.h"
+
+// bytes that the varints of a stroke and of a point take at most (a delta of
+// two 32-bit coordinates fits in 33 bits, that is 5 bytes)
+#define STROKE_EXPORT_MAX_STROKE_HEADER_SIZE (3 * STROKE_EXPORT_MAX_VARINT_SIZE)
+#define STROKE_EXPORT_MAX_POINT_SIZE         10
+// size of a single fwrite of mWriteStrokeExportBuffer
+#define STROKE_EXPORT_WRITE_CHUNK_SIZE       (4 << 20)
+
+static __inline BYTE* mEncodeVarint(BYTE* cursor, unsigned long long value)
+{
+  while (value >= 0x80)
+  {
+    (*cursor) = (BYTE)(value | 0x80);
+    cursor++;
+    value >>= 7;
+  }
+
+  (*cursor) = (BYTE)value;
+
+  return cursor + 1;
+}
+
+// Returns NULL if the varint is truncated or longer than STROKE_EXPORT_MAX_VARINT_SIZE bytes.
+static __inline const BYTE* mDecodeVarint(const BYTE* cursor, const BYTE* end, unsigned long long* value)
+{
+  unsigned long long result = 0;
+
+  for (unsigned int shift = 0; shift < (7 * STROKE_EXPORT_MAX_VARINT_SIZE); shift += 7)
+  {
+    if (cursor == end)
+    {
+      return NULL;
+    }
+
+    BYTE byte = (*cursor);
+    cursor++;
+    result |= (unsigned long long)(byte & 0x7f) << shift;
+
+    if (byte < 0x80)
+    {
+      (*value) = result;
+      return cursor;
+    }
+  }
+
+  return NULL;
+}
+
+// small negative and positive deltas both get small codes: 0, -1, 1, -2, 2, ...
+static __inline unsigned long long mZigzagEncode(unsigned long long value, unsigned long long previous)
+{
+  long long delta = (long long)(value - previous);
+  return ((unsigned long long)delta << 1) ^ (unsigned long long)(delta >> 63);
+}
+
+// previous + delta in two's complement
+static __inline unsigned long long mZigzagDecode(unsigned long long code, unsigned long long previous)
+{
+  return previous + ((code >> 1) ^ (0 - (code & 1)));
+}
+
+static unsigned long long mGetTimestampMicroseconds(unsigned long long ticks, unsigned long long frequency)
+{
+  // split so that the product does not overflow
+  return ((ticks / frequency) * 1000000) + (((ticks % frequency) * 1000000) / frequency);
+}
+
+int mEncodeStrokeExport(const StrokeIndexEntry* strokes, unsigned int numStrokes, const Point2D* points, const RECT* physicalRect, STROKE_EXPORT_BUFFER* buffer)
+{
+  STROKE_EXPORT_FILE_HEADER fileHeader;
+  memset(&fileHeader, 0, sizeof(STROKE_EXPORT_FILE_HEADER));
+  fileHeader.Magic        = STROKE_EXPORT_MAGIC;
+  fileHeader.Version      = STROKE_EXPORT_VERSION;
+  fileHeader.cbFileHeader = sizeof(STROKE_EXPORT_FILE_HEADER);
+  fileHeader.NumStrokes   = numStrokes;
+
+  if (physicalRect != NULL)
+  {
+    fileHeader.PhysicalRect = (*physicalRect);
+  }
+
+  unsigned long long numPoints = 0;
+  for (unsigned int strokeIdx = 0; strokeIdx < numStrokes; strokeIdx++)
+  {
+    numPoints += strokes[strokeIdx].Size;
+    fileHeader.MaxStrokePoints = (strokes[strokeIdx].Size > fileHeader.MaxStrokePoints) ? strokes[strokeIdx].Size : fileHeader.MaxStrokePoints;
+  }
+
+  if (numPoints > (unsigned int)-1)
+  {
+    printf(FG_RED);
+    printf("Too many points to export at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  fileHeader.NumPoints = (unsigned int)numPoints;
+
+  // reserve the worst case once so that the encoding loop never checks the size
+  size_t cbMaxData = sizeof(STROKE_EXPORT_FILE_HEADER) + ((size_t)numStrokes * STROKE_EXPORT_MAX_STROKE_HEADER_SIZE) + ((size_t)numPoints * STROKE_EXPORT_MAX_POINT_SIZE);
+  if (cbMaxData > buffer->Capacity)
+  {
+    buffer->Data     = (BYTE*)mRealloc(buffer->Data, cbMaxData, __FILE__, __LINE__);
+    buffer->Capacity = cbMaxData;
+  }
+
+  BYTE* cursor                      = buffer->Data + sizeof(STROKE_EXPORT_FILE_HEADER);
+  unsigned long long frequency      = mGetTimestampFrequency();
+  unsigned long long firstTimestamp = (numStrokes != 0) ? strokes[0].StartTimestamp : 0;
+  unsigned long long lastStart      = 0;
+  unsigned long long lastX          = 0;
+  unsigned long long lastY          = 0;
+
+  for (unsigned int strokeIdx = 0; strokeIdx < numStrokes; strokeIdx++)
+  {
+    StrokeIndexEntry stroke = strokes[strokeIdx];
+
+    // strokes without timestamps (or from before the first one) start with the previous one
+    unsigned long long start    = (stroke.StartTimestamp > firstTimestamp) ? mGetTimestampMicroseconds(stroke.StartTimestamp - firstTimestamp, frequency) : 0;
+    unsigned long long duration = (stroke.EndTimestamp > stroke.StartTimestamp) ? mGetTimestampMicroseconds(stroke.EndTimestamp - stroke.StartTimestamp, frequency) : 0;
+    start                       = (start > lastStart) ? start : lastStart;
+
+    cursor    = mEncodeVarint(cursor, stroke.Size);
+    cursor    = mEncodeVarint(cursor, start - lastStart);
+    cursor    = mEncodeVarint(cursor, duration);
+    lastStart = start;
+
+    const Point2D* strokePoints = points + stroke.Offset;
+    for (unsigned int pointIdx = 0; pointIdx < stroke.Size; pointIdx++)
+    {
+      cursor = mEncodeVarint(cursor, mZigzagEncode(strokePoints[pointIdx].X, lastX));
+      cursor = mEncodeVarint(cursor, mZigzagEncode(strokePoints[pointIdx].Y, lastY));
+      lastX  = strokePoints[pointIdx].X;
+      lastY  = strokePoints[pointIdx].Y;
+    }
+  }
+
+  fileHeader.cbStrokeData = (unsigned long long)(cursor - buffer->Data) - sizeof(STROKE_EXPORT_FILE_HEADER);
+  memcpy(buffer->Data, &fileHeader, sizeof(STROKE_EXPORT_FILE_HEADER));
+  buffer->cbData = (size_t)(cursor - buffer->Data);
+
+  return 0;
+}
+
+void mFreeStrokeExportBuffer(STROKE_EXPORT_BUFFER* buffer)
+{
+  free(buffer->Data);
+  memset(buffer, 0, sizeof(STROKE_EXPORT_BUFFER));
+}
+
+int mWriteStrokeExportBuffer(const char* filePath, const STROKE_EXPORT_BUFFER* buffer)
+{
+  FILE* file = fopen(filePath, "wb");
+  if (file == NULL)
+  {
+    printf(FG_RED);
+    printf("Failed to create the export file %s at %s:%d\n", filePath, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  // the buffer is already in memory, hand it to the OS in large writes without copying it
+  setvbuf(file, NULL, _IONBF, 0);
+
+  int retval = 0;
+  for (size_t offset = 0; (offset < buffer->cbData) && (retval == 0); offset += STROKE_EXPORT_WRITE_CHUNK_SIZE)
+  {
+    size_t cbChunk = ((buffer->cbData - offset) < STROKE_EXPORT_WRITE_CHUNK_SIZE) ? (buffer->cbData - offset) : STROKE_EXPORT_WRITE_CHUNK_SIZE;
+    retval         = (fwrite(buffer->Data + offset, 1, cbChunk, file) == cbChunk) ? 0 : -1;
+  }
+
+  retval = (fclose(file) == 0) ? retval : -1;
+
+  if (retval != 0)
+  {
+    printf(FG_RED);
+    printf("Failed to write the export file %s at %s:%d\n", filePath, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+  }
+
+  return retval;
+}
+
+int mWriteStrokeExport(const char* filePath, StrokeList* strokes, const RECT* physicalRect)
+{
+  STROKE_EXPORT_BUFFER buffer;
+  memset(&buffer, 0, sizeof(STROKE_EXPORT_BUFFER));
+
+  int retval = mEncodeStrokeExport(strokes->Entries, strokes->Size, strokes->Points.Entries, physicalRect, &buffer);
+  if (retval == 0)
+  {
+    retval = mWriteStrokeExportBuffer(filePath, &buffer);
+  }
+
+  mFreeStrokeExportBuffer(&buffer);
+
+  return retval;
+}
+
+int mOpenStrokeExportReader(const BYTE* data, size_t cbData, STROKE_EXPORT_READER* reader)
+{
+  memset(reader, 0, sizeof(STROKE_EXPORT_READER));
+
+  if ((data == NULL) || (cbData < sizeof(STROKE_EXPORT_FILE_HEADER)))
+  {
+    return -1;
+  }
+
+  const STROKE_EXPORT_FILE_HEADER* fileHeader = (const STROKE_EXPORT_FILE_HEADER*)data;
+
+  int isMagicValid       = (fileHeader->Magic == STROKE_EXPORT_MAGIC);
+  int isVersionSupported = (fileHeader->Version == STROKE_EXPORT_VERSION);
+  // a newer writer may only append fields
+  int isLayoutValid = (fileHeader->cbFileHeader >= sizeof(STROKE_EXPORT_FILE_HEADER)) && (fileHeader->cbFileHeader <= cbData) && (fileHeader->cbStrokeData <= (cbData - fileHeader->cbFileHeader));
+
+  if (!isMagicValid || !isVersionSupported || !isLayoutValid)
+  {
+    return -1;
+  }
+
+  reader->FileHeader = fileHeader;
+  reader->Next       = data + fileHeader->cbFileHeader;
+  reader->End        = reader->Next + fileHeader->cbStrokeData;
+
+  return 0;
+}
+
+int mReadExportedStroke(STROKE_EXPORT_READER* reader, EXPORTED_STROKE* stroke, Point2D* points)
+{
+  if (reader->NumStrokesRead == reader->FileHeader->NumStrokes)
+  {
+    return -1;
+  }
+
+  const BYTE* cursor = reader->Next;
+  const BYTE* end    = reader->End;
+  unsigned long long numPoints;
+  unsigned long long startDelta;
+  unsigned long long duration;
+
+  if (((cursor = mDecodeVarint(cursor, end, &numPoints)) == NULL) || ((cursor = mDecodeVarint(cursor, end, &startDelta)) == NULL) || ((cursor = mDecodeVarint(cursor, end, &duration)) == NULL))
+  {
+    return -1;
+  }
+
+  if (numPoints > reader->FileHeader->MaxStrokePoints)
+  {
+    return -1;
+  }
+
+  unsigned long long x = reader->LastX;
+  unsigned long long y = reader->LastY;
+
+  for (unsigned int pointIdx = 0; pointIdx < (unsigned int)numPoints; pointIdx++)
+  {
+    unsigned long long codeX;
+    unsigned long long codeY;
+
+    // most reports move less than 64 units on both axes: two single byte varints
+    if (((end - cursor) >= 2) && (((cursor[0] | cursor[1]) & 0x80) == 0))
+    {
+      codeX = cursor[0];
+      codeY = cursor[1];
+      cursor += 2;
+    }
+    else if (((cursor = mDecodeVarint(cursor, end, &codeX)) == NULL) || ((cursor = mDecodeVarint(cursor, end, &codeY)) == NULL))
+    {
+      return -1;
+    }
+
+    x = mZigzagDecode(codeX, x);
+    y = mZigzagDecode(codeY, y);
+
+    if (((x | y) >> 32) != 0)
+    {
+      return -1;
+    }
+
+    points[pointIdx] = (Point2D){.X = (ULONG)x, .Y = (ULONG)y};
+  }
+
+  reader->LastX = x;
+  reader->LastY = y;
+  reader->Next  = cursor;
+  reader->LastStartMicroseconds += startDelta;
+  reader->NumStrokesRead++;
+
+  stroke->NumPoints            = (unsigned int)numPoints;
+  stroke->StartMicroseconds    = reader->LastStartMicroseconds;
+  stroke->DurationMicroseconds = duration;
+
+  return 0;
+}
@@ -0,0 +1,90 @@
+#ifndef __STROKEEXPORT_H__
+#define __STROKEEXPORT_H__
+#include "platform.h"
+
+#include "point2d.h"
+#include "stroke.h"
+
+// A stroke export file is a STROKE_EXPORT_FILE_HEADER followed by
+// cbStrokeData bytes of strokes. Every stroke is a sequence of unsigned
+// LEB128 varints:
+//   number of points
+//   microseconds from the start of the previous stroke (of the first stroke for itself)
+//   duration in microseconds
+//   the points as zigzag encoded X and Y deltas
+// The deltas are taken from the previous point, across strokes (the first
+// point of the file from (0, 0)), so a touchpad report costs 2 to 4 bytes
+// instead of the 8 bytes of a Point2D. The header is little endian.
+#define STROKE_EXPORT_MAGIC   0x4b525453  // "STRK"
+#define STROKE_EXPORT_VERSION 1
+// the most bytes that a varint of a 64-bit value takes
+#define STROKE_EXPORT_MAX_VARINT_SIZE 10
+
+struct STROKE_EXPORT_FILE_HEADER
+{
+  unsigned int Magic;
+  unsigned int Version;
+  unsigned int cbFileHeader;
+  unsigned int NumStrokes;
+  unsigned int NumPoints;
+  // the reader's point buffer must hold this many points
+  unsigned int MaxStrokePoints;
+  unsigned long long cbStrokeData;
+  // the geometry of the touchpad (HID_TOUCH_LINK_COL_INFO.PhysicalRect)
+  RECT PhysicalRect;
+};
+
+typedef struct STROKE_EXPORT_FILE_HEADER STROKE_EXPORT_FILE_HEADER;
+
+// a whole encoded file, the memory is reused between exports
+struct STROKE_EXPORT_BUFFER
+{
+  BYTE* Data;
+  size_t cbData;
+  size_t Capacity;
+};
+
+typedef struct STROKE_EXPORT_BUFFER STROKE_EXPORT_BUFFER;
+
+struct EXPORTED_STROKE
+{
+  unsigned int NumPoints;
+  // from the start of the first stroke
+  unsigned long long StartMicroseconds;
+  unsigned long long DurationMicroseconds;
+};
+
+typedef struct EXPORTED_STROKE EXPORTED_STROKE;
+
+// Decodes the strokes of an export file in memory one after another.
+struct STROKE_EXPORT_READER
+{
+  const STROKE_EXPORT_FILE_HEADER* FileHeader;
+  const BYTE* Next;
+  const BYTE* End;
+  unsigned int NumStrokesRead;
+  // the deltas of the next stroke are relative to them
+  unsigned long long LastX;
+  unsigned long long LastY;
+  unsigned long long LastStartMicroseconds;
+};
+
+typedef struct STROKE_EXPORT_READER STROKE_EXPORT_READER;
+
+// Encode the strokes (Entries[strokeIdx] ranges of points with mGetTimestamp
+// timestamps) into the buffer, replacing its content. physicalRect can be NULL
+// when the geometry is not known.
+int mEncodeStrokeExport(const StrokeIndexEntry* strokes, unsigned int numStrokes, const Point2D* points, const RECT* physicalRect, STROKE_EXPORT_BUFFER* buffer);
+void mFreeStrokeExportBuffer(STROKE_EXPORT_BUFFER* buffer);
+// write the encoded file
+int mWriteStrokeExportBuffer(const char* filePath, const STROKE_EXPORT_BUFFER* buffer);
+// encode every stroke of the list and write the file
+int mWriteStrokeExport(const char* filePath, StrokeList* strokes, const RECT* physicalRect);
+
+// Returns -1 if the data does not start with a valid header of a supported version.
+int mOpenStrokeExportReader(const BYTE* data, size_t cbData, STROKE_EXPORT_READER* reader);
+// Decode the next stroke into points (FileHeader->MaxStrokePoints of them).
+// Returns -1 after the last stroke or if the data is corrupt, NumStrokesRead
+// tells the two apart.
+int mReadExportedStroke(STROKE_EXPORT_READER* reader, EXPORTED_STROKE* stroke, Point2D* points);
+#endif  // __STROKEEXPORT_H__
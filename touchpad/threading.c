@@ -0,0 +1,236 @@
+#include "platform.h"
+
+#include <stdio.h>
+#include <time.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#include "threading.h"
+
+#include "utils.h"
+#include "termcolor.h"
+
+struct THREAD_START_INFO
+{
+  THREAD_PROC Proc;
+  void* Arg;
+};
+
+typedef struct THREAD_START_INFO THREAD_START_INFO;
+
+// the entry points of Windows and POSIX threads have different signatures
+#ifdef _WIN32
+static DWORD WINAPI mThreadEntryPoint(LPVOID param)
+#else
+static void* mThreadEntryPoint(void* param)
+#endif
+{
+  THREAD_START_INFO startInfo = *((THREAD_START_INFO*)param);
+  free(param);
+
+  startInfo.Proc(startInfo.Arg);
+
+  return 0;
+}
+
+int mCreateThread(THREAD_HANDLE* thread, THREAD_PROC proc, void* arg)
+{
+  THREAD_START_INFO* startInfo = (THREAD_START_INFO*)mMalloc(sizeof(THREAD_START_INFO), __FILE__, __LINE__);
+  startInfo->Proc              = proc;
+  startInfo->Arg               = arg;
+
+#ifdef _WIN32
+  thread->Handle = CreateThread(NULL, 0, mThreadEntryPoint, startInfo, 0, NULL);
+  int failed     = (thread->Handle == NULL);
+#else
+  int failed = (pthread_create(&thread->Handle, NULL, mThreadEntryPoint, startInfo) != 0);
+#endif
+
+  if (failed)
+  {
+    free(startInfo);
+    printf(FG_RED);
+    printf("Failed to create a thread at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  return 0;
+}
+
+void mJoinThread(THREAD_HANDLE* thread)
+{
+#ifdef _WIN32
+  WaitForSingleObject(thread->Handle, INFINITE);
+  CloseHandle(thread->Handle);
+  thread->Handle = NULL;
+#else
+  pthread_join(thread->Handle, NULL);
+#endif
+}
+
+void mInitializeThreadMutex(THREAD_MUTEX* mutex)
+{
+#ifdef _WIN32
+  InitializeSRWLock(&mutex->Lock);
+#else
+  pthread_mutex_init(&mutex->Lock, NULL);
+#endif
+}
+
+void mLockThreadMutex(THREAD_MUTEX* mutex)
+{
+#ifdef _WIN32
+  AcquireSRWLockExclusive(&mutex->Lock);
+#else
+  pthread_mutex_lock(&mutex->Lock);
+#endif
+}
+
+void mUnlockThreadMutex(THREAD_MUTEX* mutex)
+{
+#ifdef _WIN32
+  ReleaseSRWLockExclusive(&mutex->Lock);
+#else
+  pthread_mutex_unlock(&mutex->Lock);
+#endif
+}
+
+void mDestroyThreadMutex(THREAD_MUTEX* mutex)
+{
+#ifndef _WIN32
+  // SRW locks do not need to be destroyed
+  pthread_mutex_destroy(&mutex->Lock);
+#endif
+}
+
+void mInitializeThreadCondition(THREAD_CONDITION* condition)
+{
+#ifdef _WIN32
+  InitializeConditionVariable(&condition->Condition);
+#else
+  pthread_cond_init(&condition->Condition, NULL);
+#endif
+}
+
+int mWaitThreadCondition(THREAD_CONDITION* condition, THREAD_MUTEX* mutex, unsigned int timeoutMilliseconds)
+{
+#ifdef _WIN32
+  DWORD timeout = (timeoutMilliseconds == THREAD_WAIT_INFINITE) ? INFINITE : timeoutMilliseconds;
+  if (!SleepConditionVariableSRW(&condition->Condition, &mutex->Lock, timeout, 0))
+  {
+    return -1;
+  }
+#else
+  if (timeoutMilliseconds == THREAD_WAIT_INFINITE)
+  {
+    pthread_cond_wait(&condition->Condition, &mutex->Lock);
+  }
+  else
+  {
+    // pthread_cond_timedwait takes an absolute CLOCK_REALTIME deadline
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+
+    deadline.tv_sec += timeoutMilliseconds / 1000;
+    deadline.tv_nsec += (long)(timeoutMilliseconds % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+      deadline.tv_sec += 1;
+      deadline.tv_nsec -= 1000000000L;
+    }
+
+    if (pthread_cond_timedwait(&condition->Condition, &mutex->Lock, &deadline) == ETIMEDOUT)
+    {
+      return -1;
+    }
+  }
+#endif
+
+  return 0;
+}
+
+void mSignalThreadCondition(THREAD_CONDITION* condition)
+{
+#ifdef _WIN32
+  WakeConditionVariable(&condition->Condition);
+#else
+  pthread_cond_signal(&condition->Condition);
+#endif
+}
+
+void mBroadcastThreadCondition(THREAD_CONDITION* condition)
+{
+#ifdef _WIN32
+  WakeAllConditionVariable(&condition->Condition);
+#else
+  pthread_cond_broadcast(&condition->Condition);
+#endif
+}
+
+void mDestroyThreadCondition(THREAD_CONDITION* condition)
+{
+#ifndef _WIN32
+  pthread_cond_destroy(&condition->Condition);
+#endif
+}
+
+unsigned long long mGetTimestamp()
+{
+#ifdef _WIN32
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  return (unsigned long long)counter.QuadPart;
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((unsigned long long)now.tv_sec * 1000000000ULL) + (unsigned long long)now.tv_nsec;
+#endif
+}
+
+unsigned long long mGetTimestampFrequency()
+{
+#ifdef _WIN32
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  return (unsigned long long)frequency.QuadPart;
+#else
+  return 1000000000ULL;
+#endif
+}
+
+void mSleepMilliseconds(unsigned int milliseconds)
+{
+#ifdef _WIN32
+  Sleep(milliseconds);
+#else
+  struct timespec duration;
+  duration.tv_sec  = milliseconds / 1000;
+  duration.tv_nsec = (long)(milliseconds % 1000) * 1000000L;
+  nanosleep(&duration, NULL);
+#endif
+}
+
+void mYieldThread()
+{
+#ifdef _WIN32
+  SwitchToThread();
+#else
+  sched_yield();
+#endif
+}
+
+unsigned int mGetNumProcessors()
+{
+#ifdef _WIN32
+  SYSTEM_INFO systemInfo;
+  GetSystemInfo(&systemInfo);
+  return (unsigned int)systemInfo.dwNumberOfProcessors;
+#else
+  long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+  return (numProcessors > 0) ? (unsigned int)numProcessors : 1;
+#endif
+}
@@ -0,0 +1,149 @@
+#ifndef __THREADING_H__
+#define __THREADING_H__
+#include "platform.h"
+
+// Thin wrappers around the threads, locks and clocks of Windows and POSIX so
+// that the background workers can be built and profiled on both.
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+typedef void (*THREAD_PROC)(void* arg);
+
+struct THREAD_HANDLE
+{
+#ifdef _WIN32
+  HANDLE Handle;
+#else
+  pthread_t Handle;
+#endif
+};
+
+typedef struct THREAD_HANDLE THREAD_HANDLE;
+
+struct THREAD_MUTEX
+{
+#ifdef _WIN32
+  SRWLOCK Lock;
+#else
+  pthread_mutex_t Lock;
+#endif
+};
+
+typedef struct THREAD_MUTEX THREAD_MUTEX;
+
+struct THREAD_CONDITION
+{
+#ifdef _WIN32
+  CONDITION_VARIABLE Condition;
+#else
+  pthread_cond_t Condition;
+#endif
+};
+
+typedef struct THREAD_CONDITION THREAD_CONDITION;
+
+// Atomic 32-bit loads and stores for flags and indices that are shared
+// between threads without a lock. The project only targets x86 and x64 on
+// Windows whose loads and stores are already ordered (TSO) so only the
+// compiler has to be kept from reordering them there.
+#ifdef _WIN32
+static __inline unsigned int mAtomicLoadAcquire(volatile unsigned int* value)
+{
+  unsigned int retval = *value;
+  _ReadWriteBarrier();
+  return retval;
+}
+
+static __inline void mAtomicStoreRelease(volatile unsigned int* value, unsigned int newValue)
+{
+  _ReadWriteBarrier();
+  *value = newValue;
+}
+
+static __inline unsigned int mAtomicExchange(volatile unsigned int* value, unsigned int newValue)
+{
+  return (unsigned int)InterlockedExchange((volatile LONG*)value, (LONG)newValue);
+}
+
+static __inline unsigned int mAtomicCompareExchange(volatile unsigned int* value, unsigned int expected, unsigned int newValue)
+{
+  return (unsigned int)InterlockedCompareExchange((volatile LONG*)value, (LONG)newValue, (LONG)expected);
+}
+
+static __inline unsigned int mAtomicAdd(volatile unsigned int* value, unsigned int delta)
+{
+  return (unsigned int)InterlockedExchangeAdd((volatile LONG*)value, (LONG)delta) + delta;
+}
+
+static __inline void mAtomicFullBarrier()
+{
+  MemoryBarrier();
+}
+#else
+static __inline unsigned int mAtomicLoadAcquire(volatile unsigned int* value)
+{
+  return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static __inline void mAtomicStoreRelease(volatile unsigned int* value, unsigned int newValue)
+{
+  __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+}
+
+static __inline unsigned int mAtomicExchange(volatile unsigned int* value, unsigned int newValue)
+{
+  return __atomic_exchange_n(value, newValue, __ATOMIC_SEQ_CST);
+}
+
+static __inline unsigned int mAtomicCompareExchange(volatile unsigned int* value, unsigned int expected, unsigned int newValue)
+{
+  __atomic_compare_exchange_n(value, &expected, newValue, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  return expected;
+}
+
+static __inline unsigned int mAtomicAdd(volatile unsigned int* value, unsigned int delta)
+{
+  return __atomic_add_fetch(value, delta, __ATOMIC_SEQ_CST);
+}
+
+static __inline void mAtomicFullBarrier()
+{
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+#endif
+
+// mAtomicCompareExchange returns the value before the exchange, newValue was
+// stored if that is expected. mAtomicAdd returns the new value (add
+// (unsigned int)-1 to subtract 1). Both and mAtomicFullBarrier are sequentially
+// consistent on every platform.
+
+// wait forever in mWaitThreadCondition
+#define THREAD_WAIT_INFINITE ((unsigned int)-1)
+
+int mCreateThread(THREAD_HANDLE* thread, THREAD_PROC proc, void* arg);
+void mJoinThread(THREAD_HANDLE* thread);
+
+void mInitializeThreadMutex(THREAD_MUTEX* mutex);
+void mLockThreadMutex(THREAD_MUTEX* mutex);
+void mUnlockThreadMutex(THREAD_MUTEX* mutex);
+void mDestroyThreadMutex(THREAD_MUTEX* mutex);
+
+void mInitializeThreadCondition(THREAD_CONDITION* condition);
+// The mutex must be locked. Returns -1 if the timeout elapsed, spurious wake
+// ups are possible so the caller has to check its predicate again.
+int mWaitThreadCondition(THREAD_CONDITION* condition, THREAD_MUTEX* mutex, unsigned int timeoutMilliseconds);
+void mSignalThreadCondition(THREAD_CONDITION* condition);
+void mBroadcastThreadCondition(THREAD_CONDITION* condition);
+void mDestroyThreadCondition(THREAD_CONDITION* condition);
+
+// high resolution monotonic clock (QueryPerformanceCounter or CLOCK_MONOTONIC)
+unsigned long long mGetTimestamp();
+// number of timestamp ticks per second
+unsigned long long mGetTimestampFrequency();
+void mSleepMilliseconds(unsigned int milliseconds);
+// give the rest of the time slice to another thread (e.g. while spinning on a lock free queue)
+void mYieldThread();
+// number of logical processors that the process can run on
+unsigned int mGetNumProcessors();
+#endif  // __THREADING_H__
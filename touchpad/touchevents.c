@@ -1,10 +1,79 @@
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "touchevents.h"
 #include "termcolor.h"
-#include "utils.h"
 
-int mInterpretRawTouchInput(TOUCH_DATA_LIST* prevTouchesList, TOUCH_DATA curTouch, unsigned int* eventType)
+static unsigned int mGetContactHomeSlot(ULONG touchId)
+{
+  // contact IDs are small and usually consecutive so they spread well without hashing
+  return ((unsigned int)touchId) & (TOUCH_CONTACT_TABLE_SIZE - 1);
+}
+
+static void mRemoveContactAtSlot(TOUCH_CONTACT_TABLE* contactTable, unsigned int slotIdx)
+{
+  // backward shift deletion keeps the probe sequences intact without tombstones
+  unsigned int emptySlotIdx = slotIdx;
+  unsigned int nextSlotIdx  = slotIdx;
+
+  while (1)
+  {
+    nextSlotIdx = (nextSlotIdx + 1) & (TOUCH_CONTACT_TABLE_SIZE - 1);
+    if (!contactTable->IsOccupied[nextSlotIdx])
+    {
+      break;
+    }
+
+    unsigned int homeSlotIdx = mGetContactHomeSlot(contactTable->Entries[nextSlotIdx].TouchID);
+
+    // distance from the home slot of the entry to the empty slot and to its current slot
+    unsigned int distToEmptySlot = (emptySlotIdx - homeSlotIdx) & (TOUCH_CONTACT_TABLE_SIZE - 1);
+    unsigned int distToNextSlot  = (nextSlotIdx - homeSlotIdx) & (TOUCH_CONTACT_TABLE_SIZE - 1);
+
+    if (distToEmptySlot < distToNextSlot)
+    {
+      contactTable->Entries[emptySlotIdx] = contactTable->Entries[nextSlotIdx];
+      emptySlotIdx                        = nextSlotIdx;
+    }
+  }
+
+  contactTable->IsOccupied[emptySlotIdx] = 0;
+  contactTable->Size--;
+}
+
+void mResetTouchContactTable(TOUCH_CONTACT_TABLE* contactTable)
+{
+  for (unsigned int slotIdx = 0; slotIdx < TOUCH_CONTACT_TABLE_SIZE; slotIdx++)
+  {
+    contactTable->IsOccupied[slotIdx] = 0;
+  }
+
+  contactTable->Size               = 0;
+  contactTable->NumEvictedContacts = 0;
+}
+
+// the contact whose last report is the oldest, i.e. the one that the device stopped reporting
+static void mEvictOldestContact(TOUCH_CONTACT_TABLE* contactTable, ULONG curSequenceNumber)
+{
+  unsigned int oldestSlotIdx = 0;
+  ULONG oldestAge            = 0;
+
+  for (unsigned int slotIdx = 0; slotIdx < TOUCH_CONTACT_TABLE_SIZE; slotIdx++)
+  {
+    // unsigned so that a sequence number that wrapped around still counts as newer
+    ULONG age = curSequenceNumber - contactTable->Entries[slotIdx].SequenceNumber;
+    if (contactTable->IsOccupied[slotIdx] && (age >= oldestAge))
+    {
+      oldestSlotIdx = slotIdx;
+      oldestAge     = age;
+    }
+  }
+
+  mRemoveContactAtSlot(contactTable, oldestSlotIdx);
+  contactTable->NumEvictedContacts++;
+}
+
+int mInterpretRawTouchInput(TOUCH_CONTACT_TABLE* contactTable, TOUCH_DATA curTouch, unsigned int* eventType)
 {
   // check arguments
   if (eventType == NULL)
@@ -16,91 +85,87 @@ int mInterpretRawTouchInput(TOUCH_DATA_LIST* prevTouchesList, TOUCH_DATA curTouc
     return -1;
   }
 
-  if (prevTouchesList == NULL)
+  if (contactTable == NULL)
   {
     printf(FG_RED);
-    printf("You must pass a valid pointer for prevTouchesList. It's NULL right now!\n");
+    printf("You must pass a valid pointer for contactTable. It's NULL right now!\n");
     printf(RESET_COLOR);
     exit(-1);
     return -1;
   }
 
-  if ((prevTouchesList->Entries == NULL) || (prevTouchesList->Size == 0))
-  {
-    prevTouchesList->Entries = (TOUCH_DATA*)mMalloc(sizeof(TOUCH_DATA), __FILE__, __LINE__);
-    prevTouchesList->Size    = 1;
-
-    prevTouchesList->Entries[0] = curTouch;
-
-    if (curTouch.OnSurface)
-    {
-      (*eventType) = EVENT_TYPE_TOUCH_DOWN;
-    }
-    else
-    {
-      (*eventType) = EVENT_TYPE_TOUCH_UP;
-    }
+  unsigned int slotIdx = mGetContactHomeSlot(curTouch.TouchID);
 
-    return 0;
-  }
-  else
+  while (contactTable->IsOccupied[slotIdx])
   {
-    for (unsigned int touchIdx = 0; touchIdx < prevTouchesList->Size; touchIdx++)
+    TOUCH_DATA prevTouch = contactTable->Entries[slotIdx];
+    if (prevTouch.TouchID == curTouch.TouchID)
     {
-      TOUCH_DATA prevTouch = prevTouchesList->Entries[touchIdx];
-      if (prevTouch.TouchID == curTouch.TouchID)
+      if (prevTouch.OnSurface && curTouch.OnSurface)
       {
-        if (prevTouch.OnSurface && curTouch.OnSurface)
+        if ((prevTouch.X == curTouch.X) && (prevTouch.Y == curTouch.Y))
         {
-          if ((prevTouch.X == curTouch.X) && (prevTouch.Y == curTouch.Y))
-          {
-            (*eventType) = EVENT_TYPE_TOUCH_MOVE_UNCHANGED;
-          }
-          else
-          {
-            (*eventType) = EVENT_TYPE_TOUCH_MOVE;
-          }
-        }
-        else if ((prevTouch.OnSurface != 0) && (curTouch.OnSurface == 0))
-        {
-          (*eventType) = EVENT_TYPE_TOUCH_UP;
-        }
-        else if ((prevTouch.OnSurface == 0) && (curTouch.OnSurface != 0))
-        {
-          (*eventType) = EVENT_TYPE_TOUCH_DOWN;
+          (*eventType) = EVENT_TYPE_TOUCH_MOVE_UNCHANGED;
         }
         else
         {
-          // (prevTouch.OnSurface == 0) && (curTouch.OnSurface == 0)
-          // this might never be the case unless the touchpad or its driver is broken
-          (*eventType) = EVENT_TYPE_TOUCH_UP;
+          (*eventType) = EVENT_TYPE_TOUCH_MOVE;
         }
+      }
+      else if ((prevTouch.OnSurface != 0) && (curTouch.OnSurface == 0))
+      {
+        (*eventType) = EVENT_TYPE_TOUCH_UP;
+      }
+      else if ((prevTouch.OnSurface == 0) && (curTouch.OnSurface != 0))
+      {
+        (*eventType) = EVENT_TYPE_TOUCH_DOWN;
+      }
+      else
+      {
+        // (prevTouch.OnSurface == 0) && (curTouch.OnSurface == 0)
+        // this might never be the case unless the touchpad or its driver is broken
+        (*eventType) = EVENT_TYPE_TOUCH_UP;
+      }
 
+      if (curTouch.OnSurface)
+      {
         // update touch data
-        prevTouchesList->Entries[touchIdx] = curTouch;
-
-        return 0;
+        contactTable->Entries[slotIdx] = curTouch;
       }
+      else
+      {
+        // the contact ID may be reused by the next finger
+        mRemoveContactAtSlot(contactTable, slotIdx);
+      }
+
+      return 0;
     }
+
+    slotIdx = (slotIdx + 1) & (TOUCH_CONTACT_TABLE_SIZE - 1);
   }
 
-  // this touch id has not been recorded before
+  // this touch id is not on the touchpad surface right now
 
-  // If you touchpad only supports maximum of 5 touches, then there will be only 5 unique touch IDs.
-  unsigned int newTouchesListSize = prevTouchesList->Size + 1;
-  TOUCH_DATA* tmpTouchesList      = (TOUCH_DATA*)mMalloc(sizeof(TOUCH_DATA) * newTouchesListSize, __FILE__, __LINE__);
+  if (curTouch.OnSurface)
+  {
+    // always keep one empty slot so that the probing loop above terminates
+    if (contactTable->Size >= (TOUCH_CONTACT_TABLE_SIZE - 1))
+    {
+      mEvictOldestContact(contactTable, curTouch.SequenceNumber);
 
-  memcpy(tmpTouchesList, prevTouchesList->Entries, sizeof(TOUCH_DATA) * prevTouchesList->Size);
+      // the backward shift may have moved the entries, probe again
+      slotIdx = mGetContactHomeSlot(curTouch.TouchID);
+      while (contactTable->IsOccupied[slotIdx])
+      {
+        slotIdx = (slotIdx + 1) & (TOUCH_CONTACT_TABLE_SIZE - 1);
+      }
+    }
 
-  tmpTouchesList[newTouchesListSize - 1] = curTouch;
-  free(prevTouchesList->Entries);
-  prevTouchesList->Entries = tmpTouchesList;
-  tmpTouchesList           = NULL;
-  prevTouchesList->Size    = newTouchesListSize;
+    contactTable->Entries[slotIdx]    = curTouch;
+    contactTable->IsOccupied[slotIdx] = 1;
+    contactTable->Size++;
 
-  if (curTouch.OnSurface)
-  {
-    (*eventType) = EVENT_TYPE_TOUCH_MOVE;
+    (*eventType) = EVENT_TYPE_TOUCH_DOWN;
   }
   else
   {
@@ -112,3 +177,26 @@ int mInterpretRawTouchInput(TOUCH_DATA_LIST* prevTouchesList, TOUCH_DATA curTouc
 
   return 0;
 }
+
+int mInterpretRawTouchInputBatch(TOUCH_CONTACT_TABLE* contactTable, const TOUCH_DATA* curTouches, unsigned int numTouches, unsigned int* eventTypes)
+{
+  if ((curTouches == NULL) || (eventTypes == NULL))
+  {
+    printf(FG_RED);
+    printf("curTouches and eventTypes must not be NULL at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    exit(-1);
+    return -1;
+  }
+
+  for (unsigned int touchIdx = 0; touchIdx < numTouches; touchIdx++)
+  {
+    int retval = mInterpretRawTouchInput(contactTable, curTouches[touchIdx], &eventTypes[touchIdx]);
+    if (retval != 0)
+    {
+      return retval;
+    }
+  }
+
+  return 0;
+}
@@ -1,30 +1,62 @@
 #ifndef __TOUCHEVENTS_H__
 #define __TOUCHEVENTS_H__
-#include <Windows.h>
+#include "platform.h"
 
 static const unsigned int EVENT_TYPE_TOUCH_DOWN           = 0;
 static const unsigned int EVENT_TYPE_TOUCH_MOVE           = 1;
 static const unsigned int EVENT_TYPE_TOUCH_UP             = 2;
 static const unsigned int EVENT_TYPE_TOUCH_MOVE_UNCHANGED = 3;
 
+// Number of slots in TOUCH_CONTACT_TABLE. It must be a power of 2.
+// Windows Precision Touchpads report at most 5 simultaneous contacts (the
+// actual limit of a device is its HID_USAGE_DIGITIZER_CONTACT_COUNT_MAXIMUM
+// feature value). The extra slots keep the probe sequences short and leave
+// room for digitizers that report up to 10 contacts.
+#define TOUCH_CONTACT_TABLE_SIZE 16
+
 struct TOUCH_DATA
 {
   ULONG TouchID;
   ULONG X;
   ULONG Y;
   int OnSurface;
+  // sequence number of the input report that the contact was decoded from
+  ULONG SequenceNumber;
 };
 
 typedef struct TOUCH_DATA TOUCH_DATA;
 
-struct TOUCH_DATA_LIST
+// a contact and its EVENT_TYPE_* as it is passed from the input thread to the UI thread
+struct TOUCH_EVENT
+{
+  TOUCH_DATA Touch;
+  unsigned int EventType;
+  // mGetTimestamp when the input thread received the report
+  unsigned long long Timestamp;
+};
+
+typedef struct TOUCH_EVENT TOUCH_EVENT;
+
+// Contacts that are currently on the touchpad surface, keyed by TouchID
+// (open addressing with linear probing). A contact is removed as soon as it
+// is lifted so the table never holds more than the device's maximum number
+// of contacts and it never allocates memory. A device that drops a lift
+// report leaves a stale contact behind; when the table is full the contact
+// with the oldest report is evicted to make room for a new one.
+struct TOUCH_CONTACT_TABLE
 {
-  TOUCH_DATA* Entries;
+  TOUCH_DATA Entries[TOUCH_CONTACT_TABLE_SIZE];
+  int IsOccupied[TOUCH_CONTACT_TABLE_SIZE];
   unsigned int Size;
+  // contacts evicted since the last reset
+  unsigned int NumEvictedContacts;
 };
 
-typedef struct TOUCH_DATA_LIST TOUCH_DATA_LIST;
+typedef struct TOUCH_CONTACT_TABLE TOUCH_CONTACT_TABLE;
 
-int mInterpretRawTouchInput(TOUCH_DATA_LIST* prevTouchesList, TOUCH_DATA curTouch, unsigned int* eventType);
+void mResetTouchContactTable(TOUCH_CONTACT_TABLE* contactTable);
+int mInterpretRawTouchInput(TOUCH_CONTACT_TABLE* contactTable, TOUCH_DATA curTouch, unsigned int* eventType);
+// interpret all contacts of a single report, eventTypes must hold numTouches entries
+int mInterpretRawTouchInputBatch(TOUCH_CONTACT_TABLE* contactTable, const TOUCH_DATA* curTouches, unsigned int numTouches, unsigned int* eventTypes);
 
 #endif  // __TOUCHEVENTS_H__
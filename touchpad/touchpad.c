@@ -293,3 +293,212 @@ int mGetRawInputData(_In_ HRAWINPUT hRawInput, _Out_ PUINT pcbSize, _Out_ LPVOID
 
   return retval;
 }
+
+static int mFindChangedBitOffset(_In_ BYTE* baselineReport, _In_ BYTE* probeReport, _In_ ULONG cbReport, _Out_ unsigned int* bitOffset)
+{
+  for (ULONG byteIdx = 0; byteIdx < cbReport; byteIdx++)
+  {
+    BYTE changedBits = baselineReport[byteIdx] ^ probeReport[byteIdx];
+    if (changedBits != 0)
+    {
+      unsigned int bitIdx = 0;
+      while ((changedBits & (1 << bitIdx)) == 0)
+      {
+        bitIdx++;
+      }
+
+      (*bitOffset) = (byteIdx * 8) + bitIdx;
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+// HidP does not tell us where a value is located in the report so we find it by
+// writing the value as all zeros and all ones into two reports and comparing them.
+static int mCompileHidValueField(_In_ PHIDP_PREPARSED_DATA preparsedData, _In_ USAGE usagePage, _In_ USHORT linkCollection, _In_ USAGE usage, _In_ BYTE* baselineReport, _In_ BYTE* probeReport, _In_ ULONG cbReport, _Out_ HID_REPORT_FIELD* field, _Out_ UCHAR* reportId)
+{
+  NTSTATUS hidpReturnCode;
+  HIDP_VALUE_CAPS valueCap;
+  USHORT numValueCaps = 1;
+
+  hidpReturnCode = HidP_GetSpecificValueCaps(HidP_Input, usagePage, linkCollection, usage, &valueCap, &numValueCaps, preparsedData);
+  if ((hidpReturnCode != HIDP_STATUS_SUCCESS) || (numValueCaps == 0))
+  {
+    print_HidP_errors(hidpReturnCode, __FILE__, __LINE__);
+    return -1;
+  }
+
+  if ((valueCap.BitSize == 0) || (valueCap.BitSize > 32) || (valueCap.ReportCount != 1))
+  {
+    printf(FG_RED);
+    printf("Unsupported value layout (BitSize: %d, ReportCount: %d) for usage 0x%x at %s:%d\n", valueCap.BitSize, valueCap.ReportCount, usage, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  hidpReturnCode = HidP_InitializeReportForID(HidP_Input, valueCap.ReportID, preparsedData, (PCHAR)baselineReport, cbReport);
+  if (hidpReturnCode != HIDP_STATUS_SUCCESS)
+  {
+    print_HidP_errors(hidpReturnCode, __FILE__, __LINE__);
+    return -1;
+  }
+
+  memcpy(probeReport, baselineReport, cbReport);
+
+  ULONG allBits = (valueCap.BitSize == 32) ? 0xFFFFFFFF : ((1UL << valueCap.BitSize) - 1);
+
+  hidpReturnCode = HidP_SetUsageValue(HidP_Input, usagePage, linkCollection, usage, 0, preparsedData, (PCHAR)baselineReport, cbReport);
+  if (hidpReturnCode == HIDP_STATUS_SUCCESS)
+  {
+    hidpReturnCode = HidP_SetUsageValue(HidP_Input, usagePage, linkCollection, usage, allBits, preparsedData, (PCHAR)probeReport, cbReport);
+  }
+
+  if (hidpReturnCode != HIDP_STATUS_SUCCESS)
+  {
+    print_HidP_errors(hidpReturnCode, __FILE__, __LINE__);
+    return -1;
+  }
+
+  field->BitSize    = valueCap.BitSize;
+  field->LogicalMin = valueCap.LogicalMin;
+  field->LogicalMax = valueCap.LogicalMax;
+  (*reportId)       = valueCap.ReportID;
+
+  return mFindChangedBitOffset(baselineReport, probeReport, cbReport, &field->BitOffset);
+}
+
+static int mCompileHidButtonField(_In_ PHIDP_PREPARSED_DATA preparsedData, _In_ USAGE usagePage, _In_ USHORT linkCollection, _In_ USAGE usage, _In_ BYTE* baselineReport, _In_ BYTE* probeReport, _In_ ULONG cbReport, _Out_ HID_REPORT_FIELD* field, _Out_ UCHAR* reportId)
+{
+  NTSTATUS hidpReturnCode;
+  HIDP_BUTTON_CAPS buttonCap;
+  USHORT numButtonCaps = 1;
+
+  hidpReturnCode = HidP_GetSpecificButtonCaps(HidP_Input, usagePage, linkCollection, usage, &buttonCap, &numButtonCaps, preparsedData);
+  if ((hidpReturnCode != HIDP_STATUS_SUCCESS) || (numButtonCaps == 0))
+  {
+    print_HidP_errors(hidpReturnCode, __FILE__, __LINE__);
+    return -1;
+  }
+
+  hidpReturnCode = HidP_InitializeReportForID(HidP_Input, buttonCap.ReportID, preparsedData, (PCHAR)baselineReport, cbReport);
+  if (hidpReturnCode != HIDP_STATUS_SUCCESS)
+  {
+    print_HidP_errors(hidpReturnCode, __FILE__, __LINE__);
+    return -1;
+  }
+
+  memcpy(probeReport, baselineReport, cbReport);
+
+  USAGE usageList[1]  = {usage};
+  ULONG usageListSize = 1;
+
+  hidpReturnCode = HidP_SetUsages(HidP_Input, usagePage, linkCollection, usageList, &usageListSize, preparsedData, (PCHAR)probeReport, cbReport);
+  if (hidpReturnCode != HIDP_STATUS_SUCCESS)
+  {
+    print_HidP_errors(hidpReturnCode, __FILE__, __LINE__);
+    return -1;
+  }
+
+  field->BitSize    = 1;
+  field->LogicalMin = 0;
+  field->LogicalMax = 1;
+  (*reportId)       = buttonCap.ReportID;
+
+  return mFindChangedBitOffset(baselineReport, probeReport, cbReport, &field->BitOffset);
+}
+
+int mCompileTouchDecodePlan(_In_ PHIDP_PREPARSED_DATA preparsedData, _In_ HID_LINK_COL_INFO_LIST* linkColInfoList, _In_ USHORT contactCountLinkCollection, _Out_ HID_TOUCH_DECODE_PLAN* plan)
+{
+  if ((preparsedData == NULL) || (linkColInfoList == NULL) || (plan == NULL))
+  {
+    printf(FG_RED);
+    printf("mCompileTouchDecodePlan received a NULL argument at %s:%d\n", __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    exit(-1);
+    return -1;
+  }
+
+  mInitializeTouchDecodePlan(plan);
+
+  if (contactCountLinkCollection == (USHORT)-1)
+  {
+    return -1;
+  }
+
+  HIDP_CAPS caps;
+  NTSTATUS hidpReturnCode = HidP_GetCaps(preparsedData, &caps);
+  if (hidpReturnCode != HIDP_STATUS_SUCCESS)
+  {
+    print_HidP_errors(hidpReturnCode, __FILE__, __LINE__);
+    return -1;
+  }
+
+  ULONG cbReport       = caps.InputReportByteLength;
+  BYTE* baselineReport = (BYTE*)mMalloc(cbReport, __FILE__, __LINE__);
+  BYTE* probeReport    = (BYTE*)mMalloc(cbReport, __FILE__, __LINE__);
+
+  int retval = 0;
+  UCHAR reportId;
+  UCHAR fieldReportId;
+
+  retval = mCompileHidValueField(preparsedData, HID_USAGE_PAGE_DIGITIZER, contactCountLinkCollection, HID_USAGE_DIGITIZER_CONTACT_COUNT, baselineReport, probeReport, cbReport, &plan->ContactCount, &reportId);
+
+  for (unsigned int linkColIdx = 0; (retval == 0) && (linkColIdx < linkColInfoList->Size); linkColIdx++)
+  {
+    HID_TOUCH_LINK_COL_INFO collectionInfo = linkColInfoList->Entries[linkColIdx];
+    if (!(collectionInfo.HasX && collectionInfo.HasY && collectionInfo.HasContactID && collectionInfo.HasTipSwitch))
+    {
+      continue;
+    }
+
+    if (plan->NumContacts == HID_TOUCH_DECODE_PLAN_MAX_CONTACTS)
+    {
+      printf(FG_BRIGHT_YELLOW);
+      printf("Ignoring contact link collection %d because the decode plan is full at %s:%d\n", collectionInfo.LinkColID, __FILE__, __LINE__);
+      printf(RESET_COLOR);
+      continue;
+    }
+
+    HID_TOUCH_CONTACT_LAYOUT* layout = &plan->Contacts[plan->NumContacts];
+    layout->LinkColID                = collectionInfo.LinkColID;
+
+    retval = mCompileHidValueField(preparsedData, HID_USAGE_PAGE_GENERIC, collectionInfo.LinkColID, HID_USAGE_GENERIC_X, baselineReport, probeReport, cbReport, &layout->X, &fieldReportId);
+    retval = (retval == 0) && (fieldReportId == reportId) ? 0 : -1;
+
+    if (retval == 0)
+    {
+      retval = mCompileHidValueField(preparsedData, HID_USAGE_PAGE_GENERIC, collectionInfo.LinkColID, HID_USAGE_GENERIC_Y, baselineReport, probeReport, cbReport, &layout->Y, &fieldReportId);
+      retval = (retval == 0) && (fieldReportId == reportId) ? 0 : -1;
+    }
+
+    if (retval == 0)
+    {
+      retval = mCompileHidValueField(preparsedData, HID_USAGE_PAGE_DIGITIZER, collectionInfo.LinkColID, HID_USAGE_DIGITIZER_CONTACT_ID, baselineReport, probeReport, cbReport, &layout->ContactID, &fieldReportId);
+      retval = (retval == 0) && (fieldReportId == reportId) ? 0 : -1;
+    }
+
+    if (retval == 0)
+    {
+      retval = mCompileHidButtonField(preparsedData, HID_USAGE_PAGE_DIGITIZER, collectionInfo.LinkColID, HID_USAGE_DIGITIZER_TIP_SWITCH, baselineReport, probeReport, cbReport, &layout->TipSwitch, &fieldReportId);
+      retval = (retval == 0) && (fieldReportId == reportId) ? 0 : -1;
+    }
+
+    if (retval == 0)
+    {
+      plan->NumContacts++;
+    }
+  }
+
+  free(baselineReport);
+  free(probeReport);
+
+  if (retval == 0)
+  {
+    plan->ReportID = reportId;
+    retval         = mFinalizeTouchDecodePlan(plan);
+  }
+
+  return retval;
+}
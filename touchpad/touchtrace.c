@@ -0,0 +1,166 @@
+#include "platform.h"
+
+#include <stdio.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "touchtrace.h"
+
+#include "termcolor.h"
+
+unsigned int mGetTouchTraceRecordSize(unsigned int cbPayload)
+{
+  unsigned int cbPaddedPayload = (cbPayload + (TOUCH_TRACE_ALIGNMENT - 1)) & ~(unsigned int)(TOUCH_TRACE_ALIGNMENT - 1);
+  return (unsigned int)sizeof(TOUCH_TRACE_RECORD_HEADER) + cbPaddedPayload;
+}
+
+int mMapTouchTrace(const char* filePath, TOUCH_TRACE_MAPPING* mapping)
+{
+  memset(mapping, 0, sizeof(TOUCH_TRACE_MAPPING));
+
+#ifdef _WIN32
+  mapping->File = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (mapping->File == INVALID_HANDLE_VALUE)
+  {
+    printf(FG_RED);
+    printf("Failed to open %s at %s:%d\n", filePath, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  LARGE_INTEGER fileSize;
+  GetFileSizeEx(mapping->File, &fileSize);
+  mapping->cbData = (size_t)fileSize.QuadPart;
+
+  if (mapping->cbData != 0)
+  {
+    mapping->Mapping = CreateFileMappingA(mapping->File, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping->Mapping != NULL)
+    {
+      mapping->Data = (const BYTE*)MapViewOfFile(mapping->Mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+  }
+#else
+  mapping->File = open(filePath, O_RDONLY);
+  if (mapping->File < 0)
+  {
+    printf(FG_RED);
+    printf("Failed to open %s at %s:%d\n", filePath, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  struct stat fileStat;
+  fstat(mapping->File, &fileStat);
+  mapping->cbData = (size_t)fileStat.st_size;
+
+  if (mapping->cbData != 0)
+  {
+    void* data = mmap(NULL, mapping->cbData, PROT_READ, MAP_PRIVATE, mapping->File, 0);
+    if (data != MAP_FAILED)
+    {
+      // the records are read front to back
+      madvise(data, mapping->cbData, MADV_SEQUENTIAL);
+      mapping->Data = (const BYTE*)data;
+    }
+  }
+#endif
+
+  if (mapping->Data == NULL)
+  {
+    printf(FG_RED);
+    printf("Failed to map %s at %s:%d\n", filePath, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    mUnmapTouchTrace(mapping);
+    return -1;
+  }
+
+  return 0;
+}
+
+void mUnmapTouchTrace(TOUCH_TRACE_MAPPING* mapping)
+{
+#ifdef _WIN32
+  if (mapping->Data != NULL)
+  {
+    UnmapViewOfFile(mapping->Data);
+  }
+
+  if (mapping->Mapping != NULL)
+  {
+    CloseHandle(mapping->Mapping);
+  }
+
+  if ((mapping->File != NULL) && (mapping->File != INVALID_HANDLE_VALUE))
+  {
+    CloseHandle(mapping->File);
+  }
+#else
+  if (mapping->Data != NULL)
+  {
+    munmap((void*)mapping->Data, mapping->cbData);
+  }
+
+  if (mapping->File >= 0)
+  {
+    close(mapping->File);
+  }
+#endif
+
+  memset(mapping, 0, sizeof(TOUCH_TRACE_MAPPING));
+#ifndef _WIN32
+  mapping->File = -1;
+#endif
+}
+
+const TOUCH_TRACE_FILE_HEADER* mGetTouchTraceFileHeader(const BYTE* data, size_t cbData)
+{
+  if ((data == NULL) || (cbData < sizeof(TOUCH_TRACE_FILE_HEADER)))
+  {
+    return NULL;
+  }
+
+  const TOUCH_TRACE_FILE_HEADER* fileHeader = (const TOUCH_TRACE_FILE_HEADER*)data;
+
+  int isMagicValid       = (fileHeader->Magic == TOUCH_TRACE_MAGIC);
+  int isVersionSupported = (fileHeader->Version == TOUCH_TRACE_VERSION);
+  // the records must stay aligned and a newer writer may only append fields
+  int isLayoutValid = (fileHeader->cbFileHeader >= sizeof(TOUCH_TRACE_FILE_HEADER)) && ((fileHeader->cbFileHeader % TOUCH_TRACE_ALIGNMENT) == 0) && (fileHeader->cbFileHeader <= cbData) && (fileHeader->cbRecordHeader == sizeof(TOUCH_TRACE_RECORD_HEADER));
+
+  if (!isMagicValid || !isVersionSupported || !isLayoutValid)
+  {
+    return NULL;
+  }
+
+  return fileHeader;
+}
+
+const TOUCH_TRACE_RECORD_HEADER* mGetNextTouchTraceRecord(const BYTE* data, size_t cbData, size_t* offset)
+{
+  if ((cbData < (*offset)) || ((cbData - (*offset)) < sizeof(TOUCH_TRACE_RECORD_HEADER)))
+  {
+    return NULL;
+  }
+
+  const TOUCH_TRACE_RECORD_HEADER* record = (const TOUCH_TRACE_RECORD_HEADER*)(data + (*offset));
+
+  // compare in 64 bits, a corrupted cbPayload must not wrap around
+  unsigned long long cbRecord = sizeof(TOUCH_TRACE_RECORD_HEADER) + (((unsigned long long)record->cbPayload + (TOUCH_TRACE_ALIGNMENT - 1)) & ~(unsigned long long)(TOUCH_TRACE_ALIGNMENT - 1));
+  if (cbRecord > (unsigned long long)(cbData - (*offset)))
+  {
+    return NULL;
+  }
+
+  (*offset) += (size_t)cbRecord;
+
+  return record;
+}
+
+const BYTE* mGetTouchTraceRecordPayload(const TOUCH_TRACE_RECORD_HEADER* record)
+{
+  return (const BYTE*)(record + 1);
+}
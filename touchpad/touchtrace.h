@@ -0,0 +1,80 @@
+#ifndef __TOUCHTRACE_H__
+#define __TOUCHTRACE_H__
+#include "platform.h"
+
+// A touch trace file is a TOUCH_TRACE_FILE_HEADER followed by records. Every
+// record is a TOUCH_TRACE_RECORD_HEADER followed by cbPayload bytes of payload
+// and zero padding up to the next multiple of TOUCH_TRACE_ALIGNMENT so that
+// the headers stay aligned when the file is memory mapped and walked in place.
+// All fields are little endian (the byte order of every platform we run on).
+#define TOUCH_TRACE_MAGIC     0x43525454  // "TTRC"
+#define TOUCH_TRACE_VERSION   1
+#define TOUCH_TRACE_ALIGNMENT 8
+
+// Payload: RAWHID.bRawData of a single WM_INPUT message, that is Count
+// reports of (cbPayload / Count) bytes each.
+#define TOUCH_TRACE_RECORD_REPORTS           1
+// Payload: the preparsed data (RIDI_PREPARSEDDATA) of the device. It is only
+// meaningful to the HidP_* functions of the Windows version that recorded it.
+#define TOUCH_TRACE_RECORD_PREPARSED_DATA    2
+// 3 is not used: Raw Input only exposes the preparsed data, not the report descriptor.
+// Payload: the HID_TOUCH_DECODE_PLAN that was compiled for the device so that
+// its reports can be decoded without the HidP_* functions.
+#define TOUCH_TRACE_RECORD_DECODE_PLAN       4
+
+struct TOUCH_TRACE_FILE_HEADER
+{
+  unsigned int Magic;
+  unsigned int Version;
+  unsigned int cbFileHeader;
+  unsigned int cbRecordHeader;
+  // ticks per second of the record timestamps
+  unsigned long long TimestampFrequency;
+  // timestamp of the moment that the recording started
+  unsigned long long StartTimestamp;
+};
+
+typedef struct TOUCH_TRACE_FILE_HEADER TOUCH_TRACE_FILE_HEADER;
+
+struct TOUCH_TRACE_RECORD_HEADER
+{
+  unsigned int Type;
+  // index of the device in the device info list of the recording
+  unsigned int DeviceIdx;
+  unsigned long long Timestamp;
+  unsigned int cbPayload;
+  // number of reports for TOUCH_TRACE_RECORD_REPORTS, 0 otherwise
+  unsigned int Count;
+};
+
+typedef struct TOUCH_TRACE_RECORD_HEADER TOUCH_TRACE_RECORD_HEADER;
+
+// A read only view of a whole trace file.
+struct TOUCH_TRACE_MAPPING
+{
+  const BYTE* Data;
+  size_t cbData;
+#ifdef _WIN32
+  HANDLE File;
+  HANDLE Mapping;
+#else
+  int File;
+#endif
+};
+
+typedef struct TOUCH_TRACE_MAPPING TOUCH_TRACE_MAPPING;
+
+unsigned int mGetTouchTraceRecordSize(unsigned int cbPayload);
+
+int mMapTouchTrace(const char* filePath, TOUCH_TRACE_MAPPING* mapping);
+void mUnmapTouchTrace(TOUCH_TRACE_MAPPING* mapping);
+
+// Returns NULL if the data does not start with a valid header of a supported version.
+const TOUCH_TRACE_FILE_HEADER* mGetTouchTraceFileHeader(const BYTE* data, size_t cbData);
+// Returns the record at (*offset) and moves (*offset) to the next record.
+// Returns NULL at the end of the data or if the last record is truncated
+// (e.g. the application did not close the recorder).
+// (*offset) must start at the cbFileHeader of the file header.
+const TOUCH_TRACE_RECORD_HEADER* mGetNextTouchTraceRecord(const BYTE* data, size_t cbData, size_t* offset);
+const BYTE* mGetTouchTraceRecordPayload(const TOUCH_TRACE_RECORD_HEADER* record);
+#endif  // __TOUCHTRACE_H__
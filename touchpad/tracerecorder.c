@@ -0,0 +1,177 @@
+#include "platform.h"
+
+#include <stdio.h>
+
+#include "tracerecorder.h"
+
+#include "utils.h"
+#include "termcolor.h"
+
+// The mutex must be locked and the other buffer must be empty.
+static void mSwapTouchTraceBuffers(TOUCH_TRACE_RECORDER* recorder)
+{
+  recorder->ActiveBuffer ^= 1;
+  recorder->IsFlushPending = 1;
+}
+
+static void mTouchTraceWriterThread(void* arg)
+{
+  TOUCH_TRACE_RECORDER* recorder = (TOUCH_TRACE_RECORDER*)arg;
+
+  mLockThreadMutex(&recorder->Mutex);
+
+  while (1)
+  {
+    if (recorder->IsFlushPending)
+    {
+      unsigned int flushBuffer = recorder->ActiveBuffer ^ 1;
+
+      // the message loop keeps appending to the active buffer while we write
+      mUnlockThreadMutex(&recorder->Mutex);
+      fwrite(recorder->Buffers[flushBuffer], 1, recorder->cbBuffered[flushBuffer], recorder->File);
+      fflush(recorder->File);
+      mLockThreadMutex(&recorder->Mutex);
+
+      recorder->cbBuffered[flushBuffer] = 0;
+      recorder->IsFlushPending          = 0;
+    }
+    else if (recorder->IsStopping)
+    {
+      if (recorder->cbBuffered[recorder->ActiveBuffer] == 0)
+      {
+        break;
+      }
+
+      mSwapTouchTraceBuffers(recorder);
+    }
+    else
+    {
+      int timedOut = (mWaitThreadCondition(&recorder->FlushCondition, &recorder->Mutex, TOUCH_TRACE_RECORDER_FLUSH_INTERVAL_MS) != 0);
+      if (timedOut && !recorder->IsFlushPending && (recorder->cbBuffered[recorder->ActiveBuffer] != 0))
+      {
+        // do not keep the records in memory for too long when the input is slow
+        mSwapTouchTraceBuffers(recorder);
+      }
+    }
+  }
+
+  mUnlockThreadMutex(&recorder->Mutex);
+}
+
+int mOpenTouchTraceRecorder(const char* filePath, TOUCH_TRACE_RECORDER* recorder)
+{
+  memset(recorder, 0, sizeof(TOUCH_TRACE_RECORDER));
+
+  recorder->File = fopen(filePath, "wb");
+  if (recorder->File == NULL)
+  {
+    printf(FG_RED);
+    printf("Failed to create the trace file %s at %s:%d\n", filePath, __FILE__, __LINE__);
+    printf(RESET_COLOR);
+    return -1;
+  }
+
+  TOUCH_TRACE_FILE_HEADER fileHeader;
+  memset(&fileHeader, 0, sizeof(TOUCH_TRACE_FILE_HEADER));
+  fileHeader.Magic              = TOUCH_TRACE_MAGIC;
+  fileHeader.Version            = TOUCH_TRACE_VERSION;
+  fileHeader.cbFileHeader       = sizeof(TOUCH_TRACE_FILE_HEADER);
+  fileHeader.cbRecordHeader     = sizeof(TOUCH_TRACE_RECORD_HEADER);
+  fileHeader.TimestampFrequency = mGetTimestampFrequency();
+  fileHeader.StartTimestamp     = mGetTimestamp();
+
+  fwrite(&fileHeader, 1, sizeof(TOUCH_TRACE_FILE_HEADER), recorder->File);
+
+  recorder->Buffers[0] = (BYTE*)mMalloc(TOUCH_TRACE_RECORDER_BUFFER_SIZE, __FILE__, __LINE__);
+  recorder->Buffers[1] = (BYTE*)mMalloc(TOUCH_TRACE_RECORDER_BUFFER_SIZE, __FILE__, __LINE__);
+
+  mInitializeThreadMutex(&recorder->Mutex);
+  mInitializeThreadCondition(&recorder->FlushCondition);
+
+  if (mCreateThread(&recorder->WriterThread, mTouchTraceWriterThread, recorder) != 0)
+  {
+    mDestroyThreadCondition(&recorder->FlushCondition);
+    mDestroyThreadMutex(&recorder->Mutex);
+    free(recorder->Buffers[0]);
+    free(recorder->Buffers[1]);
+    fclose(recorder->File);
+    memset(recorder, 0, sizeof(TOUCH_TRACE_RECORDER));
+    return -1;
+  }
+
+  return 0;
+}
+
+int mRecordTouchTrace(TOUCH_TRACE_RECORDER* recorder, unsigned int recordType, unsigned int deviceIdx, unsigned int count, const void* payload, unsigned int cbPayload)
+{
+  TOUCH_TRACE_RECORD_HEADER recordHeader;
+  recordHeader.Type      = recordType;
+  recordHeader.DeviceIdx = deviceIdx;
+  recordHeader.Timestamp = mGetTimestamp();
+  recordHeader.cbPayload = cbPayload;
+  recordHeader.Count     = count;
+
+  unsigned int cbRecord = mGetTouchTraceRecordSize(cbPayload);
+  if (cbRecord > TOUCH_TRACE_RECORDER_BUFFER_SIZE)
+  {
+    recorder->NumDroppedRecords++;
+    return -1;
+  }
+
+  mLockThreadMutex(&recorder->Mutex);
+
+  if ((recorder->cbBuffered[recorder->ActiveBuffer] + cbRecord) > TOUCH_TRACE_RECORDER_BUFFER_SIZE)
+  {
+    if (recorder->IsFlushPending)
+    {
+      // the disk cannot keep up, never stall the message loop for it
+      recorder->NumDroppedRecords++;
+      mUnlockThreadMutex(&recorder->Mutex);
+      return -1;
+    }
+
+    mSwapTouchTraceBuffers(recorder);
+    mSignalThreadCondition(&recorder->FlushCondition);
+  }
+
+  BYTE* record = recorder->Buffers[recorder->ActiveBuffer] + recorder->cbBuffered[recorder->ActiveBuffer];
+  memcpy(record, &recordHeader, sizeof(TOUCH_TRACE_RECORD_HEADER));
+  memcpy(record + sizeof(TOUCH_TRACE_RECORD_HEADER), payload, cbPayload);
+  memset(record + sizeof(TOUCH_TRACE_RECORD_HEADER) + cbPayload, 0, cbRecord - sizeof(TOUCH_TRACE_RECORD_HEADER) - cbPayload);
+
+  recorder->cbBuffered[recorder->ActiveBuffer] += cbRecord;
+
+  mUnlockThreadMutex(&recorder->Mutex);
+
+  return 0;
+}
+
+void mCloseTouchTraceRecorder(TOUCH_TRACE_RECORDER* recorder)
+{
+  if (recorder->File == NULL)
+  {
+    return;
+  }
+
+  mLockThreadMutex(&recorder->Mutex);
+  recorder->IsStopping = 1;
+  mSignalThreadCondition(&recorder->FlushCondition);
+  mUnlockThreadMutex(&recorder->Mutex);
+
+  mJoinThread(&recorder->WriterThread);
+
+  if (recorder->NumDroppedRecords != 0)
+  {
+    printf(FG_YELLOW);
+    printf("The trace recorder dropped %llu records\n", recorder->NumDroppedRecords);
+    printf(RESET_COLOR);
+  }
+
+  mDestroyThreadCondition(&recorder->FlushCondition);
+  mDestroyThreadMutex(&recorder->Mutex);
+  free(recorder->Buffers[0]);
+  free(recorder->Buffers[1]);
+  fclose(recorder->File);
+
+  memset(recorder, 0, sizeof(TOUCH_TRACE_RECORDER));
+}
@@ -0,0 +1,42 @@
+#ifndef __TRACERECORDER_H__
+#define __TRACERECORDER_H__
+#include "platform.h"
+
+#include <stdio.h>
+
+#include "threading.h"
+#include "touchtrace.h"
+
+// size of each of the two record buffers
+#define TOUCH_TRACE_RECORDER_BUFFER_SIZE (1 << 20)
+// the writer thread flushes a partially filled buffer after this long
+#define TOUCH_TRACE_RECORDER_FLUSH_INTERVAL_MS 250
+
+// Writes a touch trace file (see touchtrace.h) from the message loop without
+// blocking it on disk I/O. Records are copied into the active buffer while the
+// writer thread writes the other one to the file. If both buffers are full the
+// record is dropped (and counted) instead of waiting for the disk.
+struct TOUCH_TRACE_RECORDER
+{
+  FILE* File;
+  BYTE* Buffers[2];
+  unsigned int cbBuffered[2];
+  // index of the buffer that records are appended to
+  unsigned int ActiveBuffer;
+  // the other buffer is waiting to be written by the writer thread
+  int IsFlushPending;
+  int IsStopping;
+  unsigned long long NumDroppedRecords;
+  THREAD_MUTEX Mutex;
+  THREAD_CONDITION FlushCondition;
+  THREAD_HANDLE WriterThread;
+};
+
+typedef struct TOUCH_TRACE_RECORDER TOUCH_TRACE_RECORDER;
+
+int mOpenTouchTraceRecorder(const char* filePath, TOUCH_TRACE_RECORDER* recorder);
+// Returns -1 if the record was dropped. The timestamp is taken by this function.
+int mRecordTouchTrace(TOUCH_TRACE_RECORDER* recorder, unsigned int recordType, unsigned int deviceIdx, unsigned int count, const void* payload, unsigned int cbPayload);
+// write the remaining records and close the file
+void mCloseTouchTraceRecorder(TOUCH_TRACE_RECORDER* recorder);
+#endif  // __TRACERECORDER_H__
@@ -1,17 +1,21 @@
-#include <Windows.h>
+#include "platform.h"
 
+#ifdef _WIN32
 #include <hidusage.h>
 #include <hidpi.h>
 #pragma comment(lib, "hid.lib")
 
+#include <tchar.h>
+#endif
+
 #include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <tchar.h>
 
 #include "termcolor.h"
 #include "utils.h"
 
+#ifdef _WIN32
 void mGetLastError()
 {
   DWORD errorCode      = GetLastError();
@@ -57,181 +61,157 @@ void print_HidP_errors(NTSTATUS hidpReturnCode, const char* filePath, int lineNu
   printf("%s:%d\n", filePath, lineNumber);
   printf(RESET_COLOR);
 }
+#endif
 
-int FindInputDeviceInList(HID_DEVICE_INFO_LIST* hidInfoList, TCHAR* deviceName, const unsigned int cbDeviceName, PHIDP_PREPARSED_DATA preparsedData, const UINT cbPreparsedData, unsigned int* foundHidIndex)
+// The first allocation of the device and link collection lists will hold this many entries.
+#define HID_LIST_MIN_CAPACITY 4
+
+static unsigned long long mHashDeviceName(TCHAR* deviceName)
 {
-  (*foundHidIndex)              = (unsigned int)-1;
-  HID_DEVICE_INFO* hidInfoArray = hidInfoList->Entries;
-  unsigned int hidInfoArraySize = hidInfoList->Size;
-  const int isHidArrayNull      = (hidInfoArray == NULL);
-  const int isHidArraySizeEmpty = (hidInfoArraySize == 0);
-  if (isHidArrayNull || isHidArraySizeEmpty)
+  size_t nameLength = 0;
+  while (deviceName[nameLength] != 0)
   {
-    // the array/list/dictionary is empty
-    // allocate memory for the first entry
-    hidInfoArraySize = 1;
-    (*foundHidIndex) = 0;
-
-    // TODO recursive free pointers inside struct
-    // but we can't know the size of array pointer here
-    // because the size is recorded as 0
-
-    // shallow free memory in case if it has been assigned before
-    free(hidInfoArray);
-    hidInfoArray = (HID_DEVICE_INFO*)mMalloc(sizeof(HID_DEVICE_INFO), __FILE__, __LINE__);
-
-    hidInfoArray[(*foundHidIndex)].cbName          = cbDeviceName;
-    hidInfoArray[(*foundHidIndex)].LinkColInfoList = (HID_LINK_COL_INFO_LIST){.Entries = NULL, .Size = 0};
-    hidInfoArray[(*foundHidIndex)].PreparedData    = preparsedData;
-    hidInfoArray[(*foundHidIndex)].cbPreparsedData = cbPreparsedData;
-
-    hidInfoArray[(*foundHidIndex)].Name                       = (TCHAR*)mMalloc(cbDeviceName, __FILE__, __LINE__);
-    hidInfoArray[(*foundHidIndex)].ContactCountLinkCollection = (USHORT)-1;
+    nameLength++;
+  }
 
-    memcpy(hidInfoArray[(*foundHidIndex)].Name, deviceName, cbDeviceName);
+  return mHashBytes(deviceName, sizeof(TCHAR) * nameLength);
+}
 
-    hidInfoArray[(*foundHidIndex)].PreparedData = (PHIDP_PREPARSED_DATA)mMalloc(cbPreparsedData, __FILE__, __LINE__);
+int LookupInputDeviceInList(HID_DEVICE_INFO_LIST* hidInfoList, TCHAR* deviceName, unsigned int* foundHidIndex)
+{
+  (*foundHidIndex) = (unsigned int)-1;
 
-    memcpy(hidInfoArray[(*foundHidIndex)].PreparedData, preparsedData, cbPreparsedData);
-  }
-  else
+  unsigned int hidIndex;
+  if (mFindInHashIndex(&hidInfoList->NameIndex, mHashDeviceName(deviceName), &hidIndex) != 0)
   {
-    for (unsigned int touchpadIndex = 0; touchpadIndex < hidInfoArraySize; touchpadIndex++)
-    {
-      int compareNameResult = _tcscmp(deviceName, hidInfoArray[touchpadIndex].Name);
-      if (compareNameResult == 0)
-      {
-        (*foundHidIndex) = touchpadIndex;
-        break;
-      }
-    }
+    return -1;
   }
 
-  if ((*foundHidIndex) == (unsigned int)-1)
+  if (_tcscmp(deviceName, hidInfoList->Entries[hidIndex].Name) == 0)
   {
-    // the array/list/dictionary is not empty
-    // but we cannot find any entry with the same name
-
-    // allocate memory and create a new entry at the end of array
-    (*foundHidIndex) = hidInfoArraySize;
-    hidInfoArraySize = (*foundHidIndex) + 1;
-
-    // copy entries to new array
-    HID_DEVICE_INFO* tmpHidInfoArray = (HID_DEVICE_INFO*)mMalloc(sizeof(HID_DEVICE_INFO) * hidInfoArraySize, __FILE__, __LINE__);
+    (*foundHidIndex) = hidIndex;
+    return 0;
+  }
 
-    for (unsigned int hidIndex = 0; hidIndex < (*foundHidIndex); hidIndex++)
+  // two names with the same 64-bit hash
+  for (unsigned int touchpadIndex = 0; touchpadIndex < hidInfoList->Size; touchpadIndex++)
+  {
+    if (_tcscmp(deviceName, hidInfoList->Entries[touchpadIndex].Name) == 0)
     {
-      tmpHidInfoArray[hidIndex].Name = hidInfoArray[hidIndex].Name;
-      hidInfoArray[hidIndex].Name    = NULL;
-
-      tmpHidInfoArray[hidIndex].cbName = hidInfoArray[hidIndex].cbName;
-
-      tmpHidInfoArray[hidIndex].LinkColInfoList.Entries = hidInfoArray[hidIndex].LinkColInfoList.Entries;
-      hidInfoArray[hidIndex].LinkColInfoList.Entries    = NULL;
-
-      tmpHidInfoArray[hidIndex].LinkColInfoList.Size = hidInfoArray[hidIndex].LinkColInfoList.Size;
+      (*foundHidIndex) = touchpadIndex;
+      return 0;
+    }
+  }
 
-      tmpHidInfoArray[hidIndex].PreparedData = hidInfoArray[hidIndex].PreparedData;
-      hidInfoArray[hidIndex].PreparedData    = NULL;
+  return -1;
+}
 
-      tmpHidInfoArray[hidIndex].cbPreparsedData            = hidInfoArray[hidIndex].cbPreparsedData;
-      tmpHidInfoArray[hidIndex].ContactCountLinkCollection = hidInfoArray[hidIndex].ContactCountLinkCollection;
-    }
+int FindInputDeviceInList(HID_DEVICE_INFO_LIST* hidInfoList, TCHAR* deviceName, const unsigned int cbDeviceName, PHIDP_PREPARSED_DATA preparsedData, const UINT cbPreparsedData, unsigned int* foundHidIndex)
+{
+  if (LookupInputDeviceInList(hidInfoList, deviceName, foundHidIndex) == 0)
+  {
+    return 0;
+  }
 
-    free(hidInfoArray);
-    hidInfoArray = tmpHidInfoArray;
+  // we cannot find any entry with the same name
+  // create a new entry at the end of array
+  if ((hidInfoList->Entries == NULL) || (hidInfoList->Size == hidInfoList->Capacity))
+  {
+    unsigned int newCapacity = (hidInfoList->Capacity == 0) ? HID_LIST_MIN_CAPACITY : (hidInfoList->Capacity * 2);
 
-    hidInfoArray[(*foundHidIndex)].cbName          = cbDeviceName;
-    hidInfoArray[(*foundHidIndex)].LinkColInfoList = (HID_LINK_COL_INFO_LIST){.Entries = NULL, .Size = 0};
-    hidInfoArray[(*foundHidIndex)].cbPreparsedData = cbPreparsedData;
+    hidInfoList->Entries  = (HID_DEVICE_INFO*)mRealloc(hidInfoList->Entries, sizeof(HID_DEVICE_INFO) * newCapacity, __FILE__, __LINE__);
+    hidInfoList->Capacity = newCapacity;
+  }
 
-    hidInfoArray[(*foundHidIndex)].Name = (TCHAR*)mMalloc(cbDeviceName, __FILE__, __LINE__);
+  (*foundHidIndex)            = hidInfoList->Size;
+  HID_DEVICE_INFO* deviceInfo = &hidInfoList->Entries[(*foundHidIndex)];
+  hidInfoList->Size++;
 
-    memcpy(hidInfoArray[(*foundHidIndex)].Name, deviceName, cbDeviceName);
+  memset(deviceInfo, 0, sizeof(HID_DEVICE_INFO));
 
-    hidInfoArray[(*foundHidIndex)].PreparedData = (PHIDP_PREPARSED_DATA)mMalloc(cbPreparsedData, __FILE__, __LINE__);
+  deviceInfo->cbName                     = cbDeviceName;
+  deviceInfo->Name                       = (TCHAR*)mMalloc(cbDeviceName, __FILE__, __LINE__);
+  deviceInfo->cbPreparsedData            = cbPreparsedData;
+  deviceInfo->PreparedData               = (PHIDP_PREPARSED_DATA)mMalloc(cbPreparsedData, __FILE__, __LINE__);
+  deviceInfo->ContactCountLinkCollection = (USHORT)-1;
+  mInitializeTouchDecodePlan(&deviceInfo->DecodePlan);
 
-    memcpy(hidInfoArray[(*foundHidIndex)].PreparedData, preparsedData, cbPreparsedData);
-  }
+  memcpy(deviceInfo->Name, deviceName, cbDeviceName);
+  memcpy(deviceInfo->PreparedData, preparsedData, cbPreparsedData);
 
-  hidInfoList->Entries = hidInfoArray;
-  hidInfoList->Size    = hidInfoArraySize;
+  mInsertIntoHashIndex(&hidInfoList->NameIndex, mHashDeviceName(deviceInfo->Name), (*foundHidIndex));
 
   return 0;
 }
 
 int FindLinkCollectionInList(HID_LINK_COL_INFO_LIST* linkColInfoList, USHORT linkCollection, unsigned int* foundLinkColIdx)
 {
-  (*foundLinkColIdx)      = (unsigned int)-1;
-  int isLinkColArrayNull  = (linkColInfoList->Entries == NULL);
-  int isLinkColArrayEmpty = (linkColInfoList->Size == 0);
-
-  if (isLinkColArrayNull || isLinkColArrayEmpty)
+  if (mFindInHashIndex(&linkColInfoList->LinkColIndex, linkCollection, foundLinkColIdx) == 0)
   {
-    (*foundLinkColIdx)    = 0;
-    linkColInfoList->Size = 1;
-
-    free(linkColInfoList->Entries);
-    linkColInfoList->Entries = (HID_TOUCH_LINK_COL_INFO*)mMalloc(sizeof(HID_TOUCH_LINK_COL_INFO), __FILE__, __LINE__);
-
-    linkColInfoList->Entries[(*foundLinkColIdx)].LinkColID     = linkCollection;
-    linkColInfoList->Entries[(*foundLinkColIdx)].HasX          = 0;
-    linkColInfoList->Entries[(*foundLinkColIdx)].HasY          = 0;
-    linkColInfoList->Entries[(*foundLinkColIdx)].HasTipSwitch  = 0;
-    linkColInfoList->Entries[(*foundLinkColIdx)].HasContactID  = 0;
-    linkColInfoList->Entries[(*foundLinkColIdx)].HasConfidence = 0;
-    linkColInfoList->Entries[(*foundLinkColIdx)].HasWidth      = 0;
-    linkColInfoList->Entries[(*foundLinkColIdx)].HasHeight     = 0;
-    linkColInfoList->Entries[(*foundLinkColIdx)].HasPressure   = 0;
+    return 0;
   }
-  else
+
+  if ((linkColInfoList->Entries == NULL) || (linkColInfoList->Size == linkColInfoList->Capacity))
   {
-    for (unsigned int linkColIdx = 0; linkColIdx < linkColInfoList->Size; linkColIdx++)
-    {
-      if (linkColInfoList->Entries[linkColIdx].LinkColID == linkCollection)
-      {
-        (*foundLinkColIdx) = linkColIdx;
-        break;
-      }
-    }
+    unsigned int newCapacity = (linkColInfoList->Capacity == 0) ? HID_LIST_MIN_CAPACITY : (linkColInfoList->Capacity * 2);
+
+    linkColInfoList->Entries  = (HID_TOUCH_LINK_COL_INFO*)mRealloc(linkColInfoList->Entries, sizeof(HID_TOUCH_LINK_COL_INFO) * newCapacity, __FILE__, __LINE__);
+    linkColInfoList->Capacity = newCapacity;
   }
 
-  if ((*foundLinkColIdx) == (unsigned int)-1)
-  {
-    (*foundLinkColIdx)    = linkColInfoList->Size;
-    linkColInfoList->Size = (*foundLinkColIdx) + 1;
+  (*foundLinkColIdx) = linkColInfoList->Size;
+  linkColInfoList->Size++;
 
-    HID_TOUCH_LINK_COL_INFO* tmpCollectionArray = (HID_TOUCH_LINK_COL_INFO*)mMalloc(sizeof(HID_TOUCH_LINK_COL_INFO) * linkColInfoList->Size, __FILE__, __LINE__);
+  HID_TOUCH_LINK_COL_INFO* linkColInfo = &linkColInfoList->Entries[(*foundLinkColIdx)];
 
-    for (unsigned int linkColIdx = 0; linkColIdx < (*foundLinkColIdx); linkColIdx++)
-    {
-      tmpCollectionArray[linkColIdx] = linkColInfoList->Entries[linkColIdx];
-    }
+  memset(linkColInfo, 0, sizeof(HID_TOUCH_LINK_COL_INFO));
+  linkColInfo->LinkColID = linkCollection;
 
-    free(linkColInfoList->Entries);
-    linkColInfoList->Entries = tmpCollectionArray;
+  mInsertIntoHashIndex(&linkColInfoList->LinkColIndex, linkCollection, (*foundLinkColIdx));
 
-    linkColInfoList->Entries[(*foundLinkColIdx)].LinkColID     = linkCollection;
-    linkColInfoList->Entries[(*foundLinkColIdx)].HasX          = 0;
-    linkColInfoList->Entries[(*foundLinkColIdx)].HasY          = 0;
-    linkColInfoList->Entries[(*foundLinkColIdx)].HasTipSwitch  = 0;
-    linkColInfoList->Entries[(*foundLinkColIdx)].HasContactID  = 0;
-    linkColInfoList->Entries[(*foundLinkColIdx)].HasConfidence = 0;
-    linkColInfoList->Entries[(*foundLinkColIdx)].HasWidth      = 0;
-    linkColInfoList->Entries[(*foundLinkColIdx)].HasHeight     = 0;
-    linkColInfoList->Entries[(*foundLinkColIdx)].HasPressure   = 0;
-  }
+  return 0;
+}
 
+#ifdef COUNT_MEMORY_ALLOCATIONS
+static unsigned long long g_num_memory_allocations = 0;
+#endif
+
+unsigned long long mGetNumMemoryAllocations()
+{
+#ifdef COUNT_MEMORY_ALLOCATIONS
+  return g_num_memory_allocations;
+#else
   return 0;
+#endif
 }
 
 void* mMalloc(size_t size, char* filePath, int lineNumber)
 {
+#ifdef COUNT_MEMORY_ALLOCATIONS
+  g_num_memory_allocations++;
+#endif
   void* retval = malloc(size);
   if (retval == NULL)
   {
     printf(FG_RED);
-    printf("malloc failed to allocate %d byte(s) at %s:%d\n", size, filePath, lineNumber);
+    printf("malloc failed to allocate %llu byte(s) at %s:%d\n", (unsigned long long)size, filePath, lineNumber);
+    printf(RESET_COLOR);
+    exit(-1);
+  }
+
+  return retval;
+}
+
+void* mRealloc(void* memory, size_t size, char* filePath, int lineNumber)
+{
+#ifdef COUNT_MEMORY_ALLOCATIONS
+  g_num_memory_allocations++;
+#endif
+  void* retval = realloc(memory, size);
+  if (retval == NULL)
+  {
+    printf(FG_RED);
+    printf("realloc failed to allocate %llu byte(s) at %s:%d\n", (unsigned long long)size, filePath, lineNumber);
     printf(RESET_COLOR);
     exit(-1);
   }
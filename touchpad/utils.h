@@ -1,12 +1,44 @@
 #ifndef __UTILS_H__
 #define __UTILS_H__
-#include <Windows.h>
+#include "platform.h"
 
+#ifdef _WIN32
 #include <hidusage.h>
 #include <hidpi.h>
 #pragma comment(lib, "hid.lib")
 
 #include <tchar.h>
+#else
+// the preparsed data is only used as an opaque blob outside of Windows
+typedef void* PHIDP_PREPARSED_DATA;
+
+// the subset of hidusage.h that the portable modules use
+typedef USHORT USAGE;
+
+#define HID_USAGE_PAGE_GENERIC   ((USAGE)0x01)
+#define HID_USAGE_PAGE_DIGITIZER ((USAGE)0x0D)
+
+#define HID_USAGE_GENERIC_X ((USAGE)0x30)
+#define HID_USAGE_GENERIC_Y ((USAGE)0x31)
+
+#define HID_USAGE_DIGITIZER_TOUCH_PAD    ((USAGE)0x05)
+#define HID_USAGE_DIGITIZER_TIP_PRESSURE ((USAGE)0x30)
+#define HID_USAGE_DIGITIZER_TIP_SWITCH   ((USAGE)0x42)
+#endif
+
+// https://docs.microsoft.com/en-us/windows-hardware/design/component-guidelines/supporting-usages-in-multitouch-digitizer-drivers
+
+// Digitizer Page (0x0D)
+//
+#define HID_USAGE_DIGITIZER_CONFIDENCE            ((USAGE)0x47)
+#define HID_USAGE_DIGITIZER_WIDTH                 ((USAGE)0x48)
+#define HID_USAGE_DIGITIZER_HEIGHT                ((USAGE)0x49)
+#define HID_USAGE_DIGITIZER_CONTACT_ID            ((USAGE)0x51)
+#define HID_USAGE_DIGITIZER_CONTACT_COUNT         ((USAGE)0x54)
+#define HID_USAGE_DIGITIZER_CONTACT_COUNT_MAXIMUM ((USAGE)0x55)
+
+#include "hashindex.h"
+#include "hiddecoder.h"
 
 struct HID_TOUCH_LINK_COL_INFO
 {
@@ -34,11 +66,14 @@ struct HID_LINK_COL_INFO_LIST
 {
   HID_TOUCH_LINK_COL_INFO* Entries;
   unsigned int Size;
+  unsigned int Capacity;
+  // LinkColID -> index into Entries
+  HASH_INDEX LinkColIndex;
 };
 
 typedef struct HID_LINK_COL_INFO_LIST HID_LINK_COL_INFO_LIST;
 
-// C doesn't have map or dictionary so we are going to use array of struct to replace that
+// C doesn't have map or dictionary so we are going to use array of struct with a hash index to replace that
 struct HID_DEVICE_INFO
 {
   TCHAR* Name;
@@ -47,6 +82,11 @@ struct HID_DEVICE_INFO
   PHIDP_PREPARSED_DATA PreparedData;
   UINT cbPreparsedData;
   USHORT ContactCountLinkCollection;
+  HID_TOUCH_DECODE_PLAN DecodePlan;
+  // a hybrid frame can continue in the next WM_INPUT message of the device
+  HID_TOUCH_DECODE_STATE DecodeState;
+  // the input thread reports a device without a valid decode plan only once
+  int HasReportedInvalidDecodePlan;
 };
 
 typedef struct HID_DEVICE_INFO HID_DEVICE_INFO;
@@ -55,17 +95,30 @@ struct HID_DEVICE_INFO_LIST
 {
   HID_DEVICE_INFO* Entries;
   unsigned int Size;
+  unsigned int Capacity;
+  // hash of the device name -> index into Entries
+  HASH_INDEX NameIndex;
 };
 
 typedef struct HID_DEVICE_INFO_LIST HID_DEVICE_INFO_LIST;
 
+#ifdef _WIN32
 void mGetLastError();
 
 void print_HidP_errors(NTSTATUS hidpReturnCode, const char* filePath, int lineNumber);
+#endif
+
+// returns -1 if there is no device with the name in the list
+int LookupInputDeviceInList(HID_DEVICE_INFO_LIST* hidInfoList, TCHAR* deviceName, unsigned int* foundHidIndex);
 
+// find the device or add it to the list if it is not there yet
 int FindInputDeviceInList(HID_DEVICE_INFO_LIST* hidInfoList, TCHAR* deviceName, const unsigned int cbDeviceName, PHIDP_PREPARSED_DATA preparsedData, const UINT cbPreparsedData, unsigned int* foundHidIndex);
 
 int FindLinkCollectionInList(HID_LINK_COL_INFO_LIST* linkColInfoList, USHORT linkCollection, unsigned int* foundLinkColIdx);
 
 void* mMalloc(size_t size, char* filePath, int lineNumber);
+void* mRealloc(void* memory, size_t size, char* filePath, int lineNumber);
+// Number of mMalloc and mRealloc calls so far. The calls are only counted
+// (not thread safe) when COUNT_MEMORY_ALLOCATIONS is defined, 0 otherwise.
+unsigned long long mGetNumMemoryAllocations();
 #endif  // __UTILS_H__
@@ -0,0 +1,253 @@
+#include "platform.h"
+
+#include <stdio.h>
+
+#include "workpool.h"
+
+#include "utils.h"
+#include "termcolor.h"
+
+#define WORK_POOL_DEQUE_MASK (WORK_POOL_DEQUE_CAPACITY - 1)
+
+// owner only: returns -1 if the deque is full
+static int mPushWorkItem(WORK_DEQUE* deque, const WORK_ITEM* item)
+{
+  unsigned int bottom = mAtomicLoadAcquire(&deque->Bottom);
+  unsigned int top    = mAtomicLoadAcquire(&deque->Top);
+
+  if ((bottom - top) >= WORK_POOL_DEQUE_CAPACITY)
+  {
+    return -1;
+  }
+
+  deque->Items[bottom & WORK_POOL_DEQUE_MASK] = (*item);
+  mAtomicStoreRelease(&deque->Bottom, bottom + 1);
+
+  return 0;
+}
+
+// owner only: take the item that was pushed last, returns -1 if the deque is empty
+static int mPopWorkItem(WORK_DEQUE* deque, WORK_ITEM* item)
+{
+  unsigned int bottom = mAtomicLoadAcquire(&deque->Bottom) - 1;
+  mAtomicStoreRelease(&deque->Bottom, bottom);
+  // the thieves must see the new Bottom before we read Top
+  mAtomicFullBarrier();
+  unsigned int top = mAtomicLoadAcquire(&deque->Top);
+
+  if ((int)(bottom - top) < 0)
+  {
+    mAtomicStoreRelease(&deque->Bottom, bottom + 1);
+    return -1;
+  }
+
+  (*item) = deque->Items[bottom & WORK_POOL_DEQUE_MASK];
+  if (bottom != top)
+  {
+    return 0;
+  }
+
+  // the last item, the thieves may be racing us for it
+  int isTaken = (mAtomicCompareExchange(&deque->Top, top, top + 1) == top);
+  mAtomicStoreRelease(&deque->Bottom, bottom + 1);
+
+  return isTaken ? 0 : -1;
+}
+
+// any thread: take the item that was pushed first, returns -1 if the deque is empty or another thread was faster
+static int mStealWorkItem(WORK_DEQUE* deque, WORK_ITEM* item)
+{
+  unsigned int top = mAtomicLoadAcquire(&deque->Top);
+  mAtomicFullBarrier();
+  unsigned int bottom = mAtomicLoadAcquire(&deque->Bottom);
+
+  if ((int)(bottom - top) <= 0)
+  {
+    return -1;
+  }
+
+  (*item) = deque->Items[top & WORK_POOL_DEQUE_MASK];
+
+  return (mAtomicCompareExchange(&deque->Top, top, top + 1) == top) ? 0 : -1;
+}
+
+// pop from our own deque or steal from the others starting at a random one
+static int mFindWorkItem(WORK_POOL* pool, unsigned int workerIdx, WORK_ITEM* item)
+{
+  int retval = mPopWorkItem(&pool->Deques[workerIdx], item);
+
+  if ((retval != 0) && (pool->NumThreads > 1))
+  {
+    WORK_POOL_WORKER* worker = &pool->Workers[workerIdx];
+    worker->RandomState      = (worker->RandomState * 1103515245u) + 12345u;
+    unsigned int firstVictim = (worker->RandomState >> 16) % pool->NumThreads;
+
+    for (unsigned int victimIdx = 0; (victimIdx < pool->NumThreads) && (retval != 0); victimIdx++)
+    {
+      unsigned int victim = (firstVictim + victimIdx) % pool->NumThreads;
+      if (victim != workerIdx)
+      {
+        retval = mStealWorkItem(&pool->Deques[victim], item);
+      }
+    }
+  }
+
+  if (retval == 0)
+  {
+    mAtomicAdd(&pool->NumQueuedItems, (unsigned int)-1);
+  }
+
+  return retval;
+}
+
+static void mRunWorkItem(WORK_POOL* pool, unsigned int workerIdx, const WORK_ITEM* item)
+{
+  item->Proc(pool, workerIdx, item->Arg);
+  mAtomicAdd(&item->Group->NumPending, (unsigned int)-1);
+}
+
+static void mWorkPoolThread(void* arg)
+{
+  WORK_POOL_WORKER* worker = (WORK_POOL_WORKER*)arg;
+  WORK_POOL* pool          = worker->Pool;
+  unsigned int numSpins    = 0;
+
+  while (!mAtomicLoadAcquire(&pool->IsStopping))
+  {
+    WORK_ITEM item;
+    if (mFindWorkItem(pool, worker->WorkerIdx, &item) == 0)
+    {
+      mRunWorkItem(pool, worker->WorkerIdx, &item);
+      numSpins = 0;
+      continue;
+    }
+
+    numSpins++;
+    if (numSpins < WORK_POOL_SPIN_COUNT)
+    {
+      mYieldThread();
+      continue;
+    }
+
+    // mSubmitWork increments NumQueuedItems before it reads NumSleepingWorkers,
+    // we do the opposite so that one of us sees the other
+    mLockThreadMutex(&pool->Mutex);
+    mAtomicAdd(&pool->NumSleepingWorkers, 1);
+    if ((mAtomicLoadAcquire(&pool->NumQueuedItems) == 0) && !mAtomicLoadAcquire(&pool->IsStopping))
+    {
+      mWaitThreadCondition(&pool->WorkCondition, &pool->Mutex, WORK_POOL_SLEEP_MILLISECONDS);
+    }
+    mAtomicAdd(&pool->NumSleepingWorkers, (unsigned int)-1);
+    mUnlockThreadMutex(&pool->Mutex);
+
+    numSpins = 0;
+  }
+}
+
+void mInitializeWorkPool(WORK_POOL* pool, unsigned int numThreads)
+{
+  if (numThreads == 0)
+  {
+    numThreads = mGetNumProcessors();
+  }
+
+  if (numThreads > WORK_POOL_MAX_THREADS)
+  {
+    numThreads = WORK_POOL_MAX_THREADS;
+  }
+
+  memset(pool, 0, sizeof(WORK_POOL));
+  pool->NumThreads = numThreads;
+  pool->Deques     = (WORK_DEQUE*)mMalloc(sizeof(WORK_DEQUE) * numThreads, __FILE__, __LINE__);
+  pool->Workers    = (WORK_POOL_WORKER*)mMalloc(sizeof(WORK_POOL_WORKER) * numThreads, __FILE__, __LINE__);
+  memset(pool->Deques, 0, sizeof(WORK_DEQUE) * numThreads);
+  memset(pool->Workers, 0, sizeof(WORK_POOL_WORKER) * numThreads);
+
+  mInitializeThreadMutex(&pool->Mutex);
+  mInitializeThreadCondition(&pool->WorkCondition);
+
+  for (unsigned int workerIdx = 0; workerIdx < numThreads; workerIdx++)
+  {
+    WORK_POOL_WORKER* worker = &pool->Workers[workerIdx];
+    worker->Pool             = pool;
+    worker->WorkerIdx        = workerIdx;
+    worker->RandomState      = (workerIdx * 2654435761u) + 1;
+
+    // worker 0 is the calling thread
+    if ((workerIdx != 0) && (mCreateThread(&worker->Thread, mWorkPoolThread, worker) != 0))
+    {
+      printf(FG_RED);
+      printf("Failed to start the worker threads at %s:%d\n", __FILE__, __LINE__);
+      printf(RESET_COLOR);
+      exit(-1);
+    }
+  }
+}
+
+void mFreeWorkPool(WORK_POOL* pool)
+{
+  mLockThreadMutex(&pool->Mutex);
+  mAtomicStoreRelease(&pool->IsStopping, 1);
+  mBroadcastThreadCondition(&pool->WorkCondition);
+  mUnlockThreadMutex(&pool->Mutex);
+
+  for (unsigned int workerIdx = 1; workerIdx < pool->NumThreads; workerIdx++)
+  {
+    mJoinThread(&pool->Workers[workerIdx].Thread);
+  }
+
+  mDestroyThreadCondition(&pool->WorkCondition);
+  mDestroyThreadMutex(&pool->Mutex);
+  free(pool->Deques);
+  free(pool->Workers);
+  memset(pool, 0, sizeof(WORK_POOL));
+}
+
+void mInitializeWorkGroup(WORK_GROUP* group)
+{
+  group->NumPending = 0;
+}
+
+void mSubmitWork(WORK_POOL* pool, unsigned int workerIdx, WORK_GROUP* group, WORK_PROC proc, void* arg)
+{
+  WORK_ITEM item = {.Proc = proc, .Arg = arg, .Group = group};
+  mAtomicAdd(&group->NumPending, 1);
+
+  if (pool->NumThreads == 1)
+  {
+    mRunWorkItem(pool, workerIdx, &item);
+    return;
+  }
+
+  // counted before it is visible so that the count never drops below 0
+  mAtomicAdd(&pool->NumQueuedItems, 1);
+  if (mPushWorkItem(&pool->Deques[workerIdx], &item) != 0)
+  {
+    mAtomicAdd(&pool->NumQueuedItems, (unsigned int)-1);
+    mRunWorkItem(pool, workerIdx, &item);
+    return;
+  }
+
+  if (mAtomicLoadAcquire(&pool->NumSleepingWorkers) != 0)
+  {
+    mLockThreadMutex(&pool->Mutex);
+    mSignalThreadCondition(&pool->WorkCondition);
+    mUnlockThreadMutex(&pool->Mutex);
+  }
+}
+
+void mWaitForWorkGroup(WORK_POOL* pool, unsigned int workerIdx, WORK_GROUP* group)
+{
+  while (mAtomicLoadAcquire(&group->NumPending) != 0)
+  {
+    WORK_ITEM item;
+    if (mFindWorkItem(pool, workerIdx, &item) == 0)
+    {
+      mRunWorkItem(pool, workerIdx, &item);
+    }
+    else
+    {
+      mYieldThread();
+    }
+  }
+}
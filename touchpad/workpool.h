@@ -0,0 +1,94 @@
+#ifndef __WORKPOOL_H__
+#define __WORKPOOL_H__
+#include "platform.h"
+
+#include "threading.h"
+
+#define WORK_POOL_MAX_THREADS 64
+// work items that a worker can have queued, must be a power of 2
+#define WORK_POOL_DEQUE_CAPACITY 1024
+// the workers look for work this many times before they go to sleep
+#define WORK_POOL_SPIN_COUNT 64
+// a sleeping worker looks for work again after this long even without a signal
+#define WORK_POOL_SLEEP_MILLISECONDS 10
+#define WORK_POOL_CACHE_LINE_SIZE 64
+
+struct WORK_POOL;
+
+// workerIdx is the worker that runs the item, it can be used to submit more
+// items or to index per worker scratch memory
+typedef void (*WORK_PROC)(struct WORK_POOL* pool, unsigned int workerIdx, void* arg);
+
+// counts the items of a group that have not finished yet
+struct WORK_GROUP
+{
+  volatile unsigned int NumPending;
+};
+
+typedef struct WORK_GROUP WORK_GROUP;
+
+struct WORK_ITEM
+{
+  WORK_PROC Proc;
+  void* Arg;
+  WORK_GROUP* Group;
+};
+
+typedef struct WORK_ITEM WORK_ITEM;
+
+// Chase-Lev deque: the owner pushes and pops at Bottom, the other workers steal at Top.
+struct WORK_DEQUE
+{
+  volatile unsigned int Top;
+  BYTE Padding0[WORK_POOL_CACHE_LINE_SIZE - sizeof(unsigned int)];
+  volatile unsigned int Bottom;
+  BYTE Padding1[WORK_POOL_CACHE_LINE_SIZE - sizeof(unsigned int)];
+  WORK_ITEM Items[WORK_POOL_DEQUE_CAPACITY];
+};
+
+typedef struct WORK_DEQUE WORK_DEQUE;
+
+struct WORK_POOL_WORKER
+{
+  struct WORK_POOL* Pool;
+  unsigned int WorkerIdx;
+  // state of the random victim selection
+  unsigned int RandomState;
+  THREAD_HANDLE Thread;
+};
+
+typedef struct WORK_POOL_WORKER WORK_POOL_WORKER;
+
+// A pool of NumThreads - 1 threads plus the thread that created it. Every
+// worker has its own deque and takes its work from the bottom, an idle worker
+// steals from the top of the deque of a random other worker so that the items
+// that were submitted first (usually the largest) are handed out first.
+//
+// Worker 0 is the thread that created the pool (e.g. the UI thread). It is the
+// only thread outside the pool that may submit items and it helps with the
+// work while it waits for a group. With NumThreads == 1 the items run inline.
+struct WORK_POOL
+{
+  WORK_DEQUE* Deques;
+  WORK_POOL_WORKER* Workers;
+  unsigned int NumThreads;
+
+  // items in the deques, the workers sleep when it is 0
+  volatile unsigned int NumQueuedItems;
+  volatile unsigned int NumSleepingWorkers;
+  volatile unsigned int IsStopping;
+  THREAD_MUTEX Mutex;
+  THREAD_CONDITION WorkCondition;
+};
+
+typedef struct WORK_POOL WORK_POOL;
+
+// numThreads includes the calling thread, 0 uses one thread per processor
+void mInitializeWorkPool(WORK_POOL* pool, unsigned int numThreads);
+void mFreeWorkPool(WORK_POOL* pool);
+void mInitializeWorkGroup(WORK_GROUP* group);
+// Queue an item on the deque of workerIdx (the caller), it runs at once if the deque is full.
+void mSubmitWork(WORK_POOL* pool, unsigned int workerIdx, WORK_GROUP* group, WORK_PROC proc, void* arg);
+// Run and steal items until every item of the group has finished.
+void mWaitForWorkGroup(WORK_POOL* pool, unsigned int workerIdx, WORK_GROUP* group);
+#endif  // __WORKPOOL_H__